@@ -0,0 +1,72 @@
+/**
+ * Benchmark: Native Frame Accessors
+ *
+ * VideoFrame._fromNative reads `format` and `colorSpace` from the native
+ * frame for every decoded frame. This measures the cost of those reads and
+ * how much heap they leave behind for the garbage collector.
+ *
+ * Run it before and after a change to the accessors and compare the
+ * ns/read and bytes/read columns.
+ */
+
+import { VideoFrame } from '../src/VideoFrame';
+
+const WIDTH = 320;
+const HEIGHT = 240;
+const READS = 1_000_000;
+
+function createTestFrame(): VideoFrame {
+  const ySize = WIDTH * HEIGHT;
+  const buffer = Buffer.alloc(ySize + (ySize / 4) * 2, 128);
+  return new VideoFrame(buffer, {
+    format: 'I420',
+    codedWidth: WIDTH,
+    codedHeight: HEIGHT,
+    timestamp: 0,
+  });
+}
+
+function measure(label: string, read: () => unknown): void {
+  // Warm up so the accessor is optimised before timing
+  for (let i = 0; i < 10_000; i++) read();
+
+  global.gc?.();
+  const heapBefore = process.memoryUsage().heapUsed;
+  const start = process.hrtime.bigint();
+  let sink: unknown;
+  for (let i = 0; i < READS; i++) {
+    sink = read();
+  }
+  const elapsedNs = Number(process.hrtime.bigint() - start);
+  const heapAfter = process.memoryUsage().heapUsed;
+  void sink;
+
+  console.log(
+    label.padEnd(16) +
+    (elapsedNs / READS).toFixed(1).padStart(12) +
+    ((heapAfter - heapBefore) / READS).toFixed(2).padStart(14)
+  );
+}
+
+function main(): void {
+  const frame = createTestFrame();
+  const native = frame._getNative();
+  if (!native) {
+    console.log('Native addon not available');
+    return;
+  }
+  if (!global.gc) {
+    console.log('Run with --expose-gc for stable heap numbers');
+  }
+
+  console.log(`${READS} reads of a ${WIDTH}x${HEIGHT} I420 frame`);
+  console.log('');
+  console.log('Accessor'.padEnd(16) + 'ns/read'.padStart(12) + 'bytes/read'.padStart(14));
+  console.log('-'.repeat(42));
+  measure('format', () => native.format);
+  measure('colorSpace', () => native.colorSpace);
+
+  frame.close();
+}
+
+main();
@@ -0,0 +1,220 @@
+/**
+ * Benchmark: Glass-to-Glass Realtime Latency
+ *
+ * Pushes timestamped synthetic frames at a live pace through the
+ * worker-thread encoder (latencyMode 'realtime') and straight into the
+ * worker-thread decoder (optimizeForLatency), the way a low-latency relay
+ * or a loopback call would. Each frame's latency is split into stages:
+ *
+ *   queue     encode() until the encoder worker picked the frame up
+ *   convert   orientation/tone mapping/LUT and pixel format conversion
+ *   encode    frame sent to the codec until its packet came out
+ *   delivery  packet out until the output callback ran on the JS thread
+ *   decode    decode() until the decoded frame reached its callback
+ *   total     frame captured until it was decoded
+ *
+ * The first four come from the encoder's `stageTimings` metadata; decode
+ * and total are measured here. The table shows p50/p99/p99.9 per codec,
+ * in milliseconds. p99.9 needs at least 1000 frames to mean anything.
+ *
+ * Run with: FRAMES=1200 npx ts-node benchmark/glass-to-glass-latency.ts
+ */
+
+import { VideoEncoder, VideoEncoderStageTimings } from '../src/VideoEncoder';
+import { VideoDecoder } from '../src/VideoDecoder';
+import { VideoFrame } from '../src/VideoFrame';
+
+const WIDTH = 1280;
+const HEIGHT = 720;
+const FPS = 60;
+const FRAME_COUNT = Number(process.env.FRAMES ?? 1200);
+const WARMUP_FRAMES = 30;  // Encoder start-up, excluded from the results
+const PATTERNS = 16;
+
+const CODECS = ['avc1.42001f', 'vp8', 'vp09.00.10.08', 'av01.0.04M.08'];
+const STAGES = ['queue', 'convert', 'encode', 'delivery', 'decode', 'total'] as const;
+type Stage = typeof STAGES[number];
+
+interface FrameRecord {
+  capturedNs: bigint;
+  stageTimings?: VideoEncoderStageTimings;
+  decodeCalledNs?: bigint;
+  decodedNs?: bigint;
+}
+
+interface CodecResult {
+  codec: string;
+  frames: number;
+  samples: Record<Stage, number[]>;
+  error?: string;
+}
+
+// Moving gradients with some noise, so every frame has real work for the encoder
+function createPatterns(): Uint8Array[] {
+  const ySize = WIDTH * HEIGHT;
+  const uvSize = (WIDTH / 2) * (HEIGHT / 2);
+  const patterns: Uint8Array[] = [];
+  for (let p = 0; p < PATTERNS; p++) {
+    const buffer = new Uint8Array(ySize + uvSize * 2);
+    for (let y = 0; y < HEIGHT; y++) {
+      for (let x = 0; x < WIDTH; x++) {
+        const noise = (Math.imul(x * 73856093 ^ y * 19349663 ^ p * 83492791, 2654435761) >>> 27);
+        buffer[y * WIDTH + x] = (x + y + p * 8 + noise) & 0xff;
+      }
+    }
+    buffer.fill(96 + p * 4, ySize, ySize + uvSize);
+    buffer.fill(160 - p * 4, ySize + uvSize);
+    patterns.push(buffer);
+  }
+  return patterns;
+}
+
+function elapsedMs(from: bigint, to: bigint): number {
+  return Number(to - from) / 1e6;
+}
+
+function percentile(sorted: number[], p: number): number {
+  if (sorted.length === 0) return NaN;
+  const index = Math.min(sorted.length - 1, Math.floor((p / 100) * sorted.length));
+  return sorted[index];
+}
+
+async function runCodec(codec: string, patterns: Uint8Array[]): Promise<CodecResult> {
+  const records = new Map<number, FrameRecord>();
+  let failure: unknown = null;
+  let decoderConfigured = false;
+
+  const decoder = new VideoDecoder({
+    output: (frame) => {
+      const record = records.get(frame.timestamp);
+      if (record) record.decodedNs = process.hrtime.bigint();
+      frame.close();
+    },
+    error: (err) => { failure = err; },
+  });
+
+  const encoder = new VideoEncoder({
+    output: (chunk, metadata) => {
+      const record = records.get(chunk.timestamp);
+      if (record) record.stageTimings = metadata?.stageTimings;
+
+      if (!decoderConfigured) {
+        if (!metadata?.decoderConfig) return;
+        decoder.configure({ ...metadata.decoderConfig, optimizeForLatency: true, useWorkerThread: true });
+        decoderConfigured = true;
+      }
+      if (record) record.decodeCalledNs = process.hrtime.bigint();
+      decoder.decode(chunk);
+    },
+    error: (err) => { failure = err; },
+  });
+
+  encoder.configure({
+    codec,
+    width: WIDTH,
+    height: HEIGHT,
+    bitrate: 2_500_000,
+    framerate: FPS,
+    latencyMode: 'realtime',
+    useWorkerThread: true,
+    stageTimings: true,
+  });
+
+  // Live pace: frame i is captured at start + i / FPS, whatever the previous frame cost
+  const intervalNs = BigInt(Math.round(1e9 / FPS));
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < FRAME_COUNT && !failure; i++) {
+    const due = start + BigInt(i) * intervalNs;
+    const waitMs = elapsedMs(process.hrtime.bigint(), due);
+    if (waitMs > 0) {
+      await new Promise((r) => setTimeout(r, waitMs));
+    } else {
+      await new Promise((r) => setImmediate(r));  // Let outputs run even when behind
+    }
+
+    const timestamp = Math.round((i * 1e6) / FPS);
+    const frame = new VideoFrame(patterns[i % PATTERNS], {
+      format: 'I420',
+      codedWidth: WIDTH,
+      codedHeight: HEIGHT,
+      timestamp,
+    });
+    records.set(timestamp, { capturedNs: process.hrtime.bigint() });
+    encoder.encode(frame, { keyFrame: i === 0 });
+    frame.close();
+  }
+
+  await encoder.flush();
+  if (decoderConfigured) await decoder.flush();
+  encoder.close();
+  decoder.close();
+  if (failure) throw failure;
+
+  const samples = Object.fromEntries(STAGES.map((s) => [s, [] as number[]])) as Record<Stage, number[]>;
+  let index = 0;
+  for (const record of records.values()) {
+    if (index++ < WARMUP_FRAMES || record.decodedNs === undefined) continue;
+    const timings = record.stageTimings;
+    if (timings) {
+      samples.queue.push(timings.queueUs / 1000);
+      samples.convert.push(timings.convertUs / 1000);
+      samples.encode.push(timings.encodeUs / 1000);
+      samples.delivery.push(timings.deliveryUs / 1000);
+    }
+    if (record.decodeCalledNs !== undefined) {
+      samples.decode.push(elapsedMs(record.decodeCalledNs, record.decodedNs));
+    }
+    samples.total.push(elapsedMs(record.capturedNs, record.decodedNs));
+  }
+  for (const stage of STAGES) {
+    samples[stage].sort((a, b) => a - b);
+  }
+  return { codec, frames: samples.total.length, samples };
+}
+
+function report(result: CodecResult): void {
+  console.log('');
+  if (result.error) {
+    console.log(`${result.codec}: skipped (${result.error})`);
+    return;
+  }
+  console.log(`${result.codec} (${result.frames} frames measured)`);
+  console.log('-'.repeat(46));
+  console.log('Stage'.padEnd(16) + 'p50 ms'.padStart(10) + 'p99 ms'.padStart(10) + 'p99.9 ms'.padStart(10));
+  console.log('-'.repeat(46));
+  for (const stage of STAGES) {
+    const sorted = result.samples[stage];
+    console.log(
+      stage.padEnd(16) +
+      percentile(sorted, 50).toFixed(2).padStart(10) +
+      percentile(sorted, 99).toFixed(2).padStart(10) +
+      percentile(sorted, 99.9).toFixed(2).padStart(10)
+    );
+  }
+}
+
+async function main() {
+  console.log('='.repeat(60));
+  console.log('Glass-to-Glass Realtime Latency Benchmark');
+  console.log('='.repeat(60));
+  console.log(`Resolution: ${WIDTH}x${HEIGHT} at ${FPS} fps, ${FRAME_COUNT} frames per codec`);
+  console.log(`Encoder: worker thread, realtime; decoder: worker thread, optimizeForLatency`);
+
+  const patterns = createPatterns();
+  for (const codec of CODECS) {
+    let result: CodecResult;
+    try {
+      result = await runCodec(codec, patterns);
+    } catch (e) {
+      result = {
+        codec,
+        frames: 0,
+        samples: {} as Record<Stage, number[]>,
+        error: (e as Error).message,
+      };
+    }
+    report(result);
+  }
+}
+
+main().catch(console.error);
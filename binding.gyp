@@ -15,7 +15,18 @@
         "native/hw_accel.cpp",
         "native/image_decoder.cpp",
         "native/color.cpp",
-        "native/svc.cpp"
+        "native/svc.cpp",
+        "native/tonemap.cpp",
+        "native/transform.cpp",
+        "native/lut3d.cpp",
+        "native/compositor.cpp",
+        "native/analysis.cpp",
+        "native/loudness.cpp",
+        "native/encode_cache.cpp",
+        "native/smart_render.cpp",
+        "native/heif.cpp",
+        "native/frame_rate.cpp",
+        "native/audio_batch.cpp"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
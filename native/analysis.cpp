@@ -0,0 +1,291 @@
+#include "analysis.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ANALYSIS_SSE2 1
+#endif
+
+namespace FrameAnalysis {
+
+namespace {
+
+// Where luma comes from: the Y component, or 8-bit R/G/B weighted per BT.709
+struct LumaSource {
+    bool rgb;
+    int plane[3];
+    int offset[3];
+    int step;      // Bytes between pixels
+    int shift;     // Right shift from the stored value to 8 bits
+    bool wide;     // 16-bit storage
+};
+
+bool describe(AVPixelFormat format, LumaSource& src) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM |
+                                 AV_PIX_FMT_FLAG_BE | AV_PIX_FMT_FLAG_FLOAT))) {
+        return false;
+    }
+
+    src.rgb = (desc->flags & AV_PIX_FMT_FLAG_RGB) != 0;
+    const int components = src.rgb ? 3 : 1;
+    if (desc->nb_components < components) {
+        return false;
+    }
+
+    const AVComponentDescriptor& first = desc->comp[0];
+    src.step = first.step;
+    src.wide = first.depth > 8;
+    src.shift = first.shift + first.depth - 8;
+    for (int c = 0; c < components; c++) {
+        const AVComponentDescriptor& comp = desc->comp[c];
+        if (comp.depth != first.depth || comp.step != first.step || comp.shift != first.shift) {
+            return false;
+        }
+        src.plane[c] = comp.plane;
+        src.offset[c] = comp.offset;
+    }
+    // RGB is only read at 8 bits; wide luma must sit in a 16-bit word
+    if (src.rgb ? first.depth != 8 : (first.depth < 8 || first.depth > 16)) {
+        return false;
+    }
+    return true;
+}
+
+// Read every `stride`th luma sample of source row y into dst
+void gatherRow(const AVFrame* frame, const LumaSource& src, int y, int stride, uint8_t* dst, int count) {
+    const ptrdiff_t pitch = static_cast<ptrdiff_t>(stride) * src.step;
+    if (src.rgb) {
+        const uint8_t* r = frame->data[src.plane[0]] + y * frame->linesize[src.plane[0]] + src.offset[0];
+        const uint8_t* g = frame->data[src.plane[1]] + y * frame->linesize[src.plane[1]] + src.offset[1];
+        const uint8_t* b = frame->data[src.plane[2]] + y * frame->linesize[src.plane[2]] + src.offset[2];
+        for (int x = 0; x < count; x++) {
+            const ptrdiff_t o = x * pitch;
+            dst[x] = static_cast<uint8_t>((54 * r[o] + 183 * g[o] + 19 * b[o] + 128) >> 8);
+        }
+        return;
+    }
+
+    const uint8_t* row = frame->data[src.plane[0]] + y * frame->linesize[src.plane[0]] + src.offset[0];
+    if (src.wide) {
+        for (int x = 0; x < count; x++) {
+            uint16_t v;
+            memcpy(&v, row + x * pitch, sizeof(v));
+            dst[x] = static_cast<uint8_t>(std::min(v >> src.shift, 255));
+        }
+    } else if (pitch == 1) {
+        memcpy(dst, row, count);
+    } else {
+        for (int x = 0; x < count; x++) {
+            dst[x] = row[x * pitch];
+        }
+    }
+}
+
+struct Partial {
+    uint32_t histogram[4][256];  // Interleaved so repeated values do not serialize
+    uint64_t sum = 0;
+    uint64_t sumSquares = 0;
+    uint64_t black = 0;
+    uint64_t absDiff = 0;
+};
+
+#ifdef ANALYSIS_SSE2
+uint64_t sumLanes(__m128i v) {
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v);
+    return lanes[0] + lanes[1];
+}
+#endif
+
+// Sums over a contiguous row, 16 samples at a time with SSE2 (SAD against
+// zero for the sum, madd for the squares, SAD against the previous row for
+// the difference); the tail and other targets use the plain loops
+void reduceRow(const uint8_t* row, const uint8_t* previous, int count, int blackCode, Partial& p) {
+    uint32_t sum = 0, sumSquares = 0, black = 0, absDiff = 0;
+    int x = 0;
+#ifdef ANALYSIS_SSE2
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i threshold = _mm_set1_epi8(static_cast<char>(blackCode));
+        __m128i vsum = zero, vsquares = zero, vblack = zero, vdiff = zero;
+        for (; x + 16 <= count; x += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+            vsum = _mm_add_epi64(vsum, _mm_sad_epu8(v, zero));
+            const __m128i lo = _mm_unpacklo_epi8(v, zero);
+            const __m128i hi = _mm_unpackhi_epi8(v, zero);
+            vsquares = _mm_add_epi32(vsquares, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+            // min(v, threshold) == v where v <= blackCode
+            const __m128i isBlack = _mm_cmpeq_epi8(_mm_min_epu8(v, threshold), v);
+            vblack = _mm_add_epi64(vblack, _mm_sad_epu8(_mm_and_si128(isBlack, one), zero));
+            if (previous) {
+                const __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + x));
+                vdiff = _mm_add_epi64(vdiff, _mm_sad_epu8(v, prev));
+            }
+        }
+        alignas(16) uint32_t squares[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(squares), vsquares);
+        sum = static_cast<uint32_t>(sumLanes(vsum));
+        sumSquares = squares[0] + squares[1] + squares[2] + squares[3];
+        black = static_cast<uint32_t>(sumLanes(vblack));
+        absDiff = static_cast<uint32_t>(sumLanes(vdiff));
+    }
+#endif
+    for (int i = x; i < count; i++) {
+        const uint32_t v = row[i];
+        sum += v;
+        sumSquares += v * v;
+        black += v <= static_cast<uint32_t>(blackCode);
+    }
+    p.sum += sum;
+    p.sumSquares += sumSquares;
+    p.black += black;
+
+    if (previous) {
+        for (int i = x; i < count; i++) {
+            absDiff += static_cast<uint32_t>(std::abs(static_cast<int>(row[i]) - static_cast<int>(previous[i])));
+        }
+        p.absDiff += absDiff;
+    }
+
+    for (x = 0; x + 4 <= count; x += 4) {
+        p.histogram[0][row[x]]++;
+        p.histogram[1][row[x + 1]]++;
+        p.histogram[2][row[x + 2]]++;
+        p.histogram[3][row[x + 3]]++;
+    }
+    for (; x < count; x++) {
+        p.histogram[0][row[x]]++;
+    }
+}
+
+}  // namespace
+
+bool isSupported(const AVFrame* frame) {
+    LumaSource src;
+    return frame && frame->data[0] && describe(static_cast<AVPixelFormat>(frame->format), src);
+}
+
+bool parseOptions(Napi::Value value, Options& options, std::string& error) {
+    if (!value.IsObject()) {
+        return true;  // `true` or omitted: defaults
+    }
+    Napi::Object obj = value.As<Napi::Object>();
+
+    if (obj.Has("blackThreshold") && !obj.Get("blackThreshold").IsUndefined()) {
+        Napi::Value v = obj.Get("blackThreshold");
+        double threshold = v.IsNumber() ? v.As<Napi::Number>().DoubleValue() : -1.0;
+        if (!(threshold >= 0.0 && threshold <= 1.0)) {
+            error = "blackThreshold must be between 0 and 1";
+            return false;
+        }
+        options.blackThreshold = threshold;
+    }
+    if (obj.Has("subsample") && !obj.Get("subsample").IsUndefined()) {
+        Napi::Value v = obj.Get("subsample");
+        double subsample = v.IsNumber() ? v.As<Napi::Number>().DoubleValue() : 0.0;
+        if (!(subsample >= 1 && subsample <= 8) || subsample != std::floor(subsample)) {
+            error = "subsample must be an integer from 1 to 8";
+            return false;
+        }
+        options.subsample = static_cast<int>(subsample);
+    }
+    return true;
+}
+
+Napi::Object toJS(Napi::Env env, const Stats& stats) {
+    Napi::Object obj = Napi::Object::New(env);
+
+    Napi::Uint32Array histogram = Napi::Uint32Array::New(env, stats.histogram.size());
+    std::copy(stats.histogram.begin(), stats.histogram.end(), histogram.Data());
+    obj.Set("histogram", histogram);
+    obj.Set("samples", Napi::Number::New(env, static_cast<double>(stats.samples)));
+    obj.Set("mean", Napi::Number::New(env, stats.mean));
+    obj.Set("variance", Napi::Number::New(env, stats.variance));
+    obj.Set("blackRatio", Napi::Number::New(env, stats.blackRatio));
+    obj.Set("diff", stats.hasDiff ? Napi::Number::New(env, stats.diff) : env.Null());
+    obj.Set("fullRange", Napi::Boolean::New(env, stats.fullRange));
+    return obj;
+}
+
+bool Analyzer::Analyze(const AVFrame* frame, Stats& stats) {
+    LumaSource src;
+    if (!frame || !frame->data[0] || !describe(static_cast<AVPixelFormat>(frame->format), src)) {
+        return false;
+    }
+
+    const int step = options_.subsample;
+    const int width = (frame->width + step - 1) / step;
+    const int height = (frame->height + step - 1) / step;
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    AVPixelFormat format = static_cast<AVPixelFormat>(frame->format);
+    stats.fullRange = src.rgb || frame->color_range == AVCOL_RANGE_JPEG ||
+                      format == AV_PIX_FMT_YUVJ420P || format == AV_PIX_FMT_YUVJ422P ||
+                      format == AV_PIX_FMT_YUVJ444P;
+    const double white = stats.fullRange ? 255.0 : 235.0;
+    const double black = stats.fullRange ? 0.0 : 16.0;
+    const int blackCode = static_cast<int>(std::lround(black + (white - black) * options_.blackThreshold));
+
+    const bool diff = previousWidth_ == width && previousHeight_ == height;
+    luma_.resize(static_cast<size_t>(width) * height);
+
+    Partial total;
+    memset(total.histogram, 0, sizeof(total.histogram));
+    std::mutex totalMutex;
+
+    // Sample and reduce in one pass per slice, while the rows are in cache
+    Parallel::forEachSlice(height, [&](int first, int end) {
+        Partial part;
+        memset(part.histogram, 0, sizeof(part.histogram));
+        for (int y = first; y < end; y++) {
+            uint8_t* row = luma_.data() + static_cast<size_t>(y) * width;
+            gatherRow(frame, src, y * step, step, row, width);
+            reduceRow(row, diff ? previous_.data() + static_cast<size_t>(y) * width : nullptr,
+                      width, blackCode, part);
+        }
+
+        std::lock_guard<std::mutex> lock(totalMutex);
+        for (int t = 0; t < 4; t++) {
+            for (int v = 0; v < 256; v++) {
+                total.histogram[t][v] += part.histogram[t][v];
+            }
+        }
+        total.sum += part.sum;
+        total.sumSquares += part.sumSquares;
+        total.black += part.black;
+        total.absDiff += part.absDiff;
+    });
+
+    const double n = static_cast<double>(width) * height;
+    for (int v = 0; v < 256; v++) {
+        stats.histogram[v] = total.histogram[0][v] + total.histogram[1][v] +
+                             total.histogram[2][v] + total.histogram[3][v];
+    }
+    stats.samples = static_cast<uint64_t>(width) * height;
+    stats.mean = total.sum / n;
+    stats.variance = std::max(0.0, total.sumSquares / n - stats.mean * stats.mean);
+    stats.blackRatio = total.black / n;
+    stats.hasDiff = diff;
+    stats.diff = diff ? total.absDiff / n : 0.0;
+
+    // This frame becomes the reference for the next one
+    luma_.swap(previous_);
+    previousWidth_ = width;
+    previousHeight_ = height;
+    return true;
+}
+
+}  // namespace FrameAnalysis
@@ -0,0 +1,70 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <napi.h>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+/**
+ * Per-frame luma statistics for QC: histogram, mean/variance, black-pixel
+ * ratio and the mean absolute difference from the previous frame.
+ *
+ * Luma is sampled on a grid (every Nth row and column) into a contiguous
+ * 8-bit plane. The reductions run over that plane, with rows split across
+ * threads. The plane is kept so the next frame can be diffed against it.
+ */
+namespace FrameAnalysis {
+
+struct Options {
+    // Pixels at or below this fraction of nominal white count as black
+    double blackThreshold = 0.1;
+    // Sample every Nth row and column (1-8)
+    int subsample = 2;
+};
+
+struct Stats {
+    std::array<uint32_t, 256> histogram;  // 8-bit luma codes
+    uint64_t samples = 0;
+    double mean = 0;       // 8-bit luma code
+    double variance = 0;
+    double blackRatio = 0;
+    double diff = 0;       // Mean absolute luma difference from the previous frame
+    bool hasDiff = false;
+    bool fullRange = false;
+};
+
+// Whether luma can be read from this frame's pixel format
+bool isSupported(const AVFrame* frame);
+
+// Read { blackThreshold?, subsample? }; false and a message on bad values
+bool parseOptions(Napi::Value value, Options& options, std::string& error);
+
+// { histogram: Uint32Array, mean, variance, blackRatio, diff, fullRange }
+Napi::Object toJS(Napi::Env env, const Stats& stats);
+
+class Analyzer {
+public:
+    explicit Analyzer(const Options& options) : options_(options) {}
+
+    // Analyze a frame; diff is against the frame passed to the previous call
+    bool Analyze(const AVFrame* frame, Stats& stats);
+    // Forget the previous frame (after a seek or reset)
+    void Reset() { previousWidth_ = previousHeight_ = 0; }
+
+private:
+    Options options_;
+    std::vector<uint8_t> luma_;
+    std::vector<uint8_t> previous_;
+    int previousWidth_ = 0;
+    int previousHeight_ = 0;
+};
+
+}  // namespace FrameAnalysis
+
+#endif
@@ -1,5 +1,6 @@
 #include "async_decoder.h"
 #include "frame.h"
+#include "lut3d.h"
 
 Napi::FunctionReference VideoDecoderAsync::constructor;
 
@@ -10,6 +11,12 @@ Napi::Object VideoDecoderAsync::Init(Napi::Env env, Napi::Object exports) {
         InstanceMethod("flush", &VideoDecoderAsync::Flush),
         InstanceMethod("reset", &VideoDecoderAsync::Reset),
         InstanceMethod("close", &VideoDecoderAsync::Close),
+        InstanceMethod("setBackpressure", &VideoDecoderAsync::SetBackpressure),
+        InstanceAccessor("queueDepth", &VideoDecoderAsync::GetQueueDepth, nullptr),
+        InstanceMethod("setPullMode", &VideoDecoderAsync::SetPullMode),
+        InstanceMethod("takeOutputs", &VideoDecoderAsync::TakeOutputs),
+        InstanceAccessor("droppedOutputs", &VideoDecoderAsync::GetDroppedOutputs, nullptr),
+        InstanceAccessor("decoderDelay", &VideoDecoderAsync::GetDecoderDelay, nullptr),
     });
 
     constructor = Napi::Persistent(func);
@@ -50,9 +57,10 @@ VideoDecoderAsync::VideoDecoderAsync(const Napi::CallbackInfo& info)
 }
 
 VideoDecoderAsync::~VideoDecoderAsync() {
-    // Signal worker to stop
+    // Signal worker to stop (and wake it if it is blocked on a full pull buffer)
     running_ = false;
-    queueCV_.notify_all();
+    jobs_.Wake();
+    pullOutputs_.Disable();
 
     // Wait for worker thread to finish
     if (workerThread_.joinable()) {
@@ -63,10 +71,12 @@ VideoDecoderAsync::~VideoDecoderAsync() {
     if (codecCtx_) {
         avcodec_free_context(&codecCtx_);
     }
+    FreeRenditions();
 
     // Release thread-safe functions
     tsfnOutput_.Release();
     tsfnError_.Release();
+    backpressure_.Release();
     if (tsfnFlush_) {
         tsfnFlush_.Release();
     }
@@ -83,6 +93,18 @@ void VideoDecoderAsync::Configure(const Napi::CallbackInfo& info) {
     Napi::Object config = info[0].As<Napi::Object>();
     std::string codecName = config.Get("codec").As<Napi::String>().Utf8Value();
 
+    // Reconfigure: chunks still queued are dropped as on reset() rather than
+    // decoded while JS waits, and the worker must be gone before its codec
+    // and renditions are freed
+    jobs_.Discard();
+    backpressure_.OnPop(0);
+    StopWorker();
+    AbortFlush();
+    if (codecCtx_) {
+        avcodec_free_context(&codecCtx_);
+    }
+    configured_ = false;
+
     // For H.264 decoding, use the decoder not encoder
     if (codecName == "libx264") {
         codecName = "h264";
@@ -142,6 +164,101 @@ void VideoDecoderAsync::Configure(const Napi::CallbackInfo& info) {
         memset(codecCtx_->extradata + extradata.Length(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
     }
 
+    // Carry packet tags through reordering so frames get their own timestamps
+    TimestampTable::ConfigureContext(codecCtx_);
+
+    // Resource limits: FFmpeg size checks plus the allocation hook
+    std::string limitsError;
+    if (!limits_.Parse(config.Get("limits"), limitsError)) {
+        avcodec_free_context(&codecCtx_);
+        codecCtx_ = nullptr;
+        Napi::TypeError::New(env, limitsError).ThrowAsJavaScriptException();
+        return;
+    }
+    limits_.Apply(codecCtx_);
+    awaitKeyframe_ = false;
+
+    // Latency mode: each frame thread adds a frame of delay, so decode
+    // with slice threads only and output pictures as soon as they are complete
+    optimizeForLatency_ = config.Has("optimizeForLatency") &&
+                          config.Get("optimizeForLatency").IsBoolean() &&
+                          config.Get("optimizeForLatency").As<Napi::Boolean>().Value();
+    if (optimizeForLatency_) {
+        codecCtx_->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        codecCtx_->thread_count = 0;  // Auto
+        codecCtx_->thread_type = FF_THREAD_SLICE;
+
+        if (strcmp(codec_->name, "libdav1d") == 0) {
+            // dav1d pipelines frames internally unless limited to one
+            av_opt_set_int(codecCtx_->priv_data, "max_frame_delay", 1, 0);
+        }
+    } else if (config.Has("intraOnly") && config.Get("intraOnly").IsBoolean() &&
+               config.Get("intraOnly").As<Napi::Boolean>().Value()) {
+        // Intra-only streams have no reordering and no references between
+        // frames, so frame threads decode pictures fully in parallel
+        codecCtx_->thread_count = 0;  // Auto
+        codecCtx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    }
+
+    // Color LUT stage (shared, parsed once by ColorLUT)
+    colorLut_.reset();
+    if (config.Has("colorLut") && !config.Get("colorLut").IsUndefined()) {
+        colorLut_ = ColorLutNative::FromValue(config.Get("colorLut"));
+        if (!colorLut_) {
+            Napi::TypeError::New(env, "colorLut must be a ColorLUT").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+
+    // Frame analysis stage: true or { blackThreshold, subsample }
+    analyzer_.reset();
+    if (config.Has("analysis") && !config.Get("analysis").IsUndefined() &&
+        !(config.Get("analysis").IsBoolean() && !config.Get("analysis").As<Napi::Boolean>().Value())) {
+        FrameAnalysis::Options options;
+        std::string error;
+        if (!FrameAnalysis::parseOptions(config.Get("analysis"), options, error)) {
+            Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+            return;
+        }
+        analyzer_.reset(new FrameAnalysis::Analyzer(options));
+    }
+    decoderDelay_ = 0;
+
+    // Additional renditions: [{ format, width, height, every }]
+    FreeRenditions();
+    if (config.Has("renditions") && config.Get("renditions").IsArray()) {
+        Napi::Array specs = config.Get("renditions").As<Napi::Array>();
+        for (uint32_t i = 0; i < specs.Length(); i++) {
+            if (!specs.Get(i).IsObject()) {
+                continue;
+            }
+            Napi::Object spec = specs.Get(i).As<Napi::Object>();
+
+            RenditionSpec rendition = { AV_PIX_FMT_NONE, 0, 0, 1, nullptr };
+            if (spec.Has("format") && spec.Get("format").IsString()) {
+                std::string format = spec.Get("format").As<Napi::String>().Utf8Value();
+                rendition.format = StringToPixelFormat(format);
+                if (rendition.format == AV_PIX_FMT_NONE) {
+                    avcodec_free_context(&codecCtx_);
+                    codecCtx_ = nullptr;
+                    Napi::TypeError::New(env, "Unsupported rendition format: " + format).ThrowAsJavaScriptException();
+                    return;
+                }
+            }
+            if (spec.Has("width") && spec.Get("width").IsNumber()) {
+                rendition.width = std::max(0, spec.Get("width").As<Napi::Number>().Int32Value());
+            }
+            if (spec.Has("height") && spec.Get("height").IsNumber()) {
+                rendition.height = std::max(0, spec.Get("height").As<Napi::Number>().Int32Value());
+            }
+            if (spec.Has("every") && spec.Get("every").IsNumber()) {
+                rendition.every = std::max(1, spec.Get("every").As<Napi::Number>().Int32Value());
+            }
+            renditions_.push_back(rendition);
+        }
+    }
+    framesDecoded_ = 0;
+
     // Open codec
     int ret = avcodec_open2(codecCtx_, codec_, nullptr);
     if (ret < 0) {
@@ -160,27 +277,35 @@ void VideoDecoderAsync::Configure(const Napi::CallbackInfo& info) {
     workerThread_ = std::thread(&VideoDecoderAsync::WorkerThread, this);
 }
 
-void VideoDecoderAsync::WorkerThread() {
-    while (running_) {
-        DecodeJob job;
-
-        {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            queueCV_.wait(lock, [this] {
-                return !jobQueue_.empty() || !running_;
-            });
-
-            if (!running_ && jobQueue_.empty()) {
-                break;
-            }
+void VideoDecoderAsync::StopWorker() {
+    if (!workerThread_.joinable()) {
+        return;
+    }
+    // JS cannot take pull-mode outputs while it waits here
+    stopping_ = true;
+    running_ = false;
+    jobs_.Wake();
+    workerThread_.join();
+    stopping_ = false;
+}
 
-            if (jobQueue_.empty()) {
-                continue;
-            }
+void VideoDecoderAsync::AbortFlush() {
+    // The flush job was discarded with the rest of the queue; settle its promise
+    if (!flushPending_ || !tsfnFlush_) {
+        return;
+    }
+    tsfnFlush_.NonBlockingCall([](Napi::Env env, Napi::Function fn) {
+        Napi::Error err = Napi::Error::New(env, "Flush aborted by configure()");
+        err.Set("name", Napi::String::New(env, "AbortError"));
+        fn.Call({ err.Value() });
+    });
+    flushPending_ = false;
+}
 
-            job = std::move(jobQueue_.front());
-            jobQueue_.pop();
-        }
+void VideoDecoderAsync::WorkerThread() {
+    DecodeJob job{};
+    while (jobs_.Pop(job, running_)) {
+        backpressure_.OnPop(jobs_.size());
 
         if (job.isFlush) {
             ProcessFlush();
@@ -195,86 +320,92 @@ void VideoDecoderAsync::ProcessDecode(DecodeJob& job) {
         return;
     }
 
+    if (job.rejectedBytes > 0) {
+        RecoverFromLimit(limits_.CheckChunk(job.rejectedBytes));
+        return;
+    }
+    if (awaitKeyframe_) {
+        if (!job.isKeyframe) {
+            return;
+        }
+        awaitKeyframe_ = false;
+    }
+
     // Create packet
     AVPacket* packet = av_packet_alloc();
     packet->data = job.data.data();
     packet->size = static_cast<int>(job.data.size());
-    packet->pts = job.timestamp;
-    packet->dts = job.timestamp;
     packet->duration = job.duration;
 
+    // Tag the packet; the decoder hands the tag back on whichever frame it produces
+    int64_t seq = timestamps_.Insert(job.timestamp, job.duration, job.userData, job.hasUserData);
+    TimestampTable::TagPacket(packet, seq);
+
     if (job.isKeyframe) {
         packet->flags |= AV_PKT_FLAG_KEY;
     }
 
+    // Decode first and emit afterwards, so a blocked consumer does not count
+    // against the time budget
+    limits_.BeginJob();
+    std::vector<AVFrame*> frames;
+    std::string error;
+
     // Send packet to decoder
     int ret = avcodec_send_packet(codecCtx_, packet);
     if (ret < 0) {
         char errBuf[256];
         av_strerror(ret, errBuf, sizeof(errBuf));
-
-        DecodeResult result;
-        result.frame = nullptr;
-        result.isError = true;
-        result.errorMessage = std::string("Decode error: ") + errBuf;
-
-        tsfnError_.BlockingCall(&result, [](Napi::Env env, Napi::Function fn, DecodeResult* res) {
-            fn.Call({ Napi::String::New(env, res->errorMessage) });
-        });
-
-        av_packet_free(&packet);
-        return;
-    }
-
-    // Receive decoded frames
-    AVFrame* frame = av_frame_alloc();
-    while (ret >= 0) {
-        ret = avcodec_receive_frame(codecCtx_, frame);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
-        } else if (ret < 0) {
-            char errBuf[256];
-            av_strerror(ret, errBuf, sizeof(errBuf));
-
-            DecodeResult result;
-            result.frame = nullptr;
-            result.isError = true;
-            result.errorMessage = std::string("Decode error: ") + errBuf;
-
-            tsfnError_.BlockingCall(&result, [](Napi::Env env, Napi::Function fn, DecodeResult* res) {
-                fn.Call({ Napi::String::New(env, res->errorMessage) });
-            });
-            break;
+        error = errBuf;
+    } else {
+        // Receive decoded frames
+        while (true) {
+            AVFrame* frame = av_frame_alloc();
+            ret = avcodec_receive_frame(codecCtx_, frame);
+            if (ret < 0) {
+                av_frame_free(&frame);
+                if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+                    char errBuf[256];
+                    av_strerror(ret, errBuf, sizeof(errBuf));
+                    error = errBuf;
+                }
+                break;
+            }
+            frames.push_back(frame);
         }
+    }
+    av_packet_free(&packet);
 
-        // Clone frame for output
-        AVFrame* outputFrame = av_frame_clone(frame);
-
-        DecodeResult* result = new DecodeResult();
-        result->frame = outputFrame;
-        result->timestamp = job.timestamp;
-        result->duration = job.duration;
-        result->isError = false;
-        result->isFlushComplete = false;
-
-        // Call JS callback
-        tsfnOutput_.BlockingCall(result, [](Napi::Env env, Napi::Function fn, DecodeResult* res) {
-            Napi::Object nativeFrame = VideoFrameNative::NewInstance(env, res->frame);
-
-            fn.Call({
-                nativeFrame,
-                Napi::Number::New(env, static_cast<double>(res->timestamp)),
-                Napi::Number::New(env, static_cast<double>(res->duration))
-            });
+    // A limit hit also surfaces as an FFmpeg error; report the limit instead
+    const std::string limit = limits_.EndJob(codecCtx_, !error.empty());
 
-            delete res;
-        });
+    for (AVFrame* frame : frames) {
+        EmitFrame(frame, true);
+        av_frame_free(&frame);
+    }
 
-        av_frame_unref(frame);
+    if (!limit.empty()) {
+        RecoverFromLimit(limit);
+    } else if (!error.empty()) {
+        EmitError("Decode error: " + error, "EncodingError");
     }
+}
 
-    av_frame_free(&frame);
-    av_packet_free(&packet);
+void VideoDecoderAsync::EmitError(const std::string& message, const char* name) {
+    // Owned by the callback, which may run after this job has finished
+    std::string* text = new std::string(message);
+    tsfnError_.BlockingCall(text, [name](Napi::Env env, Napi::Function fn, std::string* msg) {
+        fn.Call({ Napi::String::New(env, *msg), Napi::String::New(env, name) });
+        delete msg;
+    });
+}
+
+void VideoDecoderAsync::RecoverFromLimit(const std::string& message) {
+    // Drop what the decoder holds of the offending stream and resume at the
+    // next keyframe; the instance stays configured
+    avcodec_flush_buffers(codecCtx_);
+    awaitKeyframe_ = true;
+    EmitError(message, "QuotaExceededError");
 }
 
 void VideoDecoderAsync::ProcessFlush() {
@@ -289,29 +420,9 @@ void VideoDecoderAsync::ProcessFlush() {
     AVFrame* frame = av_frame_alloc();
     int ret;
     while ((ret = avcodec_receive_frame(codecCtx_, frame)) >= 0) {
-        AVFrame* outputFrame = av_frame_clone(frame);
-
-        DecodeResult* result = new DecodeResult();
-        result->frame = outputFrame;
-        result->timestamp = frame->pts;
-        result->duration = frame->duration;
-        result->isError = false;
-        result->isFlushComplete = false;
-
         // Use NonBlockingCall to prevent deadlock in resource-constrained environments
         // (CI, serverless, containers) where the JS event loop may be starved
-        tsfnOutput_.NonBlockingCall(result, [](Napi::Env env, Napi::Function fn, DecodeResult* res) {
-            Napi::Object nativeFrame = VideoFrameNative::NewInstance(env, res->frame);
-
-            fn.Call({
-                nativeFrame,
-                Napi::Number::New(env, static_cast<double>(res->timestamp)),
-                Napi::Number::New(env, static_cast<double>(res->duration))
-            });
-
-            delete res;
-        });
-
+        EmitFrame(frame, false);
         av_frame_unref(frame);
     }
     av_frame_free(&frame);
@@ -326,12 +437,150 @@ void VideoDecoderAsync::ProcessFlush() {
     flushPending_ = false;
 }
 
-void VideoDecoderAsync::Decode(const Napi::CallbackInfo& info) {
+void VideoDecoderAsync::EmitFrame(AVFrame* frame, bool blocking) {
+    // Packets still held by the decoder when this frame came out; the drain
+    // at flush says nothing about steady-state delay, so skip it there
+    const int64_t backlog = timestamps_.Backlog(frame);
+    if (blocking && backlog >= 0) {
+        decoderDelay_ = backlog;
+    }
+
+    // Look up the metadata of the chunk this frame was decoded from
+    FrameMetadata meta = timestamps_.Resolve(frame);
+
+    DecodeResult* result = new DecodeResult();
+    // Grade before renditions so every output carries the look
+    AVFrame* graded = colorLut_ ? colorLut_->Apply(frame, true) : nullptr;
+    result->frame = graded ? graded : av_frame_clone(frame);
+
+    // Statistics describe the frame as delivered, after grading
+    if (analyzer_) {
+        if (analyzerReset_.exchange(false)) {
+            analyzer_->Reset();
+        }
+        result->hasAnalysis = analyzer_->Analyze(result->frame, result->analysis);
+    }
+
+    // Produce the requested renditions here so JS gets them in the same call
+    for (size_t i = 0; i < renditions_.size(); i++) {
+        if (framesDecoded_ % renditions_[i].every != 0) {
+            continue;
+        }
+        AVFrame* rendition = RenderRendition(renditions_[i], result->frame);
+        if (rendition) {
+            result->renditions.emplace_back(static_cast<int>(i), rendition);
+        }
+    }
+    framesDecoded_++;
+
+    result->timestamp = meta.timestamp;
+    result->duration = meta.duration;
+    result->userData = meta.userData;
+    result->hasUserData = meta.hasUserData;
+    result->isError = false;
+    result->isFlushComplete = false;
+
+    if (pullOutputs_.Enabled()) {
+        // Blocks here when the buffer is full and the policy is "block"
+        pullOutputs_.Push(result, !stopping_);
+        return;
+    }
+
+    auto callback = [](Napi::Env env, Napi::Function fn, DecodeResult* res) {
+        Napi::Object nativeFrame = VideoFrameNative::NewInstance(env, res->frame);
+        Napi::Value renditions = RenditionsToJS(env, res);
+
+        fn.Call({
+            nativeFrame,
+            Napi::Number::New(env, static_cast<double>(res->timestamp)),
+            Napi::Number::New(env, static_cast<double>(res->duration)),
+            res->hasUserData ? Napi::Number::New(env, res->userData) : env.Undefined(),
+            renditions,
+            res->hasAnalysis ? FrameAnalysis::toJS(env, res->analysis) : env.Undefined()
+        });
+
+        delete res;
+    };
+
+    if (blocking) {
+        tsfnOutput_.BlockingCall(result, callback);
+    } else {
+        tsfnOutput_.NonBlockingCall(result, callback);
+    }
+}
+
+Napi::Value VideoDecoderAsync::RenditionsToJS(Napi::Env env, DecodeResult* res) {
+    if (res->renditions.empty()) {
+        return env.Undefined();
+    }
+
+    // Renditions are tagged with the index of their spec
+    Napi::Array list = Napi::Array::New(env, res->renditions.size());
+    for (size_t i = 0; i < res->renditions.size(); i++) {
+        Napi::Object entry = Napi::Object::New(env);
+        entry.Set("index", Napi::Number::New(env, res->renditions[i].first));
+        entry.Set("frame", VideoFrameNative::NewInstance(env, res->renditions[i].second));
+        list.Set(static_cast<uint32_t>(i), entry);
+    }
+    return list;
+}
+
+void VideoDecoderAsync::FreeResult(DecodeResult* res) {
+    if (res->frame) {
+        av_frame_free(&res->frame);
+    }
+    for (auto& rendition : res->renditions) {
+        av_frame_free(&rendition.second);
+    }
+    delete res;
+}
+
+AVFrame* VideoDecoderAsync::RenderRendition(RenditionSpec& spec, const AVFrame* src) {
+    AVPixelFormat srcFormat = static_cast<AVPixelFormat>(src->format);
+    AVPixelFormat dstFormat = spec.format != AV_PIX_FMT_NONE ? spec.format : srcFormat;
+    int dstWidth = spec.width > 0 ? spec.width : src->width;
+    int dstHeight = spec.height > 0 ? spec.height : src->height;
+
+    spec.swsCtx = sws_getCachedContext(
+        spec.swsCtx,
+        src->width, src->height, srcFormat,
+        dstWidth, dstHeight, dstFormat,
+        SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
+    if (!spec.swsCtx) {
+        return nullptr;
+    }
+
+    AVFrame* dst = av_frame_alloc();
+    dst->format = dstFormat;
+    dst->width = dstWidth;
+    dst->height = dstHeight;
+    if (av_frame_get_buffer(dst, 0) < 0) {
+        av_frame_free(&dst);
+        return nullptr;
+    }
+    av_frame_copy_props(dst, src);
+
+    sws_scale(spec.swsCtx, src->data, src->linesize, 0, src->height,
+              dst->data, dst->linesize);
+    return dst;
+}
+
+void VideoDecoderAsync::FreeRenditions() {
+    for (RenditionSpec& spec : renditions_) {
+        if (spec.swsCtx) {
+            sws_freeContext(spec.swsCtx);
+        }
+    }
+    renditions_.clear();
+}
+
+Napi::Value VideoDecoderAsync::Decode(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     if (!configured_) {
         Napi::Error::New(env, "Decoder not configured").ThrowAsJavaScriptException();
-        return;
+        return env.Undefined();
     }
 
     Napi::Buffer<uint8_t> data = info[0].As<Napi::Buffer<uint8_t>>();
@@ -339,19 +588,108 @@ void VideoDecoderAsync::Decode(const Napi::CallbackInfo& info) {
     int64_t timestamp = info[2].As<Napi::Number>().Int64Value();
     int64_t duration = info[3].As<Napi::Number>().Int64Value();
 
-    // Copy data for async processing
+    // Copy data for async processing; oversized chunks are only counted
     DecodeJob job;
-    job.data.assign(data.Data(), data.Data() + data.Length());
+    if (limits_.CheckChunk(data.Length()).empty()) {
+        job.data.assign(data.Data(), data.Data() + data.Length());
+    } else {
+        job.rejectedBytes = data.Length();
+    }
     job.isKeyframe = isKeyframe;
     job.timestamp = timestamp;
     job.duration = duration;
+    job.hasUserData = info.Length() > 4 && info[4].IsNumber();
+    job.userData = job.hasUserData ? info[4].As<Napi::Number>().DoubleValue() : 0;
     job.isFlush = false;
 
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        jobQueue_.push(std::move(job));
+    // false tells the caller to wait for the backpressure resume callback
+    jobs_.Push(std::move(job));
+    bool belowHighWater = backpressure_.OnPush([this] { return jobs_.size(); });
+
+    return Napi::Boolean::New(env, belowHighWater);
+}
+
+void VideoDecoderAsync::SetBackpressure(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Expected (highWaterMark, lowWaterMark, onResume)").ThrowAsJavaScriptException();
+        return;
+    }
+
+    int64_t highWater = info[0].As<Napi::Number>().Int64Value();
+    int64_t lowWater = info[1].As<Napi::Number>().Int64Value();
+
+    backpressure_.Configure(env,
+                            static_cast<size_t>(std::max<int64_t>(0, highWater)),
+                            static_cast<size_t>(std::max<int64_t>(0, lowWater)),
+                            info[2].As<Napi::Function>());
+}
+
+void VideoDecoderAsync::SetPullMode(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // setPullMode(false): back to the output callback
+    if (info.Length() > 0 && info[0].IsBoolean() && !info[0].As<Napi::Boolean>().Value()) {
+        pullOutputs_.Disable();
+        return;
+    }
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsString() || !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Expected (capacity, policy, onReadable)").ThrowAsJavaScriptException();
+        return;
+    }
+
+    std::string policyName = info[1].As<Napi::String>().Utf8Value();
+    OutputBuffer<DecodeResult>::Policy policy;
+    if (!OutputBuffer<DecodeResult>::ParsePolicy(policyName, policy)) {
+        Napi::TypeError::New(env, "Unknown pull policy: " + policyName).ThrowAsJavaScriptException();
+        return;
+    }
+
+    int64_t capacity = info[0].As<Napi::Number>().Int64Value();
+    pullOutputs_.Enable(env, static_cast<size_t>(std::max<int64_t>(1, capacity)), policy,
+                        info[2].As<Napi::Function>());
+}
+
+Napi::Value VideoDecoderAsync::TakeOutputs(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    size_t max = SIZE_MAX;
+    if (info.Length() > 0 && info[0].IsNumber()) {
+        max = static_cast<size_t>(std::max<int64_t>(0, info[0].As<Napi::Number>().Int64Value()));
     }
-    queueCV_.notify_one();
+
+    std::vector<DecodeResult*> results = pullOutputs_.Take(max);
+    Napi::Array batch = Napi::Array::New(env, results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        DecodeResult* res = results[i];
+
+        Napi::Object output = Napi::Object::New(env);
+        output.Set("frame", VideoFrameNative::NewInstance(env, res->frame));
+        output.Set("timestamp", Napi::Number::New(env, static_cast<double>(res->timestamp)));
+        output.Set("duration", Napi::Number::New(env, static_cast<double>(res->duration)));
+        if (res->hasUserData) {
+            output.Set("userData", Napi::Number::New(env, res->userData));
+        }
+        output.Set("renditions", RenditionsToJS(env, res));
+        if (res->hasAnalysis) {
+            output.Set("analysis", FrameAnalysis::toJS(env, res->analysis));
+        }
+        batch.Set(static_cast<uint32_t>(i), output);
+
+        // Frames now belong to their VideoFrameNative wrappers
+        delete res;
+    }
+    return batch;
+}
+
+Napi::Value VideoDecoderAsync::GetDroppedOutputs(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(pullOutputs_.Dropped()));
+}
+
+Napi::Value VideoDecoderAsync::GetQueueDepth(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(jobs_.size()));
 }
 
 Napi::Value VideoDecoderAsync::Flush(const Napi::CallbackInfo& info) {
@@ -379,51 +717,46 @@ Napi::Value VideoDecoderAsync::Flush(const Napi::CallbackInfo& info) {
     DecodeJob job;
     job.isFlush = true;
 
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        jobQueue_.push(std::move(job));
-    }
-    queueCV_.notify_one();
+    jobs_.Push(std::move(job));
 
     return env.Undefined();
 }
 
 void VideoDecoderAsync::Reset(const Napi::CallbackInfo& info) {
-    // Clear queue
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        while (!jobQueue_.empty()) {
-            jobQueue_.pop();
-        }
-    }
+    // Drop queued jobs; the worker skips them as it reaches them
+    jobs_.Discard();
+    backpressure_.OnPop(0);
+    pullOutputs_.Clear();
 
     if (codecCtx_) {
         avcodec_flush_buffers(codecCtx_);
     }
+    analyzerReset_ = true;
+}
+
+Napi::Value VideoDecoderAsync::GetDecoderDelay(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(decoderDelay_.load()));
 }
 
 void VideoDecoderAsync::Close(const Napi::CallbackInfo& info) {
     // Stop worker thread
     running_ = false;
-    queueCV_.notify_all();
+    jobs_.Wake();
+    pullOutputs_.Disable();
 
     if (workerThread_.joinable()) {
         workerThread_.join();
     }
 
     // Clear queue
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        while (!jobQueue_.empty()) {
-            jobQueue_.pop();
-        }
-    }
+    jobs_.Clear();
 
     // Clean up FFmpeg
     if (codecCtx_) {
         avcodec_free_context(&codecCtx_);
         codecCtx_ = nullptr;
     }
+    FreeRenditions();
 
     configured_ = false;
 }
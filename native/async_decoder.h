@@ -2,16 +2,27 @@
 #define ASYNC_DECODER_H
 
 #include <napi.h>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
 #include <atomic>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "timestamp_table.h"
+#include "backpressure.h"
+#include "job_ring.h"
+#include "output_buffer.h"
+#include "lut3d.h"
+#include "analysis.h"
+#include "decode_limits.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavutil/frame.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
 }
 
 // Job to be processed by worker thread
@@ -20,14 +31,31 @@ struct DecodeJob {
     bool isKeyframe;
     int64_t timestamp;
     int64_t duration;
+    double userData;      // Optional caller tag, echoed back with the output frame
+    bool hasUserData;
     bool isFlush;
+    size_t rejectedBytes = 0;  // Over limits.maxChunkBytes: reported by the worker, data not copied
+};
+
+// Extra output produced by the worker from each decoded frame
+struct RenditionSpec {
+    AVPixelFormat format;   // AV_PIX_FMT_NONE keeps the decoded format
+    int width;              // 0 keeps the decoded size
+    int height;
+    int every;              // Produce on every Nth decoded frame
+    SwsContext* swsCtx;     // Cached scaler (worker thread only)
 };
 
 // Result from worker thread back to JS
 struct DecodeResult {
     AVFrame* frame;  // Ownership transferred to callback
+    std::vector<std::pair<int, AVFrame*>> renditions;  // (spec index, frame), ownership transferred
+    bool hasAnalysis;
+    FrameAnalysis::Stats analysis;
     int64_t timestamp;
     int64_t duration;
+    double userData;
+    bool hasUserData;
     bool isError;
     std::string errorMessage;
     bool isFlushComplete;
@@ -44,10 +72,16 @@ private:
 
     // JavaScript-facing methods
     void Configure(const Napi::CallbackInfo& info);
-    void Decode(const Napi::CallbackInfo& info);
+    Napi::Value Decode(const Napi::CallbackInfo& info);
     Napi::Value Flush(const Napi::CallbackInfo& info);
     void Reset(const Napi::CallbackInfo& info);
     void Close(const Napi::CallbackInfo& info);
+    Napi::Value GetDecoderDelay(const Napi::CallbackInfo& info);
+    void SetBackpressure(const Napi::CallbackInfo& info);
+    Napi::Value GetQueueDepth(const Napi::CallbackInfo& info);
+    void SetPullMode(const Napi::CallbackInfo& info);
+    Napi::Value TakeOutputs(const Napi::CallbackInfo& info);
+    Napi::Value GetDroppedOutputs(const Napi::CallbackInfo& info);
 
     // Worker thread entry point
     void WorkerThread();
@@ -55,6 +89,18 @@ private:
     // Process a single decode job (runs on worker thread)
     void ProcessDecode(DecodeJob& job);
     void ProcessFlush();
+    void EmitFrame(AVFrame* frame, bool blocking);
+    void EmitError(const std::string& message, const char* name);
+    void RecoverFromLimit(const std::string& message);
+    AVFrame* RenderRendition(RenditionSpec& spec, const AVFrame* src);
+    void FreeRenditions();
+    // Let the worker dispose of the discarded jobs, then join it (main thread)
+    void StopWorker();
+    // Reject a flush whose job was discarded by reconfigure (main thread)
+    void AbortFlush();
+    static Napi::Value RenditionsToJS(Napi::Env env, DecodeResult* res);
+    static void FreeResult(DecodeResult* res);
+    static void DisposeJob(DecodeJob&) {}
 
     // Thread-safe functions for callbacks to JS
     Napi::ThreadSafeFunction tsfnOutput_;
@@ -64,12 +110,12 @@ private:
     // Worker thread
     std::thread workerThread_;
     std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};  // StopWorker() is waiting: pull mode must not block
     std::atomic<bool> configured_{false};
 
-    // Job queue with synchronization
-    std::queue<DecodeJob> jobQueue_;
-    std::mutex queueMutex_;
-    std::condition_variable queueCV_;
+    // Job queue: JS thread produces, worker consumes
+    JobRing<DecodeJob> jobs_{64, &VideoDecoderAsync::DisposeJob};
+    QueueBackpressure backpressure_;
 
     // Flush synchronization
     std::atomic<bool> flushPending_{false};
@@ -77,6 +123,36 @@ private:
     // FFmpeg context (owned/accessed by worker thread after configure)
     AVCodecContext* codecCtx_;
     const AVCodec* codec_;
+
+    // optimizeForLatency: low-delay flags, slice threads only
+    bool optimizeForLatency_ = false;
+
+    // Packets the decoder was holding when the most recent frame came out
+    std::atomic<int64_t> decoderDelay_{0};
+
+    // Renditions requested at configure time and the decoded-frame counter
+    // used for every-Nth sampling (worker thread only)
+    std::vector<RenditionSpec> renditions_;
+    int64_t framesDecoded_ = 0;
+
+    // Color LUT applied to every decoded frame, if configured
+    std::shared_ptr<const Lut3D> colorLut_;
+
+    // Luma statistics attached to every output frame, if configured (worker
+    // thread only). reset() asks the worker to drop the previous frame.
+    std::unique_ptr<FrameAnalysis::Analyzer> analyzer_;
+    std::atomic<bool> analyzerReset_{false};
+
+    // Pull mode: outputs wait here for takeOutputs() instead of the output callback
+    OutputBuffer<DecodeResult> pullOutputs_{&VideoDecoderAsync::FreeResult};
+
+    // Maps packet sequence numbers back to chunk timestamps (worker thread only)
+    TimestampTable timestamps_;
+
+    // Resource limits for untrusted streams; after a violation the worker
+    // drops chunks until the next keyframe (worker thread only)
+    DecodeLimits limits_;
+    bool awaitKeyframe_ = false;
 };
 
 #endif // ASYNC_DECODER_H
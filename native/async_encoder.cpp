@@ -2,6 +2,41 @@
 #include "frame.h"
 #include "color.h"
 #include "svc.h"
+#include "transform.h"
+#include "lut3d.h"
+#include "encode_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Frames still inside the encoder; lookahead never holds more than this
+constexpr size_t kMaxFrameTimings = 256;
+// Constant QP of x264/x265 in bitrateMode 'quantizer' when a frame sets none
+constexpr int kDefaultQp = 23;
+
+int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// metadata.stageTimings of a chunk; delivery ends when JS receives it
+Napi::Value stageTimingsToJS(Napi::Env env, const EncodeResult* res) {
+    if (res->queueNs < 0) {
+        return env.Undefined();
+    }
+    Napi::Object timings = Napi::Object::New(env);
+    timings.Set("queueUs", Napi::Number::New(env, res->queueNs / 1000.0));
+    timings.Set("convertUs", Napi::Number::New(env, res->convertNs / 1000.0));
+    timings.Set("encodeUs", Napi::Number::New(env, res->encodeNs / 1000.0));
+    timings.Set("deliveryUs", Napi::Number::New(env, (steadyNowNs() - res->encodedAtNs) / 1000.0));
+    return timings;
+}
+
+}  // namespace
 
 Napi::FunctionReference VideoEncoderAsync::constructor;
 
@@ -12,6 +47,13 @@ Napi::Object VideoEncoderAsync::Init(Napi::Env env, Napi::Object exports) {
         InstanceMethod("flush", &VideoEncoderAsync::Flush),
         InstanceMethod("reset", &VideoEncoderAsync::Reset),
         InstanceMethod("close", &VideoEncoderAsync::Close),
+        InstanceMethod("setBackpressure", &VideoEncoderAsync::SetBackpressure),
+        InstanceAccessor("queueDepth", &VideoEncoderAsync::GetQueueDepth, nullptr),
+        InstanceMethod("setPullMode", &VideoEncoderAsync::SetPullMode),
+        InstanceMethod("takeOutputs", &VideoEncoderAsync::TakeOutputs),
+        InstanceAccessor("droppedOutputs", &VideoEncoderAsync::GetDroppedOutputs, nullptr),
+        InstanceMethod("getLiveGop", &VideoEncoderAsync::GetLiveGop),
+        InstanceAccessor("lastEncodeQueued", &VideoEncoderAsync::GetLastEncodeQueued, nullptr),
     });
 
     constructor = Napi::Persistent(func);
@@ -26,6 +68,7 @@ VideoEncoderAsync::VideoEncoderAsync(const Napi::CallbackInfo& info)
     , codecCtx_(nullptr)
     , codec_(nullptr)
     , swsCtx_(nullptr)
+    , cacheSeed_(0)
     , hwType_(HWAccel::Type::None)
     , hwDeviceCtx_(nullptr)
     , hwFramesCtx_(nullptr)
@@ -39,7 +82,10 @@ VideoEncoderAsync::VideoEncoderAsync(const Napi::CallbackInfo& info)
     , alpha_(false)
     , scalabilityMode_("")
     , temporalLayers_(1)
-    , latencyMode_("quality") {
+    , latencyMode_("quality")
+    , contentHint_("")
+    , intraOnly_(false)
+    , roiSupported_(false) {
 
     Napi::Env env = info.Env();
 
@@ -67,9 +113,10 @@ VideoEncoderAsync::VideoEncoderAsync(const Napi::CallbackInfo& info)
 }
 
 VideoEncoderAsync::~VideoEncoderAsync() {
-    // Signal worker to stop
+    // Signal worker to stop (and wake it if it is blocked on a full pull buffer)
     running_ = false;
-    queueCV_.notify_all();
+    jobs_.Wake();
+    pullOutputs_.Disable();
 
     // Wait for worker thread to finish
     if (workerThread_.joinable()) {
@@ -77,6 +124,8 @@ VideoEncoderAsync::~VideoEncoderAsync() {
     }
 
     // Clean up FFmpeg resources
+    DiscardFrameRateState();
+    DiscardGop();
     if (swsCtx_) {
         sws_freeContext(swsCtx_);
     }
@@ -93,13 +142,26 @@ VideoEncoderAsync::~VideoEncoderAsync() {
     // Release thread-safe functions
     tsfnOutput_.Release();
     tsfnError_.Release();
+    backpressure_.Release();
     if (tsfnFlush_) {
         tsfnFlush_.Release();
     }
 }
 
-void VideoEncoderAsync::configureEncoderOptions(const std::string& encoderName, const std::string& latencyMode) {
+bool VideoEncoderAsync::AppliesRoi() const {
+    // x264 and x265 apply ROI side data as AQ offsets, and constant QP turns AQ off
+    if (codecName_ == "libx264" || codecName_ == "libx265") {
+        return bitrateMode_ != "quantizer";
+    }
+    return codecName_ == "libvpx" || codecName_ == "libvpx-vp9";
+}
+
+void VideoEncoderAsync::configureEncoderOptions(const std::string& encoderName, const std::string& latencyMode,
+                                            const std::string& contentHint) {
     bool isRealtime = (latencyMode == "realtime");
+    // "text" is screen/slide content, "detail" trades frame rate for sharpness
+    bool isText = (contentHint == "text");
+    bool isDetail = (contentHint == "detail");
 
     // Global realtime optimizations
     if (isRealtime) {
@@ -113,12 +175,17 @@ void VideoEncoderAsync::configureEncoderOptions(const std::string& encoderName,
     if (encoderName == "libx264") {
         if (isRealtime) {
             av_opt_set(codecCtx_->priv_data, "preset", "ultrafast", 0);
-            av_opt_set(codecCtx_->priv_data, "tune", "zerolatency", 0);
+            av_opt_set(codecCtx_->priv_data, "tune", isText ? "stillimage,zerolatency" : "zerolatency", 0);
             av_opt_set(codecCtx_->priv_data, "rc-lookahead", "0", 0);
             av_opt_set(codecCtx_->priv_data, "sync-lookahead", "0", 0);
             av_opt_set(codecCtx_->priv_data, "intra-refresh", "1", 0);
+            // ultrafast turns AQ off, and x264 applies ROI offsets only through AQ
+            av_opt_set(codecCtx_->priv_data, "aq-mode", "variance", 0);
         } else {
-            av_opt_set(codecCtx_->priv_data, "preset", "medium", 0);
+            av_opt_set(codecCtx_->priv_data, "preset", isText ? "faster" : isDetail ? "slow" : "medium", 0);
+            if (isText) {
+                av_opt_set(codecCtx_->priv_data, "tune", "stillimage", 0);
+            }
         }
     }
     else if (encoderName == "h264_videotoolbox" || encoderName == "hevc_videotoolbox") {
@@ -153,13 +220,26 @@ void VideoEncoderAsync::configureEncoderOptions(const std::string& encoderName,
             av_opt_set_int(codecCtx_->priv_data, "lag-in-frames", 0, 0);
             av_opt_set(codecCtx_->priv_data, "deadline", "realtime", 0);
         } else {
-            av_opt_set_int(codecCtx_->priv_data, "cpu-used", 4, 0);
+            av_opt_set_int(codecCtx_->priv_data, "cpu-used", isText ? 5 : isDetail ? 2 : 4, 0);
+        }
+        if (isText) {
+            // VP8 has a screen content mode, VP9 a content tune
+            if (encoderName == "libvpx") {
+                av_opt_set_int(codecCtx_->priv_data, "screen-content-mode", 1, 0);
+            } else {
+                av_opt_set(codecCtx_->priv_data, "tune-content", "screen", 0);
+            }
         }
     }
     else if (encoderName == "libx265") {
-        av_opt_set(codecCtx_->priv_data, "preset", isRealtime ? "ultrafast" : "medium", 0);
+        av_opt_set(codecCtx_->priv_data, "preset",
+                   isRealtime ? "ultrafast" : isText ? "fast" : isDetail ? "slow" : "medium", 0);
         if (isRealtime) {
             av_opt_set(codecCtx_->priv_data, "tune", "zerolatency", 0);
+            // As with x264: keep AQ on under ultrafast so ROI offsets apply
+            av_opt_set(codecCtx_->priv_data, "x265-params", "aq-mode=1", 0);
+        } else if (isText) {
+            av_opt_set(codecCtx_->priv_data, "tune", "animation", 0);
         }
     }
     else if (encoderName == "libaom-av1" || encoderName == "libsvtav1") {
@@ -168,9 +248,46 @@ void VideoEncoderAsync::configureEncoderOptions(const std::string& encoderName,
             av_opt_set_int(codecCtx_->priv_data, "lag-in-frames", 0, 0);
             av_opt_set(codecCtx_->priv_data, "usage", "realtime", 0);
         } else {
-            av_opt_set_int(codecCtx_->priv_data, "cpu-used", 6, 0);
+            av_opt_set_int(codecCtx_->priv_data, "cpu-used", isDetail ? 4 : 6, 0);
+        }
+        if (isText && encoderName == "libaom-av1") {
+            // Screen tools: palette mode and intra block copy
+            av_opt_set(codecCtx_->priv_data, "tune-content", "screen", 0);
+            av_opt_set_int(codecCtx_->priv_data, "enable-palette", 1, 0);
+            av_opt_set_int(codecCtx_->priv_data, "enable-intrabc", 1, 0);
+        } else if (isText) {
+            av_opt_set(codecCtx_->priv_data, "svtav1-params", "scm=1", 0);
+        }
+    }
+
+    // Intra-only (mezzanine) proxies: every frame is a keyframe, so B-frames and
+    // lookahead buy nothing; slice threads parallelize without adding delay
+    if (intraOnly_) {
+        codecCtx_->gop_size = 1;
+        codecCtx_->max_b_frames = 0;
+        codecCtx_->thread_count = 0;  // Auto
+        codecCtx_->thread_type = FF_THREAD_SLICE;
+
+        if (encoderName == "libx264") {
+            av_opt_set(codecCtx_->priv_data, "intra-refresh", "0", 0);
+            av_opt_set(codecCtx_->priv_data, "rc-lookahead", "0", 0);
+        } else if (encoderName == "libvpx" || encoderName == "libvpx-vp9") {
+            av_opt_set_int(codecCtx_->priv_data, "lag-in-frames", 0, 0);
+            if (encoderName == "libvpx-vp9") {
+                av_opt_set_int(codecCtx_->priv_data, "row-mt", 1, 0);
+            }
+        } else if (encoderName == "libaom-av1") {
+            av_opt_set(codecCtx_->priv_data, "usage", "allintra", 0);
+            av_opt_set_int(codecCtx_->priv_data, "row-mt", 1, 0);
         }
     }
+
+    // The live GOP cache serves late joiners from the last keyframe. With intra
+    // refresh libx264 only emits the first one, so a cache that outgrew maxBytes
+    // would stay empty for good; keep regular keyframes instead
+    if (liveGop_ && encoderName == "libx264") {
+        av_opt_set(codecCtx_->priv_data, "intra-refresh", "0", 0);
+    }
 }
 
 void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
@@ -184,6 +301,21 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
     Napi::Object config = info[0].As<Napi::Object>();
     std::string codecName = config.Get("codec").As<Napi::String>().Utf8Value();
 
+    // Reconfigure: frames still queued are dropped as on reset() rather than
+    // encoded while JS waits; the previous codec's worker state goes with
+    // its worker
+    jobs_.Discard();
+    backpressure_.OnPop(0);
+    StopWorker();
+    AbortFlush();
+    if (codecCtx_) {
+        avcodec_free_context(&codecCtx_);
+    }
+    configured_ = false;
+    resetPending_ = false;
+    DiscardGop();
+    frameTimings_.clear();
+
     width_ = config.Get("width").As<Napi::Number>().Int32Value();
     height_ = config.Get("height").As<Napi::Number>().Int32Value();
 
@@ -194,6 +326,70 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
         hwPref = HWAccel::parsePreference(pref);
     }
 
+    // HDR -> SDR tone mapping of PQ/HLG input frames
+    toneMapper_.reset();
+    if (config.Has("toneMapping") && config.Get("toneMapping").IsString()) {
+        std::string curveName = config.Get("toneMapping").As<Napi::String>().Utf8Value();
+        ToneMap::Curve curve = ToneMap::parseCurve(curveName);
+        if (curve == ToneMap::Curve::None) {
+            Napi::TypeError::New(env, "Unknown toneMapping: " + curveName).ThrowAsJavaScriptException();
+            return;
+        }
+        double peakLuminance = 0;
+        if (config.Has("hdrPeakLuminance") && config.Get("hdrPeakLuminance").IsNumber()) {
+            peakLuminance = config.Get("hdrPeakLuminance").As<Napi::Number>().DoubleValue();
+        }
+        toneMapper_.reset(new ToneMap::ToneMapper(curve, peakLuminance));
+    }
+
+    // Color LUT stage (shared, parsed once by ColorLUT)
+    colorLut_.reset();
+    if (config.Has("colorLut") && !config.Get("colorLut").IsUndefined()) {
+        colorLut_ = ColorLutNative::FromValue(config.Get("colorLut"));
+        if (!colorLut_) {
+            Napi::TypeError::New(env, "colorLut must be a ColorLUT").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+
+    // Encode result cache (shared store, owned by EncodeCache)
+    encodeCache_.reset();
+    if (config.Has("encodeCache") && !config.Get("encodeCache").IsUndefined()) {
+        encodeCache_ = EncodeCacheNative::FromValue(config.Get("encodeCache"));
+        if (!encodeCache_) {
+            Napi::TypeError::New(env, "encodeCache must be an EncodeCache").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+
+    // Frame-rate conversion to the configured framerate, before frames are copied
+    DiscardFrameRateState();
+    FrameRate::Mode rateMode = FrameRate::Mode::Off;
+    if (config.Has("frameRateConversion") && config.Get("frameRateConversion").IsString()) {
+        std::string modeName = config.Get("frameRateConversion").As<Napi::String>().Utf8Value();
+        if (!FrameRate::parseMode(modeName, rateMode)) {
+            Napi::TypeError::New(env, "Unknown frameRateConversion: " + modeName).ThrowAsJavaScriptException();
+            return;
+        }
+        if (!config.Get("framerate").IsNumber()) {
+            Napi::TypeError::New(env, "frameRateConversion requires framerate").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+    frameRate_.Configure(rateMode != FrameRate::Mode::Off ? config.Get("framerate").As<Napi::Number>().DoubleValue() : 0,
+                         rateMode);
+
+    // Live GOP cache for late joiners, bounded in bytes
+    liveGop_.reset();
+    if (config.Has("liveGopCacheBytes") && config.Get("liveGopCacheBytes").IsNumber()) {
+        int64_t maxBytes = config.Get("liveGopCacheBytes").As<Napi::Number>().Int64Value();
+        if (maxBytes <= 0) {
+            Napi::RangeError::New(env, "liveGopCache.maxBytes must be positive").ThrowAsJavaScriptException();
+            return;
+        }
+        liveGop_.reset(new LiveGopCache(static_cast<size_t>(maxBytes)));
+    }
+
     // Select encoder
     HWAccel::EncoderInfo encInfo = HWAccel::selectEncoder(codecName, hwPref, width_, height_);
 
@@ -256,7 +452,8 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
 
         if (codecName_.find("libx264") != std::string::npos ||
             codecName_.find("libx265") != std::string::npos) {
-            av_opt_set_int(codecCtx_->priv_data, "crf", 23, 0);
+            // Constant QP, so per-frame quantizers replace it rather than bias a CRF
+            av_opt_set_int(codecCtx_->priv_data, "qp", kDefaultQp, 0);
         } else if (codecName_.find("libvpx") != std::string::npos) {
             av_opt_set_int(codecCtx_->priv_data, "crf", 30, 0);
             codecCtx_->qmin = 0;
@@ -267,6 +464,7 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
     } else {
         codecCtx_->bit_rate = bitrate_;
     }
+    roiSupported_ = AppliesRoi();
 
     // Framerate
     int fps = 30;
@@ -314,6 +512,14 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
         }
     }
 
+    // Tone mapped output is SDR BT.709 unless the config says otherwise
+    if (toneMapper_ && !config.Has("colorSpace")) {
+        codecCtx_->color_primaries = AVCOL_PRI_BT709;
+        codecCtx_->color_trc = AVCOL_TRC_BT709;
+        codecCtx_->colorspace = AVCOL_SPC_BT709;
+        codecCtx_->color_range = AVCOL_RANGE_MPEG;
+    }
+
     // Hardware device context
     if (hwType_ != HWAccel::Type::None) {
         hwDeviceCtx_ = HWAccel::createHWDeviceContext(hwType_);
@@ -340,8 +546,9 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
 
     // Profile for H.264
     std::string encoderName = codec_->name;
+    int profile = 0;
     if (encoderName == "libx264" && config.Has("profile")) {
-        int profile = config.Get("profile").As<Napi::Number>().Int32Value();
+        profile = config.Get("profile").As<Napi::Number>().Int32Value();
         switch (profile) {
             case 66: av_opt_set(codecCtx_->priv_data, "profile", "baseline", 0); break;
             case 77: av_opt_set(codecCtx_->priv_data, "profile", "main", 0); break;
@@ -350,6 +557,11 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
         }
     }
 
+    // Level (level_idc from the codec string), so output can match an existing stream
+    if (encoderName == "libx264" && config.Has("level") && config.Get("level").IsNumber()) {
+        codecCtx_->level = config.Get("level").As<Napi::Number>().Int32Value();
+    }
+
     // AVC format
     if (config.Has("avcFormat")) {
         std::string format = config.Get("avcFormat").As<Napi::String>().Utf8Value();
@@ -360,7 +572,13 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
     if (config.Has("latencyMode")) {
         latencyMode_ = config.Get("latencyMode").As<Napi::String>().Utf8Value();
     }
-    configureEncoderOptions(encoderName, latencyMode_);
+    contentHint_ = config.Has("contentHint") && config.Get("contentHint").IsString()
+        ? config.Get("contentHint").As<Napi::String>().Utf8Value() : "";
+    intraOnly_ = config.Has("intraOnly") && config.Get("intraOnly").IsBoolean() &&
+                 config.Get("intraOnly").As<Napi::Boolean>().Value();
+    stageTimings_ = config.Has("stageTimings") && config.Get("stageTimings").IsBoolean() &&
+                    config.Get("stageTimings").As<Napi::Boolean>().Value();
+    configureEncoderOptions(encoderName, latencyMode_, contentHint_);
 
     // Scalability mode (SVC)
     if (config.Has("scalabilityMode") && config.Get("scalabilityMode").IsString()) {
@@ -446,6 +664,8 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
                 codec_ = swInfo.codec;
                 hwType_ = HWAccel::Type::None;
                 hwInputFormat_ = swInfo.inputFormat;
+                codecName_ = codec_->name;
+                roiSupported_ = AppliesRoi();
 
                 codecCtx_ = avcodec_alloc_context3(codec_);
                 codecCtx_->width = width_;
@@ -457,7 +677,7 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
                 codecCtx_->max_b_frames = 0;
                 codecCtx_->pix_fmt = AV_PIX_FMT_YUV420P;
 
-                configureEncoderOptions(codec_->name, latencyMode_);
+                configureEncoderOptions(codec_->name, latencyMode_, contentHint_);
 
                 ret = avcodec_open2(codecCtx_, codec_, nullptr);
                 if (ret < 0) {
@@ -477,6 +697,27 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
         }
     }
 
+    // Closed GOPs need IDR keyframes; intra refresh (realtime x264) has none
+    if (latencyMode_ == "realtime") {
+        encodeCache_.reset();
+    }
+    if (encodeCache_) {
+        // Normalized settings: what the opened encoder actually uses, however the config spelled it
+        char settings[512];
+        snprintf(settings, sizeof(settings),
+                 "%u|%s|%dx%d|%d|%lld|%s|%d/%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|%s|%s|%s",
+                 avcodec_version(), codec_->name, codecCtx_->width, codecCtx_->height,
+                 static_cast<int>(codecCtx_->pix_fmt), static_cast<long long>(codecCtx_->bit_rate),
+                 bitrateMode_.c_str(), codecCtx_->framerate.num, codecCtx_->framerate.den,
+                 codecCtx_->gop_size, codecCtx_->max_b_frames, profile, codecCtx_->level, avcAnnexB_ ? 1 : 0,
+                 static_cast<int>(codecCtx_->color_primaries), static_cast<int>(codecCtx_->color_trc),
+                 static_cast<int>(codecCtx_->colorspace), static_cast<int>(codecCtx_->color_range),
+                 latencyMode_.c_str(), scalabilityMode_.c_str(), contentHint_.c_str());
+        EncodeCache::Hasher settingsHash;
+        settingsHash.Update(settings, strlen(settings));
+        cacheSeed_ = settingsHash.Digest().lo;
+    }
+
     configured_ = true;
 
     // Start worker thread
@@ -484,27 +725,35 @@ void VideoEncoderAsync::Configure(const Napi::CallbackInfo& info) {
     workerThread_ = std::thread(&VideoEncoderAsync::WorkerThread, this);
 }
 
-void VideoEncoderAsync::WorkerThread() {
-    while (running_) {
-        EncodeJob job;
-
-        {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            queueCV_.wait(lock, [this] {
-                return !jobQueue_.empty() || !running_;
-            });
-
-            if (!running_ && jobQueue_.empty()) {
-                break;
-            }
+void VideoEncoderAsync::StopWorker() {
+    if (!workerThread_.joinable()) {
+        return;
+    }
+    // JS cannot take pull-mode outputs while it waits here
+    stopping_ = true;
+    running_ = false;
+    jobs_.Wake();
+    workerThread_.join();
+    stopping_ = false;
+}
 
-            if (jobQueue_.empty()) {
-                continue;
-            }
+void VideoEncoderAsync::AbortFlush() {
+    // The flush job was discarded with the rest of the queue; settle its promise
+    if (!flushPending_ || !tsfnFlush_) {
+        return;
+    }
+    tsfnFlush_.NonBlockingCall([](Napi::Env env, Napi::Function fn) {
+        Napi::Error err = Napi::Error::New(env, "Flush aborted by configure()");
+        err.Set("name", Napi::String::New(env, "AbortError"));
+        fn.Call({ err.Value() });
+    });
+    flushPending_ = false;
+}
 
-            job = std::move(jobQueue_.front());
-            jobQueue_.pop();
-        }
+void VideoEncoderAsync::WorkerThread() {
+    EncodeJob job{};
+    while (jobs_.Pop(job, running_)) {
+        backpressure_.OnPop(jobs_.size());
 
         if (job.isFlush) {
             ProcessFlush();
@@ -516,13 +765,59 @@ void VideoEncoderAsync::WorkerThread() {
 
 void VideoEncoderAsync::ProcessEncode(EncodeJob& job) {
     if (!codecCtx_) {
-        if (job.frame) {
-            av_frame_free(&job.frame);
-        }
+        DisposeJob(job);
         return;
     }
+    const int64_t dequeuedNs = stageTimings_ ? steadyNowNs() : 0;
+
+    if (resetPending_.exchange(false)) {
+        DiscardGop();
+        frameTimings_.clear();
+    }
 
     AVFrame* srcFrame = job.frame;
+    job.frame = nullptr;
+
+    // Frames of one output slot in frame-rate blend mode
+    if (!job.blend.empty()) {
+        AVFrame* blended = FrameRate::blend(srcFrame, job.blend);
+        if (blended) {
+            av_frame_free(&srcFrame);
+            srcFrame = blended;
+        }
+        for (AVFrame*& frame : job.blend) {
+            av_frame_free(&frame);
+        }
+        job.blend.clear();
+    }
+
+    // Orientation first, while the frame is still in its (smaller) source format.
+    // Scaling to the encoder size happens in the conversion pass below.
+    if (job.rotation != 0 || job.flip) {
+        AVFrame* oriented = FrameTransform::apply(srcFrame, job.rotation, job.flip);
+        if (oriented) {
+            av_frame_free(&srcFrame);
+            srcFrame = oriented;
+        }
+    }
+
+    // Tone map HDR input before it is converted for the encoder
+    if (toneMapper_ && ToneMap::isHdr(srcFrame)) {
+        AVFrame* sdr = toneMapper_->Process(srcFrame);
+        if (sdr) {
+            av_frame_free(&srcFrame);
+            srcFrame = sdr;
+        }
+    }
+
+    // Color LUT; the graded frame stays in planar RGB for the conversion pass
+    if (colorLut_) {
+        AVFrame* graded = colorLut_->Apply(srcFrame, false);
+        if (graded) {
+            av_frame_free(&srcFrame);
+            srcFrame = graded;
+        }
+    }
 
     // Determine target pixel format
     AVPixelFormat targetFormat = codecCtx_->pix_fmt;
@@ -566,15 +861,18 @@ void VideoEncoderAsync::ProcessEncode(EncodeJob& job) {
         srcFrame->width != width_ ||
         srcFrame->height != height_) {
 
-        if (!swsCtx_) {
-            swsCtx_ = sws_getContext(
-                srcFrame->width, srcFrame->height, (AVPixelFormat)srcFrame->format,
-                width_, height_, targetFormat,
-                SWS_BILINEAR, nullptr, nullptr, nullptr
-            );
-        }
+        // Cached: reused while the input format and size stay the same
+        swsCtx_ = sws_getCachedContext(swsCtx_,
+            srcFrame->width, srcFrame->height, (AVPixelFormat)srcFrame->format,
+            width_, height_, targetFormat,
+            SWS_BILINEAR, nullptr, nullptr, nullptr
+        );
 
         if (swsCtx_) {
+            ColorSpace::configureSws(swsCtx_,
+                (AVPixelFormat)srcFrame->format, srcFrame->colorspace, srcFrame->color_range,
+                targetFormat, codecCtx_->colorspace, codecCtx_->color_range);
+
             sws_scale(swsCtx_,
                 srcFrame->data, srcFrame->linesize, 0, srcFrame->height,
                 frame->data, frame->linesize
@@ -587,13 +885,51 @@ void VideoEncoderAsync::ProcessEncode(EncodeJob& job) {
     // Free source frame
     av_frame_free(&srcFrame);
 
+    // Per-frame quantizer rides on frame->quality (never 0, which means unset)
+    if (job.quantizer >= 0 && bitrateMode_ == "quantizer") {
+        frame->quality = std::max(1, job.quantizer * FF_QP2LAMBDA);
+    }
+
+    // Region-of-interest quantizer offsets; other encoders ignore them
+    if (roiSupported_ && !job.rois.empty()) {
+        const size_t bytes = job.rois.size() * sizeof(AVRegionOfInterest);
+        AVFrameSideData* sideData = av_frame_new_side_data(frame, AV_FRAME_DATA_REGIONS_OF_INTEREST, bytes);
+        if (sideData) {
+            memcpy(sideData->data, job.rois.data(), bytes);
+        }
+    }
+
+    if (stageTimings_) {
+        if (frameTimings_.size() >= kMaxFrameTimings) {
+            frameTimings_.pop_front();
+        }
+        frameTimings_.push_back({job.timestamp, job.queuedNs, dequeuedNs, steadyNowNs()});
+    }
+
+    if (encodeCache_) {
+        CacheFrame(frame, job.forceKeyframe);
+        return;
+    }
+
     // Set keyframe flag
     if (job.forceKeyframe) {
         frame->pict_type = AV_PICTURE_TYPE_I;
     }
 
+    EncodeFrame(frame);
+}
+
+bool VideoEncoderAsync::EncodeFrame(AVFrame* frame) {
+    // libx264 reconfigures its constant QP before each frame; the change follows the
+    // frame through lookahead, so it is exact only without lookahead (realtime).
+    // The option sticks, so frames without a quantizer go back to the default.
+    if (bitrateMode_ == "quantizer" && codecName_ == "libx264") {
+        const int qp = frame->quality > 0 ? (frame->quality + FF_QP2LAMBDA / 2) / FF_QP2LAMBDA : kDefaultQp;
+        av_opt_set_int(codecCtx_->priv_data, "qp", qp, 0);
+    }
+
     // Send frame to encoder
-    ret = avcodec_send_frame(codecCtx_, frame);
+    int ret = avcodec_send_frame(codecCtx_, frame);
     av_frame_free(&frame);
 
     if (ret < 0) {
@@ -607,7 +943,7 @@ void VideoEncoderAsync::ProcessEncode(EncodeJob& job) {
         tsfnError_.BlockingCall(&result, [](Napi::Env env, Napi::Function fn, EncodeResult* res) {
             fn.Call({ Napi::String::New(env, res->errorMessage) });
         });
-        return;
+        return false;
     }
 
     // Receive encoded packets
@@ -620,49 +956,239 @@ void VideoEncoderAsync::ProcessEncode(EncodeJob& job) {
             break;
         }
 
-        // Create result
+        HandlePacket(packet, true, true);
+
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    return true;
+}
+
+void VideoEncoderAsync::HandlePacket(const AVPacket* packet, bool withExtradata, bool blocking) {
+    // Create result
+    EncodeResult* result = new EncodeResult();
+    result->data.assign(packet->data, packet->data + packet->size);
+    result->isKeyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    result->pts = packet->pts;
+    result->duration = packet->duration;
+    result->isError = false;
+    result->isFlushComplete = false;
+
+    if (stageTimings_) {
+        for (auto it = frameTimings_.begin(); it != frameTimings_.end(); ++it) {
+            if (it->pts == packet->pts) {
+                result->encodedAtNs = steadyNowNs();
+                result->queueNs = it->dequeuedNs - it->queuedNs;
+                result->convertNs = it->convertedNs - it->dequeuedNs;
+                result->encodeNs = result->encodedAtNs - it->convertedNs;
+                frameTimings_.erase(it);
+                break;
+            }
+        }
+    }
+
+    // Quantizer the encoder actually used (libx264, libx265, libaom, ...)
+    size_t statsSize = 0;
+    const uint8_t* stats = av_packet_get_side_data(packet, AV_PKT_DATA_QUALITY_STATS, &statsSize);
+    if (stats && statsSize >= 4) {
+        const int quality = stats[0] | (stats[1] << 8) | (stats[2] << 16) | (stats[3] << 24);
+        result->qp = (quality + FF_QP2LAMBDA / 2) / FF_QP2LAMBDA;
+    }
+
+    // Include extradata for keyframes
+    if (withExtradata && result->isKeyframe && codecCtx_->extradata && codecCtx_->extradata_size > 0) {
+        result->extradata.assign(codecCtx_->extradata, codecCtx_->extradata + codecCtx_->extradata_size);
+        result->hasExtradata = true;
+    } else {
+        result->hasExtradata = false;
+    }
+
+    // Collect the packets of GOPs being encoded for the cache; without
+    // B-frames each input frame yields one packet with its own pts
+    for (auto it = recordings_.begin(); it != recordings_.end(); ++it) {
+        if (packet->pts < it->firstPts || packet->pts > it->lastPts) {
+            continue;
+        }
+        it->packets.push_back({result->data, result->isKeyframe, packet->pts - it->firstPts, packet->duration,
+                               result->qp});
+        if (it->closed && it->packets.size() == it->frames) {
+            encodeCache_->Store(it->key, std::move(it->packets));
+            recordings_.erase(it);
+        }
+        break;
+    }
+
+    EmitPacket(result, blocking);
+}
+
+void VideoEncoderAsync::CacheFrame(AVFrame* frame, bool forceKeyframe) {
+    // A GOP ends at a forced keyframe or after gop_size frames
+    const size_t gopLength = codecCtx_->gop_size > 0 ? static_cast<size_t>(codecCtx_->gop_size) : 1;
+    if (gopFrameCount_ > 0 && (forceKeyframe || gopFrameCount_ >= gopLength)) {
+        CloseGop(true);
+    }
+
+    // The first frame is hashed on its own; its digest seeds the GOP hash
+    const bool first = gopFrameCount_ == 0;
+    EncodeCache::Hasher startHasher(cacheSeed_);
+    EncodeCache::Hasher& hasher = first ? startHasher : gopHasher_;
+    bool hashed = hasher.UpdateFrame(frame);
+    if (hashed) {
+        // ROI offsets change the packets as much as the pixels do
+        AVFrameSideData* rois = av_frame_get_side_data(frame, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+        if (rois) {
+            hasher.Update(rois->data, rois->size);
+        }
+    }
+    if (!hashed) {
+        // Not hashable (never for the software formats converted above): encode it directly
+        CloseGop(true);
+        frame->pict_type = AV_PICTURE_TYPE_I;
+        encodeCache_->RecordMiss();
+        EncodeFrame(frame);
+        return;
+    }
+    hasher.UpdateValue(first ? 0 : frame->pts - gopFirstPts_);
+    hasher.UpdateValue(frame->quality);
+    gopFrameCount_++;
+
+    if (first) {
+        gopStart_ = startHasher.Digest().lo;
+        gopHasher_.Reset(gopStart_);
+        gopFirstPts_ = frame->pts;
+        // Hold frames back only if the cache has a GOP starting with this
+        // frame and a replay would not overtake packets inside the encoder
+        gopStreaming_ = !encodeCache_->HasStart(gopStart_) || (!recordings_.empty() && !CanDrainEncoder());
+        if (gopStreaming_) {
+            frame->pict_type = AV_PICTURE_TYPE_I;
+            recordings_.push_back({{}, frame->pts, frame->pts, 0, false, {}});
+        }
+    }
+
+    if (!gopStreaming_) {
+        gopBytes_ += static_cast<size_t>(std::max(0, av_image_get_buffer_size(
+            static_cast<AVPixelFormat>(frame->format), frame->width, frame->height, 1)));
+        if (gopBytes_ <= encodeCache_->maxPendingBytes()) {
+            gopFrames_.push_back(frame);
+            return;
+        }
+        // Too large to hold back: encode what was held and stream the rest
+        StreamGop();
+    }
+
+    GopRecording& recording = recordings_.back();
+    recording.lastPts = frame->pts;
+    recording.frames++;
+    EncodeFrame(frame);
+}
+
+void VideoEncoderAsync::StreamGop() {
+    // Start on a keyframe so the stored GOP decodes on its own
+    if (!gopFrames_.empty()) {
+        gopFrames_.front()->pict_type = AV_PICTURE_TYPE_I;
+    }
+    recordings_.push_back({{}, gopFirstPts_, gopFirstPts_, 0, false, {}});
+    for (AVFrame* frame : gopFrames_) {
+        recordings_.back().lastPts = frame->pts;
+        recordings_.back().frames++;
+        EncodeFrame(frame);
+    }
+    gopFrames_.clear();
+    gopStreaming_ = true;
+}
+
+void VideoEncoderAsync::CloseGop(bool blocking) {
+    if (gopFrameCount_ == 0) {
+        return;
+    }
+
+    gopHasher_.UpdateValue(static_cast<int64_t>(gopFrameCount_));
+    const EncodeCache::Key key = {gopStart_, gopHasher_.Digest().lo};
+    gopFrameCount_ = 0;
+    gopBytes_ = 0;
+
+    std::shared_ptr<const EncodeCache::Entry> entry;
+    if (!gopStreaming_) {
+        entry = encodeCache_->Lookup(key);
+        if (!entry) {
+            StreamGop();
+        }
+    } else {
+        encodeCache_->RecordMiss();
+    }
+
+    if (!entry) {
+        // Encoded: stored once all of its packets are out
+        GopRecording& recording = recordings_.back();
+        recording.key = key;
+        recording.closed = true;
+        if (recording.packets.size() == recording.frames) {
+            encodeCache_->Store(key, std::move(recording.packets));
+            recordings_.pop_back();
+        }
+        return;
+    }
+
+    // Replayed packets must not overtake packets still inside the encoder
+    if (!recordings_.empty()) {
+        DrainEncoder(blocking);
+    }
+    for (const EncodeCache::Packet& packet : *entry) {
         EncodeResult* result = new EncodeResult();
-        result->data.assign(packet->data, packet->data + packet->size);
-        result->isKeyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
-        result->pts = packet->pts;
-        result->duration = packet->duration;
+        result->data = packet.data;
+        result->isKeyframe = packet.isKeyframe;
+        result->pts = gopFirstPts_ + packet.ptsOffset;
+        result->duration = packet.duration;
+        result->qp = packet.qp;
         result->isError = false;
         result->isFlushComplete = false;
-
-        // Include extradata for keyframes
-        if (result->isKeyframe && codecCtx_->extradata && codecCtx_->extradata_size > 0) {
+        result->hasExtradata = false;
+        if (packet.isKeyframe && codecCtx_->extradata && codecCtx_->extradata_size > 0) {
             result->extradata.assign(codecCtx_->extradata, codecCtx_->extradata + codecCtx_->extradata_size);
             result->hasExtradata = true;
-        } else {
-            result->hasExtradata = false;
         }
+        EmitPacket(result, blocking);
+    }
+    for (AVFrame*& frame : gopFrames_) {
+        av_frame_free(&frame);
+    }
+    gopFrames_.clear();
+}
 
-        // Call JS callback
-        tsfnOutput_.BlockingCall(result, [](Napi::Env env, Napi::Function fn, EncodeResult* res) {
-            Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                env, res->data.data(), res->data.size());
-
-            Napi::Value extradataValue = env.Undefined();
-            if (res->hasExtradata) {
-                extradataValue = Napi::Buffer<uint8_t>::Copy(
-                    env, res->extradata.data(), res->extradata.size());
-            }
-
-            fn.Call({
-                buffer,
-                Napi::Boolean::New(env, res->isKeyframe),
-                Napi::Number::New(env, static_cast<double>(res->pts)),
-                Napi::Number::New(env, static_cast<double>(res->duration)),
-                extradataValue,
-                env.Undefined()  // alphaSideData (not supported in async yet)
-            });
+bool VideoEncoderAsync::CanDrainEncoder() const {
+#ifdef AV_CODEC_CAP_ENCODER_FLUSH
+    return codec_ && (codec_->capabilities & AV_CODEC_CAP_ENCODER_FLUSH) != 0;
+#else
+    return false;
+#endif
+}
 
-            delete res;
-        });
+void VideoEncoderAsync::DrainEncoder(bool blocking) {
+    // Emit everything the encoder holds, then reopen it for more input
+    avcodec_send_frame(codecCtx_, nullptr);
 
+    AVPacket* packet = av_packet_alloc();
+    while (avcodec_receive_packet(codecCtx_, packet) >= 0) {
+        HandlePacket(packet, true, blocking);
         av_packet_unref(packet);
     }
     av_packet_free(&packet);
+
+    avcodec_flush_buffers(codecCtx_);
+
+    // GOPs that came up short (dropped frames, errors) are not stored
+    recordings_.clear();
+}
+
+void VideoEncoderAsync::DiscardGop() {
+    for (AVFrame*& frame : gopFrames_) {
+        av_frame_free(&frame);
+    }
+    gopFrames_.clear();
+    gopFrameCount_ = 0;
+    gopBytes_ = 0;
+    gopStreaming_ = false;
+    recordings_.clear();
 }
 
 void VideoEncoderAsync::ProcessFlush() {
@@ -672,43 +1198,37 @@ void VideoEncoderAsync::ProcessFlush() {
         return;
     }
 
+    if (resetPending_.exchange(false)) {
+        DiscardGop();
+        frameTimings_.clear();
+    }
+
+    // Packets are emitted with NonBlockingCall to prevent deadlock in resource-constrained
+    // environments (CI, serverless, containers) where the JS event loop may be starved
+
+    // The trailing GOP is complete now
+    if (encodeCache_) {
+        CloseGop(false);
+    }
+
     // Send NULL frame to flush
     avcodec_send_frame(codecCtx_, nullptr);
 
     AVPacket* packet = av_packet_alloc();
-    int ret;
-    while ((ret = avcodec_receive_packet(codecCtx_, packet)) >= 0) {
-        EncodeResult* result = new EncodeResult();
-        result->data.assign(packet->data, packet->data + packet->size);
-        result->isKeyframe = (packet->flags & AV_PKT_FLAG_KEY) != 0;
-        result->pts = packet->pts;
-        result->duration = packet->duration;
-        result->isError = false;
-        result->isFlushComplete = false;
-        result->hasExtradata = false;
-
-        // Use NonBlockingCall to prevent deadlock in resource-constrained environments
-        // (CI, serverless, containers) where the JS event loop may be starved
-        tsfnOutput_.NonBlockingCall(result, [](Napi::Env env, Napi::Function fn, EncodeResult* res) {
-            Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                env, res->data.data(), res->data.size());
-
-            fn.Call({
-                buffer,
-                Napi::Boolean::New(env, res->isKeyframe),
-                Napi::Number::New(env, static_cast<double>(res->pts)),
-                Napi::Number::New(env, static_cast<double>(res->duration)),
-                env.Undefined(),
-                env.Undefined()
-            });
-
-            delete res;
-        });
-
+    while (avcodec_receive_packet(codecCtx_, packet) >= 0) {
+        HandlePacket(packet, false, false);
         av_packet_unref(packet);
     }
     av_packet_free(&packet);
 
+    if (encodeCache_) {
+        recordings_.clear();
+        // Keep encoding after flush() when the encoder allows it
+        if (CanDrainEncoder()) {
+            avcodec_flush_buffers(codecCtx_);
+        }
+    }
+
     // Signal flush complete using NonBlockingCall to prevent deadlock
     if (tsfnFlush_) {
         tsfnFlush_.NonBlockingCall([](Napi::Env env, Napi::Function fn) {
@@ -720,12 +1240,55 @@ void VideoEncoderAsync::ProcessFlush() {
     flushCV_.notify_all();
 }
 
-void VideoEncoderAsync::Encode(const Napi::CallbackInfo& info) {
+void VideoEncoderAsync::EmitPacket(EncodeResult* result, bool blocking) {
+    if (liveGop_) {
+        liveGop_->Add(result->data, result->isKeyframe, result->pts, result->duration,
+                      result->hasExtradata ? &result->extradata : nullptr);
+    }
+
+    if (pullOutputs_.Enabled()) {
+        // Blocks here when the buffer is full and the policy is "block"
+        pullOutputs_.Push(result, !stopping_);
+        return;
+    }
+
+    auto callback = [](Napi::Env env, Napi::Function fn, EncodeResult* res) {
+        Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
+            env, res->data.data(), res->data.size());
+
+        Napi::Value extradataValue = env.Undefined();
+        if (res->hasExtradata) {
+            extradataValue = Napi::Buffer<uint8_t>::Copy(
+                env, res->extradata.data(), res->extradata.size());
+        }
+
+        fn.Call({
+            buffer,
+            Napi::Boolean::New(env, res->isKeyframe),
+            Napi::Number::New(env, static_cast<double>(res->pts)),
+            Napi::Number::New(env, static_cast<double>(res->duration)),
+            extradataValue,
+            env.Undefined(),  // alphaSideData (not supported in async yet)
+            res->qp >= 0 ? Napi::Number::New(env, res->qp) : env.Undefined(),
+            stageTimingsToJS(env, res)
+        });
+
+        delete res;
+    };
+
+    if (blocking) {
+        tsfnOutput_.BlockingCall(result, callback);
+    } else {
+        tsfnOutput_.NonBlockingCall(result, callback);
+    }
+}
+
+Napi::Value VideoEncoderAsync::Encode(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     if (!configured_) {
         Napi::Error::New(env, "Encoder not configured").ThrowAsJavaScriptException();
-        return;
+        return env.Undefined();
     }
 
     // Get native frame
@@ -734,26 +1297,325 @@ void VideoEncoderAsync::Encode(const Napi::CallbackInfo& info) {
 
     if (!srcFrame) {
         Napi::Error::New(env, "Invalid frame").ThrowAsJavaScriptException();
-        return;
+        return env.Undefined();
     }
 
     int64_t timestamp = info[1].As<Napi::Number>().Int64Value();
     bool forceKeyframe = info[2].As<Napi::Boolean>().Value();
 
+    // Optional orientation pre-stage
+    int rotation = info.Length() > 3 && info[3].IsNumber() ? info[3].As<Napi::Number>().Int32Value() : 0;
+    bool flip = info.Length() > 4 && info[4].IsBoolean() && info[4].As<Napi::Boolean>().Value();
+    if ((rotation != 0 || flip) && !FrameTransform::isSupported(srcFrame, rotation)) {
+        Napi::Error::New(env, "Rotation/flip not supported for this frame").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // Optional per-frame regions of interest
+    std::vector<AVRegionOfInterest> rois;
+    if (info.Length() > 5 && !info[5].IsUndefined()) {
+        std::string error;
+        if (!parseRegionsOfInterest(info[5], rois, error)) {
+            Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    // Optional per-frame quantizer (AVC/HEVC only, checked by the caller)
+    int quantizer = -1;
+    if (info.Length() > 6 && info[6].IsNumber()) {
+        quantizer = info[6].As<Napi::Number>().Int32Value();
+        if (quantizer < 0 || quantizer > 51) {
+            Napi::RangeError::New(env, "quantizer must be between 0 and 51").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    EncodeJob job;
+    job.timestamp = timestamp;
+    job.forceKeyframe = forceKeyframe;
+    job.rotation = rotation;
+    job.flip = flip;
+    job.rois = std::move(rois);
+    job.quantizer = quantizer;
+
+    // false tells the caller to wait for the backpressure resume callback
+    bool belowHighWater = true;
+    lastEncodeQueued_ = 0;
+
+    // Frame-rate stage: decided from the timestamp, before the frame is copied
+    FrameRate::Converter::Step step;
+    if (frameRate_.Active()) {
+        step = frameRate_.Place(timestamp);
+        if (step.closeGroup) {
+            belowHighWater = QueueBlendGroup();
+        }
+        for (int64_t i = 0; i < step.repeatCount; i++) {
+            belowHighWater = QueueRepeat(frameRate_.SlotTime(step.repeatFrom + i));
+        }
+        if (!step.take && !step.join) {
+            // A keyframe request on a dropped frame moves to the next kept one
+            pendingKeyframe_ = pendingKeyframe_ || forceKeyframe;
+            return Napi::Boolean::New(env, belowHighWater);
+        }
+        if (step.take) {
+            job.timestamp = frameRate_.SlotTime(step.slot);
+            job.forceKeyframe = forceKeyframe || pendingKeyframe_;
+            pendingKeyframe_ = false;
+        }
+    }
+
     // Clone frame for async processing
-    AVFrame* frameCopy = av_frame_clone(srcFrame);
-    if (!frameCopy) {
+    job.frame = av_frame_clone(srcFrame);
+    if (!job.frame) {
         Napi::Error::New(env, "Failed to clone frame").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (frameRate_.mode() == FrameRate::Mode::Blend) {
+        // Held until a frame for a later slot (or flush) closes the group
+        if (step.join) {
+            blendJob_.blend.push_back(job.frame);
+            blendJob_.forceKeyframe = blendJob_.forceKeyframe || forceKeyframe;
+        } else {
+            blendJob_ = std::move(job);
+        }
+        return Napi::Boolean::New(env, belowHighWater);
+    }
+
+    if (frameRate_.Active()) {
+        // Kept for repeats when input frames are missing
+        av_frame_free(&lastFrame_);
+        lastFrame_ = av_frame_clone(job.frame);
+        lastJob_ = job;
+        lastJob_.frame = nullptr;
+    }
+
+    belowHighWater = QueueJob(std::move(job));
+    return Napi::Boolean::New(env, belowHighWater);
+}
+
+bool VideoEncoderAsync::QueueJob(EncodeJob&& job) {
+    if (stageTimings_) {
+        job.queuedNs = steadyNowNs();
+    }
+    jobs_.Push(std::move(job));
+    lastEncodeQueued_++;
+    return backpressure_.OnPush([this] { return jobs_.size(); });
+}
+
+bool VideoEncoderAsync::QueueRepeat(int64_t timestamp) {
+    AVFrame* frame = lastFrame_ ? av_frame_clone(lastFrame_) : nullptr;
+    if (!frame) {
+        return true;
+    }
+    EncodeJob job = lastJob_;
+    job.frame = frame;
+    job.timestamp = timestamp;
+    job.forceKeyframe = false;
+    return QueueJob(std::move(job));
+}
+
+bool VideoEncoderAsync::QueueBlendGroup() {
+    if (!blendJob_.frame) {
+        return true;
+    }
+    // Repeats show the newest frame of the group
+    av_frame_free(&lastFrame_);
+    lastFrame_ = av_frame_clone(blendJob_.blend.empty() ? blendJob_.frame : blendJob_.blend.back());
+    lastJob_ = blendJob_;
+    lastJob_.frame = nullptr;
+    lastJob_.blend.clear();
+
+    EncodeJob job = std::move(blendJob_);
+    blendJob_ = EncodeJob{};
+    return QueueJob(std::move(job));
+}
+
+void VideoEncoderAsync::DiscardFrameRateState() {
+    frameRate_.Reset();
+    av_frame_free(&lastFrame_);
+    DisposeJob(blendJob_);
+    blendJob_ = EncodeJob{};
+    lastJob_ = EncodeJob{};
+    pendingKeyframe_ = false;
+}
+
+Napi::Value VideoEncoderAsync::GetLastEncodeQueued(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), lastEncodeQueued_);
+}
+
+bool VideoEncoderAsync::parseRegionsOfInterest(Napi::Value value, std::vector<AVRegionOfInterest>& rois,
+                                               std::string& error) const {
+    if (!value.IsArray()) {
+        error = "roi must be an array";
+        return false;
+    }
+
+    Napi::Array list = value.As<Napi::Array>();
+    for (uint32_t i = 0; i < list.Length(); i++) {
+        Napi::Value item = list.Get(i);
+        if (!item.IsObject()) {
+            error = "Each roi entry must be an object";
+            return false;
+        }
+        Napi::Object obj = item.As<Napi::Object>();
+
+        double rect[4];
+        const char* keys[4] = {"x", "y", "width", "height"};
+        for (int k = 0; k < 4; k++) {
+            Napi::Value v = obj.Get(keys[k]);
+            if (!v.IsNumber()) {
+                error = std::string("roi ") + keys[k] + " must be a number";
+                return false;
+            }
+            rect[k] = v.As<Napi::Number>().DoubleValue();
+        }
+        Napi::Value offsetValue = obj.Get("qualityOffset");
+        double quality = 0.0;
+        if (!offsetValue.IsUndefined()) {
+            quality = offsetValue.IsNumber() ? offsetValue.As<Napi::Number>().DoubleValue() : 2.0;
+        }
+        if (!(quality >= -1.0 && quality <= 1.0)) {
+            error = "roi qualityOffset must be between -1 and 1";
+            return false;
+        }
+
+        // Clip to the encoded picture; empty regions are dropped
+        const int left = static_cast<int>(std::max(0.0, rect[0]));
+        const int top = static_cast<int>(std::max(0.0, rect[1]));
+        const int right = static_cast<int>(std::min<double>(width_, rect[0] + rect[2]));
+        const int bottom = static_cast<int>(std::min<double>(height_, rect[1] + rect[3]));
+        if (right <= left || bottom <= top) {
+            continue;
+        }
+
+        AVRegionOfInterest roi;
+        roi.self_size = sizeof(AVRegionOfInterest);
+        roi.left = left;
+        roi.top = top;
+        roi.right = right;
+        roi.bottom = bottom;
+        // FFmpeg's qoffset is a quantizer offset: negative means better quality
+        roi.qoffset = { -static_cast<int>(std::lround(quality * 1000)), 1000 };
+        rois.push_back(roi);
+    }
+    return true;
+}
+
+void VideoEncoderAsync::SetBackpressure(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Expected (highWaterMark, lowWaterMark, onResume)").ThrowAsJavaScriptException();
         return;
     }
 
-    EncodeJob job{frameCopy, timestamp, forceKeyframe, false};
+    int64_t highWater = info[0].As<Napi::Number>().Int64Value();
+    int64_t lowWater = info[1].As<Napi::Number>().Int64Value();
 
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        jobQueue_.push(std::move(job));
+    backpressure_.Configure(env,
+                            static_cast<size_t>(std::max<int64_t>(0, highWater)),
+                            static_cast<size_t>(std::max<int64_t>(0, lowWater)),
+                            info[2].As<Napi::Function>());
+}
+
+void VideoEncoderAsync::SetPullMode(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // setPullMode(false): back to the output callback
+    if (info.Length() > 0 && info[0].IsBoolean() && !info[0].As<Napi::Boolean>().Value()) {
+        pullOutputs_.Disable();
+        return;
     }
-    queueCV_.notify_one();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsString() || !info[2].IsFunction()) {
+        Napi::TypeError::New(env, "Expected (capacity, policy, onReadable)").ThrowAsJavaScriptException();
+        return;
+    }
+
+    std::string policyName = info[1].As<Napi::String>().Utf8Value();
+    OutputBuffer<EncodeResult>::Policy policy;
+    if (!OutputBuffer<EncodeResult>::ParsePolicy(policyName, policy)) {
+        Napi::TypeError::New(env, "Unknown pull policy: " + policyName).ThrowAsJavaScriptException();
+        return;
+    }
+
+    int64_t capacity = info[0].As<Napi::Number>().Int64Value();
+    pullOutputs_.Enable(env, static_cast<size_t>(std::max<int64_t>(1, capacity)), policy,
+                        info[2].As<Napi::Function>());
+}
+
+Napi::Value VideoEncoderAsync::TakeOutputs(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    size_t max = SIZE_MAX;
+    if (info.Length() > 0 && info[0].IsNumber()) {
+        max = static_cast<size_t>(std::max<int64_t>(0, info[0].As<Napi::Number>().Int64Value()));
+    }
+
+    std::vector<EncodeResult*> results = pullOutputs_.Take(max);
+    Napi::Array batch = Napi::Array::New(env, results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        EncodeResult* res = results[i];
+
+        Napi::Object output = Napi::Object::New(env);
+        output.Set("data", Napi::Buffer<uint8_t>::Copy(env, res->data.data(), res->data.size()));
+        output.Set("isKeyframe", Napi::Boolean::New(env, res->isKeyframe));
+        output.Set("timestamp", Napi::Number::New(env, static_cast<double>(res->pts)));
+        output.Set("duration", Napi::Number::New(env, static_cast<double>(res->duration)));
+        if (res->hasExtradata) {
+            output.Set("extradata", Napi::Buffer<uint8_t>::Copy(
+                env, res->extradata.data(), res->extradata.size()));
+        }
+        if (res->qp >= 0) {
+            output.Set("qp", Napi::Number::New(env, res->qp));
+        }
+        if (res->queueNs >= 0) {
+            output.Set("stageTimings", stageTimingsToJS(env, res));
+        }
+        batch.Set(static_cast<uint32_t>(i), output);
+
+        delete res;
+    }
+    return batch;
+}
+
+Napi::Value VideoEncoderAsync::GetDroppedOutputs(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(pullOutputs_.Dropped()));
+}
+
+Napi::Value VideoEncoderAsync::GetLiveGop(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    LiveGopCache::Snapshot snapshot;
+    if (!liveGop_ || !liveGop_->Take(snapshot)) {
+        return env.Null();
+    }
+
+    Napi::Array packets = Napi::Array::New(env, snapshot.packets.size());
+    for (size_t i = 0; i < snapshot.packets.size(); i++) {
+        const LiveGopCache::Packet& packet = *snapshot.packets[i];
+        Napi::Object output = Napi::Object::New(env);
+        output.Set("data", Napi::Buffer<uint8_t>::Copy(env, packet.data.data(), packet.data.size()));
+        output.Set("isKeyframe", Napi::Boolean::New(env, packet.isKeyframe));
+        output.Set("timestamp", Napi::Number::New(env, static_cast<double>(packet.pts)));
+        output.Set("duration", Napi::Number::New(env, static_cast<double>(packet.duration)));
+        packets.Set(static_cast<uint32_t>(i), output);
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("packets", packets);
+    if (snapshot.extradata) {
+        result.Set("extradata", Napi::Buffer<uint8_t>::Copy(
+            env, snapshot.extradata->data(), snapshot.extradata->size()));
+    }
+    result.Set("bytes", Napi::Number::New(env, static_cast<double>(snapshot.bytes)));
+    return result;
+}
+
+Napi::Value VideoEncoderAsync::GetQueueDepth(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(jobs_.size()));
 }
 
 Napi::Value VideoEncoderAsync::Flush(const Napi::CallbackInfo& info) {
@@ -777,30 +1639,30 @@ Napi::Value VideoEncoderAsync::Flush(const Napi::CallbackInfo& info) {
 
     flushPending_ = true;
 
+    // A blend group still collecting frames goes out before the flush
+    if (frameRate_.OpenSlot() >= 0) {
+        QueueBlendGroup();
+        frameRate_.CloseOpenSlot();
+    }
+
     // Queue flush job
-    EncodeJob job{nullptr, 0, false, true};
+    EncodeJob job;
+    job.isFlush = true;
 
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        jobQueue_.push(std::move(job));
-    }
-    queueCV_.notify_one();
+    jobs_.Push(std::move(job));
 
     return env.Undefined();
 }
 
 void VideoEncoderAsync::Reset(const Napi::CallbackInfo& info) {
-    // Wait for pending work to complete
-    {
-        std::unique_lock<std::mutex> lock(queueMutex_);
-        // Clear queue
-        while (!jobQueue_.empty()) {
-            EncodeJob& job = jobQueue_.front();
-            if (job.frame) {
-                av_frame_free(&job.frame);
-            }
-            jobQueue_.pop();
-        }
+    // Drop queued jobs; the worker frees them as it reaches them
+    jobs_.Discard();
+    backpressure_.OnPop(0);
+    pullOutputs_.Clear();
+    resetPending_ = true;
+    DiscardFrameRateState();
+    if (liveGop_) {
+        liveGop_->Clear();
     }
 
     if (codecCtx_) {
@@ -811,25 +1673,19 @@ void VideoEncoderAsync::Reset(const Napi::CallbackInfo& info) {
 void VideoEncoderAsync::Close(const Napi::CallbackInfo& info) {
     // Stop worker thread
     running_ = false;
-    queueCV_.notify_all();
+    jobs_.Wake();
+    pullOutputs_.Disable();
 
     if (workerThread_.joinable()) {
         workerThread_.join();
     }
 
     // Clear queue
-    {
-        std::lock_guard<std::mutex> lock(queueMutex_);
-        while (!jobQueue_.empty()) {
-            EncodeJob& job = jobQueue_.front();
-            if (job.frame) {
-                av_frame_free(&job.frame);
-            }
-            jobQueue_.pop();
-        }
-    }
+    jobs_.Clear();
 
     // Clean up FFmpeg
+    DiscardFrameRateState();
+    DiscardGop();
     if (swsCtx_) {
         sws_freeContext(swsCtx_);
         swsCtx_ = nullptr;
@@ -2,12 +2,23 @@
 #define ASYNC_ENCODER_H
 
 #include <napi.h>
-#include <queue>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
 #include <atomic>
+#include <algorithm>
+#include <memory>
+#include <vector>
 #include "hw_accel.h"
+#include "tonemap.h"
+#include "lut3d.h"
+#include "encode_cache.h"
+#include "backpressure.h"
+#include "job_ring.h"
+#include "live_gop_cache.h"
+#include "frame_rate.h"
+#include "output_buffer.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -19,10 +30,16 @@ extern "C" {
 
 // Job to be processed by worker thread
 struct EncodeJob {
-    AVFrame* frame;
-    int64_t timestamp;
-    bool forceKeyframe;
-    bool isFlush;  // True if this is a flush signal
+    AVFrame* frame = nullptr;
+    int64_t timestamp = 0;
+    bool forceKeyframe = false;
+    bool isFlush = false;  // True if this is a flush signal
+    int rotation = 0;      // Clockwise degrees applied before conversion
+    bool flip = false;     // Horizontal flip after rotation
+    std::vector<AVRegionOfInterest> rois;  // In encoded picture coordinates
+    int quantizer = -1;                    // Per-frame QP in quantizer mode, -1 for the default
+    std::vector<AVFrame*> blend;           // Frame-rate blend: averaged with `frame` on the worker
+    int64_t queuedNs = 0;                  // Stage timings: steady clock when the JS thread queued it
 };
 
 // Result from worker thread back to JS
@@ -36,6 +53,12 @@ struct EncodeResult {
     bool isError;
     std::string errorMessage;
     bool isFlushComplete;
+    int qp = -1;  // From AV_PKT_DATA_QUALITY_STATS, -1 if the encoder does not report it
+    // Stage timings in ns, -1 unless enabled: queued -> picked up -> converted -> packet out
+    int64_t queueNs = -1;
+    int64_t convertNs = -1;
+    int64_t encodeNs = -1;
+    int64_t encodedAtNs = 0;
 };
 
 class VideoEncoderAsync : public Napi::ObjectWrap<VideoEncoderAsync> {
@@ -49,20 +72,67 @@ private:
 
     // JavaScript-facing methods
     void Configure(const Napi::CallbackInfo& info);
-    void Encode(const Napi::CallbackInfo& info);
+    Napi::Value Encode(const Napi::CallbackInfo& info);
     Napi::Value Flush(const Napi::CallbackInfo& info);
     void Reset(const Napi::CallbackInfo& info);
     void Close(const Napi::CallbackInfo& info);
+    void SetBackpressure(const Napi::CallbackInfo& info);
+    Napi::Value GetQueueDepth(const Napi::CallbackInfo& info);
+    void SetPullMode(const Napi::CallbackInfo& info);
+    Napi::Value TakeOutputs(const Napi::CallbackInfo& info);
+    Napi::Value GetDroppedOutputs(const Napi::CallbackInfo& info);
+    Napi::Value GetLiveGop(const Napi::CallbackInfo& info);
+    Napi::Value GetLastEncodeQueued(const Napi::CallbackInfo& info);
+
+    // Frame-rate stage (main thread): queue a job, or the pieces the converter emits
+    bool QueueJob(EncodeJob&& job);
+    bool QueueRepeat(int64_t timestamp);
+    bool QueueBlendGroup();
+    void DiscardFrameRateState();
 
     // Worker thread entry point
     void WorkerThread();
+    // Let the worker dispose of the discarded jobs, then join it (main thread)
+    void StopWorker();
+    // Reject a flush whose job was discarded by reconfigure (main thread)
+    void AbortFlush();
 
     // Process a single encode job (runs on worker thread)
     void ProcessEncode(EncodeJob& job);
     void ProcessFlush();
+    void EmitPacket(EncodeResult* result, bool blocking);
+
+    // Send one converted frame and emit whatever packets are ready; frees the frame
+    bool EncodeFrame(AVFrame* frame);
+    void HandlePacket(const AVPacket* packet, bool withExtradata, bool blocking);
+
+    // Encode cache: frames are hashed per GOP as they stream to the encoder, or
+    // held back and replayed from the cache when the GOP may be a hit
+    void CacheFrame(AVFrame* frame, bool forceKeyframe);
+    void StreamGop();
+    void CloseGop(bool blocking);
+    bool CanDrainEncoder() const;
+    void DrainEncoder(bool blocking);
+    void DiscardGop();
+    static void FreeResult(EncodeResult* res) { delete res; }
+    static void DisposeJob(EncodeJob& job) {
+        if (job.frame) {
+            av_frame_free(&job.frame);
+        }
+        for (AVFrame*& frame : job.blend) {
+            av_frame_free(&frame);
+        }
+        job.blend.clear();
+    }
+
+    // Whether the configured encoder reads AV_FRAME_DATA_REGIONS_OF_INTEREST
+    bool AppliesRoi() const;
+    // Parse ROI rectangles for this encoder's picture size; false and a message on bad input
+    bool parseRegionsOfInterest(Napi::Value value, std::vector<AVRegionOfInterest>& rois, std::string& error) const;
 
     // Helper to configure encoder options
-    void configureEncoderOptions(const std::string& encoderName, const std::string& latencyMode);
+    void configureEncoderOptions(const std::string& encoderName, const std::string& latencyMode,
+                                 const std::string& contentHint);
 
     // Thread-safe functions for callbacks to JS
     Napi::ThreadSafeFunction tsfnOutput_;
@@ -72,12 +142,12 @@ private:
     // Worker thread
     std::thread workerThread_;
     std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};  // StopWorker() is waiting: pull mode must not block
     std::atomic<bool> configured_{false};
 
-    // Job queue with synchronization
-    std::queue<EncodeJob> jobQueue_;
-    std::mutex queueMutex_;
-    std::condition_variable queueCV_;
+    // Job queue: JS thread produces, worker consumes
+    JobRing<EncodeJob> jobs_{64, &VideoEncoderAsync::DisposeJob};
+    QueueBackpressure backpressure_;
 
     // Flush synchronization
     std::mutex flushMutex_;
@@ -85,11 +155,67 @@ private:
     std::atomic<bool> flushPending_{false};
     Napi::FunctionReference flushCallback_;
 
+    // Pull mode: outputs wait here for takeOutputs() instead of the output callback
+    OutputBuffer<EncodeResult> pullOutputs_{&VideoEncoderAsync::FreeResult};
+
     // FFmpeg context (owned/accessed by worker thread after configure)
     AVCodecContext* codecCtx_;
     const AVCodec* codec_;
     SwsContext* swsCtx_;
 
+    // HDR -> SDR pre-stage, created at configure when toneMapping is set (worker thread)
+    std::unique_ptr<ToneMap::ToneMapper> toneMapper_;
+
+    // Color LUT applied to every input frame, if configured
+    std::shared_ptr<const Lut3D> colorLut_;
+
+    // Encode result cache, if configured (worker thread state below)
+    struct GopRecording {
+        EncodeCache::Key key;
+        int64_t firstPts;
+        int64_t lastPts;
+        size_t frames;
+        bool closed;                      // Every frame sent and the key known
+        EncodeCache::Entry packets;
+    };
+    std::shared_ptr<EncodeCache> encodeCache_;
+    uint64_t cacheSeed_;                  // Hash of the normalized encoder settings
+    std::vector<AVFrame*> gopFrames_;     // Held back while the open GOP may be a hit
+    size_t gopFrameCount_ = 0;
+    size_t gopBytes_ = 0;
+    int64_t gopFirstPts_ = 0;
+    uint64_t gopStart_ = 0;               // Digest of the first frame (Key::hi)
+    bool gopStreaming_ = false;           // Frames of the open GOP go straight to the encoder
+    EncodeCache::Hasher gopHasher_;
+    std::deque<GopRecording> recordings_;  // Encoded GOPs waiting for their packets
+
+    // Frame-rate conversion on the input (main thread state). The previous
+    // kept frame is held for repeats; blend collects one slot's frames.
+    FrameRate::Converter frameRate_;
+    AVFrame* lastFrame_ = nullptr;
+    EncodeJob lastJob_{};
+    EncodeJob blendJob_{};
+    bool pendingKeyframe_ = false;
+    int lastEncodeQueued_ = 0;
+
+    // Packets since the last keyframe for late joiners, if configured
+    std::unique_ptr<LiveGopCache> liveGop_;
+
+    // Per-frame stage timings, if configured. The worker keeps the times of
+    // frames inside the encoder until their packet comes out.
+    struct FrameTiming {
+        int64_t pts;
+        int64_t queuedNs;
+        int64_t dequeuedNs;
+        int64_t convertedNs;
+    };
+    bool stageTimings_ = false;
+    std::deque<FrameTiming> frameTimings_;
+
+    // Set by Reset(); the worker drops its GOP recording and frame timings
+    // before the next job, since it may be using them while JS resets
+    std::atomic<bool> resetPending_{false};
+
     // Hardware acceleration
     HWAccel::Type hwType_;
     AVBufferRef* hwDeviceCtx_;
@@ -107,6 +233,9 @@ private:
     std::string scalabilityMode_;
     int temporalLayers_;
     std::string latencyMode_;
+    std::string contentHint_;  // "", "motion", "detail" or "text"
+    bool intraOnly_;           // Every frame a keyframe (editing proxies)
+    bool roiSupported_;  // Encoder reads AV_FRAME_DATA_REGIONS_OF_INTEREST
 };
 
 #endif // ASYNC_ENCODER_H
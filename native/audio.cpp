@@ -1,4 +1,5 @@
 #include "audio.h"
+#include <algorithm>
 #include <cstring>
 
 // ==================== AudioDataNative ====================
@@ -203,7 +204,8 @@ AudioDecoderNative::AudioDecoderNative(const Napi::CallbackInfo& info)
     , swrCtx_(nullptr)
     , configured_(false)
     , sampleRate_(0)
-    , channels_(0) {
+    , channels_(0)
+    , loudnessEnabled_(false) {
 
     Napi::Env env = info.Env();
 
@@ -280,6 +282,22 @@ void AudioDecoderNative::Configure(const Napi::CallbackInfo& info) {
         memset(codecCtx_->extradata + extradata.Length(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
     }
 
+    // EBU R128 metering of everything this decoder outputs
+    loudnessEnabled_ = config.Has("loudness") && config.Get("loudness").IsBoolean() &&
+                       config.Get("loudness").As<Napi::Boolean>().Value();
+    loudness_.reset();
+
+    // Resource limits; max_samples is checked by FFmpeg before allocation
+    std::string limitsError;
+    if (!limits_.Parse(config.Get("limits"), limitsError)) {
+        avcodec_free_context(&codecCtx_);
+        Napi::TypeError::New(env, limitsError).ThrowAsJavaScriptException();
+        return;
+    }
+    limits_.maxWidth = limits_.maxHeight = 0;
+    limits_.maxDecodeTimeMs = 0;
+    limits_.Apply(codecCtx_);
+
     int ret = avcodec_open2(codecCtx_, codec_, nullptr);
     if (ret < 0) {
         char errBuf[256];
@@ -305,6 +323,12 @@ void AudioDecoderNative::Decode(const Napi::CallbackInfo& info) {
     int64_t timestamp = info[2].As<Napi::Number>().Int64Value();
     int64_t duration = info[3].As<Napi::Number>().Int64Value();
 
+    const std::string oversize = limits_.CheckChunk(data.Length());
+    if (!oversize.empty()) {
+        EmitError(env, oversize, "QuotaExceededError");
+        return;
+    }
+
     // Create packet
     AVPacket* packet = av_packet_alloc();
     packet->data = data.Data();
@@ -377,6 +401,16 @@ void AudioDecoderNative::EmitData(Napi::Env env, AVFrame* frame, int64_t timesta
         return;
     }
 
+    // Meter the converted samples, so measurement needs no second pass
+    Napi::Value loudness = env.Undefined();
+    if (loudnessEnabled_) {
+        if (!loudness_ || loudness_->sampleRate() != frame->sample_rate || loudness_->channels() != numChannels) {
+            loudness_.reset(new LoudnessMeter(frame->sample_rate, numChannels));
+        }
+        loudness_->Process(outputData.data(), outSamples);
+        loudness = LoudnessMeter::ToJS(env, loudness_->Measure());
+    }
+
     Napi::Float32Array buffer = Napi::Float32Array::New(env, outputData.size());
     memcpy(buffer.Data(), outputData.data(), outputData.size() * sizeof(float));
 
@@ -386,12 +420,13 @@ void AudioDecoderNative::EmitData(Napi::Env env, AVFrame* frame, int64_t timesta
         Napi::Number::New(env, frame->sample_rate),
         Napi::Number::New(env, numSamples),
         Napi::Number::New(env, numChannels),
-        Napi::Number::New(env, timestamp)
+        Napi::Number::New(env, timestamp),
+        loudness
     });
 }
 
-void AudioDecoderNative::EmitError(Napi::Env env, const std::string& message) {
-    errorCallback_.Value().Call({ Napi::String::New(env, message) });
+void AudioDecoderNative::EmitError(Napi::Env env, const std::string& message, const char* name) {
+    errorCallback_.Value().Call({ Napi::String::New(env, message), Napi::String::New(env, name) });
 }
 
 Napi::Value AudioDecoderNative::Flush(const Napi::CallbackInfo& info) {
@@ -419,6 +454,7 @@ void AudioDecoderNative::Reset(const Napi::CallbackInfo& info) {
     if (codecCtx_) {
         avcodec_flush_buffers(codecCtx_);
     }
+    loudness_.reset();
 }
 
 void AudioDecoderNative::Close(const Napi::CallbackInfo& info) {
@@ -437,6 +473,171 @@ void AudioDecoderNative::Close(const Napi::CallbackInfo& info) {
 
 // ==================== AudioEncoderNative ====================
 
+namespace AudioEncoding {
+
+AVCodecContext* open(const std::string& codecName, int sampleRate, int channels, int64_t bitrate,
+                     std::string& error) {
+    const AVCodec* codec = avcodec_find_encoder_by_name(codecName.c_str());
+    if (!codec) {
+        error = "Codec not found: " + codecName;
+        return nullptr;
+    }
+
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    if (!ctx) {
+        error = "Failed to allocate codec context";
+        return nullptr;
+    }
+
+    ctx->sample_rate = sampleRate;
+    // WebCodecs timestamps are in microseconds, so use microsecond time_base
+    ctx->time_base = { 1, 1000000 };
+
+    // Select appropriate sample format for codec
+    // Each codec has different requirements
+    if (codecName == "libopus") {
+        ctx->sample_fmt = AV_SAMPLE_FMT_FLT;  // Opus uses float non-planar
+    } else if (codecName == "flac") {
+        ctx->sample_fmt = AV_SAMPLE_FMT_S16;  // FLAC uses s16
+    } else if (codecName == "libmp3lame") {
+        ctx->sample_fmt = AV_SAMPLE_FMT_FLTP; // MP3 uses float planar
+    } else {
+        // AAC and most others use float planar
+        ctx->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    }
+
+    AVChannelLayout layout;
+    av_channel_layout_default(&layout, channels);
+    av_channel_layout_copy(&ctx->ch_layout, &layout);
+    av_channel_layout_uninit(&layout);
+
+    ctx->bit_rate = bitrate > 0 ? bitrate : 128000;  // 128 kbps default
+
+    int ret = avcodec_open2(ctx, codec, nullptr);
+    if (ret < 0) {
+        char errBuf[256];
+        av_strerror(ret, errBuf, sizeof(errBuf));
+        avcodec_free_context(&ctx);
+        error = std::string("Failed to open codec: ") + errBuf;
+        return nullptr;
+    }
+    return ctx;
+}
+
+bool encode(AVCodecContext* ctx, SwrContext*& swr, const float* data, int sampleRate, int numberOfFrames,
+            int numberOfChannels, int64_t timestamp, const std::function<void(const AVPacket*)>& onPacket,
+            std::string& error) {
+    const int frameSize = ctx->frame_size > 0 ? ctx->frame_size : 1024;
+
+    // Setup frame
+    AVFrame* frame = av_frame_alloc();
+    frame->format = ctx->sample_fmt;
+    frame->sample_rate = ctx->sample_rate;
+    av_channel_layout_copy(&frame->ch_layout, &ctx->ch_layout);
+    frame->nb_samples = std::min(numberOfFrames, frameSize);
+    frame->pts = timestamp;
+
+    int ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0) {
+        char errBuf[256];
+        av_strerror(ret, errBuf, sizeof(errBuf));
+        av_frame_free(&frame);
+        error = std::string("Failed to allocate frame: ") + errBuf;
+        return false;
+    }
+
+    // Convert input to encoder format
+    if (!swr) {
+        AVChannelLayout inLayout, outLayout;
+        av_channel_layout_default(&inLayout, numberOfChannels);
+        av_channel_layout_copy(&outLayout, &ctx->ch_layout);
+
+        int swrRet = swr_alloc_set_opts2(&swr,
+            &outLayout, ctx->sample_fmt, ctx->sample_rate,
+            &inLayout, AV_SAMPLE_FMT_FLT, sampleRate,
+            0, nullptr);
+
+        av_channel_layout_uninit(&inLayout);
+        av_channel_layout_uninit(&outLayout);
+
+        if (swrRet < 0 || swr_init(swr) < 0) {
+            av_frame_free(&frame);
+            error = "Failed to initialize resampler";
+            return false;
+        }
+    }
+
+    const uint8_t* inPtr = (const uint8_t*)data;
+    int outSamples = swr_convert(swr,
+        frame->data, frame->nb_samples,
+        &inPtr, numberOfFrames);
+
+    if (outSamples < 0) {
+        av_frame_free(&frame);
+        error = "Resampling failed";
+        return false;
+    }
+
+    frame->nb_samples = outSamples;
+
+    ret = avcodec_send_frame(ctx, frame);
+    av_frame_free(&frame);
+
+    if (ret < 0) {
+        char errBuf[256];
+        av_strerror(ret, errBuf, sizeof(errBuf));
+        error = std::string("Encode error: ") + errBuf;
+        return false;
+    }
+
+    AVPacket* packet = av_packet_alloc();
+    bool ok = true;
+    while (ret >= 0) {
+        ret = avcodec_receive_packet(ctx, packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            break;
+        } else if (ret < 0) {
+            char errBuf[256];
+            av_strerror(ret, errBuf, sizeof(errBuf));
+            error = std::string("Encode error: ") + errBuf;
+            ok = false;
+            break;
+        }
+
+        onPacket(packet);
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    return ok;
+}
+
+void drain(AVCodecContext* ctx, const std::function<void(const AVPacket*)>& onPacket) {
+    avcodec_send_frame(ctx, nullptr);
+
+    AVPacket* packet = av_packet_alloc();
+    while (avcodec_receive_packet(ctx, packet) >= 0) {
+        onPacket(packet);
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+}
+
+int64_t packetTimestamp(const AVCodecContext* ctx, const AVPacket* packet) {
+    // WebCodecs spec: output timestamps should match input timestamps (in microseconds).
+    // time_base is now {1, 1000000} so packet->pts is already in microseconds.
+    // FFmpeg adjusts timestamps by subtracting initial_padding (encoder priming delay).
+    // We need to add back the delay converted to microseconds.
+    int64_t timestampUs = packet->pts;
+    if (ctx->initial_padding > 0) {
+        // Convert initial_padding from samples to microseconds
+        int64_t paddingUs = (int64_t)ctx->initial_padding * 1000000 / ctx->sample_rate;
+        timestampUs += paddingUs;
+    }
+    return timestampUs;
+}
+
+}  // namespace AudioEncoding
+
 Napi::FunctionReference AudioEncoderNative::constructor;
 
 Napi::Object AudioEncoderNative::Init(Napi::Env env, Napi::Object exports) {
@@ -499,54 +700,15 @@ void AudioEncoderNative::Configure(const Napi::CallbackInfo& info) {
     sampleRate_ = config.Get("sampleRate").As<Napi::Number>().Int32Value();
     channels_ = config.Get("channels").As<Napi::Number>().Int32Value();
 
-    codec_ = avcodec_find_encoder_by_name(codecName.c_str());
-    if (!codec_) {
-        Napi::Error::New(env, "Codec not found: " + codecName).ThrowAsJavaScriptException();
-        return;
-    }
+    int64_t bitrate = config.Has("bitrate") ? config.Get("bitrate").As<Napi::Number>().Int64Value() : 0;
 
-    codecCtx_ = avcodec_alloc_context3(codec_);
+    std::string error;
+    codecCtx_ = AudioEncoding::open(codecName, sampleRate_, channels_, bitrate, error);
     if (!codecCtx_) {
-        Napi::Error::New(env, "Failed to allocate codec context").ThrowAsJavaScriptException();
-        return;
-    }
-
-    codecCtx_->sample_rate = sampleRate_;
-    // WebCodecs timestamps are in microseconds, so use microsecond time_base
-    codecCtx_->time_base = { 1, 1000000 };
-
-    // Select appropriate sample format for codec
-    // Each codec has different requirements
-    if (codecName == "libopus") {
-        codecCtx_->sample_fmt = AV_SAMPLE_FMT_FLT;  // Opus uses float non-planar
-    } else if (codecName == "flac") {
-        codecCtx_->sample_fmt = AV_SAMPLE_FMT_S16;  // FLAC uses s16
-    } else if (codecName == "libmp3lame") {
-        codecCtx_->sample_fmt = AV_SAMPLE_FMT_FLTP; // MP3 uses float planar
-    } else {
-        // AAC and most others use float planar
-        codecCtx_->sample_fmt = AV_SAMPLE_FMT_FLTP;
-    }
-
-    AVChannelLayout layout;
-    av_channel_layout_default(&layout, channels_);
-    av_channel_layout_copy(&codecCtx_->ch_layout, &layout);
-    av_channel_layout_uninit(&layout);
-
-    if (config.Has("bitrate")) {
-        codecCtx_->bit_rate = config.Get("bitrate").As<Napi::Number>().Int64Value();
-    } else {
-        codecCtx_->bit_rate = 128000;  // 128 kbps default
-    }
-
-    int ret = avcodec_open2(codecCtx_, codec_, nullptr);
-    if (ret < 0) {
-        char errBuf[256];
-        av_strerror(ret, errBuf, sizeof(errBuf));
-        avcodec_free_context(&codecCtx_);
-        Napi::Error::New(env, std::string("Failed to open codec: ") + errBuf).ThrowAsJavaScriptException();
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
         return;
     }
+    codec_ = codecCtx_->codec;
 
     frameSize_ = codecCtx_->frame_size > 0 ? codecCtx_->frame_size : 1024;
     configured_ = true;
@@ -567,86 +729,14 @@ void AudioEncoderNative::Encode(const Napi::CallbackInfo& info) {
     int numberOfChannels = info[4].As<Napi::Number>().Int32Value();
     int64_t timestamp = info[5].As<Napi::Number>().Int64Value();
 
-    // Setup frame
-    AVFrame* frame = av_frame_alloc();
-    frame->format = codecCtx_->sample_fmt;
-    frame->sample_rate = codecCtx_->sample_rate;
-    av_channel_layout_copy(&frame->ch_layout, &codecCtx_->ch_layout);
-    frame->nb_samples = std::min(numberOfFrames, frameSize_);
-    frame->pts = timestamp;
-
-    int ret = av_frame_get_buffer(frame, 0);
-    if (ret < 0) {
-        char errBuf[256];
-        av_strerror(ret, errBuf, sizeof(errBuf));
-        av_frame_free(&frame);
-        EmitError(env, std::string("Failed to allocate frame: ") + errBuf);
-        return;
+    std::string error;
+    if (!AudioEncoding::encode(codecCtx_, swrCtx_, data.Data(), sampleRate, numberOfFrames, numberOfChannels,
+                               timestamp, [&](const AVPacket* packet) { EmitChunk(env, packet); }, error)) {
+        EmitError(env, error);
     }
-
-    // Convert input to encoder format
-    if (!swrCtx_) {
-        AVChannelLayout inLayout, outLayout;
-        av_channel_layout_default(&inLayout, numberOfChannels);
-        av_channel_layout_copy(&outLayout, &codecCtx_->ch_layout);
-
-        int swrRet = swr_alloc_set_opts2(&swrCtx_,
-            &outLayout, codecCtx_->sample_fmt, codecCtx_->sample_rate,
-            &inLayout, AV_SAMPLE_FMT_FLT, sampleRate,
-            0, nullptr);
-
-        av_channel_layout_uninit(&inLayout);
-        av_channel_layout_uninit(&outLayout);
-
-        if (swrRet < 0 || swr_init(swrCtx_) < 0) {
-            av_frame_free(&frame);
-            EmitError(env, "Failed to initialize resampler");
-            return;
-        }
-    }
-
-    const uint8_t* inPtr = (const uint8_t*)data.Data();
-    int outSamples = swr_convert(swrCtx_,
-        frame->data, frame->nb_samples,
-        &inPtr, numberOfFrames);
-
-    if (outSamples < 0) {
-        av_frame_free(&frame);
-        EmitError(env, "Resampling failed");
-        return;
-    }
-
-    frame->nb_samples = outSamples;
-
-    ret = avcodec_send_frame(codecCtx_, frame);
-    av_frame_free(&frame);
-
-    if (ret < 0) {
-        char errBuf[256];
-        av_strerror(ret, errBuf, sizeof(errBuf));
-        EmitError(env, std::string("Encode error: ") + errBuf);
-        return;
-    }
-
-    AVPacket* packet = av_packet_alloc();
-    while (ret >= 0) {
-        ret = avcodec_receive_packet(codecCtx_, packet);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
-        } else if (ret < 0) {
-            char errBuf[256];
-            av_strerror(ret, errBuf, sizeof(errBuf));
-            EmitError(env, std::string("Encode error: ") + errBuf);
-            break;
-        }
-
-        EmitChunk(env, packet);
-        av_packet_unref(packet);
-    }
-    av_packet_free(&packet);
 }
 
-void AudioEncoderNative::EmitChunk(Napi::Env env, AVPacket* packet) {
+void AudioEncoderNative::EmitChunk(Napi::Env env, const AVPacket* packet) {
     Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(env, packet->data, packet->size);
 
     Napi::Value extradataValue = env.Undefined();
@@ -654,16 +744,7 @@ void AudioEncoderNative::EmitChunk(Napi::Env env, AVPacket* packet) {
         extradataValue = Napi::Buffer<uint8_t>::Copy(env, codecCtx_->extradata, codecCtx_->extradata_size);
     }
 
-    // WebCodecs spec: output timestamps should match input timestamps (in microseconds).
-    // time_base is now {1, 1000000} so packet->pts is already in microseconds.
-    // FFmpeg adjusts timestamps by subtracting initial_padding (encoder priming delay).
-    // We need to add back the delay converted to microseconds.
-    int64_t timestampUs = packet->pts;
-    if (codecCtx_->initial_padding > 0) {
-        // Convert initial_padding from samples to microseconds
-        int64_t paddingUs = (int64_t)codecCtx_->initial_padding * 1000000 / codecCtx_->sample_rate;
-        timestampUs += paddingUs;
-    }
+    int64_t timestampUs = AudioEncoding::packetTimestamp(codecCtx_, packet);
 
     outputCallback_.Value().Call({
         buffer,
@@ -681,15 +762,7 @@ Napi::Value AudioEncoderNative::Flush(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     if (configured_ && codecCtx_) {
-        avcodec_send_frame(codecCtx_, nullptr);
-
-        AVPacket* packet = av_packet_alloc();
-        int ret;
-        while ((ret = avcodec_receive_packet(codecCtx_, packet)) >= 0) {
-            EmitChunk(env, packet);
-            av_packet_unref(packet);
-        }
-        av_packet_free(&packet);
+        AudioEncoding::drain(codecCtx_, [&](const AVPacket* packet) { EmitChunk(env, packet); });
     }
 
     Napi::Function callback = info[0].As<Napi::Function>();
@@ -2,6 +2,11 @@
 #define AUDIO_H
 
 #include <napi.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include "loudness.h"
+#include "decode_limits.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -54,7 +59,7 @@ private:
     void Close(const Napi::CallbackInfo& info);
 
     void EmitData(Napi::Env env, AVFrame* frame, int64_t timestamp);
-    void EmitError(Napi::Env env, const std::string& message);
+    void EmitError(Napi::Env env, const std::string& message, const char* name = "EncodingError");
 
     AVCodecContext* codecCtx_;
     const AVCodec* codec_;
@@ -66,6 +71,13 @@ private:
     bool configured_;
     int sampleRate_;
     int channels_;
+
+    // Loudness metering of the decoded output, if configured
+    bool loudnessEnabled_;
+    std::unique_ptr<LoudnessMeter> loudness_;
+
+    // maxSamples / maxChunkBytes for untrusted input
+    DecodeLimits limits_;
 };
 
 // AudioEncoderNative class
@@ -84,7 +96,7 @@ private:
     void Reset(const Napi::CallbackInfo& info);
     void Close(const Napi::CallbackInfo& info);
 
-    void EmitChunk(Napi::Env env, AVPacket* packet);
+    void EmitChunk(Napi::Env env, const AVPacket* packet);
     void EmitError(Napi::Env env, const std::string& message);
 
     AVCodecContext* codecCtx_;
@@ -100,6 +112,27 @@ private:
     int frameSize_;  // Samples per frame for AAC
 };
 
+// Encoder steps shared by AudioEncoderNative and AudioBatchScheduler
+namespace AudioEncoding {
+
+// Open an encoder for interleaved float input; nullptr and a message on failure
+AVCodecContext* open(const std::string& codecName, int sampleRate, int channels, int64_t bitrate,
+                     std::string& error);
+
+// Resample one block of interleaved float samples and send it; packets go
+// to onPacket as they come out. False and a message on failure.
+bool encode(AVCodecContext* ctx, SwrContext*& swr, const float* data, int sampleRate, int numberOfFrames,
+            int numberOfChannels, int64_t timestamp, const std::function<void(const AVPacket*)>& onPacket,
+            std::string& error);
+
+// End of stream: send NULL and hand over the remaining packets
+void drain(AVCodecContext* ctx, const std::function<void(const AVPacket*)>& onPacket);
+
+// Packet pts in microseconds with the encoder priming delay added back
+int64_t packetTimestamp(const AVCodecContext* ctx, const AVPacket* packet);
+
+}  // namespace AudioEncoding
+
 // Factory function
 Napi::Value CreateAudioData(const Napi::CallbackInfo& info);
 
@@ -0,0 +1,480 @@
+#include "audio_batch.h"
+#include "audio.h"
+#include <algorithm>
+#include <cmath>
+
+using Clock = std::chrono::steady_clock;
+
+Napi::FunctionReference AudioBatchSchedulerNative::constructor;
+
+Napi::Object AudioBatchSchedulerNative::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "AudioBatchSchedulerNative", {
+        InstanceMethod("open", &AudioBatchSchedulerNative::Open),
+        InstanceMethod("encode", &AudioBatchSchedulerNative::Encode),
+        InstanceMethod("flush", &AudioBatchSchedulerNative::Flush),
+        InstanceMethod("closeSession", &AudioBatchSchedulerNative::CloseSession),
+        InstanceMethod("close", &AudioBatchSchedulerNative::Close),
+        InstanceAccessor("stats", &AudioBatchSchedulerNative::GetStats, nullptr),
+    });
+
+    constructor = Napi::Persistent(func);
+    constructor.SuppressDestruct();
+
+    exports.Set("AudioBatchSchedulerNative", func);
+    return exports;
+}
+
+AudioBatchSchedulerNative::AudioBatchSchedulerNative(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<AudioBatchSchedulerNative>(info)
+    , tick_(10000) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[1].IsFunction()) {
+        Napi::TypeError::New(env, "Expected options and a batch callback").ThrowAsJavaScriptException();
+        return;
+    }
+
+    if (info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (options.Has("tickMs") && !options.Get("tickMs").IsUndefined()) {
+            if (!options.Get("tickMs").IsNumber()) {
+                Napi::TypeError::New(env, "tickMs must be a number").ThrowAsJavaScriptException();
+                return;
+            }
+            double tickMs = options.Get("tickMs").As<Napi::Number>().DoubleValue();
+            if (!(tickMs >= 1 && tickMs <= 1000)) {
+                Napi::RangeError::New(env, "tickMs must be between 1 and 1000").ThrowAsJavaScriptException();
+                return;
+            }
+            tick_ = std::chrono::microseconds(std::llround(tickMs * 1000));
+        }
+    }
+
+    tsfnBatch_ = Napi::ThreadSafeFunction::New(
+        env,
+        info[1].As<Napi::Function>(),
+        "AudioBatchScheduler",
+        0,  // Unlimited queue
+        1
+    );
+    // An idle scheduler does not keep the process alive; see Open()
+    tsfnBatch_.Unref(env);
+
+    running_ = true;
+    worker_ = std::thread(&AudioBatchSchedulerNative::WorkerLoop, this);
+}
+
+AudioBatchSchedulerNative::~AudioBatchSchedulerNative() {
+    Shutdown();
+}
+
+void AudioBatchSchedulerNative::Shutdown() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex_);
+        running_ = false;
+    }
+    inboxCV_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+
+    for (Session& session : sessions_) {
+        FreeSession(session);
+    }
+    for (Op& op : inbox_) {
+        if (op.ctx) {
+            avcodec_free_context(&op.ctx);
+        }
+    }
+    inbox_.clear();
+
+    if (tsfnBatch_) {
+        tsfnBatch_.Release();
+    }
+}
+
+// --- JS thread ---
+
+Napi::Value AudioBatchSchedulerNative::Open(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (closed_) {
+        Napi::Error::New(env, "Scheduler is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (!info[0].IsObject()) {
+        Napi::TypeError::New(env, "Config must be an object").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object config = info[0].As<Napi::Object>();
+    if (!config.Get("codec").IsString() || !config.Get("sampleRate").IsNumber() ||
+        !config.Get("channels").IsNumber()) {
+        Napi::TypeError::New(env, "codec, sampleRate and channels are required").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string codecName = config.Get("codec").As<Napi::String>().Utf8Value();
+    int sampleRate = config.Get("sampleRate").As<Napi::Number>().Int32Value();
+    int channels = config.Get("channels").As<Napi::Number>().Int32Value();
+    int64_t bitrate = config.Get("bitrate").IsNumber() ? config.Get("bitrate").As<Napi::Number>().Int64Value() : 0;
+
+    uint32_t slot;
+    if (!freeSlots_.empty()) {
+        slot = freeSlots_.back();
+    } else if (generations_.size() <= kSlotMask) {
+        slot = static_cast<uint32_t>(generations_.size());
+    } else {
+        Napi::RangeError::New(env, "Too many sessions").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // Opened here so configuration errors throw from configure()
+    std::string error;
+    AVCodecContext* ctx = AudioEncoding::open(codecName, sampleRate, channels, bitrate, error);
+    if (!ctx) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!freeSlots_.empty()) {
+        freeSlots_.pop_back();
+    } else {
+        generations_.push_back(0);
+        live_.push_back(false);
+    }
+    live_[slot] = true;
+    if (openSessions_++ == 0) {
+        tsfnBatch_.Ref(env);
+    }
+
+    Op op;
+    op.kind = Op::Open;
+    op.id = (generations_[slot] << kSlotBits) | slot;
+    op.ctx = ctx;
+    const uint32_t id = op.id;
+    Post(std::move(op));
+    return Napi::Number::New(env, id);
+}
+
+bool AudioBatchSchedulerNative::SessionArg(const Napi::CallbackInfo& info, uint32_t& id) {
+    Napi::Env env = info.Env();
+    if (closed_) {
+        Napi::Error::New(env, "Scheduler is closed").ThrowAsJavaScriptException();
+        return false;
+    }
+    if (!info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Session id must be a number").ThrowAsJavaScriptException();
+        return false;
+    }
+    id = info[0].As<Napi::Number>().Uint32Value();
+    const uint32_t slot = id & kSlotMask;
+    if (slot >= live_.size() || !live_[slot] || generations_[slot] != (id >> kSlotBits)) {
+        Napi::Error::New(env, "Unknown session").ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+void AudioBatchSchedulerNative::Encode(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    uint32_t id;
+    if (!SessionArg(info, id)) {
+        return;
+    }
+    if (!info[1].IsTypedArray()) {
+        Napi::TypeError::New(env, "Samples must be a Float32Array").ThrowAsJavaScriptException();
+        return;
+    }
+
+    // (id, samples, format, sampleRate, numberOfFrames, numberOfChannels, timestamp)
+    Napi::Float32Array data = info[1].As<Napi::Float32Array>();
+    Op op;
+    op.kind = Op::Encode;
+    op.id = id;
+    op.sampleRate = info[3].As<Napi::Number>().Int32Value();
+    op.frames = info[4].As<Napi::Number>().Int32Value();
+    op.channels = info[5].As<Napi::Number>().Int32Value();
+    op.timestamp = info[6].As<Napi::Number>().Int64Value();
+    if (op.frames <= 0 || op.channels <= 0 ||
+        data.ElementLength() < static_cast<size_t>(op.frames) * static_cast<size_t>(op.channels)) {
+        Napi::RangeError::New(env, "Sample buffer is too small").ThrowAsJavaScriptException();
+        return;
+    }
+
+    // Copied: the caller's buffer may be reused before the next tick
+    op.samples.assign(data.Data(), data.Data() + static_cast<size_t>(op.frames) * op.channels);
+    Post(std::move(op));
+}
+
+void AudioBatchSchedulerNative::Flush(const Napi::CallbackInfo& info) {
+    uint32_t id;
+    if (!SessionArg(info, id)) {
+        return;
+    }
+    Op op;
+    op.kind = Op::Flush;
+    op.id = id;
+    Post(std::move(op));
+}
+
+void AudioBatchSchedulerNative::CloseSession(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    uint32_t id;
+    if (!SessionArg(info, id)) {
+        return;
+    }
+    const uint32_t slot = id & kSlotMask;
+    live_[slot] = false;
+    generations_[slot] = (generations_[slot] + 1) & 0xFFFF;
+    freeSlots_.push_back(slot);
+    if (--openSessions_ == 0) {
+        tsfnBatch_.Unref(env);
+    }
+
+    // Queued in order, so the worker frees the slot before any reopen of it
+    Op op;
+    op.kind = Op::Close;
+    op.id = id;
+    Post(std::move(op));
+}
+
+void AudioBatchSchedulerNative::Close(const Napi::CallbackInfo& info) {
+    Shutdown();
+}
+
+Napi::Value AudioBatchSchedulerNative::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("sessions", Napi::Number::New(env, static_cast<double>(openSessions_)));
+    stats.Set("sweeps", Napi::Number::New(env, static_cast<double>(sweeps_.load())));
+    stats.Set("chunks", Napi::Number::New(env, static_cast<double>(chunks_.load())));
+    stats.Set("lastSweepUs", Napi::Number::New(env, static_cast<double>(lastSweepUs_.load())));
+    return stats;
+}
+
+void AudioBatchSchedulerNative::Post(Op&& op) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex_);
+        inbox_.push_back(std::move(op));
+        // A ticking worker picks the op up on its next tick
+        wake = idle_;
+    }
+    if (wake) {
+        inboxCV_.notify_one();
+    }
+}
+
+// --- Worker thread ---
+
+void AudioBatchSchedulerNative::WorkerLoop() {
+    std::vector<Op> ops;
+    Clock::time_point next = Clock::now() + tick_;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(inboxMutex_);
+            if (activeSessions_ == 0 && inbox_.empty()) {
+                // No sessions: park until an op arrives instead of waking every tick
+                idle_ = true;
+                inboxCV_.wait(lock, [this] { return !running_ || !inbox_.empty(); });
+                idle_ = false;
+            } else {
+                inboxCV_.wait_until(lock, next, [this] { return !running_; });
+            }
+            if (!running_) {
+                break;
+            }
+            ops.swap(inbox_);
+        }
+
+        const Clock::time_point start = Clock::now();
+        next += tick_;
+        if (next <= start) {
+            next = start + tick_;  // Fell behind: skip the missed ticks rather than burst
+        }
+        if (ops.empty()) {
+            continue;
+        }
+
+        Dispatch(ops);
+        ops.clear();
+        if (dirty_.empty()) {
+            continue;
+        }
+
+        Batch* batch = new Batch();
+        Sweep(*batch);
+        sweeps_.fetch_add(1, std::memory_order_relaxed);
+        lastSweepUs_.store(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count(),
+                           std::memory_order_relaxed);
+
+        if (batch->entries.empty()) {
+            delete batch;
+        } else {
+            Deliver(batch);
+        }
+    }
+
+    for (Op& op : ops) {
+        if (op.ctx) {
+            avcodec_free_context(&op.ctx);
+        }
+    }
+}
+
+void AudioBatchSchedulerNative::Dispatch(std::vector<Op>& ops) {
+    for (Op& op : ops) {
+        const uint32_t slot = op.id & kSlotMask;
+
+        if (op.kind == Op::Open) {
+            if (slot >= sessions_.size()) {
+                sessions_.resize(slot + 1);
+            }
+            Session& session = sessions_[slot];
+            if (session.ctx) {
+                activeSessions_--;
+            }
+            FreeSession(session);
+            session.id = op.id;
+            session.ctx = op.ctx;
+            op.ctx = nullptr;
+            activeSessions_++;
+            continue;
+        }
+
+        if (slot >= sessions_.size() || !sessions_[slot].ctx || sessions_[slot].id != op.id) {
+            continue;
+        }
+        Session& session = sessions_[slot];
+
+        if (op.kind == Op::Close) {
+            FreeSession(session);
+            activeSessions_--;
+            continue;
+        }
+
+        if (session.pending.empty()) {
+            dirty_.push_back(slot);
+        }
+        session.pending.push_back(std::move(op));
+    }
+}
+
+void AudioBatchSchedulerNative::Sweep(Batch& batch) {
+    // A slot closed and reopened within one tick is listed twice
+    std::sort(dirty_.begin(), dirty_.end());
+    dirty_.erase(std::unique(dirty_.begin(), dirty_.end()), dirty_.end());
+
+    for (uint32_t slot : dirty_) {
+        Session& session = sessions_[slot];
+        if (!session.ctx) {
+            continue;
+        }
+
+        auto onPacket = [&](const AVPacket* packet) {
+            Entry entry;
+            entry.session = session.id;
+            entry.offset = batch.data.size();
+            entry.size = static_cast<size_t>(packet->size);
+            entry.timestamp = AudioEncoding::packetTimestamp(session.ctx, packet);
+            entry.duration = packet->duration;
+            if (!session.sentExtradata && session.ctx->extradata && session.ctx->extradata_size > 0) {
+                entry.extradata.assign(session.ctx->extradata, session.ctx->extradata + session.ctx->extradata_size);
+            }
+            session.sentExtradata = true;
+            batch.data.insert(batch.data.end(), packet->data, packet->data + packet->size);
+            batch.entries.push_back(std::move(entry));
+            chunks_.fetch_add(1, std::memory_order_relaxed);
+        };
+
+        uint32_t dequeued = 0;
+        for (Op& op : session.pending) {
+            if (op.kind == Op::Encode) {
+                dequeued++;
+                std::string error;
+                if (!AudioEncoding::encode(session.ctx, session.swr, op.samples.data(), op.sampleRate, op.frames,
+                                           op.channels, op.timestamp, onPacket, error)) {
+                    Entry entry;
+                    entry.kind = Entry::Error;
+                    entry.session = session.id;
+                    entry.error = error;
+                    batch.entries.push_back(std::move(entry));
+                }
+            } else {
+                AudioEncoding::drain(session.ctx, onPacket);
+                avcodec_flush_buffers(session.ctx);
+                Entry entry;
+                entry.kind = Entry::Flushed;
+                entry.session = session.id;
+                batch.entries.push_back(std::move(entry));
+            }
+        }
+        session.pending.clear();
+
+        // Input consumed, whatever number of packets it made; drives encodeQueueSize
+        if (dequeued > 0) {
+            Entry entry;
+            entry.kind = Entry::Dequeued;
+            entry.session = session.id;
+            entry.count = dequeued;
+            batch.entries.push_back(std::move(entry));
+        }
+    }
+    dirty_.clear();
+}
+
+void AudioBatchSchedulerNative::FreeSession(Session& session) {
+    if (session.swr) {
+        swr_free(&session.swr);
+    }
+    if (session.ctx) {
+        avcodec_free_context(&session.ctx);
+    }
+    session.sentExtradata = false;
+    session.pending.clear();
+}
+
+void AudioBatchSchedulerNative::Deliver(Batch* batch) {
+    auto callback = [](Napi::Env env, Napi::Function fn, Batch* batch) {
+        Napi::Buffer<uint8_t> data = Napi::Buffer<uint8_t>::Copy(env, batch->data.data(), batch->data.size());
+
+        Napi::Array entries = Napi::Array::New(env, batch->entries.size());
+        for (size_t i = 0; i < batch->entries.size(); i++) {
+            const Entry& entry = batch->entries[i];
+            Napi::Object value = Napi::Object::New(env);
+            value.Set("session", Napi::Number::New(env, entry.session));
+            if (entry.kind == Entry::Chunk) {
+                value.Set("offset", Napi::Number::New(env, static_cast<double>(entry.offset)));
+                value.Set("size", Napi::Number::New(env, static_cast<double>(entry.size)));
+                value.Set("timestamp", Napi::Number::New(env, static_cast<double>(entry.timestamp)));
+                value.Set("duration", Napi::Number::New(env, static_cast<double>(entry.duration)));
+                if (!entry.extradata.empty()) {
+                    value.Set("extradata",
+                              Napi::Buffer<uint8_t>::Copy(env, entry.extradata.data(), entry.extradata.size()));
+                }
+            } else if (entry.kind == Entry::Flushed) {
+                value.Set("flushed", Napi::Boolean::New(env, true));
+            } else if (entry.kind == Entry::Dequeued) {
+                value.Set("dequeued", Napi::Number::New(env, entry.count));
+            } else {
+                value.Set("error", Napi::String::New(env, entry.error));
+            }
+            entries.Set(static_cast<uint32_t>(i), value);
+        }
+
+        fn.Call({ data, entries });
+        delete batch;
+    };
+
+    if (tsfnBatch_.NonBlockingCall(batch, callback) != napi_ok) {
+        delete batch;
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef AUDIO_BATCH_H
+#define AUDIO_BATCH_H
+
+#include <napi.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+}
+
+/**
+ * Cross-session audio encoding on one worker thread.
+ *
+ * Real-time audio servers run hundreds of small encoders (Opus at 20 ms
+ * frames, one per call leg). Encoding each on the JS thread, or giving each
+ * its own worker, costs a wakeup and a JS callback per 20 ms frame per
+ * session. Here sessions only queue their input. Once per tick the worker
+ * takes everything queued, encodes it session by session, and hands all the
+ * packets to JS in a single call: one data buffer plus an entry per packet.
+ *
+ * Session state lives in one dense vector indexed by slot. The sweep visits
+ * the sessions that have work in ascending slot order, so it walks memory
+ * forwards instead of chasing per-session heap objects.
+ *
+ * With no session open the worker parks until the next op instead of
+ * waking every tick.
+ *
+ * Session ids carry a generation in the high bits, so a batch already on its
+ * way to JS is never delivered to a later session that reused the slot.
+ */
+class AudioBatchSchedulerNative : public Napi::ObjectWrap<AudioBatchSchedulerNative> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    static Napi::FunctionReference constructor;
+
+    // new AudioBatchSchedulerNative({ tickMs? }, onBatch(data, entries))
+    AudioBatchSchedulerNative(const Napi::CallbackInfo& info);
+    ~AudioBatchSchedulerNative();
+
+private:
+    static constexpr uint32_t kSlotBits = 16;
+    static constexpr uint32_t kSlotMask = (1u << kSlotBits) - 1;
+
+    struct Op {
+        enum Kind { Open, Encode, Flush, Close };
+        Kind kind = Encode;
+        uint32_t id = 0;
+        AVCodecContext* ctx = nullptr;  // Open
+        std::vector<float> samples;     // Encode, interleaved
+        int sampleRate = 0;
+        int frames = 0;
+        int channels = 0;
+        int64_t timestamp = 0;
+    };
+
+    struct Session {
+        uint32_t id = 0;
+        AVCodecContext* ctx = nullptr;  // nullptr when the slot is free
+        SwrContext* swr = nullptr;
+        bool sentExtradata = false;
+        std::vector<Op> pending;        // Encode and Flush, in order
+    };
+
+    struct Entry {
+        enum Kind { Chunk, Flushed, Error, Dequeued };
+        Kind kind = Chunk;
+        uint32_t session = 0;
+        uint32_t count = 0;  // Dequeued: encode ops the sweep took off the session
+        size_t offset = 0;
+        size_t size = 0;
+        int64_t timestamp = 0;
+        int64_t duration = 0;
+        std::vector<uint8_t> extradata;
+        std::string error;
+    };
+
+    struct Batch {
+        std::vector<uint8_t> data;
+        std::vector<Entry> entries;
+    };
+
+    Napi::Value Open(const Napi::CallbackInfo& info);
+    void Encode(const Napi::CallbackInfo& info);
+    void Flush(const Napi::CallbackInfo& info);
+    void CloseSession(const Napi::CallbackInfo& info);
+    void Close(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+    // JS thread: id argument of a session this object opened, or throws
+    bool SessionArg(const Napi::CallbackInfo& info, uint32_t& id);
+    void Post(Op&& op);
+    void Shutdown();
+
+    // Worker thread
+    void WorkerLoop();
+    void Dispatch(std::vector<Op>& ops);
+    void Sweep(Batch& batch);
+    void FreeSession(Session& session);
+    void Deliver(Batch* batch);
+
+    std::chrono::microseconds tick_;
+    Napi::ThreadSafeFunction tsfnBatch_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+    // JS thread only
+    std::vector<uint32_t> generations_;  // Per slot, bumped on close
+    std::vector<bool> live_;             // Per slot, open on the JS side
+    std::vector<uint32_t> freeSlots_;
+    size_t openSessions_ = 0;
+    bool closed_ = false;
+
+    // Filled by the JS thread, swapped out by the worker once per tick
+    std::mutex inboxMutex_;
+    std::condition_variable inboxCV_;
+    std::vector<Op> inbox_;
+    bool idle_ = false;  // Worker parked with no sessions open; Post() wakes it
+
+    // Worker thread only
+    std::vector<Session> sessions_;
+    std::vector<uint32_t> dirty_;
+    size_t activeSessions_ = 0;
+
+    std::atomic<uint64_t> sweeps_{0};
+    std::atomic<uint64_t> chunks_{0};
+    std::atomic<uint64_t> lastSweepUs_{0};
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef BACKPRESSURE_H
+#define BACKPRESSURE_H
+
+#include <napi.h>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+/**
+ * High/low water mark signalling for the async codec job queues.
+ *
+ * The JS side pauses its producer once a submit reports that the queue has
+ * reached the high-water mark. The worker thread then calls the resume
+ * callback exactly once, when it has drained the queue down to the low-water
+ * mark, so stream pipelines flow without polling and without unbounded
+ * buffering in the native queue.
+ *
+ * OnPush runs on the producer (JS) thread and OnPop on the worker, both
+ * without a lock; the internal mutex only guards the resume callback.
+ */
+class QueueBackpressure {
+public:
+    QueueBackpressure() : highWater_(0), lowWater_(0), paused_(false), hasResume_(false) {}
+
+    // Set the water marks and the resume callback (main thread)
+    void Configure(Napi::Env env, size_t highWater, size_t lowWater, Napi::Function onResume) {
+        Release();
+        std::lock_guard<std::mutex> lock(resumeMutex_);
+        lowWater_ = lowWater < highWater ? lowWater : (highWater > 0 ? highWater - 1 : 0);
+        paused_ = false;
+
+        tsfnResume_ = Napi::ThreadSafeFunction::New(env, onResume, "CodecQueueResume", 0, 1);
+        // An idle pipeline must not keep the process alive
+        tsfnResume_.Unref(env);
+        hasResume_ = true;
+        highWater_ = highWater;
+    }
+
+    void Release() {
+        std::lock_guard<std::mutex> lock(resumeMutex_);
+        if (hasResume_) {
+            tsfnResume_.Release();
+            hasResume_ = false;
+        }
+        highWater_ = 0;
+        paused_ = false;
+    }
+
+    // After a job was queued; `depth` reads the current queue depth.
+    // Returns false when the producer should pause.
+    template <typename DepthFn>
+    bool OnPush(DepthFn depth) {
+        const size_t highWater = highWater_.load(std::memory_order_acquire);
+        if (highWater == 0 || depth() < highWater) {
+            return true;
+        }
+        paused_.store(true, std::memory_order_relaxed);
+        // The worker may have drained past the low-water mark before it could
+        // see paused_; pairs with the fence in OnPop()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        OnPop(depth());
+        return false;
+    }
+
+    // After a job was taken off the queue (or the queue was cleared)
+    void OnPop(size_t depth) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!paused_.load(std::memory_order_relaxed) || depth > lowWater_.load(std::memory_order_relaxed) ||
+            !paused_.exchange(false)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(resumeMutex_);
+        if (hasResume_) {
+            tsfnResume_.NonBlockingCall();
+        }
+    }
+
+private:
+    std::atomic<size_t> highWater_;
+    std::atomic<size_t> lowWater_;
+    std::atomic<bool> paused_;
+    bool hasResume_;                // Guarded by resumeMutex_
+    std::mutex resumeMutex_;
+    Napi::ThreadSafeFunction tsfnResume_;
+};
+
+#endif // BACKPRESSURE_H
@@ -1,12 +1,18 @@
 #include <napi.h>
 #include "frame.h"
 #include "audio.h"
+#include "audio_batch.h"
 #include "encoder.h"
 #include "decoder.h"
 #include "image_decoder.h"
 #include "async_encoder.h"
 #include "async_decoder.h"
 #include "capability_probe.h"
+#include "lut3d.h"
+#include "compositor.h"
+#include "loudness.h"
+#include "encode_cache.h"
+#include "smart_render.h"
 
 // Forward declaration
 void InitUtil(Napi::Env env, Napi::Object exports);
@@ -19,6 +25,8 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
     AudioDataNative::Init(env, exports);
     AudioDecoderNative::Init(env, exports);
     AudioEncoderNative::Init(env, exports);
+    AudioBatchSchedulerNative::Init(env, exports);
+    LoudnessMeterNative::Init(env, exports);
 
     // Initialize video encoder/decoder (sync versions)
     VideoEncoderNative::Init(env, exports);
@@ -31,9 +39,21 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
     // Initialize image decoder
     ImageDecoderNative::Init(env, exports);
 
+    // Initialize shared color LUTs
+    ColorLutNative::Init(env, exports);
+
+    // Initialize shared encode result caches
+    EncodeCacheNative::Init(env, exports);
+
+    // Initialize video compositor
+    VideoCompositorNative::Init(env, exports);
+
     // Initialize capability probe for isConfigSupported
     CapabilityProbe::Init(env, exports);
 
+    // Initialize smart-render planning helpers
+    SmartRender::Init(env, exports);
+
     // Add factory functions
     exports.Set("createVideoFrame", Napi::Function::New(env, CreateVideoFrame));
     exports.Set("createAudioData", Napi::Function::New(env, CreateAudioData));
@@ -1,6 +1,10 @@
 #include "color.h"
 #include <map>
 
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
 namespace ColorSpace {
 
 AVColorPrimaries parsePrimaries(const std::string& primaries) {
@@ -88,4 +92,49 @@ std::string matrixToString(AVColorSpace matrix) {
     }
 }
 
+bool isHdrTransfer(AVColorTransferCharacteristic transfer) {
+    return transfer == AVCOL_TRC_SMPTE2084 || transfer == AVCOL_TRC_ARIB_STD_B67;
+}
+
+static int swsMatrix(AVColorSpace matrix) {
+    switch (matrix) {
+        case AVCOL_SPC_BT709: return SWS_CS_ITU709;
+        case AVCOL_SPC_SMPTE240M: return SWS_CS_SMPTE240M;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL: return SWS_CS_BT2020;
+        default: return SWS_CS_DEFAULT;  // BT.601
+    }
+}
+
+static int swsRange(AVPixelFormat format, AVColorRange range) {
+    // RGB is always full range; YUV is limited unless tagged otherwise
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (desc && (desc->flags & AV_PIX_FMT_FLAG_RGB)) {
+        return 1;
+    }
+    return range == AVCOL_RANGE_JPEG ? 1 : 0;
+}
+
+void configureSws(SwsContext* ctx,
+                  AVPixelFormat srcFormat, AVColorSpace srcMatrix, AVColorRange srcRange,
+                  AVPixelFormat dstFormat, AVColorSpace dstMatrix, AVColorRange dstRange) {
+    if (!ctx) {
+        return;
+    }
+
+    // Keep the scaler's brightness/contrast/saturation as they are
+    int* invTable;
+    int* table;
+    int curSrcRange, curDstRange, brightness, contrast, saturation;
+    if (sws_getColorspaceDetails(ctx, &invTable, &curSrcRange, &table, &curDstRange,
+                                 &brightness, &contrast, &saturation) < 0) {
+        return;
+    }
+
+    sws_setColorspaceDetails(ctx,
+        sws_getCoefficients(swsMatrix(srcMatrix)), swsRange(srcFormat, srcRange),
+        sws_getCoefficients(swsMatrix(dstMatrix)), swsRange(dstFormat, dstRange),
+        brightness, contrast, saturation);
+}
+
 } // namespace ColorSpace
@@ -5,6 +5,7 @@
 
 extern "C" {
 #include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
 }
 
 namespace ColorSpace {
@@ -18,6 +19,13 @@ namespace ColorSpace {
     std::string primariesToString(AVColorPrimaries primaries);
     std::string transferToString(AVColorTransferCharacteristic transfer);
     std::string matrixToString(AVColorSpace matrix);
+    // Whether a transfer function is HDR (PQ or HLG)
+    bool isHdrTransfer(AVColorTransferCharacteristic transfer);
+    // Apply YUV<->RGB coefficients and ranges to a scaler from frame metadata.
+    // swscale otherwise assumes BT.601 limited range for every conversion.
+    void configureSws(SwsContext* ctx,
+                      AVPixelFormat srcFormat, AVColorSpace srcMatrix, AVColorRange srcRange,
+                      AVPixelFormat dstFormat, AVColorSpace dstMatrix, AVColorRange dstRange);
 }
 
 #endif
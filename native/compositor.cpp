@@ -0,0 +1,470 @@
+#include "compositor.h"
+#include "frame.h"
+#include "color.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+namespace {
+
+constexpr int kAlign = 64;
+constexpr int kMaxDimension = 16384;
+
+int alignUp(int value) {
+    return (value + kAlign - 1) & ~(kAlign - 1);
+}
+
+// Exact x / 255 for x in [0, 65534], which covers a blend plus rounding
+inline int div255(int x) {
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+inline void blendRow(uint8_t* dst, const uint8_t* src, int width, int alpha) {
+    const int inv = 255 - alpha;
+    for (int x = 0; x < width; x++) {
+        dst[x] = static_cast<uint8_t>(div255(src[x] * alpha + dst[x] * inv + 127));
+    }
+}
+
+// Per-pixel alpha scaled by the layer alpha
+inline void blendRowAlpha(uint8_t* dst, const uint8_t* src, const uint8_t* a, int width, int alpha) {
+    for (int x = 0; x < width; x++) {
+        int pa = div255(a[x] * alpha + 127);
+        dst[x] = static_cast<uint8_t>(div255(src[x] * pa + dst[x] * (255 - pa) + 127));
+    }
+}
+
+// Chroma row: alpha is the average of the 2x2 luma block under each sample
+inline void blendChromaAlpha(uint8_t* dst, const uint8_t* src, const uint8_t* a0, const uint8_t* a1,
+                             int width, int alpha) {
+    for (int x = 0; x < width; x++) {
+        int block = (a0[2 * x] + a0[2 * x + 1] + a1[2 * x] + a1[2 * x + 1] + 2) >> 2;
+        int pa = div255(block * alpha + 127);
+        dst[x] = static_cast<uint8_t>(div255(src[x] * pa + dst[x] * (255 - pa) + 127));
+    }
+}
+
+int roundEven(double value) {
+    return static_cast<int>(std::floor(value / 2.0)) * 2;
+}
+
+}  // namespace
+
+Napi::FunctionReference VideoCompositorNative::constructor;
+
+Napi::Object VideoCompositorNative::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "VideoCompositorNative", {
+        InstanceMethod("compose", &VideoCompositorNative::Compose),
+        InstanceMethod("close", &VideoCompositorNative::Close),
+    });
+
+    constructor = Napi::Persistent(func);
+    constructor.SuppressDestruct();
+
+    exports.Set("VideoCompositorNative", func);
+    return exports;
+}
+
+VideoCompositorNative::VideoCompositorNative(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<VideoCompositorNative>(info), width_(0), height_(0), pool_(nullptr), closed_(false) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 4 || !info[0].IsNumber() || !info[1].IsNumber() || !info[3].IsFunction()) {
+        Napi::TypeError::New(env, "Expected width, height, background and a callback").ThrowAsJavaScriptException();
+        return;
+    }
+
+    // 4:2:0 output: keep the canvas even so chroma covers it exactly
+    width_ = (info[0].As<Napi::Number>().Int32Value() + 1) & ~1;
+    height_ = (info[1].As<Napi::Number>().Int32Value() + 1) & ~1;
+    if (width_ <= 0 || height_ <= 0 || width_ > kMaxDimension || height_ > kMaxDimension) {
+        Napi::RangeError::New(env, "Invalid compositor dimensions").ThrowAsJavaScriptException();
+        return;
+    }
+
+    // Background color (RGB 0-255, default black) in BT.709 limited range
+    double r = 0, g = 0, b = 0;
+    if (info.Length() > 2 && info[2].IsObject()) {
+        Napi::Object bg = info[2].As<Napi::Object>();
+        if (bg.Has("r")) r = bg.Get("r").As<Napi::Number>().DoubleValue();
+        if (bg.Has("g")) g = bg.Get("g").As<Napi::Number>().DoubleValue();
+        if (bg.Has("b")) b = bg.Get("b").As<Napi::Number>().DoubleValue();
+    }
+    r = std::min(std::max(r, 0.0), 255.0) / 255.0;
+    g = std::min(std::max(g, 0.0), 255.0) / 255.0;
+    b = std::min(std::max(b, 0.0), 255.0) / 255.0;
+    double luma = 0.2126 * r + 0.7152 * g + 0.0722 * b;
+    background_[0] = static_cast<uint8_t>(std::lround(16.0 + 219.0 * luma));
+    background_[1] = static_cast<uint8_t>(std::lround(128.0 + 224.0 * (b - luma) / 1.8556));
+    background_[2] = static_cast<uint8_t>(std::lround(128.0 + 224.0 * (r - luma) / 1.5748));
+
+    // All three planes in one pooled buffer
+    linesize_[0] = alignUp(width_);
+    linesize_[1] = linesize_[2] = alignUp(width_ / 2);
+    size_t size = static_cast<size_t>(linesize_[0]) * height_ +
+                  static_cast<size_t>(linesize_[1]) * (height_ / 2) * 2 + kAlign;
+    pool_ = av_buffer_pool_init(size, nullptr);
+    if (!pool_) {
+        Napi::Error::New(env, "Failed to allocate compositor buffer pool").ThrowAsJavaScriptException();
+        return;
+    }
+
+    tsfnComposed_ = Napi::ThreadSafeFunction::New(
+        env,
+        info[3].As<Napi::Function>(),
+        "VideoCompositor",
+        0,  // Unlimited queue
+        1
+    );
+    // An idle compositor does not keep the process alive; see Compose()
+    tsfnComposed_.Unref(env);
+
+    running_ = true;
+    worker_ = std::thread(&VideoCompositorNative::WorkerLoop, this);
+}
+
+VideoCompositorNative::~VideoCompositorNative() {
+    Shutdown();
+}
+
+void VideoCompositorNative::FreeLayers(std::vector<Layer>& layers) {
+    for (Layer& layer : layers) {
+        av_frame_free(&layer.src);
+    }
+    layers.clear();
+}
+
+void VideoCompositorNative::Shutdown() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+
+    // The worker finishes every queued compose before it exits
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex_);
+        running_ = false;
+    }
+    jobsCV_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+
+    Cleanup();
+    if (tsfnComposed_) {
+        tsfnComposed_.Release();
+    }
+}
+
+void VideoCompositorNative::Cleanup() {
+    for (Slot& slot : slots_) {
+        if (slot.sws) {
+            sws_freeContext(slot.sws);
+        }
+        av_frame_free(&slot.scaled);
+    }
+    slots_.clear();
+    // Output frames still alive keep their buffers; the pool goes with the last one
+    av_buffer_pool_uninit(&pool_);
+}
+
+void VideoCompositorNative::Close(const Napi::CallbackInfo& info) {
+    Shutdown();
+}
+
+AVFrame* VideoCompositorNative::AcquireOutput() {
+    AVFrame* out = av_frame_alloc();
+    if (!out) {
+        return nullptr;
+    }
+    out->buf[0] = av_buffer_pool_get(pool_);
+    if (!out->buf[0]) {
+        av_frame_free(&out);
+        return nullptr;
+    }
+
+    out->format = AV_PIX_FMT_YUV420P;
+    out->width = width_;
+    out->height = height_;
+    out->data[0] = out->buf[0]->data;
+    out->data[1] = out->data[0] + static_cast<size_t>(linesize_[0]) * height_;
+    out->data[2] = out->data[1] + static_cast<size_t>(linesize_[1]) * (height_ / 2);
+    for (int p = 0; p < 3; p++) {
+        out->linesize[p] = linesize_[p];
+    }
+    out->colorspace = AVCOL_SPC_BT709;
+    out->color_primaries = AVCOL_PRI_BT709;
+    out->color_trc = AVCOL_TRC_BT709;
+    out->color_range = AVCOL_RANGE_MPEG;
+    return out;
+}
+
+bool VideoCompositorNative::ScaleLayer(const Layer& layer, Slot& slot) {
+    const AVFrame* src = layer.src;
+    AVPixelFormat srcFormat = static_cast<AVPixelFormat>(src->format);
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(srcFormat);
+    AVPixelFormat dstFormat = (desc && (desc->flags & AV_PIX_FMT_FLAG_ALPHA))
+        ? AV_PIX_FMT_YUVA420P : AV_PIX_FMT_YUV420P;
+
+    AVFrame* scaled = slot.scaled;
+    if (!scaled || scaled->width != layer.width || scaled->height != layer.height || scaled->format != dstFormat) {
+        av_frame_free(&slot.scaled);
+        scaled = av_frame_alloc();
+        if (!scaled) {
+            return false;
+        }
+        scaled->format = dstFormat;
+        scaled->width = layer.width;
+        scaled->height = layer.height;
+        if (av_frame_get_buffer(scaled, 0) < 0) {
+            av_frame_free(&scaled);
+            return false;
+        }
+        slot.scaled = scaled;
+    }
+
+    slot.sws = sws_getCachedContext(slot.sws,
+        src->width, src->height, srcFormat,
+        layer.width, layer.height, dstFormat,
+        SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!slot.sws) {
+        return false;
+    }
+    ColorSpace::configureSws(slot.sws, srcFormat, src->colorspace, src->color_range,
+                             dstFormat, AVCOL_SPC_BT709, AVCOL_RANGE_MPEG);
+
+    return sws_scale(slot.sws, src->data, src->linesize, 0, src->height,
+                     scaled->data, scaled->linesize) > 0;
+}
+
+void VideoCompositorNative::BlendRows(const std::vector<Layer>& layers, AVFrame* out, int firstRow, int endRow) {
+    for (int y = firstRow; y < endRow; y++) {
+        memset(out->data[0] + y * out->linesize[0], background_[0], width_);
+    }
+    for (int y = firstRow / 2; y < endRow / 2; y++) {
+        memset(out->data[1] + y * out->linesize[1], background_[1], width_ / 2);
+        memset(out->data[2] + y * out->linesize[2], background_[2], width_ / 2);
+    }
+
+    for (size_t i = 0; i < layers.size(); i++) {
+        const Layer& layer = layers[i];
+        const AVFrame* s = slots_[i].scaled;
+        if (layer.alpha == 0) {
+            continue;
+        }
+
+        // Layer rect clipped to the canvas and this slice (all even)
+        int x0 = std::max(layer.x, 0);
+        int x1 = std::min(layer.x + layer.width, width_);
+        int y0 = std::max(layer.y, firstRow);
+        int y1 = std::min(layer.y + layer.height, endRow);
+        if (x0 >= x1 || y0 >= y1) {
+            continue;
+        }
+        const int w = x1 - x0;
+        const int sx = x0 - layer.x;
+        const bool hasAlpha = s->format == AV_PIX_FMT_YUVA420P;
+
+        for (int y = y0; y < y1; y++) {
+            const int sy = y - layer.y;
+            uint8_t* d = out->data[0] + y * out->linesize[0] + x0;
+            const uint8_t* src = s->data[0] + sy * s->linesize[0] + sx;
+            if (hasAlpha) {
+                blendRowAlpha(d, src, s->data[3] + sy * s->linesize[3] + sx, w, layer.alpha);
+            } else if (layer.alpha == 255) {
+                memcpy(d, src, w);
+            } else {
+                blendRow(d, src, w, layer.alpha);
+            }
+        }
+
+        for (int y = y0 / 2; y < y1 / 2; y++) {
+            const int sy = y - layer.y / 2;
+            for (int p = 1; p < 3; p++) {
+                uint8_t* d = out->data[p] + y * out->linesize[p] + x0 / 2;
+                const uint8_t* src = s->data[p] + sy * s->linesize[p] + sx / 2;
+                if (hasAlpha) {
+                    const uint8_t* a0 = s->data[3] + (2 * sy) * s->linesize[3] + sx;
+                    blendChromaAlpha(d, src, a0, a0 + s->linesize[3], w / 2, layer.alpha);
+                } else if (layer.alpha == 255) {
+                    memcpy(d, src, w / 2);
+                } else {
+                    blendRow(d, src, w / 2, layer.alpha);
+                }
+            }
+        }
+    }
+}
+
+Napi::Value VideoCompositorNative::Compose(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (closed_ || !pool_) {
+        Napi::Error::New(env, "Compositor is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        Napi::TypeError::New(env, "Expected an array of layers").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Array list = info[0].As<Napi::Array>();
+    Job job;
+    std::vector<Layer>& layers = job.layers;
+    layers.reserve(list.Length());
+    for (uint32_t i = 0; i < list.Length(); i++) {
+        Napi::Value entry = list.Get(i);
+        if (!entry.IsObject()) {
+            FreeLayers(layers);
+            Napi::TypeError::New(env, "Layer must be an object").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        Napi::Object obj = entry.As<Napi::Object>();
+
+        Napi::Value frameValue = obj.Get("frame");
+        if (!frameValue.IsObject() || !frameValue.As<Napi::Object>().InstanceOf(VideoFrameNative::constructor.Value())) {
+            FreeLayers(layers);
+            Napi::TypeError::New(env, "Layer frame must be a VideoFrame").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        AVFrame* frame = Napi::ObjectWrap<VideoFrameNative>::Unwrap(frameValue.As<Napi::Object>())->GetFrame();
+        if (!frame) {
+            FreeLayers(layers);
+            Napi::Error::New(env, "Layer frame is closed").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        if (!obj.Get("x").IsNumber() || !obj.Get("y").IsNumber() ||
+            !obj.Get("width").IsNumber() || !obj.Get("height").IsNumber()) {
+            FreeLayers(layers);
+            Napi::TypeError::New(env, "Layer needs numeric x, y, width and height").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Layer layer;
+        layer.src = nullptr;
+        layer.x = roundEven(obj.Get("x").As<Napi::Number>().DoubleValue());
+        layer.y = roundEven(obj.Get("y").As<Napi::Number>().DoubleValue());
+        layer.width = roundEven(obj.Get("width").As<Napi::Number>().DoubleValue() + 1);
+        layer.height = roundEven(obj.Get("height").As<Napi::Number>().DoubleValue() + 1);
+        layer.zIndex = obj.Has("zIndex") && obj.Get("zIndex").IsNumber()
+            ? obj.Get("zIndex").As<Napi::Number>().Int32Value() : 0;
+        double alpha = obj.Has("alpha") && obj.Get("alpha").IsNumber()
+            ? obj.Get("alpha").As<Napi::Number>().DoubleValue() : 1.0;
+        layer.alpha = static_cast<int>(std::lround(std::min(std::max(alpha, 0.0), 1.0) * 255.0));
+
+        if (layer.width <= 0 || layer.height <= 0 || layer.width > kMaxDimension || layer.height > kMaxDimension) {
+            FreeLayers(layers);
+            Napi::RangeError::New(env, "Invalid layer size").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // Layers entirely off the canvas are neither scaled nor blended
+        if (layer.alpha == 0 || layer.x >= width_ || layer.y >= height_ ||
+            layer.x + layer.width <= 0 || layer.y + layer.height <= 0) {
+            continue;
+        }
+
+        // A new reference, so the caller may close its frame right away
+        layer.src = av_frame_clone(frame);
+        if (!layer.src) {
+            FreeLayers(layers);
+            Napi::Error::New(env, "Failed to reference layer frame").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        layers.push_back(layer);
+    }
+
+    // Painter's order; equal zIndex keeps array order
+    std::stable_sort(layers.begin(), layers.end(),
+                     [](const Layer& a, const Layer& b) { return a.zIndex < b.zIndex; });
+
+    const uint32_t id = nextId_++;
+    job.id = id;
+    if (pending_++ == 0) {
+        tsfnComposed_.Ref(env);
+    }
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex_);
+        jobs_.push_back(std::move(job));
+    }
+    jobsCV_.notify_one();
+
+    return Napi::Number::New(env, id);
+}
+
+// --- Worker thread ---
+
+void VideoCompositorNative::WorkerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex_);
+            jobsCV_.wait(lock, [this] { return !jobs_.empty() || !running_; });
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        Result* result = new Result();
+        result->id = job.id;
+        result->frame = Render(job.layers, result->error);
+        FreeLayers(job.layers);
+        Deliver(result);
+    }
+}
+
+AVFrame* VideoCompositorNative::Render(const std::vector<Layer>& layers, std::string& error) {
+    if (slots_.size() < layers.size()) {
+        slots_.resize(layers.size());
+    }
+
+    std::vector<char> ok(layers.size(), 0);
+    Parallel::forEachIndex(static_cast<int>(layers.size()), [&](int i) {
+        ok[i] = ScaleLayer(layers[i], slots_[i]);
+    });
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+        error = "Failed to scale layer";
+        return nullptr;
+    }
+
+    AVFrame* out = AcquireOutput();
+    if (!out) {
+        error = "Failed to allocate output frame";
+        return nullptr;
+    }
+
+    Parallel::forEachSlice(height_, [&](int first, int end) {
+        BlendRows(layers, out, first, end);
+    }, 2);
+    return out;
+}
+
+void VideoCompositorNative::Deliver(Result* result) {
+    // Runs before the tsfn is finalized, and the tsfn's callback keeps the
+    // JS wrapper (and so this object) alive until then
+    auto callback = [this](Napi::Env env, Napi::Function fn, Result* result) {
+        Napi::Value frame = result->frame
+            ? static_cast<Napi::Value>(VideoFrameNative::NewInstance(env, result->frame)) : env.Null();
+        Napi::Value error = result->frame ? env.Undefined() : Napi::String::New(env, result->error);
+        uint32_t id = result->id;
+        delete result;
+
+        if (--pending_ == 0 && !closed_) {
+            tsfnComposed_.Unref(env);
+        }
+        fn.Call({ Napi::Number::New(env, id), frame, error });
+    };
+
+    if (tsfnComposed_.NonBlockingCall(result, callback) != napi_ok) {
+        av_frame_free(&result->frame);
+        delete result;
+    }
+}
@@ -0,0 +1,176 @@
+#ifndef DECODE_LIMITS_H
+#define DECODE_LIMITS_H
+
+#include <napi.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+/**
+ * Per-instance resource limits for decoding untrusted streams.
+ *
+ * Picture and sample budgets go to FFmpeg's own checks (max_pixels,
+ * max_samples), which reject oversized frames before anything is
+ * allocated. A get_buffer2 hook checks the width/height limits and the
+ * per-job time budget at every frame allocation. FFmpeg cannot interrupt a
+ * running decode call, so a job that overruns is stopped at its next
+ * picture, or reported once the call returns.
+ *
+ * After a violation the owner flushes the decoder and waits for the next
+ * keyframe, so the instance stays usable.
+ *
+ * Configure on the main thread before avcodec_open2. BeginJob/EndJob run
+ * on the thread that decodes. The hook may also run on FFmpeg frame threads.
+ */
+class DecodeLimits {
+public:
+    // 0 means unlimited for every field
+    int maxWidth = 0;
+    int maxHeight = 0;
+    int64_t maxPixels = 0;
+    int64_t maxChunkBytes = 0;
+    int64_t maxDecodeTimeMs = 0;
+    int64_t maxSamples = 0;  // Per audio frame, all channels
+
+    DecodeLimits() = default;
+    DecodeLimits(const DecodeLimits&) = delete;
+    DecodeLimits& operator=(const DecodeLimits&) = delete;
+
+    // { maxWidth, maxHeight, maxPixels, maxChunkBytes, maxDecodeTimeMs, maxSamples };
+    // undefined clears every limit
+    bool Parse(Napi::Value value, std::string& error) {
+        maxWidth = maxHeight = 0;
+        maxPixels = maxChunkBytes = maxDecodeTimeMs = maxSamples = 0;
+        violation_ = kNone;
+        if (value.IsUndefined() || value.IsNull()) {
+            return true;
+        }
+        if (!value.IsObject()) {
+            error = "limits must be an object";
+            return false;
+        }
+        Napi::Object obj = value.As<Napi::Object>();
+        int64_t width = 0, height = 0;
+        if (!readLimit(obj, "maxWidth", width, error) || !readLimit(obj, "maxHeight", height, error) ||
+            !readLimit(obj, "maxPixels", maxPixels, error) ||
+            !readLimit(obj, "maxChunkBytes", maxChunkBytes, error) ||
+            !readLimit(obj, "maxDecodeTimeMs", maxDecodeTimeMs, error) ||
+            !readLimit(obj, "maxSamples", maxSamples, error)) {
+            return false;
+        }
+        maxWidth = static_cast<int>(std::min<int64_t>(width, INT32_MAX));
+        maxHeight = static_cast<int>(std::min<int64_t>(height, INT32_MAX));
+        return true;
+    }
+
+    // Before avcodec_open2; takes over ctx->opaque and get_buffer2
+    void Apply(AVCodecContext* ctx) {
+        if (maxPixels > 0) {
+            ctx->max_pixels = maxPixels;
+        }
+        if (maxSamples > 0) {
+            ctx->max_samples = maxSamples;
+        }
+        if (maxWidth > 0 || maxHeight > 0 || maxDecodeTimeMs > 0) {
+            ctx->opaque = this;
+            ctx->get_buffer2 = GetBuffer;
+        }
+    }
+
+    // Message for a chunk over maxChunkBytes, empty if it is within the limit
+    std::string CheckChunk(size_t bytes) const {
+        if (maxChunkBytes > 0 && static_cast<int64_t>(bytes) > maxChunkBytes) {
+            return "Chunk of " + std::to_string(bytes) + " bytes exceeds maxChunkBytes (" +
+                   std::to_string(maxChunkBytes) + ")";
+        }
+        return "";
+    }
+
+    void BeginJob() {
+        violation_ = kNone;
+        jobStart_ = std::chrono::steady_clock::now();
+        deadline_ = maxDecodeTimeMs > 0
+            ? (jobStart_ + std::chrono::milliseconds(maxDecodeTimeMs)).time_since_epoch().count()
+            : 0;
+    }
+
+    // Message for the limit the job broke, empty if none. `failed` tells
+    // whether FFmpeg returned an error, which may come from max_pixels.
+    std::string EndJob(const AVCodecContext* ctx, bool failed) {
+        deadline_ = 0;
+        const int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - jobStart_).count();
+
+        switch (violation_.exchange(kNone)) {
+            case kDimensions:
+                return "Frame of " + std::to_string(rejectedWidth_.load()) + "x" +
+                       std::to_string(rejectedHeight_.load()) + " exceeds maxWidth/maxHeight";
+            case kTime:
+                return "Decode exceeded maxDecodeTimeMs (" + std::to_string(maxDecodeTimeMs) + ")";
+            default:
+                break;
+        }
+        if (failed && maxPixels > 0 &&
+            static_cast<int64_t>(ctx->width) * ctx->height > maxPixels) {
+            return "Frame of " + std::to_string(ctx->width) + "x" + std::to_string(ctx->height) +
+                   " exceeds maxPixels (" + std::to_string(maxPixels) + ")";
+        }
+        if (maxDecodeTimeMs > 0 && elapsedMs > maxDecodeTimeMs) {
+            return "Decode took " + std::to_string(elapsedMs) + " ms, over maxDecodeTimeMs (" +
+                   std::to_string(maxDecodeTimeMs) + ")";
+        }
+        return "";
+    }
+
+private:
+    enum { kNone = 0, kDimensions, kTime };
+
+    static bool readLimit(Napi::Object obj, const char* key, int64_t& out, std::string& error) {
+        Napi::Value v = obj.Get(key);
+        if (v.IsUndefined()) {
+            return true;
+        }
+        if (!v.IsNumber() || v.As<Napi::Number>().DoubleValue() < 0) {
+            error = std::string("limits.") + key + " must be a non-negative number";
+            return false;
+        }
+        out = v.As<Napi::Number>().Int64Value();
+        return true;
+    }
+
+    static int GetBuffer(AVCodecContext* ctx, AVFrame* frame, int flags) {
+        DecodeLimits* self = static_cast<DecodeLimits*>(ctx->opaque);
+
+        if (ctx->codec_type == AVMEDIA_TYPE_VIDEO &&
+            ((self->maxWidth > 0 && frame->width > self->maxWidth) ||
+             (self->maxHeight > 0 && frame->height > self->maxHeight))) {
+            self->rejectedWidth_ = frame->width;
+            self->rejectedHeight_ = frame->height;
+            self->violation_ = kDimensions;
+            return AVERROR(ERANGE);
+        }
+
+        const int64_t deadline = self->deadline_.load();
+        if (deadline > 0 && std::chrono::steady_clock::now().time_since_epoch().count() > deadline) {
+            self->violation_ = kTime;
+            return AVERROR(ETIMEDOUT);
+        }
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+
+    std::chrono::steady_clock::time_point jobStart_;
+    std::atomic<int64_t> deadline_{0};  // steady_clock ticks, 0 = none
+    std::atomic<int> violation_{kNone};
+    std::atomic<int> rejectedWidth_{0};
+    std::atomic<int> rejectedHeight_{0};
+};
+
+#endif // DECODE_LIMITS_H
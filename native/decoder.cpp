@@ -1,5 +1,6 @@
 #include "decoder.h"
 #include "frame.h"
+#include "lut3d.h"
 
 Napi::FunctionReference VideoDecoderNative::constructor;
 
@@ -10,6 +11,7 @@ Napi::Object VideoDecoderNative::Init(Napi::Env env, Napi::Object exports) {
         InstanceMethod("flush", &VideoDecoderNative::Flush),
         InstanceMethod("reset", &VideoDecoderNative::Reset),
         InstanceMethod("close", &VideoDecoderNative::Close),
+        InstanceAccessor("decoderDelay", &VideoDecoderNative::GetDecoderDelay, nullptr),
     });
 
     constructor = Napi::Persistent(func);
@@ -23,7 +25,8 @@ VideoDecoderNative::VideoDecoderNative(const Napi::CallbackInfo& info)
     : Napi::ObjectWrap<VideoDecoderNative>(info)
     , codecCtx_(nullptr)
     , codec_(nullptr)
-    , configured_(false) {
+    , configured_(false)
+    , decoderDelay_(0) {
 
     Napi::Env env = info.Env();
 
@@ -116,6 +119,61 @@ void VideoDecoderNative::Configure(const Napi::CallbackInfo& info) {
         memset(codecCtx_->extradata + extradata.Length(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
     }
 
+    // Carry packet tags through reordering so frames get their own timestamps
+    TimestampTable::ConfigureContext(codecCtx_);
+
+    // Resource limits: FFmpeg size checks plus the allocation hook
+    std::string limitsError;
+    if (!limits_.Parse(config.Get("limits"), limitsError)) {
+        avcodec_free_context(&codecCtx_);
+        codecCtx_ = nullptr;
+        Napi::TypeError::New(env, limitsError).ThrowAsJavaScriptException();
+        return;
+    }
+    limits_.Apply(codecCtx_);
+    awaitKeyframe_ = false;
+
+    // Latency mode: no frame threading, output pictures as soon as they are complete
+    if (config.Has("optimizeForLatency") && config.Get("optimizeForLatency").IsBoolean() &&
+        config.Get("optimizeForLatency").As<Napi::Boolean>().Value()) {
+        codecCtx_->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        codecCtx_->thread_count = 0;  // Auto
+        codecCtx_->thread_type = FF_THREAD_SLICE;
+
+        if (strcmp(codec_->name, "libdav1d") == 0) {
+            av_opt_set_int(codecCtx_->priv_data, "max_frame_delay", 1, 0);
+        }
+    } else if (config.Has("intraOnly") && config.Get("intraOnly").IsBoolean() &&
+               config.Get("intraOnly").As<Napi::Boolean>().Value()) {
+        // Intra-only: no frame references another, frame threads run in parallel
+        codecCtx_->thread_count = 0;  // Auto
+        codecCtx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    }
+
+    // Color LUT stage (shared, parsed once by ColorLUT)
+    colorLut_.reset();
+    if (config.Has("colorLut") && !config.Get("colorLut").IsUndefined()) {
+        colorLut_ = ColorLutNative::FromValue(config.Get("colorLut"));
+        if (!colorLut_) {
+            Napi::TypeError::New(env, "colorLut must be a ColorLUT").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+
+    // Frame analysis stage: true or { blackThreshold, subsample }
+    analyzer_.reset();
+    if (config.Has("analysis") && !config.Get("analysis").IsUndefined() &&
+        !(config.Get("analysis").IsBoolean() && !config.Get("analysis").As<Napi::Boolean>().Value())) {
+        FrameAnalysis::Options options;
+        std::string error;
+        if (!FrameAnalysis::parseOptions(config.Get("analysis"), options, error)) {
+            Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+            return;
+        }
+        analyzer_.reset(new FrameAnalysis::Analyzer(options));
+    }
+    decoderDelay_ = 0;
+
     // Open codec
     int ret = avcodec_open2(codecCtx_, codec_, nullptr);
     if (ret < 0) {
@@ -141,63 +199,115 @@ void VideoDecoderNative::Decode(const Napi::CallbackInfo& info) {
     bool isKeyframe = info[1].As<Napi::Boolean>().Value();
     int64_t timestamp = info[2].As<Napi::Number>().Int64Value();
     int64_t duration = info[3].As<Napi::Number>().Int64Value();
+    bool hasUserData = info.Length() > 4 && info[4].IsNumber();
+    double userData = hasUserData ? info[4].As<Napi::Number>().DoubleValue() : 0;
+
+    const std::string oversize = limits_.CheckChunk(data.Length());
+    if (!oversize.empty()) {
+        RecoverFromLimit(env, oversize);
+        return;
+    }
+    if (awaitKeyframe_) {
+        if (!isKeyframe) {
+            return;
+        }
+        awaitKeyframe_ = false;
+    }
 
     // Create packet from data
     AVPacket* packet = av_packet_alloc();
     packet->data = data.Data();
     packet->size = data.Length();
-    packet->pts = timestamp;
-    packet->dts = timestamp;
     packet->duration = duration;
+    TimestampTable::TagPacket(packet, timestamps_.Insert(timestamp, duration, userData, hasUserData));
 
     if (isKeyframe) {
         packet->flags |= AV_PKT_FLAG_KEY;
     }
 
+    // Output callbacks run after decoding so they do not count against the time budget
+    limits_.BeginJob();
+    std::vector<AVFrame*> frames;
+    std::string error;
+
     // Send packet to decoder
     int ret = avcodec_send_packet(codecCtx_, packet);
     if (ret < 0) {
         char errBuf[256];
         av_strerror(ret, errBuf, sizeof(errBuf));
-        EmitError(env, std::string("Decode error: ") + errBuf);
-        av_packet_free(&packet);
-        return;
+        error = errBuf;
+    } else {
+        // Receive decoded frames
+        while (true) {
+            AVFrame* frame = av_frame_alloc();
+            ret = avcodec_receive_frame(codecCtx_, frame);
+            if (ret < 0) {
+                av_frame_free(&frame);
+                if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+                    char errBuf[256];
+                    av_strerror(ret, errBuf, sizeof(errBuf));
+                    error = errBuf;
+                }
+                break;
+            }
+            frames.push_back(frame);
+        }
     }
+    av_packet_free(&packet);
 
-    // Receive decoded frames
-    AVFrame* frame = av_frame_alloc();
-    while (ret >= 0) {
-        ret = avcodec_receive_frame(codecCtx_, frame);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
-        } else if (ret < 0) {
-            char errBuf[256];
-            av_strerror(ret, errBuf, sizeof(errBuf));
-            EmitError(env, std::string("Decode error: ") + errBuf);
-            break;
-        }
+    const std::string limit = limits_.EndJob(codecCtx_, !error.empty());
 
-        // Clone frame and emit
-        AVFrame* outputFrame = av_frame_clone(frame);
-        EmitFrame(env, outputFrame, timestamp, duration);
-        av_frame_unref(frame);
+    for (AVFrame* frame : frames) {
+        // Packets still held by the decoder when this frame came out
+        const int64_t backlog = timestamps_.Backlog(frame);
+        if (backlog >= 0) {
+            decoderDelay_ = backlog;
+        }
+        EmitFrame(env, frame);
     }
 
-    av_frame_free(&frame);
-    av_packet_free(&packet);
+    if (!limit.empty()) {
+        RecoverFromLimit(env, limit);
+    } else if (!error.empty()) {
+        EmitError(env, "Decode error: " + error);
+    }
 }
 
-void VideoDecoderNative::EmitFrame(Napi::Env env, AVFrame* frame, int64_t timestamp, int64_t duration) {
+void VideoDecoderNative::EmitFrame(Napi::Env env, AVFrame* frame) {
+    // Frames may come out in a different order than packets went in
+    FrameMetadata meta = timestamps_.Resolve(frame);
+
+    if (colorLut_) {
+        AVFrame* graded = colorLut_->Apply(frame, true);
+        if (graded) {
+            av_frame_free(&frame);
+            frame = graded;
+        }
+    }
+
+    FrameAnalysis::Stats stats;
+    bool hasAnalysis = analyzer_ && analyzer_->Analyze(frame, stats);
+
     Napi::Object nativeFrame = VideoFrameNative::NewInstance(env, frame);
     outputCallback_.Value().Call({
         nativeFrame,
-        Napi::Number::New(env, timestamp),
-        Napi::Number::New(env, duration)
+        Napi::Number::New(env, meta.timestamp),
+        Napi::Number::New(env, meta.duration),
+        meta.hasUserData ? Napi::Number::New(env, meta.userData) : env.Undefined(),
+        env.Undefined(),  // Renditions are worker-thread only
+        hasAnalysis ? FrameAnalysis::toJS(env, stats) : env.Undefined()
     });
 }
 
-void VideoDecoderNative::EmitError(Napi::Env env, const std::string& message) {
-    errorCallback_.Value().Call({ Napi::String::New(env, message) });
+void VideoDecoderNative::EmitError(Napi::Env env, const std::string& message, const char* name) {
+    errorCallback_.Value().Call({ Napi::String::New(env, message), Napi::String::New(env, name) });
+}
+
+void VideoDecoderNative::RecoverFromLimit(Napi::Env env, const std::string& message) {
+    // Drop the offending stream's state and resume at the next keyframe
+    avcodec_flush_buffers(codecCtx_);
+    awaitKeyframe_ = true;
+    EmitError(env, message, "QuotaExceededError");
 }
 
 Napi::Value VideoDecoderNative::Flush(const Napi::CallbackInfo& info) {
@@ -211,7 +321,7 @@ Napi::Value VideoDecoderNative::Flush(const Napi::CallbackInfo& info) {
         int ret;
         while ((ret = avcodec_receive_frame(codecCtx_, frame)) >= 0) {
             AVFrame* outputFrame = av_frame_clone(frame);
-            EmitFrame(env, outputFrame, frame->pts, frame->duration);
+            EmitFrame(env, outputFrame);
             av_frame_unref(frame);
         }
         av_frame_free(&frame);
@@ -229,6 +339,13 @@ void VideoDecoderNative::Reset(const Napi::CallbackInfo& info) {
     if (codecCtx_) {
         avcodec_flush_buffers(codecCtx_);
     }
+    if (analyzer_) {
+        analyzer_->Reset();
+    }
+}
+
+Napi::Value VideoDecoderNative::GetDecoderDelay(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(decoderDelay_));
 }
 
 void VideoDecoderNative::Close(const Napi::CallbackInfo& info) {
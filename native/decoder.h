@@ -2,11 +2,18 @@
 #define DECODER_H
 
 #include <napi.h>
+#include "timestamp_table.h"
+#include "lut3d.h"
+#include "analysis.h"
+#include "decode_limits.h"
+#include <memory>
+#include <vector>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavutil/frame.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
 }
 
 class VideoDecoderNative : public Napi::ObjectWrap<VideoDecoderNative> {
@@ -23,17 +30,33 @@ private:
     Napi::Value Flush(const Napi::CallbackInfo& info);
     void Reset(const Napi::CallbackInfo& info);
     void Close(const Napi::CallbackInfo& info);
+    Napi::Value GetDecoderDelay(const Napi::CallbackInfo& info);
 
-    void EmitFrame(Napi::Env env, AVFrame* frame, int64_t timestamp, int64_t duration);
-    void EmitError(Napi::Env env, const std::string& message);
+    void EmitFrame(Napi::Env env, AVFrame* frame);
+    void EmitError(Napi::Env env, const std::string& message, const char* name = "EncodingError");
+    void RecoverFromLimit(Napi::Env env, const std::string& message);
 
     AVCodecContext* codecCtx_;
     const AVCodec* codec_;
+    TimestampTable timestamps_;
 
     Napi::FunctionReference outputCallback_;
     Napi::FunctionReference errorCallback_;
 
     bool configured_;
+
+    // Packets the decoder was holding when the most recent frame came out
+    int64_t decoderDelay_;
+
+    // Color LUT applied to every decoded frame, if configured
+    std::shared_ptr<const Lut3D> colorLut_;
+
+    // Luma statistics reported with every output frame, if configured
+    std::unique_ptr<FrameAnalysis::Analyzer> analyzer_;
+
+    // Resource limits; after a violation chunks are dropped until the next keyframe
+    DecodeLimits limits_;
+    bool awaitKeyframe_ = false;
 };
 
 #endif
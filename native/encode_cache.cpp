@@ -0,0 +1,598 @@
+#include "encode_cache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+// File layout: magic, packet count, then per packet flags/ptsOffset/duration/qp/size/bytes (host order)
+constexpr char kMagic[8] = {'W', 'C', 'G', 'O', 'P', '0', '0', '2'};
+constexpr const char* kExtension = ".gop";
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    return rotl(acc, 31) * kPrime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t lane) {
+    acc ^= round64(0, lane);
+    return acc * kPrime1 + kPrime4;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+bool parseKey(const std::string& name, EncodeCache::Key& key) {
+    if (name.size() != 32) {
+        return false;
+    }
+    uint64_t parts[2] = {0, 0};
+    for (int i = 0; i < 32; i++) {
+        char c = name[i];
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else return false;
+        parts[i / 16] = (parts[i / 16] << 4) | static_cast<uint64_t>(digit);
+    }
+    key.hi = parts[0];
+    key.lo = parts[1];
+    return true;
+}
+
+}  // namespace
+
+// --- Hasher ---
+
+void EncodeCache::Hasher::Reset(uint64_t seed) {
+    lanes_[0] = seed + kPrime1 + kPrime2;
+    lanes_[1] = seed + kPrime2;
+    lanes_[2] = seed;
+    lanes_[3] = seed - kPrime1;
+    tailSize_ = 0;
+    total_ = 0;
+}
+
+void EncodeCache::Hasher::Consume(const uint8_t* stripes, size_t count) {
+    uint64_t v0 = lanes_[0], v1 = lanes_[1], v2 = lanes_[2], v3 = lanes_[3];
+    for (size_t i = 0; i < count; i++, stripes += 32) {
+        v0 = round64(v0, read64(stripes));
+        v1 = round64(v1, read64(stripes + 8));
+        v2 = round64(v2, read64(stripes + 16));
+        v3 = round64(v3, read64(stripes + 24));
+    }
+    lanes_[0] = v0;
+    lanes_[1] = v1;
+    lanes_[2] = v2;
+    lanes_[3] = v3;
+}
+
+void EncodeCache::Hasher::Update(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    total_ += size;
+
+    if (tailSize_ > 0) {
+        size_t take = std::min(size, sizeof(tail_) - tailSize_);
+        memcpy(tail_ + tailSize_, p, take);
+        tailSize_ += take;
+        p += take;
+        size -= take;
+        if (tailSize_ < sizeof(tail_)) {
+            return;
+        }
+        Consume(tail_, 1);
+        tailSize_ = 0;
+    }
+
+    size_t stripes = size / 32;
+    Consume(p, stripes);
+    p += stripes * 32;
+    size -= stripes * 32;
+
+    memcpy(tail_, p, size);
+    tailSize_ = size;
+}
+
+bool EncodeCache::Hasher::UpdateFrame(const AVFrame* frame) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+        return false;
+    }
+
+    UpdateValue(frame->format);
+    UpdateValue(frame->width);
+    UpdateValue(frame->height);
+    UpdateValue(frame->colorspace);
+    UpdateValue(frame->color_range);
+    UpdateValue(frame->color_primaries);
+    UpdateValue(frame->color_trc);
+
+    // Only the visible bytes of each row: padding is not part of the picture
+    const bool rgb = (desc->flags & AV_PIX_FMT_FLAG_RGB) != 0;
+    for (int plane = 0; plane < 4; plane++) {
+        size_t rowBytes = 0;
+        int rows = 0;
+        for (int c = 0; c < desc->nb_components; c++) {
+            const AVComponentDescriptor& comp = desc->comp[c];
+            if (comp.plane != plane) {
+                continue;
+            }
+            const bool chroma = !rgb && (c == 1 || c == 2);
+            const int w = chroma ? (frame->width + (1 << desc->log2_chroma_w) - 1) >> desc->log2_chroma_w
+                                 : frame->width;
+            const int h = chroma ? (frame->height + (1 << desc->log2_chroma_h) - 1) >> desc->log2_chroma_h
+                                 : frame->height;
+            rowBytes = std::max(rowBytes, static_cast<size_t>(w) * comp.step);
+            rows = std::max(rows, h);
+        }
+        if (rowBytes == 0) {
+            continue;
+        }
+        if (!frame->data[plane]) {
+            return false;
+        }
+        for (int y = 0; y < rows; y++) {
+            Update(frame->data[plane] + static_cast<ptrdiff_t>(y) * frame->linesize[plane], rowBytes);
+        }
+    }
+    return true;
+}
+
+EncodeCache::Key EncodeCache::Hasher::Digest() const {
+    const uint64_t v0 = lanes_[0], v1 = lanes_[1], v2 = lanes_[2], v3 = lanes_[3];
+
+    uint64_t h = rotl(v0, 1) + rotl(v1, 7) + rotl(v2, 12) + rotl(v3, 18);
+    h = merge(h, v0);
+    h = merge(h, v1);
+    h = merge(h, v2);
+    h = merge(h, v3);
+    h += total_;
+
+    size_t i = 0;
+    for (; i + 8 <= tailSize_; i += 8) {
+        h ^= round64(0, read64(tail_ + i));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    for (; i < tailSize_; i++) {
+        h ^= tail_[i] * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+    }
+
+    // The second half mixes the lanes in a different order, so the pair
+    // carries more of the 256-bit state than either half alone
+    Key key;
+    key.lo = avalanche(h);
+    key.hi = avalanche((rotl(v3, 33) ^ v0 * kPrime3) + (rotl(v1, 23) ^ v2 * kPrime5) + h * kPrime4);
+    return key;
+}
+
+// --- Store ---
+
+EncodeCache::EncodeCache(size_t maxMemoryBytes, const std::string& directory, uint64_t maxDiskBytes,
+                         size_t maxPendingBytes)
+    : maxMemoryBytes_(maxMemoryBytes)
+    , directory_(directory)
+    , maxDiskBytes_(maxDiskBytes)
+    , maxPendingBytes_(maxPendingBytes) {
+}
+
+std::shared_ptr<EncodeCache> EncodeCache::Create(size_t maxMemoryBytes, const std::string& directory,
+                                                 uint64_t maxDiskBytes, size_t maxPendingBytes,
+                                                 std::string& error) {
+    std::shared_ptr<EncodeCache> cache(new EncodeCache(maxMemoryBytes, directory, maxDiskBytes, maxPendingBytes));
+    if (!directory.empty() && !cache->ScanDirectory(error)) {
+        return nullptr;
+    }
+    return cache;
+}
+
+size_t EncodeCache::EntryBytes(const Entry& entry) {
+    size_t bytes = 0;
+    for (const Packet& packet : entry) {
+        bytes += packet.data.size() + sizeof(Packet);
+    }
+    return bytes;
+}
+
+void EncodeCache::AddStart(const Key& key) {
+    starts_[key.hi]++;
+}
+
+void EncodeCache::RemoveStart(const Key& key) {
+    auto it = starts_.find(key.hi);
+    if (it != starts_.end() && --it->second == 0) {
+        starts_.erase(it);
+    }
+}
+
+bool EncodeCache::HasStart(uint64_t start) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return starts_.find(start) != starts_.end();
+}
+
+std::string EncodeCache::PathFor(const Key& key) const {
+    char name[33];
+    snprintf(name, sizeof(name), "%016llx%016llx",
+             static_cast<unsigned long long>(key.hi), static_cast<unsigned long long>(key.lo));
+    return (fs::path(directory_) / (std::string(name) + kExtension)).string();
+}
+
+bool EncodeCache::ScanDirectory(std::string& error) {
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    if (ec || !fs::is_directory(directory_, ec)) {
+        error = "Cannot create cache directory: " + directory_;
+        return false;
+    }
+
+    // Rebuild the LRU from modification times: lookups touch their file
+    struct Found {
+        Key key;
+        uint64_t bytes;
+        fs::file_time_type time;
+    };
+    std::vector<Found> found;
+    for (const fs::directory_entry& item : fs::directory_iterator(directory_, ec)) {
+        const fs::path& path = item.path();
+        Key key;
+        if (path.extension() != kExtension || !parseKey(path.stem().string(), key) ||
+            !item.is_regular_file(ec)) {
+            continue;
+        }
+        found.push_back({key, static_cast<uint64_t>(item.file_size(ec)), item.last_write_time(ec)});
+    }
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.time > b.time; });
+
+    for (const Found& f : found) {
+        diskLru_.push_back(f.key);
+        disk_[f.key] = {f.bytes, std::prev(diskLru_.end())};
+        diskBytes_ += f.bytes;
+        AddStart(f.key);
+    }
+    while (diskBytes_ > maxDiskBytes_ && !diskLru_.empty()) {
+        Key victim = diskLru_.back();
+        fs::remove(PathFor(victim), ec);
+        diskBytes_ -= disk_[victim].bytes;
+        disk_.erase(victim);
+        diskLru_.pop_back();
+        RemoveStart(victim);
+    }
+    return true;
+}
+
+void EncodeCache::InsertMemory(const Key& key, std::shared_ptr<const Entry> entry) {
+    const size_t bytes = EntryBytes(*entry);
+    if (bytes > maxMemoryBytes_) {
+        return;
+    }
+
+    auto existing = memory_.find(key);
+    if (existing != memory_.end()) {
+        memoryBytes_ -= existing->second.bytes;
+        memoryLru_.erase(existing->second.lru);
+        memory_.erase(existing);
+        RemoveStart(key);
+    }
+
+    while (memoryBytes_ + bytes > maxMemoryBytes_ && !memoryLru_.empty()) {
+        auto victim = memory_.find(memoryLru_.back());
+        memoryBytes_ -= victim->second.bytes;
+        RemoveStart(victim->first);
+        memory_.erase(victim);
+        memoryLru_.pop_back();
+    }
+
+    memoryLru_.push_front(key);
+    memory_[key] = {std::move(entry), bytes, memoryLru_.begin()};
+    memoryBytes_ += bytes;
+    AddStart(key);
+}
+
+void EncodeCache::WriteDisk(const Key& key, const Entry& entry) {
+    const std::string path = PathFor(key);
+    const std::string temp = path + ".tmp";
+
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        const uint32_t count = static_cast<uint32_t>(entry.size());
+        out.write(kMagic, sizeof(kMagic));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const Packet& packet : entry) {
+            const uint8_t flags = packet.isKeyframe ? 1 : 0;
+            const int32_t qp = packet.qp;
+            const uint32_t size = static_cast<uint32_t>(packet.data.size());
+            out.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+            out.write(reinterpret_cast<const char*>(&packet.ptsOffset), sizeof(packet.ptsOffset));
+            out.write(reinterpret_cast<const char*>(&packet.duration), sizeof(packet.duration));
+            out.write(reinterpret_cast<const char*>(&qp), sizeof(qp));
+            out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            out.write(reinterpret_cast<const char*>(packet.data.data()), size);
+        }
+        if (!out) {
+            out.close();
+            std::error_code ec;
+            fs::remove(temp, ec);
+            return;
+        }
+    }
+
+    // Rename so a concurrent reader never sees a partial file
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return;
+    }
+    const uint64_t bytes = fs::file_size(path, ec);
+    if (ec) {
+        return;
+    }
+
+    auto existing = disk_.find(key);
+    if (existing != disk_.end()) {
+        diskBytes_ -= existing->second.bytes;
+        diskLru_.erase(existing->second.lru);
+        disk_.erase(existing);
+        RemoveStart(key);
+    }
+    diskLru_.push_front(key);
+    disk_[key] = {bytes, diskLru_.begin()};
+    diskBytes_ += bytes;
+    AddStart(key);
+
+    while (diskBytes_ > maxDiskBytes_ && diskLru_.size() > 1) {
+        Key victim = diskLru_.back();
+        fs::remove(PathFor(victim), ec);
+        diskBytes_ -= disk_[victim].bytes;
+        disk_.erase(victim);
+        diskLru_.pop_back();
+        RemoveStart(victim);
+    }
+}
+
+std::shared_ptr<const EncodeCache::Entry> EncodeCache::ReadDisk(const Key& key) {
+    const std::string path = PathFor(key);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return nullptr;
+    }
+
+    std::error_code ec;
+    const uint64_t fileSize = fs::file_size(path, ec);
+    char magic[sizeof(kMagic)];
+    uint32_t count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || ec || memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<Entry>();
+    uint64_t remaining = fileSize - sizeof(kMagic) - sizeof(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Packet packet;
+        uint8_t flags = 0;
+        int32_t qp = -1;
+        uint32_t size = 0;
+        in.read(reinterpret_cast<char*>(&flags), sizeof(flags));
+        in.read(reinterpret_cast<char*>(&packet.ptsOffset), sizeof(packet.ptsOffset));
+        in.read(reinterpret_cast<char*>(&packet.duration), sizeof(packet.duration));
+        in.read(reinterpret_cast<char*>(&qp), sizeof(qp));
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        const uint64_t header = sizeof(flags) + sizeof(packet.ptsOffset) + sizeof(packet.duration) +
+                                sizeof(qp) + sizeof(size);
+        // Truncated or corrupt: never trust a size past the end of the file
+        if (!in || remaining < header || size > remaining - header) {
+            return nullptr;
+        }
+        remaining -= header + size;
+        packet.isKeyframe = (flags & 1) != 0;
+        packet.qp = qp;
+        packet.data.resize(size);
+        in.read(reinterpret_cast<char*>(packet.data.data()), size);
+        if (!in) {
+            return nullptr;
+        }
+        entry->push_back(std::move(packet));
+    }
+    return entry;
+}
+
+std::shared_ptr<const EncodeCache::Entry> EncodeCache::Lookup(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::shared_ptr<const Entry> entry;
+    auto inMemory = memory_.find(key);
+    if (inMemory != memory_.end()) {
+        memoryLru_.splice(memoryLru_.begin(), memoryLru_, inMemory->second.lru);
+        entry = inMemory->second.entry;
+    } else {
+        auto onDisk = disk_.find(key);
+        if (onDisk != disk_.end()) {
+            entry = ReadDisk(key);
+            std::error_code ec;
+            if (entry) {
+                diskLru_.splice(diskLru_.begin(), diskLru_, onDisk->second.lru);
+                fs::last_write_time(PathFor(key), fs::file_time_type::clock::now(), ec);
+                InsertMemory(key, entry);
+            } else {
+                fs::remove(PathFor(key), ec);
+                diskBytes_ -= onDisk->second.bytes;
+                diskLru_.erase(onDisk->second.lru);
+                disk_.erase(onDisk);
+                RemoveStart(key);
+            }
+        }
+    }
+
+    if (!entry) {
+        misses_++;
+        return nullptr;
+    }
+    hits_++;
+    for (const Packet& packet : *entry) {
+        replayedBytes_ += packet.data.size();
+    }
+    return entry;
+}
+
+void EncodeCache::RecordMiss() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    misses_++;
+}
+
+void EncodeCache::Store(const Key& key, Entry entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto shared = std::make_shared<const Entry>(std::move(entry));
+    if (!directory_.empty() && disk_.find(key) == disk_.end()) {
+        WriteDisk(key, *shared);
+    }
+    InsertMemory(key, std::move(shared));
+}
+
+void EncodeCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::error_code ec;
+    for (const Key& key : diskLru_) {
+        fs::remove(PathFor(key), ec);
+    }
+    diskLru_.clear();
+    disk_.clear();
+    diskBytes_ = 0;
+
+    memoryLru_.clear();
+    memory_.clear();
+    memoryBytes_ = 0;
+    starts_.clear();
+
+    hits_ = misses_ = replayedBytes_ = 0;
+}
+
+EncodeCache::Stats EncodeCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {hits_, misses_, replayedBytes_, memory_.size(), memoryBytes_, disk_.size(), diskBytes_};
+}
+
+// --- JS wrapper ---
+
+Napi::FunctionReference EncodeCacheNative::constructor;
+
+Napi::Object EncodeCacheNative::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "EncodeCacheNative", {
+        InstanceAccessor("stats", &EncodeCacheNative::GetStats, nullptr),
+        InstanceMethod("clear", &EncodeCacheNative::Clear),
+    });
+
+    constructor = Napi::Persistent(func);
+    constructor.SuppressDestruct();
+
+    exports.Set("EncodeCacheNative", func);
+    return exports;
+}
+
+EncodeCacheNative::EncodeCacheNative(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<EncodeCacheNative>(info) {
+    Napi::Env env = info.Env();
+
+    double maxMemoryBytes = 256.0 * 1024 * 1024;
+    double maxDiskBytes = 4.0 * 1024 * 1024 * 1024;
+    double maxPendingBytes = 128.0 * 1024 * 1024;
+    std::string directory;
+
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (options.Has("maxMemoryBytes") && !options.Get("maxMemoryBytes").IsUndefined()) {
+            Napi::Value v = options.Get("maxMemoryBytes");
+            maxMemoryBytes = v.IsNumber() ? v.As<Napi::Number>().DoubleValue() : -1.0;
+        }
+        if (options.Has("maxDiskBytes") && !options.Get("maxDiskBytes").IsUndefined()) {
+            Napi::Value v = options.Get("maxDiskBytes");
+            maxDiskBytes = v.IsNumber() ? v.As<Napi::Number>().DoubleValue() : -1.0;
+        }
+        if (options.Has("maxPendingBytes") && !options.Get("maxPendingBytes").IsUndefined()) {
+            Napi::Value v = options.Get("maxPendingBytes");
+            maxPendingBytes = v.IsNumber() ? v.As<Napi::Number>().DoubleValue() : -1.0;
+        }
+        if (options.Has("directory") && options.Get("directory").IsString()) {
+            directory = options.Get("directory").As<Napi::String>().Utf8Value();
+        }
+    }
+    if (!(maxMemoryBytes >= 0) || !(maxDiskBytes >= 0) || !(maxPendingBytes >= 0)) {
+        Napi::TypeError::New(env, "maxMemoryBytes, maxDiskBytes and maxPendingBytes must be non-negative numbers")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+
+    std::string error;
+    cache_ = EncodeCache::Create(static_cast<size_t>(maxMemoryBytes), directory,
+                                 static_cast<uint64_t>(maxDiskBytes), static_cast<size_t>(maxPendingBytes),
+                                 error);
+    if (!cache_) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    }
+}
+
+std::shared_ptr<EncodeCache> EncodeCacheNative::FromValue(Napi::Value value) {
+    if (!value.IsObject() || !value.As<Napi::Object>().InstanceOf(constructor.Value())) {
+        return nullptr;
+    }
+    return Napi::ObjectWrap<EncodeCacheNative>::Unwrap(value.As<Napi::Object>())->cache_;
+}
+
+Napi::Value EncodeCacheNative::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    EncodeCache::Stats stats = cache_ ? cache_->GetStats() : EncodeCache::Stats{};
+
+    const uint64_t lookups = stats.hits + stats.misses;
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("hits", Napi::Number::New(env, static_cast<double>(stats.hits)));
+    obj.Set("misses", Napi::Number::New(env, static_cast<double>(stats.misses)));
+    obj.Set("hitRate", Napi::Number::New(env, lookups ? static_cast<double>(stats.hits) / lookups : 0.0));
+    obj.Set("replayedBytes", Napi::Number::New(env, static_cast<double>(stats.replayedBytes)));
+    obj.Set("memoryEntries", Napi::Number::New(env, static_cast<double>(stats.memoryEntries)));
+    obj.Set("memoryBytes", Napi::Number::New(env, static_cast<double>(stats.memoryBytes)));
+    obj.Set("diskEntries", Napi::Number::New(env, static_cast<double>(stats.diskEntries)));
+    obj.Set("diskBytes", Napi::Number::New(env, static_cast<double>(stats.diskBytes)));
+    return obj;
+}
+
+void EncodeCacheNative::Clear(const Napi::CallbackInfo& info) {
+    if (cache_) {
+        cache_->Clear();
+    }
+}
@@ -0,0 +1,172 @@
+#ifndef ENCODE_CACHE_H
+#define ENCODE_CACHE_H
+
+#include <napi.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+/**
+ * Content-addressed store of encoded GOPs.
+ *
+ * An encoder hashes each GOP of converted input frames together with its
+ * normalized settings. Keys are split so the first frame alone can be
+ * checked: hi is the digest of the first frame, lo covers the whole GOP.
+ * Frames of a GOP whose first frame starts no stored entry go straight to
+ * the encoder; only a possible hit is held back (up to maxPendingBytes)
+ * until the GOP closes, and a hit replays the stored packets instead of
+ * encoding.
+ *
+ * Entries live in a byte-bounded LRU in memory and, when a directory is
+ * given, in a byte-bounded LRU of files that survives restarts. One cache
+ * may be shared by several encoders.
+ */
+class EncodeCache {
+public:
+    struct Key {
+        uint64_t hi;  // First frame of the GOP
+        uint64_t lo;  // Whole GOP
+        bool operator==(const Key& other) const { return hi == other.hi && lo == other.lo; }
+    };
+
+    struct Packet {
+        std::vector<uint8_t> data;
+        bool isKeyframe;
+        int64_t ptsOffset;  // From the first frame of the GOP
+        int64_t duration;
+        int qp;             // Reported quantizer, -1 if unknown
+    };
+    using Entry = std::vector<Packet>;
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t replayedBytes;
+        size_t memoryEntries;
+        size_t memoryBytes;
+        size_t diskEntries;
+        uint64_t diskBytes;
+    };
+
+    /**
+     * Streaming 128-bit hash: four independent 64-bit lanes over 32-byte
+     * stripes, so the inner loop has no cross-lane dependency and the
+     * compiler can keep the lanes in vector registers.
+     */
+    class Hasher {
+    public:
+        explicit Hasher(uint64_t seed = 0) { Reset(seed); }
+
+        void Reset(uint64_t seed);
+        void Update(const void* data, size_t size);
+        void UpdateValue(int64_t value) { Update(&value, sizeof(value)); }
+        // Visible pixels of every plane plus format, size and color tags
+        bool UpdateFrame(const AVFrame* frame);
+        Key Digest() const;
+
+    private:
+        void Consume(const uint8_t* stripes, size_t count);
+
+        uint64_t lanes_[4];
+        uint8_t tail_[32];
+        size_t tailSize_;
+        uint64_t total_;
+    };
+
+    // An empty directory keeps entries in memory only; nullptr and a message on I/O errors
+    static std::shared_ptr<EncodeCache> Create(size_t maxMemoryBytes, const std::string& directory,
+                                               uint64_t maxDiskBytes, size_t maxPendingBytes,
+                                               std::string& error);
+
+    // Whether a stored GOP begins with this first-frame digest (Key::hi)
+    bool HasStart(uint64_t start) const;
+    // Raw frames one encoder may hold back while a GOP could still be a hit
+    size_t maxPendingBytes() const { return maxPendingBytes_; }
+
+    // Stored packets for key, or nullptr; counts a hit or a miss
+    std::shared_ptr<const Entry> Lookup(const Key& key);
+    // A GOP that had to be encoded without a lookup
+    void RecordMiss();
+    void Store(const Key& key, Entry entry);
+    void Clear();
+    Stats GetStats() const;
+
+private:
+    EncodeCache(size_t maxMemoryBytes, const std::string& directory, uint64_t maxDiskBytes,
+                size_t maxPendingBytes);
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.lo ^ key.hi); }
+    };
+    struct MemorySlot {
+        std::shared_ptr<const Entry> entry;
+        size_t bytes;
+        std::list<Key>::iterator lru;
+    };
+    struct DiskSlot {
+        uint64_t bytes;
+        std::list<Key>::iterator lru;
+    };
+
+    static size_t EntryBytes(const Entry& entry);
+    std::string PathFor(const Key& key) const;
+    void InsertMemory(const Key& key, std::shared_ptr<const Entry> entry);
+    void WriteDisk(const Key& key, const Entry& entry);
+    std::shared_ptr<const Entry> ReadDisk(const Key& key);
+    bool ScanDirectory(std::string& error);
+    void AddStart(const Key& key);
+    void RemoveStart(const Key& key);
+
+    mutable std::mutex mutex_;
+    size_t maxMemoryBytes_;
+    std::string directory_;
+    uint64_t maxDiskBytes_;
+    size_t maxPendingBytes_;
+
+    // Most recently used at the front
+    std::list<Key> memoryLru_;
+    std::unordered_map<Key, MemorySlot, KeyHash> memory_;
+    size_t memoryBytes_ = 0;
+
+    std::list<Key> diskLru_;
+    std::unordered_map<Key, DiskSlot, KeyHash> disk_;
+    uint64_t diskBytes_ = 0;
+
+    // Entries in memory or on disk per first-frame digest
+    std::unordered_map<uint64_t, uint32_t> starts_;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t replayedBytes_ = 0;
+};
+
+/**
+ * JS handle shared between encoders through their config
+ */
+class EncodeCacheNative : public Napi::ObjectWrap<EncodeCacheNative> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    static Napi::FunctionReference constructor;
+
+    // The store behind an EncodeCacheNative object, or nullptr if value is not one
+    static std::shared_ptr<EncodeCache> FromValue(Napi::Value value);
+
+    // new EncodeCacheNative({ maxMemoryBytes?, directory?, maxDiskBytes?, maxPendingBytes? })
+    EncodeCacheNative(const Napi::CallbackInfo& info);
+
+private:
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+    void Clear(const Napi::CallbackInfo& info);
+
+    std::shared_ptr<EncodeCache> cache_;
+};
+
+#endif
@@ -3,6 +3,8 @@
 #include "hw_accel.h"
 #include "color.h"
 #include "svc.h"
+#include "transform.h"
+#include "lut3d.h"
 
 Napi::FunctionReference VideoEncoderNative::constructor;
 
@@ -39,6 +41,7 @@ VideoEncoderNative::VideoEncoderNative(const Napi::CallbackInfo& info)
     , codecName_("")
     , bitrate_(2000000)
     , alpha_(false)
+    , intraOnly_(false)
     , scalabilityMode_("")
     , temporalLayers_(1) {
 
@@ -72,8 +75,12 @@ VideoEncoderNative::~VideoEncoderNative() {
     }
 }
 
-void VideoEncoderNative::configureEncoderOptions(const std::string& encoderName, const std::string& latencyMode) {
+void VideoEncoderNative::configureEncoderOptions(const std::string& encoderName, const std::string& latencyMode,
+                                            const std::string& contentHint) {
     bool isRealtime = (latencyMode == "realtime");
+    // "text" is screen/slide content, "detail" trades frame rate for sharpness
+    bool isText = (contentHint == "text");
+    bool isDetail = (contentHint == "detail");
 
     // Global realtime optimizations - threading and delay
     if (isRealtime) {
@@ -87,12 +94,15 @@ void VideoEncoderNative::configureEncoderOptions(const std::string& encoderName,
     if (encoderName == "libx264") {
         if (isRealtime) {
             av_opt_set(codecCtx_->priv_data, "preset", "ultrafast", 0);
-            av_opt_set(codecCtx_->priv_data, "tune", "zerolatency", 0);
+            av_opt_set(codecCtx_->priv_data, "tune", isText ? "stillimage,zerolatency" : "zerolatency", 0);
             av_opt_set(codecCtx_->priv_data, "rc-lookahead", "0", 0);
             av_opt_set(codecCtx_->priv_data, "sync-lookahead", "0", 0);
             av_opt_set(codecCtx_->priv_data, "intra-refresh", "1", 0);
         } else {
-            av_opt_set(codecCtx_->priv_data, "preset", "medium", 0);
+            av_opt_set(codecCtx_->priv_data, "preset", isText ? "faster" : isDetail ? "slow" : "medium", 0);
+            if (isText) {
+                av_opt_set(codecCtx_->priv_data, "tune", "stillimage", 0);
+            }
         }
     }
     else if (encoderName == "h264_videotoolbox" || encoderName == "hevc_videotoolbox") {
@@ -128,13 +138,24 @@ void VideoEncoderNative::configureEncoderOptions(const std::string& encoderName,
             av_opt_set_int(codecCtx_->priv_data, "lag-in-frames", 0, 0);
             av_opt_set(codecCtx_->priv_data, "deadline", "realtime", 0);
         } else {
-            av_opt_set_int(codecCtx_->priv_data, "cpu-used", 4, 0);
+            av_opt_set_int(codecCtx_->priv_data, "cpu-used", isText ? 5 : isDetail ? 2 : 4, 0);
+        }
+        if (isText) {
+            // VP8 has a screen content mode, VP9 a content tune
+            if (encoderName == "libvpx") {
+                av_opt_set_int(codecCtx_->priv_data, "screen-content-mode", 1, 0);
+            } else {
+                av_opt_set(codecCtx_->priv_data, "tune-content", "screen", 0);
+            }
         }
     }
     else if (encoderName == "libx265") {
-        av_opt_set(codecCtx_->priv_data, "preset", isRealtime ? "ultrafast" : "medium", 0);
+        av_opt_set(codecCtx_->priv_data, "preset",
+                   isRealtime ? "ultrafast" : isText ? "fast" : isDetail ? "slow" : "medium", 0);
         if (isRealtime) {
             av_opt_set(codecCtx_->priv_data, "tune", "zerolatency", 0);
+        } else if (isText) {
+            av_opt_set(codecCtx_->priv_data, "tune", "animation", 0);
         }
     }
     else if (encoderName == "libaom-av1" || encoderName == "libsvtav1") {
@@ -143,7 +164,37 @@ void VideoEncoderNative::configureEncoderOptions(const std::string& encoderName,
             av_opt_set_int(codecCtx_->priv_data, "lag-in-frames", 0, 0);
             av_opt_set(codecCtx_->priv_data, "usage", "realtime", 0);
         } else {
-            av_opt_set_int(codecCtx_->priv_data, "cpu-used", 6, 0);
+            av_opt_set_int(codecCtx_->priv_data, "cpu-used", isDetail ? 4 : 6, 0);
+        }
+        if (isText && encoderName == "libaom-av1") {
+            // Screen tools: palette mode and intra block copy
+            av_opt_set(codecCtx_->priv_data, "tune-content", "screen", 0);
+            av_opt_set_int(codecCtx_->priv_data, "enable-palette", 1, 0);
+            av_opt_set_int(codecCtx_->priv_data, "enable-intrabc", 1, 0);
+        } else if (isText) {
+            av_opt_set(codecCtx_->priv_data, "svtav1-params", "scm=1", 0);
+        }
+    }
+
+    // Intra-only (mezzanine) proxies: every frame is a keyframe, so B-frames and
+    // lookahead buy nothing; slice threads parallelize without adding delay
+    if (intraOnly_) {
+        codecCtx_->gop_size = 1;
+        codecCtx_->max_b_frames = 0;
+        codecCtx_->thread_count = 0;  // Auto
+        codecCtx_->thread_type = FF_THREAD_SLICE;
+
+        if (encoderName == "libx264") {
+            av_opt_set(codecCtx_->priv_data, "intra-refresh", "0", 0);
+            av_opt_set(codecCtx_->priv_data, "rc-lookahead", "0", 0);
+        } else if (encoderName == "libvpx" || encoderName == "libvpx-vp9") {
+            av_opt_set_int(codecCtx_->priv_data, "lag-in-frames", 0, 0);
+            if (encoderName == "libvpx-vp9") {
+                av_opt_set_int(codecCtx_->priv_data, "row-mt", 1, 0);
+            }
+        } else if (encoderName == "libaom-av1") {
+            av_opt_set(codecCtx_->priv_data, "usage", "allintra", 0);
+            av_opt_set_int(codecCtx_->priv_data, "row-mt", 1, 0);
         }
     }
 }
@@ -170,6 +221,32 @@ void VideoEncoderNative::Configure(const Napi::CallbackInfo& info) {
         hwPref = HWAccel::parsePreference(pref);
     }
 
+    // HDR -> SDR tone mapping of PQ/HLG input frames
+    toneMapper_.reset();
+    if (config.Has("toneMapping") && config.Get("toneMapping").IsString()) {
+        std::string curveName = config.Get("toneMapping").As<Napi::String>().Utf8Value();
+        ToneMap::Curve curve = ToneMap::parseCurve(curveName);
+        if (curve == ToneMap::Curve::None) {
+            Napi::TypeError::New(env, "Unknown toneMapping: " + curveName).ThrowAsJavaScriptException();
+            return;
+        }
+        double peakLuminance = 0;
+        if (config.Has("hdrPeakLuminance") && config.Get("hdrPeakLuminance").IsNumber()) {
+            peakLuminance = config.Get("hdrPeakLuminance").As<Napi::Number>().DoubleValue();
+        }
+        toneMapper_.reset(new ToneMap::ToneMapper(curve, peakLuminance));
+    }
+
+    // Color LUT stage (shared, parsed once by ColorLUT)
+    colorLut_.reset();
+    if (config.Has("colorLut") && !config.Get("colorLut").IsUndefined()) {
+        colorLut_ = ColorLutNative::FromValue(config.Get("colorLut"));
+        if (!colorLut_) {
+            Napi::TypeError::New(env, "colorLut must be a ColorLUT").ThrowAsJavaScriptException();
+            return;
+        }
+    }
+
     // Select encoder based on preference and availability
     HWAccel::EncoderInfo encInfo = HWAccel::selectEncoder(codecName, hwPref, width_, height_);
 
@@ -238,14 +315,15 @@ void VideoEncoderNative::Configure(const Napi::CallbackInfo& info) {
             av_opt_set_int(codecCtx_->priv_data, "maxrate", bitrate_, 0);
         }
     } else if (bitrateMode_ == "quantizer") {
-        // CQP/CRF mode - Constant Quality, ignore bitrate
+        // CQP mode - Constant Quality, ignore bitrate
         codecCtx_->bit_rate = 0;
         codecCtx_->rc_max_rate = 0;
 
         // Set default quantizer based on codec
         if (codecName_.find("libx264") != std::string::npos ||
             codecName_.find("libx265") != std::string::npos) {
-            av_opt_set_int(codecCtx_->priv_data, "crf", 23, 0);  // Default CRF
+            // Constant QP, matching the worker-thread encoder
+            av_opt_set_int(codecCtx_->priv_data, "qp", 23, 0);
         } else if (codecName_.find("libvpx") != std::string::npos) {
             av_opt_set_int(codecCtx_->priv_data, "crf", 30, 0);  // Default for VP8/9
             codecCtx_->qmin = 0;
@@ -307,6 +385,14 @@ void VideoEncoderNative::Configure(const Napi::CallbackInfo& info) {
         }
     }
 
+    // Tone mapped output is SDR BT.709 unless the config says otherwise
+    if (toneMapper_ && !config.Has("colorSpace")) {
+        codecCtx_->color_primaries = AVCOL_PRI_BT709;
+        codecCtx_->color_trc = AVCOL_TRC_BT709;
+        codecCtx_->colorspace = AVCOL_SPC_BT709;
+        codecCtx_->color_range = AVCOL_RANGE_MPEG;
+    }
+
     // Setup hardware device context if needed
     if (hwType_ != HWAccel::Type::None) {
         hwDeviceCtx_ = HWAccel::createHWDeviceContext(hwType_);
@@ -356,7 +442,13 @@ void VideoEncoderNative::Configure(const Napi::CallbackInfo& info) {
     if (config.Has("latencyMode")) {
         latencyMode = config.Get("latencyMode").As<Napi::String>().Utf8Value();
     }
-    configureEncoderOptions(encoderName, latencyMode);
+    std::string contentHint;
+    if (config.Has("contentHint") && config.Get("contentHint").IsString()) {
+        contentHint = config.Get("contentHint").As<Napi::String>().Utf8Value();
+    }
+    intraOnly_ = config.Has("intraOnly") && config.Get("intraOnly").IsBoolean() &&
+                 config.Get("intraOnly").As<Napi::Boolean>().Value();
+    configureEncoderOptions(encoderName, latencyMode, contentHint);
 
     // Scalability mode (SVC) for temporal layers
     if (config.Has("scalabilityMode") && config.Get("scalabilityMode").IsString()) {
@@ -470,7 +562,7 @@ void VideoEncoderNative::Configure(const Napi::CallbackInfo& info) {
                 codecCtx_->max_b_frames = 0;
                 codecCtx_->pix_fmt = AV_PIX_FMT_YUV420P;
 
-                configureEncoderOptions(codec_->name, latencyMode);
+                configureEncoderOptions(codec_->name, latencyMode, contentHint);
 
                 ret = avcodec_open2(codecCtx_, codec_, nullptr);
                 if (ret < 0) {
@@ -512,6 +604,38 @@ void VideoEncoderNative::Encode(const Napi::CallbackInfo& info) {
     int64_t timestamp = info[1].As<Napi::Number>().Int64Value();
     bool forceKeyframe = info[2].As<Napi::Boolean>().Value();
 
+    // Orientation pre-stage; scaling to the encoder size happens in the conversion pass
+    int rotation = info.Length() > 3 && info[3].IsNumber() ? info[3].As<Napi::Number>().Int32Value() : 0;
+    bool flip = info.Length() > 4 && info[4].IsBoolean() && info[4].As<Napi::Boolean>().Value();
+    AVFrame* oriented = nullptr;
+    if (rotation != 0 || flip) {
+        oriented = FrameTransform::apply(srcFrame, rotation, flip);
+        if (!oriented) {
+            Napi::Error::New(env, "Rotation/flip not supported for this frame").ThrowAsJavaScriptException();
+            return;
+        }
+        srcFrame = oriented;
+    }
+
+    // Tone map HDR input before it is converted for the encoder
+    AVFrame* mapped = nullptr;
+    if (toneMapper_ && ToneMap::isHdr(srcFrame)) {
+        mapped = toneMapper_->Process(srcFrame);
+        if (mapped) {
+            srcFrame = mapped;
+        }
+    }
+
+    // Color LUT; the graded frame stays in planar RGB for the conversion pass
+    if (colorLut_) {
+        AVFrame* graded = colorLut_->Apply(srcFrame, false);
+        if (graded) {
+            av_frame_free(&mapped);
+            mapped = graded;
+            srcFrame = graded;
+        }
+    }
+
     // Determine target pixel format
     AVPixelFormat targetFormat = codecCtx_->pix_fmt;
     if (targetFormat == AV_PIX_FMT_VAAPI || targetFormat == AV_PIX_FMT_NONE) {
@@ -538,6 +662,8 @@ void VideoEncoderNative::Encode(const Napi::CallbackInfo& info) {
     int ret = av_frame_get_buffer(frame, 0);
     if (ret < 0) {
         av_frame_free(&frame);
+        av_frame_free(&mapped);
+        av_frame_free(&oriented);
         char errBuf[256];
         av_strerror(ret, errBuf, sizeof(errBuf));
         Napi::Error::New(env, std::string("Failed to allocate frame: ") + errBuf).ThrowAsJavaScriptException();
@@ -549,20 +675,25 @@ void VideoEncoderNative::Encode(const Napi::CallbackInfo& info) {
         srcFrame->width != width_ ||
         srcFrame->height != height_) {
 
+        // Cached: reused while the input format and size stay the same
+        swsCtx_ = sws_getCachedContext(swsCtx_,
+            srcFrame->width, srcFrame->height, (AVPixelFormat)srcFrame->format,
+            width_, height_, targetFormat,
+            SWS_BILINEAR, nullptr, nullptr, nullptr
+        );
+
         if (!swsCtx_) {
-            swsCtx_ = sws_getContext(
-                srcFrame->width, srcFrame->height, (AVPixelFormat)srcFrame->format,
-                width_, height_, targetFormat,
-                SWS_BILINEAR, nullptr, nullptr, nullptr
-            );
-
-            if (!swsCtx_) {
-                av_frame_free(&frame);
-                Napi::Error::New(env, "Failed to create scaler context").ThrowAsJavaScriptException();
-                return;
-            }
+            av_frame_free(&frame);
+            av_frame_free(&mapped);
+            av_frame_free(&oriented);
+            Napi::Error::New(env, "Failed to create scaler context").ThrowAsJavaScriptException();
+            return;
         }
 
+        ColorSpace::configureSws(swsCtx_,
+            (AVPixelFormat)srcFrame->format, srcFrame->colorspace, srcFrame->color_range,
+            targetFormat, codecCtx_->colorspace, codecCtx_->color_range);
+
         sws_scale(swsCtx_,
             srcFrame->data, srcFrame->linesize, 0, srcFrame->height,
             frame->data, frame->linesize
@@ -570,6 +701,8 @@ void VideoEncoderNative::Encode(const Napi::CallbackInfo& info) {
     } else {
         av_frame_copy(frame, srcFrame);
     }
+    av_frame_free(&mapped);
+    av_frame_free(&oriented);
 
     // Set keyframe flag
     if (forceKeyframe) {
@@ -2,7 +2,10 @@
 #define ENCODER_H
 
 #include <napi.h>
+#include <memory>
 #include "hw_accel.h"
+#include "tonemap.h"
+#include "lut3d.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -29,12 +32,19 @@ private:
 
     void EmitChunk(Napi::Env env, AVPacket* packet, bool isKeyframe);
     void EmitError(Napi::Env env, const std::string& message);
-    void configureEncoderOptions(const std::string& encoderName, const std::string& latencyMode);
+    void configureEncoderOptions(const std::string& encoderName, const std::string& latencyMode,
+                                 const std::string& contentHint);
 
     AVCodecContext* codecCtx_;
     const AVCodec* codec_;
     SwsContext* swsCtx_;
 
+    // HDR -> SDR pre-stage, created at configure when toneMapping is set
+    std::unique_ptr<ToneMap::ToneMapper> toneMapper_;
+
+    // Color LUT applied to every input frame, if configured
+    std::shared_ptr<const Lut3D> colorLut_;
+
     // Hardware acceleration
     HWAccel::Type hwType_;
     AVBufferRef* hwDeviceCtx_;
@@ -57,6 +67,9 @@ private:
     // Alpha channel support
     bool alpha_;
 
+    // Every frame a keyframe (editing proxies)
+    bool intraOnly_;
+
     // Scalability mode (SVC)
     std::string scalabilityMode_;
     int temporalLayers_;
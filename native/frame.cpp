@@ -1,17 +1,114 @@
 #include "frame.h"
+#include "color.h"
+#include "tonemap.h"
+#include "transform.h"
+#include "lut3d.h"
+#include "analysis.h"
 #include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
 
 Napi::FunctionReference VideoFrameNative::constructor;
 
+namespace {
+
+// copyTo() is usually called for every frame of a stream with the same
+// options. The tone mapper (gain table, 16-bit RGB scratch) and the scaler
+// are kept per thread and only rebuilt when the curve, peak or conversion
+// changes.
+struct CopyToCache {
+    std::unique_ptr<ToneMap::ToneMapper> mapper;
+    ToneMap::Curve curve = ToneMap::Curve::None;
+    double peak = 0;
+
+    SwsContext* sws = nullptr;
+    struct Key {
+        int width = 0, height = 0;
+        AVPixelFormat srcFormat = AV_PIX_FMT_NONE, dstFormat = AV_PIX_FMT_NONE;
+        AVColorSpace srcMatrix = AVCOL_SPC_UNSPECIFIED, dstMatrix = AVCOL_SPC_UNSPECIFIED;
+        AVColorRange srcRange = AVCOL_RANGE_UNSPECIFIED, dstRange = AVCOL_RANGE_UNSPECIFIED;
+
+        bool operator==(const Key& o) const {
+            return width == o.width && height == o.height &&
+                   srcFormat == o.srcFormat && dstFormat == o.dstFormat &&
+                   srcMatrix == o.srcMatrix && dstMatrix == o.dstMatrix &&
+                   srcRange == o.srcRange && dstRange == o.dstRange;
+        }
+    } key;
+
+    ~CopyToCache() {
+        sws_freeContext(sws);
+    }
+
+    ToneMap::ToneMapper* Mapper(ToneMap::Curve newCurve, double newPeak) {
+        if (!mapper || curve != newCurve || peak != newPeak) {
+            mapper.reset(new ToneMap::ToneMapper(newCurve, newPeak));
+            curve = newCurve;
+            peak = newPeak;
+        }
+        return mapper.get();
+    }
+
+    SwsContext* Scaler(const Key& newKey) {
+        // Same size and formats return the same context, colorspace included
+        sws = sws_getCachedContext(sws,
+            newKey.width, newKey.height, newKey.srcFormat,
+            newKey.width, newKey.height, newKey.dstFormat,
+            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!sws) {
+            key = Key();
+            return nullptr;
+        }
+        if (!(key == newKey)) {
+            ColorSpace::configureSws(sws,
+                newKey.srcFormat, newKey.srcMatrix, newKey.srcRange,
+                newKey.dstFormat, newKey.dstMatrix, newKey.dstRange);
+            key = newKey;
+        }
+        return sws;
+    }
+};
+
+thread_local CopyToCache copyToCache;
+
+// Every decoded frame has its format and color space read once by
+// VideoFrame._fromNative. The names come from a handful of fixed tables, so
+// the JS strings are created once per environment and handed back from a
+// reference instead of allocating fresh ones for each frame.
+struct FrameStrings {
+    std::unordered_map<std::string, Napi::Reference<Napi::String>> names;
+};
+
+Napi::String CachedString(Napi::Env env, const std::string& value) {
+    FrameStrings* strings = env.GetInstanceData<FrameStrings>();
+    if (!strings) {
+        strings = new FrameStrings();
+        env.SetInstanceData(strings);
+    }
+    auto it = strings->names.find(value);
+    if (it == strings->names.end()) {
+        it = strings->names.emplace(value,
+            Napi::Persistent(Napi::String::New(env, value))).first;
+    }
+    return it->second.Value();
+}
+
+}  // namespace
+
 Napi::Object VideoFrameNative::Init(Napi::Env env, Napi::Object exports) {
     Napi::Function func = DefineClass(env, "VideoFrameNative", {
         InstanceMethod("allocationSize", &VideoFrameNative::AllocationSize),
         InstanceMethod("copyTo", &VideoFrameNative::CopyTo),
         InstanceMethod("clone", &VideoFrameNative::Clone),
+        InstanceMethod("transform", &VideoFrameNative::Transform),
+        InstanceMethod("applyLut", &VideoFrameNative::ApplyLut),
+        InstanceMethod("analyze", &VideoFrameNative::Analyze),
         InstanceMethod("close", &VideoFrameNative::Close),
         InstanceAccessor("width", &VideoFrameNative::GetWidth, nullptr),
         InstanceAccessor("height", &VideoFrameNative::GetHeight, nullptr),
         InstanceAccessor("format", &VideoFrameNative::GetFormat, nullptr),
+        InstanceAccessor("colorSpace", &VideoFrameNative::GetColorSpace, nullptr),
     });
 
     constructor = Napi::Persistent(func);
@@ -28,7 +125,7 @@ VideoFrameNative::VideoFrameNative(const Napi::CallbackInfo& info)
 
     // Constructor can be called:
     // 1. With no args (for NewInstance with external frame)
-    // 2. With buffer, format, width, height
+    // 2. With buffer, format, width, height[, colorSpace]
     if (info.Length() == 0) {
         // Will be set via SetFrame
         return;
@@ -75,6 +172,27 @@ VideoFrameNative::VideoFrameNative(const Napi::CallbackInfo& info)
         return;
     }
 
+    // Color metadata, so conversions and tone mapping know what the pixels are
+    if (info.Length() > 4 && info[4].IsObject()) {
+        Napi::Object cs = info[4].As<Napi::Object>();
+        if (cs.Has("primaries") && cs.Get("primaries").IsString()) {
+            frame_->color_primaries = ColorSpace::parsePrimaries(
+                cs.Get("primaries").As<Napi::String>().Utf8Value());
+        }
+        if (cs.Has("transfer") && cs.Get("transfer").IsString()) {
+            frame_->color_trc = ColorSpace::parseTransfer(
+                cs.Get("transfer").As<Napi::String>().Utf8Value());
+        }
+        if (cs.Has("matrix") && cs.Get("matrix").IsString()) {
+            frame_->colorspace = ColorSpace::parseMatrix(
+                cs.Get("matrix").As<Napi::String>().Utf8Value());
+        }
+        if (cs.Has("fullRange") && cs.Get("fullRange").IsBoolean()) {
+            frame_->color_range = cs.Get("fullRange").As<Napi::Boolean>().Value()
+                ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+        }
+    }
+
     // Copy data into frame based on pixel format
     const uint8_t* src = buffer.Data();
     size_t srcLen = buffer.Length();
@@ -244,10 +362,12 @@ Napi::Value VideoFrameNative::CopyTo(const Napi::CallbackInfo& info) {
 
     Napi::Buffer<uint8_t> dest = info[0].As<Napi::Buffer<uint8_t>>();
 
-    // Parse options for format conversion and rect cropping
+    // Parse options for format conversion, rect cropping and tone mapping
     AVPixelFormat targetFormat = static_cast<AVPixelFormat>(frame_->format);
     int rectX = 0, rectY = 0;
     int rectW = frame_->width, rectH = frame_->height;
+    ToneMap::Curve toneCurve = ToneMap::Curve::None;
+    double peakLuminance = 0;
 
     if (info.Length() > 1 && info[1].IsObject()) {
         Napi::Object options = info[1].As<Napi::Object>();
@@ -275,22 +395,55 @@ Napi::Value VideoFrameNative::CopyTo(const Napi::CallbackInfo& info) {
             if (rectX + rectW > frame_->width) rectW = frame_->width - rectX;
             if (rectY + rectH > frame_->height) rectH = frame_->height - rectY;
         }
+
+        // HDR -> SDR tone mapping ('hable' or 'bt2390')
+        if (options.Has("toneMapping") && options.Get("toneMapping").IsString()) {
+            std::string curve = options.Get("toneMapping").As<Napi::String>().Utf8Value();
+            toneCurve = ToneMap::parseCurve(curve);
+            if (toneCurve == ToneMap::Curve::None) {
+                Napi::TypeError::New(env, "Unknown toneMapping: " + curve).ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+        }
+        if (options.Has("hdrPeakLuminance") && options.Get("hdrPeakLuminance").IsNumber()) {
+            peakLuminance = options.Get("hdrPeakLuminance").As<Napi::Number>().DoubleValue();
+        }
+    }
+
+    // Tone mapped frames are converted from their SDR BT.709 RGB copy
+    const AVFrame* src = frame_;
+    AVFrame* mapped = nullptr;
+    if (toneCurve != ToneMap::Curve::None && ToneMap::isHdr(frame_)) {
+        mapped = copyToCache.Mapper(toneCurve, peakLuminance)->Process(frame_);
+        if (!mapped) {
+            Napi::Error::New(env, "Failed to tone map frame").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        src = mapped;
     }
 
     // Check if we need conversion/cropping
-    bool needsConversion = (targetFormat != frame_->format) ||
+    bool needsConversion = (targetFormat != src->format) ||
                           (rectX != 0 || rectY != 0 ||
-                           rectW != frame_->width || rectH != frame_->height);
+                           rectW != src->width || rectH != src->height);
 
     if (needsConversion) {
-        // Use swscale for format conversion and/or cropping
-        SwsContext* swsCtx = sws_getContext(
-            rectW, rectH, static_cast<AVPixelFormat>(frame_->format),
-            rectW, rectH, targetFormat,
-            SWS_BILINEAR, nullptr, nullptr, nullptr
-        );
+        // Use swscale for format conversion and/or cropping. Honor the
+        // frame's matrix and range instead of swscale's BT.601 default; YUV
+        // output from a tone mapped frame is BT.709
+        CopyToCache::Key key;
+        key.width = rectW;
+        key.height = rectH;
+        key.srcFormat = static_cast<AVPixelFormat>(src->format);
+        key.srcMatrix = src->colorspace;
+        key.srcRange = src->color_range;
+        key.dstFormat = targetFormat;
+        key.dstMatrix = mapped ? AVCOL_SPC_BT709 : frame_->colorspace;
+        key.dstRange = mapped ? AVCOL_RANGE_MPEG : frame_->color_range;
+        SwsContext* swsCtx = copyToCache.Scaler(key);
 
         if (!swsCtx) {
+            av_frame_free(&mapped);
             Napi::Error::New(env, "Failed to create conversion context").ThrowAsJavaScriptException();
             return env.Undefined();
         }
@@ -298,7 +451,7 @@ Napi::Value VideoFrameNative::CopyTo(const Napi::CallbackInfo& info) {
         // Create output frame
         AVFrame* outFrame = av_frame_alloc();
         if (!outFrame) {
-            sws_freeContext(swsCtx);
+            av_frame_free(&mapped);
             Napi::Error::New(env, "Failed to allocate output frame").ThrowAsJavaScriptException();
             return env.Undefined();
         }
@@ -310,7 +463,7 @@ Napi::Value VideoFrameNative::CopyTo(const Napi::CallbackInfo& info) {
         int ret = av_frame_get_buffer(outFrame, 0);
         if (ret < 0) {
             av_frame_free(&outFrame);
-            sws_freeContext(swsCtx);
+            av_frame_free(&mapped);
             char errBuf[256];
             av_strerror(ret, errBuf, sizeof(errBuf));
             Napi::Error::New(env, std::string("Failed to allocate output buffer: ") + errBuf).ThrowAsJavaScriptException();
@@ -321,48 +474,48 @@ Napi::Value VideoFrameNative::CopyTo(const Napi::CallbackInfo& info) {
         uint8_t* srcSlice[4] = {nullptr, nullptr, nullptr, nullptr};
         int srcStride[4] = {0, 0, 0, 0};
 
-        AVPixelFormat srcFmt = static_cast<AVPixelFormat>(frame_->format);
+        AVPixelFormat srcFmt = static_cast<AVPixelFormat>(src->format);
 
         // Calculate byte offset for the crop region
         if (srcFmt == AV_PIX_FMT_YUV420P || srcFmt == AV_PIX_FMT_YUVA420P) {
             // YUV420P: Y is full res, U/V are half res
-            srcSlice[0] = frame_->data[0] + rectY * frame_->linesize[0] + rectX;
-            srcSlice[1] = frame_->data[1] + (rectY / 2) * frame_->linesize[1] + (rectX / 2);
-            srcSlice[2] = frame_->data[2] + (rectY / 2) * frame_->linesize[2] + (rectX / 2);
-            if (srcFmt == AV_PIX_FMT_YUVA420P && frame_->data[3]) {
-                srcSlice[3] = frame_->data[3] + rectY * frame_->linesize[3] + rectX;
+            srcSlice[0] = src->data[0] + rectY * src->linesize[0] + rectX;
+            srcSlice[1] = src->data[1] + (rectY / 2) * src->linesize[1] + (rectX / 2);
+            srcSlice[2] = src->data[2] + (rectY / 2) * src->linesize[2] + (rectX / 2);
+            if (srcFmt == AV_PIX_FMT_YUVA420P && src->data[3]) {
+                srcSlice[3] = src->data[3] + rectY * src->linesize[3] + rectX;
             }
-            srcStride[0] = frame_->linesize[0];
-            srcStride[1] = frame_->linesize[1];
-            srcStride[2] = frame_->linesize[2];
-            srcStride[3] = frame_->linesize[3];
+            srcStride[0] = src->linesize[0];
+            srcStride[1] = src->linesize[1];
+            srcStride[2] = src->linesize[2];
+            srcStride[3] = src->linesize[3];
         } else if (srcFmt == AV_PIX_FMT_YUV422P) {
             // YUV422P: Y is full res, U/V are half width, full height
-            srcSlice[0] = frame_->data[0] + rectY * frame_->linesize[0] + rectX;
-            srcSlice[1] = frame_->data[1] + rectY * frame_->linesize[1] + (rectX / 2);
-            srcSlice[2] = frame_->data[2] + rectY * frame_->linesize[2] + (rectX / 2);
-            srcStride[0] = frame_->linesize[0];
-            srcStride[1] = frame_->linesize[1];
-            srcStride[2] = frame_->linesize[2];
-        } else if (srcFmt == AV_PIX_FMT_YUV444P) {
-            // YUV444P: all planes are full res
-            srcSlice[0] = frame_->data[0] + rectY * frame_->linesize[0] + rectX;
-            srcSlice[1] = frame_->data[1] + rectY * frame_->linesize[1] + rectX;
-            srcSlice[2] = frame_->data[2] + rectY * frame_->linesize[2] + rectX;
-            srcStride[0] = frame_->linesize[0];
-            srcStride[1] = frame_->linesize[1];
-            srcStride[2] = frame_->linesize[2];
+            srcSlice[0] = src->data[0] + rectY * src->linesize[0] + rectX;
+            srcSlice[1] = src->data[1] + rectY * src->linesize[1] + (rectX / 2);
+            srcSlice[2] = src->data[2] + rectY * src->linesize[2] + (rectX / 2);
+            srcStride[0] = src->linesize[0];
+            srcStride[1] = src->linesize[1];
+            srcStride[2] = src->linesize[2];
+        } else if (srcFmt == AV_PIX_FMT_YUV444P || srcFmt == AV_PIX_FMT_GBRP) {
+            // YUV444P / GBRP: all planes are full res
+            srcSlice[0] = src->data[0] + rectY * src->linesize[0] + rectX;
+            srcSlice[1] = src->data[1] + rectY * src->linesize[1] + rectX;
+            srcSlice[2] = src->data[2] + rectY * src->linesize[2] + rectX;
+            srcStride[0] = src->linesize[0];
+            srcStride[1] = src->linesize[1];
+            srcStride[2] = src->linesize[2];
         } else if (srcFmt == AV_PIX_FMT_NV12) {
             // NV12: Y plane, interleaved UV plane (half res)
-            srcSlice[0] = frame_->data[0] + rectY * frame_->linesize[0] + rectX;
-            srcSlice[1] = frame_->data[1] + (rectY / 2) * frame_->linesize[1] + (rectX & ~1);
-            srcStride[0] = frame_->linesize[0];
-            srcStride[1] = frame_->linesize[1];
+            srcSlice[0] = src->data[0] + rectY * src->linesize[0] + rectX;
+            srcSlice[1] = src->data[1] + (rectY / 2) * src->linesize[1] + (rectX & ~1);
+            srcStride[0] = src->linesize[0];
+            srcStride[1] = src->linesize[1];
         } else {
             // Packed formats (RGBA, BGRA, etc.) - 4 bytes per pixel
             int bytesPerPixel = 4;
-            srcSlice[0] = frame_->data[0] + rectY * frame_->linesize[0] + rectX * bytesPerPixel;
-            srcStride[0] = frame_->linesize[0];
+            srcSlice[0] = src->data[0] + rectY * src->linesize[0] + rectX * bytesPerPixel;
+            srcStride[0] = src->linesize[0];
         }
 
         // Perform the conversion
@@ -382,7 +535,7 @@ Napi::Value VideoFrameNative::CopyTo(const Napi::CallbackInfo& info) {
         );
 
         av_frame_free(&outFrame);
-        sws_freeContext(swsCtx);
+        av_frame_free(&mapped);
 
         if (size < 0) {
             char errBuf[256];
@@ -395,13 +548,14 @@ Napi::Value VideoFrameNative::CopyTo(const Napi::CallbackInfo& info) {
         int size = av_image_copy_to_buffer(
             dest.Data(),
             dest.Length(),
-            frame_->data,
-            frame_->linesize,
-            (AVPixelFormat)frame_->format,
-            frame_->width,
-            frame_->height,
+            src->data,
+            src->linesize,
+            (AVPixelFormat)src->format,
+            src->width,
+            src->height,
             1
         );
+        av_frame_free(&mapped);
 
         if (size < 0) {
             char errBuf[256];
@@ -431,6 +585,96 @@ Napi::Value VideoFrameNative::Clone(const Napi::CallbackInfo& info) {
     return NewInstance(env, cloned);
 }
 
+Napi::Value VideoFrameNative::Transform(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (closed_ || !frame_) {
+        Napi::Error::New(env, "Frame is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // transform(rotation, flip): clockwise rotation, then horizontal flip
+    int rotation = info.Length() > 0 && info[0].IsNumber() ? info[0].As<Napi::Number>().Int32Value() : 0;
+    bool flip = info.Length() > 1 && info[1].IsBoolean() && info[1].As<Napi::Boolean>().Value();
+
+    if (!FrameTransform::isValidRotation(rotation)) {
+        Napi::TypeError::New(env, "Rotation must be 0, 90, 180 or 270").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (!FrameTransform::isSupported(frame_, rotation)) {
+        Napi::Error::New(env, "Rotation/flip not supported for format: " +
+            PixelFormatToString((AVPixelFormat)frame_->format)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    AVFrame* transformed = (rotation == 0 && !flip)
+        ? av_frame_clone(frame_)
+        : FrameTransform::apply(frame_, rotation, flip);
+    if (!transformed) {
+        Napi::Error::New(env, "Failed to transform frame").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return NewInstance(env, transformed);
+}
+
+Napi::Value VideoFrameNative::ApplyLut(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (closed_ || !frame_) {
+        Napi::Error::New(env, "Frame is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::shared_ptr<const Lut3D> lut = ColorLutNative::FromValue(info[0]);
+    if (!lut) {
+        Napi::TypeError::New(env, "Expected a ColorLutNative").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    AVFrame* graded = lut->Apply(frame_, true);
+    if (!graded) {
+        Napi::Error::New(env, "Failed to apply LUT").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return NewInstance(env, graded);
+}
+
+Napi::Value VideoFrameNative::Analyze(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (closed_ || !frame_) {
+        Napi::Error::New(env, "Frame is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // analyze(options?, previous?): previous is diffed against when given
+    FrameAnalysis::Options options;
+    std::string error;
+    if (info.Length() > 0 && !FrameAnalysis::parseOptions(info[0], options, error)) {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (!FrameAnalysis::isSupported(frame_)) {
+        Napi::Error::New(env, "Analysis not supported for format: " +
+            PixelFormatToString((AVPixelFormat)frame_->format)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    FrameAnalysis::Analyzer analyzer(options);
+    FrameAnalysis::Stats stats;
+    if (info.Length() > 1 && info[1].IsObject() && info[1].As<Napi::Object>().InstanceOf(constructor.Value())) {
+        const AVFrame* previous = Unwrap(info[1].As<Napi::Object>())->frame_;
+        if (previous) {
+            analyzer.Analyze(previous, stats);
+        }
+    }
+    analyzer.Analyze(frame_, stats);
+
+    return FrameAnalysis::toJS(env, stats);
+}
+
 void VideoFrameNative::Close(const Napi::CallbackInfo& info) {
     if (!closed_ && frame_ && ownsFrame_) {
         av_frame_free(&frame_);
@@ -457,7 +701,29 @@ Napi::Value VideoFrameNative::GetFormat(const Napi::CallbackInfo& info) {
     if (closed_ || !frame_) {
         return info.Env().Undefined();
     }
-    return Napi::String::New(info.Env(), PixelFormatToString((AVPixelFormat)frame_->format));
+    return CachedString(info.Env(), PixelFormatToString((AVPixelFormat)frame_->format));
+}
+
+Napi::Value VideoFrameNative::GetColorSpace(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (closed_ || !frame_) {
+        return env.Undefined();
+    }
+
+    auto stringOrNull = [&env](const std::string& value) -> Napi::Value {
+        return value.empty() ? env.Null() : Napi::Value(CachedString(env, value));
+    };
+
+    Napi::Object cs = Napi::Object::New(env);
+    cs.Set("primaries", stringOrNull(ColorSpace::primariesToString(frame_->color_primaries)));
+    cs.Set("transfer", stringOrNull(ColorSpace::transferToString(frame_->color_trc)));
+    cs.Set("matrix", stringOrNull(ColorSpace::matrixToString(frame_->colorspace)));
+    if (frame_->color_range == AVCOL_RANGE_UNSPECIFIED) {
+        cs.Set("fullRange", env.Null());
+    } else {
+        cs.Set("fullRange", Napi::Boolean::New(env, frame_->color_range == AVCOL_RANGE_JPEG));
+    }
+    return cs;
 }
 
 Napi::Object VideoFrameNative::NewInstance(Napi::Env env, AVFrame* frame) {
@@ -510,5 +776,6 @@ Napi::Value CreateVideoFrame(const Napi::CallbackInfo& info) {
         info[1],  // format
         info[2],  // width
         info[3],  // height
+        info.Length() > 4 ? info[4] : env.Undefined(),  // colorSpace
     });
 }
@@ -27,11 +27,15 @@ private:
     Napi::Value AllocationSize(const Napi::CallbackInfo& info);
     Napi::Value CopyTo(const Napi::CallbackInfo& info);
     Napi::Value Clone(const Napi::CallbackInfo& info);
+    Napi::Value Transform(const Napi::CallbackInfo& info);
+    Napi::Value ApplyLut(const Napi::CallbackInfo& info);
+    Napi::Value Analyze(const Napi::CallbackInfo& info);
     void Close(const Napi::CallbackInfo& info);
 
     Napi::Value GetWidth(const Napi::CallbackInfo& info);
     Napi::Value GetHeight(const Napi::CallbackInfo& info);
     Napi::Value GetFormat(const Napi::CallbackInfo& info);
+    Napi::Value GetColorSpace(const Napi::CallbackInfo& info);
 
     AVFrame* frame_;
     bool closed_;
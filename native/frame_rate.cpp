@@ -0,0 +1,152 @@
+#include "frame_rate.h"
+#include <algorithm>
+#include <cmath>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+namespace FrameRate {
+
+bool parseMode(const std::string& name, Mode& mode) {
+    if (name == "drop") {
+        mode = Mode::Drop;
+    } else if (name == "blend") {
+        mode = Mode::Blend;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void Converter::Configure(double fps, Mode mode) {
+    fps_ = fps;
+    mode_ = fps > 0 ? mode : Mode::Off;
+    Reset();
+}
+
+void Converter::Reset() {
+    started_ = false;
+    origin_ = 0;
+    originSlot_ = 0;
+    nextSlot_ = 0;
+    openSlot_ = -1;
+}
+
+Converter::Step Converter::Place(int64_t timestamp) {
+    Step step;
+    if (!started_) {
+        started_ = true;
+        origin_ = timestamp;
+        originSlot_ = nextSlot_;
+    }
+
+    // Timestamps are whole microseconds, so allow 2 us of rounding at a slot edge
+    const double position = static_cast<double>(timestamp - origin_) * fps_ / 1e6;
+    int64_t slot = originSlot_ + static_cast<int64_t>(std::floor(position + 2 * fps_ / 1e6));
+
+    // More than a second away from the grid: restart it here
+    const int64_t maxGap = std::max<int64_t>(1, std::llround(fps_));
+    if (slot > nextSlot_ + maxGap || slot < nextSlot_ - maxGap) {
+        origin_ = timestamp;
+        originSlot_ = nextSlot_;
+        slot = nextSlot_;
+    }
+
+    if (mode_ == Mode::Blend && openSlot_ >= 0 && slot <= openSlot_) {
+        step.join = true;
+        step.slot = openSlot_;
+        return step;
+    }
+    if (slot < nextSlot_) {
+        return step;  // Its slot is already filled
+    }
+
+    step.closeGroup = mode_ == Mode::Blend && openSlot_ >= 0;
+    step.repeatFrom = nextSlot_;
+    step.repeatCount = slot - nextSlot_;
+    step.take = true;
+    step.slot = slot;
+    nextSlot_ = slot + 1;
+    if (mode_ == Mode::Blend) {
+        openSlot_ = slot;
+    }
+    return step;
+}
+
+int64_t Converter::SlotTime(int64_t slot) const {
+    return origin_ + std::llround(static_cast<double>(slot - originSlot_) * 1e6 / fps_);
+}
+
+AVFrame* blend(const AVFrame* first, const std::vector<AVFrame*>& others) {
+    const AVPixelFormat format = static_cast<AVPixelFormat>(first->format);
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_PAL |
+                                 AV_PIX_FMT_FLAG_FLOAT | AV_PIX_FMT_FLAG_BE))) {
+        return nullptr;
+    }
+    for (const AVFrame* other : others) {
+        if (other->format != first->format || other->width != first->width || other->height != first->height) {
+            return nullptr;
+        }
+    }
+
+    AVFrame* out = av_frame_alloc();
+    if (!out) {
+        return nullptr;
+    }
+    out->format = format;
+    out->width = first->width;
+    out->height = first->height;
+    if (av_frame_get_buffer(out, 0) < 0) {
+        av_frame_free(&out);
+        return nullptr;
+    }
+    av_frame_copy_props(out, first);
+
+    const bool wide = desc->comp[0].depth > 8;  // 9-16 bit samples in 16-bit words
+    const uint32_t count = static_cast<uint32_t>(others.size() + 1);
+    std::vector<uint32_t> sums;
+
+    for (int p = 0; p < av_pix_fmt_count_planes(format); p++) {
+        const bool chroma = (p == 1 || p == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+        const int rows = chroma ? -((-first->height) >> desc->log2_chroma_h) : first->height;
+        const int bytes = av_image_get_linesize(format, first->width, p);
+        const int samples = wide ? bytes / 2 : bytes;
+        sums.assign(samples, 0);
+
+        for (int y = 0; y < rows; y++) {
+            std::fill(sums.begin(), sums.end(), count / 2);
+            for (size_t f = 0; f < count; f++) {
+                const AVFrame* src = f == 0 ? first : others[f - 1];
+                const uint8_t* row = src->data[p] + y * src->linesize[p];
+                if (wide) {
+                    const uint16_t* words = reinterpret_cast<const uint16_t*>(row);
+                    for (int x = 0; x < samples; x++) {
+                        sums[x] += words[x];
+                    }
+                } else {
+                    for (int x = 0; x < samples; x++) {
+                        sums[x] += row[x];
+                    }
+                }
+            }
+
+            uint8_t* dst = out->data[p] + y * out->linesize[p];
+            if (wide) {
+                uint16_t* words = reinterpret_cast<uint16_t*>(dst);
+                for (int x = 0; x < samples; x++) {
+                    words[x] = static_cast<uint16_t>(sums[x] / count);
+                }
+            } else {
+                for (int x = 0; x < samples; x++) {
+                    dst[x] = static_cast<uint8_t>(sums[x] / count);
+                }
+            }
+        }
+    }
+    return out;
+}
+
+}  // namespace FrameRate
@@ -0,0 +1,78 @@
+#ifndef FRAME_RATE_H
+#define FRAME_RATE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+/**
+ * Frame-rate conversion on the encoder input.
+ *
+ * Input timestamps are mapped onto a fixed output grid at the target rate.
+ * A frame takes the grid slot it falls into, [T(k), T(k+1)). The first
+ * frame of a slot is kept ("drop"), or all of them are averaged ("blend").
+ * Slots with no input repeat the previous frame. Decisions are made on the
+ * JS thread from the timestamp alone, so a dropped frame is never cloned,
+ * queued or converted.
+ *
+ * A jump of more than a second either way is treated as a discontinuity:
+ * the grid restarts at the new frame instead of filling the gap.
+ */
+namespace FrameRate {
+
+enum class Mode { Off, Drop, Blend };
+
+// "drop" or "blend"; false for anything else
+bool parseMode(const std::string& name, Mode& mode);
+
+class Converter {
+public:
+    // What to do for one input frame
+    struct Step {
+        bool closeGroup = false;   // Blend: the open group is complete, submit it
+        int64_t repeatFrom = 0;    // First empty slot to fill with the previous frame
+        int64_t repeatCount = 0;
+        bool take = false;         // The frame starts slot `slot` (drop: emit it; blend: open a group)
+        bool join = false;         // Blend: the frame belongs to the open group
+        int64_t slot = 0;
+    };
+
+    void Configure(double fps, Mode mode);
+    void Reset();
+
+    bool Active() const { return mode_ != Mode::Off; }
+    Mode mode() const { return mode_; }
+
+    Step Place(int64_t timestamp);
+
+    // Output timestamp of a slot, in microseconds
+    int64_t SlotTime(int64_t slot) const;
+
+    // Blend: slot of the group still collecting frames, -1 if none
+    int64_t OpenSlot() const { return openSlot_; }
+    void CloseOpenSlot() { openSlot_ = -1; }
+
+private:
+    Mode mode_ = Mode::Off;
+    double fps_ = 0;
+    bool started_ = false;
+    int64_t origin_ = 0;     // Timestamp of slot `originSlot_`
+    int64_t originSlot_ = 0;
+    int64_t nextSlot_ = 0;   // First slot not yet filled
+    int64_t openSlot_ = -1;
+};
+
+/**
+ * Average `first` with `others` (same size and software format). Returns a
+ * new frame with the props of `first`, or nullptr if the format cannot be
+ * blended (hardware, bitstream, float, big-endian).
+ */
+AVFrame* blend(const AVFrame* first, const std::vector<AVFrame*>& others);
+
+}  // namespace FrameRate
+
+#endif
@@ -0,0 +1,717 @@
+#include "heif.h"
+#include "color.h"
+#include "frame.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+// Big-endian reader over one box payload; reads past the end set `ok` to false
+struct Reader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    Reader(const uint8_t* d, size_t s) : data(d), size(s) {}
+
+    bool has(size_t n) const { return ok && n <= size - pos; }
+    uint64_t read(int bytes) {
+        if (bytes == 0) {
+            return 0;
+        }
+        if (!has(static_cast<size_t>(bytes))) {
+            ok = false;
+            return 0;
+        }
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; i++) {
+            v = (v << 8) | data[pos++];
+        }
+        return v;
+    }
+    uint32_t u8() { return static_cast<uint32_t>(read(1)); }
+    uint32_t u16() { return static_cast<uint32_t>(read(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(read(4)); }
+    std::string fourcc() {
+        if (!has(4)) {
+            ok = false;
+            return "";
+        }
+        std::string s(reinterpret_cast<const char*>(data + pos), 4);
+        pos += 4;
+        return s;
+    }
+    void skip(size_t n) {
+        if (!has(n)) {
+            ok = false;
+            return;
+        }
+        pos += n;
+    }
+};
+
+struct Box {
+    std::string type;
+    const uint8_t* payload;
+    size_t size;
+};
+
+// Children of a box payload (or of the file)
+bool readBoxes(const uint8_t* data, size_t size, std::vector<Box>& boxes) {
+    Reader r(data, size);
+    while (r.pos < size) {
+        const size_t start = r.pos;
+        uint64_t boxSize = r.u32();
+        std::string type = r.fourcc();
+        if (boxSize == 1) {
+            boxSize = r.read(8);
+        } else if (boxSize == 0) {
+            boxSize = size - start;
+        }
+        const size_t header = r.pos - start;
+        if (!r.ok || boxSize < header || boxSize > size - start) {
+            return false;
+        }
+        boxes.push_back({type, data + r.pos, static_cast<size_t>(boxSize - header)});
+        r.pos = start + static_cast<size_t>(boxSize);
+    }
+    return true;
+}
+
+const Box* findBox(const std::vector<Box>& boxes, const char* type) {
+    for (const Box& box : boxes) {
+        if (box.type == type) {
+            return &box;
+        }
+    }
+    return nullptr;
+}
+
+struct Extent {
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct Item {
+    std::string type;
+    int constructionMethod = 0;
+    uint64_t baseOffset = 0;
+    std::vector<Extent> extents;
+    std::vector<uint32_t> properties;           // 1-based ipco indices
+    std::map<std::string, std::vector<uint32_t>> refs;  // Outgoing references by type
+};
+
+struct Meta {
+    uint32_t primary = 0;
+    std::map<uint32_t, Item> items;
+    std::vector<Box> properties;                // ipco children
+    const uint8_t* idat = nullptr;
+    size_t idatSize = 0;
+};
+
+bool parseIinf(const Box& box, Meta& meta) {
+    Reader r(box.payload, box.size);
+    const uint32_t version = r.u8();
+    r.skip(3);
+    r.read(version == 0 ? 2 : 4);  // entry_count; the children are authoritative
+    std::vector<Box> entries;
+    if (!r.ok || !readBoxes(box.payload + r.pos, box.size - r.pos, entries)) {
+        return false;
+    }
+    for (const Box& entry : entries) {
+        if (entry.type != "infe") {
+            continue;
+        }
+        Reader e(entry.payload, entry.size);
+        const uint32_t infeVersion = e.u8();
+        e.skip(3);
+        if (infeVersion < 2) {
+            continue;  // Pre-HEIF item info carries no item type
+        }
+        const uint32_t id = infeVersion == 2 ? e.u16() : e.u32();
+        e.u16();  // item_protection_index
+        std::string type = e.fourcc();
+        if (!e.ok) {
+            return false;
+        }
+        meta.items[id].type = type;
+    }
+    return true;
+}
+
+bool parseIloc(const Box& box, Meta& meta) {
+    Reader r(box.payload, box.size);
+    const uint32_t version = r.u8();
+    r.skip(3);
+    const uint32_t sizes = r.u16();
+    const int offsetSize = (sizes >> 12) & 0xf;
+    const int lengthSize = (sizes >> 8) & 0xf;
+    const int baseOffsetSize = (sizes >> 4) & 0xf;
+    const int indexSize = version == 1 || version == 2 ? sizes & 0xf : 0;
+    const uint32_t count = version < 2 ? r.u16() : r.u32();
+    for (uint32_t i = 0; i < count && r.ok; i++) {
+        const uint32_t id = version < 2 ? r.u16() : r.u32();
+        Item& item = meta.items[id];
+        if (version == 1 || version == 2) {
+            item.constructionMethod = r.u16() & 0xf;
+        }
+        r.u16();  // data_reference_index
+        item.baseOffset = r.read(baseOffsetSize);
+        const uint32_t extents = r.u16();
+        for (uint32_t x = 0; x < extents && r.ok; x++) {
+            r.read(indexSize);
+            Extent extent;
+            extent.offset = r.read(offsetSize);
+            extent.length = r.read(lengthSize);
+            item.extents.push_back(extent);
+        }
+    }
+    return r.ok;
+}
+
+bool parseIref(const Box& box, Meta& meta) {
+    Reader r(box.payload, box.size);
+    const uint32_t version = r.u8();
+    r.skip(3);
+    std::vector<Box> refs;
+    if (!r.ok || !readBoxes(box.payload + r.pos, box.size - r.pos, refs)) {
+        return false;
+    }
+    const int idSize = version == 0 ? 2 : 4;
+    for (const Box& ref : refs) {
+        Reader e(ref.payload, ref.size);
+        const uint32_t from = static_cast<uint32_t>(e.read(idSize));
+        const uint32_t count = e.u16();
+        std::vector<uint32_t>& to = meta.items[from].refs[ref.type];
+        for (uint32_t i = 0; i < count && e.ok; i++) {
+            to.push_back(static_cast<uint32_t>(e.read(idSize)));
+        }
+        if (!e.ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseIprp(const Box& box, Meta& meta) {
+    std::vector<Box> children;
+    if (!readBoxes(box.payload, box.size, children)) {
+        return false;
+    }
+    const Box* ipco = findBox(children, "ipco");
+    if (!ipco || !readBoxes(ipco->payload, ipco->size, meta.properties)) {
+        return false;
+    }
+    for (const Box& child : children) {
+        if (child.type != "ipma") {
+            continue;
+        }
+        Reader r(child.payload, child.size);
+        const uint32_t version = r.u8();
+        const uint32_t flags = static_cast<uint32_t>(r.read(3));
+        const uint32_t count = r.u32();
+        for (uint32_t i = 0; i < count && r.ok; i++) {
+            const uint32_t id = version < 1 ? r.u16() : r.u32();
+            const uint32_t associations = r.u8();
+            for (uint32_t a = 0; a < associations && r.ok; a++) {
+                // High bit is the essential flag
+                const uint32_t index = (flags & 1) ? (r.u16() & 0x7fff) : (r.u8() & 0x7f);
+                if (index > 0) {
+                    meta.items[id].properties.push_back(index);
+                }
+            }
+        }
+        if (!r.ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const Box* itemProperty(const Meta& meta, const Item& item, const char* type) {
+    for (uint32_t index : item.properties) {
+        if (index <= meta.properties.size() && meta.properties[index - 1].type == type) {
+            return &meta.properties[index - 1];
+        }
+    }
+    return nullptr;
+}
+
+bool itemData(const uint8_t* file, size_t fileSize, const Meta& meta, const Item& item,
+              std::vector<uint8_t>& out) {
+    out.clear();
+    for (const Extent& extent : item.extents) {
+        const uint8_t* base = file;
+        size_t baseSize = fileSize;
+        if (item.constructionMethod == 1) {
+            base = meta.idat;
+            baseSize = meta.idatSize;
+        } else if (item.constructionMethod != 0) {
+            return false;  // Item-offset construction is not used by AVIF/HEIC encoders
+        }
+        const uint64_t offset = item.baseOffset + extent.offset;
+        // A zero length means "to the end of the file"
+        const uint64_t length = extent.length ? extent.length : baseSize - std::min<uint64_t>(offset, baseSize);
+        if (!base || offset > baseSize || length > baseSize - offset) {
+            return false;
+        }
+        out.insert(out.end(), base + offset, base + offset + length);
+    }
+    return !out.empty();
+}
+
+AVCodecID itemCodec(const std::string& type) {
+    if (type == "av01") {
+        return AV_CODEC_ID_AV1;
+    }
+    if (type == "hvc1") {
+        return AV_CODEC_ID_HEVC;
+    }
+    return AV_CODEC_ID_NONE;
+}
+
+void itemSize(const Meta& meta, const Item& item, int& width, int& height) {
+    const Box* ispe = itemProperty(meta, item, "ispe");
+    if (ispe) {
+        Reader r(ispe->payload, ispe->size);
+        r.u32();  // version/flags
+        width = static_cast<int>(r.u32());
+        height = static_cast<int>(r.u32());
+        if (!r.ok) {
+            width = height = 0;
+        }
+    }
+}
+
+// A coded item or a grid of coded items
+bool buildLayer(const uint8_t* file, size_t fileSize, const Meta& meta, uint32_t id,
+                HeifContainer::Layer& layer, std::string& error) {
+    auto it = meta.items.find(id);
+    if (it == meta.items.end()) {
+        error = "Missing image item";
+        return false;
+    }
+    const Item& item = it->second;
+
+    std::vector<uint32_t> tileIds;
+    if (item.type == "grid") {
+        std::vector<uint8_t> grid;
+        if (!itemData(file, fileSize, meta, item, grid)) {
+            error = "Invalid grid item";
+            return false;
+        }
+        Reader r(grid.data(), grid.size());
+        r.u8();  // version
+        const uint32_t flags = r.u8();
+        layer.rows = static_cast<int>(r.u8()) + 1;
+        layer.columns = static_cast<int>(r.u8()) + 1;
+        const int fieldSize = (flags & 1) ? 4 : 2;
+        layer.width = static_cast<int>(r.read(fieldSize));
+        layer.height = static_cast<int>(r.read(fieldSize));
+        auto dimg = item.refs.find("dimg");
+        if (!r.ok || dimg == item.refs.end() ||
+            dimg->second.size() != static_cast<size_t>(layer.rows * layer.columns)) {
+            error = "Grid tiles do not match the grid layout";
+            return false;
+        }
+        tileIds = dimg->second;
+    } else {
+        tileIds.push_back(id);
+        itemSize(meta, item, layer.width, layer.height);
+    }
+
+    for (uint32_t tileId : tileIds) {
+        auto tile = meta.items.find(tileId);
+        if (tile == meta.items.end()) {
+            error = "Missing grid tile";
+            return false;
+        }
+        const AVCodecID codec = itemCodec(tile->second.type);
+        if (codec == AV_CODEC_ID_NONE || (layer.codec != AV_CODEC_ID_NONE && codec != layer.codec)) {
+            error = "Unsupported image item type: " + tile->second.type;
+            return false;
+        }
+        layer.codec = codec;
+
+        if (layer.config.empty()) {
+            const Box* config = itemProperty(meta, tile->second, codec == AV_CODEC_ID_AV1 ? "av1C" : "hvcC");
+            if (config) {
+                layer.config.assign(config->payload, config->payload + config->size);
+            }
+        }
+
+        std::vector<uint8_t> data;
+        if (!itemData(file, fileSize, meta, tile->second, data)) {
+            error = "Invalid item location";
+            return false;
+        }
+        layer.tiles.push_back(std::move(data));
+    }
+    return true;
+}
+
+bool isAlphaAux(const Meta& meta, const Item& item) {
+    const Box* auxC = itemProperty(meta, item, "auxC");
+    if (!auxC || auxC->size <= 4) {
+        return false;
+    }
+    // FullBox header, then a NUL-terminated URN
+    std::string urn(reinterpret_cast<const char*>(auxC->payload + 4),
+                    strnlen(reinterpret_cast<const char*>(auxC->payload + 4), auxC->size - 4));
+    return urn == "urn:mpeg:mpegB:cicp:systems:auxiliary:alpha" || urn == "urn:mpeg:hevc:2015:auxid:1";
+}
+
+const AVCodec* findDecoder(AVCodecID id) {
+    if (id == AV_CODEC_ID_AV1) {
+        // libdav1d first, as for video; it threads over tiles within a picture
+        const AVCodec* codec = avcodec_find_decoder_by_name("libdav1d");
+        if (!codec) {
+            codec = avcodec_find_decoder_by_name("libaom-av1");
+        }
+        return codec ? codec : avcodec_find_decoder(id);
+    }
+    return avcodec_find_decoder(id);
+}
+
+AVFrame* decodeItem(const AVCodec* codec, const std::vector<uint8_t>& config,
+                    const std::vector<uint8_t>& data, int threads, std::string& error) {
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    if (!ctx) {
+        error = "Failed to allocate codec context";
+        return nullptr;
+    }
+    if (!config.empty()) {
+        ctx->extradata = static_cast<uint8_t*>(av_mallocz(config.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+        memcpy(ctx->extradata, config.data(), config.size());
+        ctx->extradata_size = static_cast<int>(config.size());
+    }
+    ctx->thread_count = threads;
+    if (strcmp(codec->name, "libdav1d") == 0) {
+        av_opt_set_int(ctx->priv_data, "max_frame_delay", 1, 0);
+    }
+
+    AVFrame* frame = nullptr;
+    int ret = avcodec_open2(ctx, codec, nullptr);
+    if (ret >= 0) {
+        AVPacket* packet = av_packet_alloc();
+        packet->data = const_cast<uint8_t*>(data.data());
+        packet->size = static_cast<int>(data.size());
+        packet->flags |= AV_PKT_FLAG_KEY;
+        ret = avcodec_send_packet(ctx, packet);
+        av_packet_free(&packet);
+        if (ret >= 0) {
+            avcodec_send_packet(ctx, nullptr);
+            frame = av_frame_alloc();
+            ret = avcodec_receive_frame(ctx, frame);
+            if (ret < 0) {
+                av_frame_free(&frame);
+            }
+        }
+    }
+    if (!frame) {
+        char errBuf[256];
+        av_strerror(ret, errBuf, sizeof(errBuf));
+        error = std::string("Failed to decode image item: ") + errBuf;
+    }
+    avcodec_free_context(&ctx);
+    return frame;
+}
+
+// Decode every tile of a layer concurrently and place them on one canvas
+AVFrame* decodeLayer(const HeifContainer::Layer& layer, std::string& error) {
+    const AVCodec* codec = findDecoder(layer.codec);
+    if (!codec) {
+        error = "No decoder for the image items";
+        return nullptr;
+    }
+
+    const int count = static_cast<int>(layer.tiles.size());
+    std::vector<AVFrame*> tiles(count, nullptr);
+    std::vector<std::string> errors(count);
+    // A lone picture gets the decoder's own threads; tiles get one thread each
+    const int threads = count == 1 ? 0 : 1;
+    Parallel::forEachIndex(count, [&](int i) {
+        tiles[i] = decodeItem(codec, layer.config, layer.tiles[i], threads, errors[i]);
+    });
+
+    AVFrame* out = nullptr;
+    for (int i = 0; i < count; i++) {
+        if (!tiles[i]) {
+            error = errors[i];
+        }
+    }
+    if (error.empty() && count == 1) {
+        out = tiles[0];
+        tiles[0] = nullptr;
+    } else if (error.empty()) {
+        const AVFrame* first = tiles[0];
+        const int tileWidth = first->width;
+        const int tileHeight = first->height;
+        for (AVFrame* tile : tiles) {
+            if (tile->format != first->format || tile->width != tileWidth || tile->height != tileHeight) {
+                error = "Grid tiles differ in size or format";
+                break;
+            }
+        }
+        if (error.empty() && (tileWidth * layer.columns < layer.width || tileHeight * layer.rows < layer.height)) {
+            error = "Grid tiles do not cover the image";
+        }
+        // Every tile must start inside the image; a grid with spare rows or
+        // columns would put a copy at a negative size
+        if (error.empty() && ((layer.columns - 1) * tileWidth >= layer.width ||
+                              (layer.rows - 1) * tileHeight >= layer.height)) {
+            error = "Grid tiles extend past the image";
+        }
+
+        if (error.empty()) {
+            const AVPixelFormat format = static_cast<AVPixelFormat>(first->format);
+            const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+            out = av_frame_alloc();
+            out->format = format;
+            out->width = layer.width;
+            out->height = layer.height;
+            if (av_frame_get_buffer(out, 0) < 0) {
+                av_frame_free(&out);
+                error = "Failed to allocate image";
+            } else {
+                av_frame_copy_props(out, first);
+                const int planes = av_pix_fmt_count_planes(format);
+                for (int i = 0; i < count; i++) {
+                    const int x = (i % layer.columns) * tileWidth;
+                    const int y = (i / layer.columns) * tileHeight;
+                    const int w = std::min(tileWidth, layer.width - x);
+                    const int h = std::min(tileHeight, layer.height - y);
+                    if (w <= 0 || h <= 0) {
+                        continue;
+                    }
+                    for (int p = 0; p < planes; p++) {
+                        const bool chroma = (p == 1 || p == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+                        const int shiftY = chroma ? desc->log2_chroma_h : 0;
+                        const int rowBytes = av_image_get_linesize(format, w, p);
+                        const int xBytes = av_image_get_linesize(format, x, p);
+                        const int rows = -((-h) >> shiftY);
+                        av_image_copy_plane(out->data[p] + (y >> shiftY) * out->linesize[p] + xBytes,
+                                            out->linesize[p], tiles[i]->data[p], tiles[i]->linesize[p],
+                                            rowBytes, rows);
+                    }
+                }
+            }
+        }
+    }
+
+    for (AVFrame* tile : tiles) {
+        av_frame_free(&tile);
+    }
+    return out;
+}
+
+AVFrame* convert(const AVFrame* src, AVPixelFormat format, int width, int height) {
+    const AVPixelFormat srcFormat = static_cast<AVPixelFormat>(src->format);
+    SwsContext* sws = sws_getContext(src->width, src->height, srcFormat,
+                                     width, height, format, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) {
+        return nullptr;
+    }
+    AVFrame* dst = av_frame_alloc();
+    dst->format = format;
+    dst->width = width;
+    dst->height = height;
+    if (av_frame_get_buffer(dst, 0) < 0) {
+        av_frame_free(&dst);
+    } else {
+        av_frame_copy_props(dst, src);
+
+        // Keep the image's matrix and range; RGB output is full range
+        const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+        if (desc && (desc->flags & AV_PIX_FMT_FLAG_RGB)) {
+            dst->colorspace = AVCOL_SPC_RGB;
+            dst->color_range = AVCOL_RANGE_JPEG;
+        }
+        ColorSpace::configureSws(sws, srcFormat, src->colorspace, src->color_range,
+                                 format, dst->colorspace, dst->color_range);
+        sws_scale(sws, src->data, src->linesize, 0, src->height, dst->data, dst->linesize);
+    }
+    sws_freeContext(sws);
+    return dst;
+}
+
+// Alpha from the luma plane of an auxiliary picture, as GRAY8 at the color
+// image's size. Alpha is not video range, so the samples are copied as they
+// are (high bit depth shifted down) instead of going through a YUV scaler.
+AVFrame* alphaPlane(const AVFrame* src, int width, int height) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(src->format));
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL))) {
+        return nullptr;
+    }
+    const AVComponentDescriptor& luma = desc->comp[0];
+    if (luma.plane != 0 || luma.depth < 8 || luma.depth > 16 || luma.step != (luma.depth > 8 ? 2 : 1)) {
+        return nullptr;
+    }
+
+    AVFrame* gray = av_frame_alloc();
+    if (!gray) {
+        return nullptr;
+    }
+    gray->format = AV_PIX_FMT_GRAY8;
+    gray->width = src->width;
+    gray->height = src->height;
+    if (av_frame_get_buffer(gray, 0) < 0) {
+        av_frame_free(&gray);
+        return nullptr;
+    }
+
+    const bool bigEndian = desc->flags & AV_PIX_FMT_FLAG_BE;
+    const int down = luma.shift + luma.depth - 8;
+    for (int y = 0; y < src->height; y++) {
+        const uint8_t* in = src->data[0] + y * src->linesize[0] + luma.offset;
+        uint8_t* out = gray->data[0] + y * gray->linesize[0];
+        if (luma.depth == 8) {
+            memcpy(out, in, src->width);
+            continue;
+        }
+        for (int x = 0; x < src->width; x++) {
+            const uint8_t* p = in + 2 * x;
+            const unsigned word = bigEndian ? (p[0] << 8 | p[1]) : (p[1] << 8 | p[0]);
+            out[x] = static_cast<uint8_t>(word >> down);
+        }
+    }
+
+    if (gray->width == width && gray->height == height) {
+        return gray;
+    }
+    // GRAY8 to GRAY8 only resamples
+    AVFrame* scaled = convert(gray, AV_PIX_FMT_GRAY8, width, height);
+    av_frame_free(&gray);
+    return scaled;
+}
+
+}  // namespace
+
+bool HeifContainer::IsContainer(const uint8_t* data, size_t size) {
+    return size >= 8 && memcmp(data + 4, "ftyp", 4) == 0;
+}
+
+bool HeifContainer::Parse(const uint8_t* data, size_t size, Image& image, std::string& error) {
+    std::vector<Box> top;
+    if (!readBoxes(data, size, top)) {
+        error = "Malformed ISOBMFF box structure";
+        return false;
+    }
+    const Box* metaBox = findBox(top, "meta");
+    if (!metaBox || metaBox->size < 4) {
+        error = findBox(top, "moov") ? "Image sequences are not supported" : "No meta box";
+        return false;
+    }
+
+    // meta is a FullBox
+    std::vector<Box> children;
+    if (!readBoxes(metaBox->payload + 4, metaBox->size - 4, children)) {
+        error = "Malformed meta box";
+        return false;
+    }
+
+    Meta meta;
+    const Box* pitm = findBox(children, "pitm");
+    const Box* iinf = findBox(children, "iinf");
+    const Box* iloc = findBox(children, "iloc");
+    const Box* iprp = findBox(children, "iprp");
+    if (!pitm || !iinf || !iloc || !iprp) {
+        error = "Missing pitm, iinf, iloc or iprp";
+        return false;
+    }
+    Reader r(pitm->payload, pitm->size);
+    const uint32_t version = r.u8();
+    r.skip(3);
+    meta.primary = version == 0 ? r.u16() : r.u32();
+    if (const Box* idat = findBox(children, "idat")) {
+        meta.idat = idat->payload;
+        meta.idatSize = idat->size;
+    }
+    const Box* iref = findBox(children, "iref");
+    if (!r.ok || !parseIinf(*iinf, meta) || !parseIloc(*iloc, meta) || !parseIprp(*iprp, meta) ||
+        (iref && !parseIref(*iref, meta))) {
+        error = "Malformed item metadata";
+        return false;
+    }
+
+    if (!buildLayer(data, size, meta, meta.primary, image.color, error)) {
+        return false;
+    }
+
+    // Alpha: an auxiliary image that references the primary item with auxl
+    image.hasAlpha = false;
+    for (const auto& entry : meta.items) {
+        auto auxl = entry.second.refs.find("auxl");
+        if (auxl == entry.second.refs.end() ||
+            std::find(auxl->second.begin(), auxl->second.end(), meta.primary) == auxl->second.end() ||
+            !isAlphaAux(meta, entry.second)) {
+            continue;
+        }
+        std::string alphaError;
+        image.hasAlpha = buildLayer(data, size, meta, entry.first, image.alpha, alphaError);
+        break;
+    }
+    return true;
+}
+
+AVFrame* HeifContainer::Decode(const Image& image, std::string& error) {
+    AVFrame* color = decodeLayer(image.color, error);
+    if (!color) {
+        return nullptr;
+    }
+
+    AVFrame* alpha = nullptr;
+    if (image.hasAlpha) {
+        std::string alphaError;
+        AVFrame* decoded = decodeLayer(image.alpha, alphaError);
+        if (decoded) {
+            // Only the luma of the auxiliary picture carries alpha
+            alpha = alphaPlane(decoded, color->width, color->height);
+            av_frame_free(&decoded);
+        }
+    }
+
+    const AVPixelFormat format = static_cast<AVPixelFormat>(color->format);
+    AVFrame* out = nullptr;
+    if (alpha) {
+        out = convert(color, format == AV_PIX_FMT_YUV420P ? AV_PIX_FMT_YUVA420P : AV_PIX_FMT_RGBA,
+                      color->width, color->height);
+        if (out) {
+            // YUVA420P takes alpha as plane 3, RGBA as every fourth byte
+            const bool planar = out->format == AV_PIX_FMT_YUVA420P;
+            for (int y = 0; y < out->height; y++) {
+                const uint8_t* a = alpha->data[0] + y * alpha->linesize[0];
+                if (planar) {
+                    memcpy(out->data[3] + y * out->linesize[3], a, out->width);
+                } else {
+                    uint8_t* row = out->data[0] + y * out->linesize[0];
+                    for (int x = 0; x < out->width; x++) {
+                        row[x * 4 + 3] = a[x];
+                    }
+                }
+            }
+        }
+        av_frame_free(&alpha);
+    } else if (PixelFormatToString(format).empty()) {
+        // High bit depth and other layouts VideoFrame does not expose
+        out = convert(color, AV_PIX_FMT_YUV420P, color->width, color->height);
+    } else {
+        return color;
+    }
+
+    av_frame_free(&color);
+    if (!out) {
+        error = "Failed to convert the decoded image";
+    }
+    return out;
+}
@@ -0,0 +1,52 @@
+#ifndef HEIF_H
+#define HEIF_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+/**
+ * HeifContainer - AVIF/HEIF still images (ISOBMFF 'meta' items)
+ *
+ * Parse() resolves the primary item through pitm/iinf/iloc/iref/ipma. It
+ * returns the coded AV1 (av01) or HEVC (hvc1) payloads with their decoder
+ * configuration, the tile layout of 'grid' items, and the alpha auxiliary
+ * image if there is one. Decode() decodes the tiles in parallel, one decoder
+ * per tile, stitches them into a single frame and attaches alpha.
+ *
+ * Image sequences (moov tracks) and the irot/imir/clap transforms are not
+ * handled; the primary image is returned as coded.
+ */
+class HeifContainer {
+public:
+    struct Layer {
+        AVCodecID codec = AV_CODEC_ID_NONE;
+        std::vector<uint8_t> config;               // av1C / hvcC payload, used as extradata
+        std::vector<std::vector<uint8_t>> tiles;   // Coded items, row-major
+        int rows = 1;
+        int columns = 1;
+        int width = 0;                             // Output size (grid canvas or ispe)
+        int height = 0;
+    };
+
+    struct Image {
+        Layer color;
+        Layer alpha;
+        bool hasAlpha = false;
+    };
+
+    // True if the buffer starts with an ISOBMFF ftyp box
+    static bool IsContainer(const uint8_t* data, size_t size);
+
+    static bool Parse(const uint8_t* data, size_t size, Image& image, std::string& error);
+
+    // Decoded and stitched picture in a VideoFrame-compatible format; nullptr on error
+    static AVFrame* Decode(const Image& image, std::string& error);
+};
+
+#endif // HEIF_H
@@ -0,0 +1,214 @@
+#ifndef JOB_RING_H
+#define JOB_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+/**
+ * Bounded single-producer/single-consumer job queue for the codec workers.
+ *
+ * The JS thread pushes and the worker pops, with no lock and no allocation
+ * on either side: jobs move through a ring of preallocated slots indexed by
+ * two atomic counters. The worker spins for a while before it parks on a
+ * condition variable, and the spin budget adapts: it grows when spinning
+ * catches the next job and shrinks when it does not. The producer only takes
+ * the park mutex to wake a worker that is actually parked.
+ *
+ * A full ring never blocks the JS thread, since the worker may itself be
+ * waiting on JS (pull mode). Jobs spill into a locked overflow list until the
+ * worker catches up. FIFO order is kept across the ring and the overflow.
+ *
+ * Discard() drops everything queued so far from the producer side (reset);
+ * the worker disposes of those jobs when it reaches them. Clear() is only
+ * for when the worker has stopped.
+ */
+template <typename T>
+class JobRing {
+public:
+    using Dispose = void (*)(T&);
+
+    explicit JobRing(size_t capacity = 64, Dispose dispose = nullptr)
+        : dispose_(dispose) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        slots_.reset(new T[size]);
+    }
+
+    JobRing(const JobRing&) = delete;
+    JobRing& operator=(const JobRing&) = delete;
+
+    ~JobRing() { Clear(); }
+
+    // Producer: queue a job and wake the worker if it is parked
+    void Push(T&& job) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (overflowCount_.load(std::memory_order_relaxed) == 0 &&
+            tail - head_.load(std::memory_order_acquire) <= mask_) {
+            slots_[tail & mask_] = std::move(job);
+            tail_.store(tail + 1, std::memory_order_release);
+        } else {
+            // Once anything has spilled, later jobs follow it until the worker drains it
+            std::lock_guard<std::mutex> lock(overflowMutex_);
+            overflow_.push_back(std::move(job));
+            overflowCount_.fetch_add(1, std::memory_order_release);
+        }
+        pushed_.fetch_add(1, std::memory_order_release);
+
+        // Pairs with the fence in Pop(): either the worker sees this job or we see it parked
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(parkMutex_);
+            parkCV_.notify_one();
+        }
+    }
+
+    // Consumer: next job without waiting
+    bool TryPop(T& out) {
+        for (;;) {
+            if (!take(out)) {
+                return false;
+            }
+            const uint64_t index = popped_.fetch_add(1, std::memory_order_acq_rel);
+            if (index >= discardTo_.load(std::memory_order_acquire)) {
+                return true;
+            }
+            if (dispose_) {
+                dispose_(out);
+            }
+            out = T();
+        }
+    }
+
+    // Consumer: next job, spinning and then parking until one arrives.
+    // Returns false once `running` is cleared (see Wake()).
+    bool Pop(T& out, const std::atomic<bool>& running) {
+        // Spinning only pays off when the producer runs on another core
+        static const bool canSpin = std::thread::hardware_concurrency() > 1;
+        const uint32_t budget = canSpin ? spinBudget_ : 0;
+        for (uint32_t i = 0; i < budget; i++) {
+            if (TryPop(out)) {
+                spinBudget_ = std::min<uint32_t>(budget * 2, kMaxSpin);
+                return true;
+            }
+            if (!running.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            relax();
+        }
+        spinBudget_ = std::max<uint32_t>(spinBudget_ / 2, kMinSpin);
+
+        std::unique_lock<std::mutex> lock(parkMutex_);
+        parked_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (;;) {
+            if (TryPop(out)) {
+                parked_.store(false, std::memory_order_relaxed);
+                return true;
+            }
+            if (!running.load()) {
+                parked_.store(false, std::memory_order_relaxed);
+                return false;
+            }
+            parkCV_.wait(lock);
+        }
+    }
+
+    // Wake a parked consumer so it can observe its stop flag
+    void Wake() {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        parkCV_.notify_all();
+    }
+
+    // Producer: drop every job queued so far
+    void Discard() {
+        discardTo_.store(pushed_.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+
+    // Only with no concurrent consumer (worker joined or never started)
+    void Clear() {
+        T job{};
+        while (take(job)) {
+            popped_.fetch_add(1, std::memory_order_relaxed);
+            if (dispose_) {
+                dispose_(job);
+            }
+            job = T();
+        }
+    }
+
+    // Jobs waiting for the worker (either thread; exact on the producer side)
+    size_t size() const {
+        const uint64_t pushed = pushed_.load(std::memory_order_acquire);
+        const uint64_t first = std::max(popped_.load(std::memory_order_acquire),
+                                        discardTo_.load(std::memory_order_acquire));
+        return pushed > first ? static_cast<size_t>(pushed - first) : 0;
+    }
+
+private:
+    static constexpr uint32_t kMinSpin = 64;
+    static constexpr uint32_t kMaxSpin = 16384;
+
+    static void relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // Ring first; the overflow only holds jobs pushed after everything in the ring
+    bool take(T& out) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head != tail_.load(std::memory_order_acquire)) {
+            out = std::move(slots_[head & mask_]);
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+        if (overflowCount_.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(overflowMutex_);
+        out = std::move(overflow_.front());
+        overflow_.pop_front();
+        overflowCount_.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    std::unique_ptr<T[]> slots_;
+    uint64_t mask_ = 0;
+    Dispose dispose_;
+
+    // Each counter has its own cache line so the two threads do not false-share
+    alignas(64) std::atomic<uint64_t> head_{0};    // Consumer
+    alignas(64) std::atomic<uint64_t> tail_{0};    // Producer
+    alignas(64) std::atomic<uint64_t> pushed_{0};  // Producer, ring + overflow
+    std::atomic<uint64_t> discardTo_{0};           // Producer
+    alignas(64) std::atomic<uint64_t> popped_{0};  // Consumer, ring + overflow
+    uint32_t spinBudget_ = kMinSpin * 4;           // Consumer
+
+    alignas(64) std::atomic<bool> parked_{false};
+    std::mutex parkMutex_;
+    std::condition_variable parkCV_;
+
+    std::atomic<size_t> overflowCount_{0};
+    std::mutex overflowMutex_;
+    std::deque<T> overflow_;
+};
+
+#endif // JOB_RING_H
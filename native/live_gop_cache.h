@@ -0,0 +1,97 @@
+#ifndef LIVE_GOP_CACHE_H
+#define LIVE_GOP_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Encoded packets since the most recent keyframe, for viewers that join a
+ * live stream mid-GOP.
+ *
+ * The encoder worker appends every packet it emits. A keyframe starts a new
+ * GOP and releases the previous one. A late joiner takes a Snapshot(): the
+ * keyframe, every delta after it and the current extradata. It can start
+ * decoding at once, without a forced keyframe that would raise the bitrate
+ * for everyone else.
+ *
+ * The cache is bounded in bytes. A GOP that outgrows the bound can no longer
+ * be served whole, so it is dropped and the cache stays empty until the next
+ * keyframe.
+ *
+ * Packets are shared and immutable, so a snapshot only copies pointers while
+ * the lock is held.
+ */
+class LiveGopCache {
+public:
+    struct Packet {
+        std::vector<uint8_t> data;
+        bool isKeyframe;
+        int64_t pts;
+        int64_t duration;
+    };
+
+    struct Snapshot {
+        std::vector<std::shared_ptr<const Packet>> packets;  // Keyframe first
+        std::shared_ptr<const std::vector<uint8_t>> extradata;
+        size_t bytes = 0;
+    };
+
+    explicit LiveGopCache(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+    // Worker thread, in output order. `extradata` is non-null when the packet carries it.
+    void Add(const std::vector<uint8_t>& data, bool isKeyframe, int64_t pts, int64_t duration,
+             const std::vector<uint8_t>* extradata) {
+        std::shared_ptr<const std::vector<uint8_t>> newExtradata;
+        if (extradata && !extradata->empty()) {
+            newExtradata = std::make_shared<const std::vector<uint8_t>>(*extradata);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (newExtradata) {
+            extradata_ = std::move(newExtradata);
+        }
+        if (isKeyframe) {
+            packets_.clear();
+            bytes_ = 0;
+        } else if (packets_.empty()) {
+            return;  // Waiting for a keyframe
+        }
+        if (bytes_ + data.size() > maxBytes_) {
+            packets_.clear();
+            bytes_ = 0;
+            return;
+        }
+        packets_.push_back(std::make_shared<const Packet>(Packet{data, isKeyframe, pts, duration}));
+        bytes_ += data.size();
+    }
+
+    // Any thread. False while no complete GOP prefix is held.
+    bool Take(Snapshot& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (packets_.empty()) {
+            return false;
+        }
+        out.packets = packets_;
+        out.extradata = extradata_;
+        out.bytes = bytes_;
+        return true;
+    }
+
+    // Any thread (reset). Extradata is kept: it still describes the stream.
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        packets_.clear();
+        bytes_ = 0;
+    }
+
+private:
+    const size_t maxBytes_;
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<const Packet>> packets_;
+    std::shared_ptr<const std::vector<uint8_t>> extradata_;
+    size_t bytes_ = 0;
+};
+
+#endif // LIVE_GOP_CACHE_H
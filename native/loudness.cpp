@@ -0,0 +1,394 @@
+#include "loudness.h"
+#include "audio.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+extern "C" {
+#include <libavutil/samplefmt.h>
+}
+
+namespace {
+
+constexpr double kAbsoluteGate = -70.0;   // LUFS
+constexpr double kRelativeGate = -10.0;   // LU below the absolute-gated level
+constexpr double kBinWidth = 0.1;         // LU per histogram bin
+constexpr size_t kMomentaryBlocks = 4;    // 400 ms
+constexpr size_t kShortTermBlocks = 30;   // 3 s
+constexpr int kTapsPerPhase = 12;
+
+double energyToLufs(double energy) {
+    return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : -std::numeric_limits<double>::infinity();
+}
+
+double amplitudeToDb(double amplitude) {
+    return amplitude > 0.0 ? 20.0 * std::log10(amplitude) : -std::numeric_limits<double>::infinity();
+}
+
+double meanOfLast(const std::deque<double>& values, size_t count) {
+    double sum = 0.0;
+    for (size_t i = values.size() - count; i < values.size(); i++) {
+        sum += values[i];
+    }
+    return sum / count;
+}
+
+}  // namespace
+
+LoudnessMeter::LoudnessMeter(int sampleRate, int channels)
+    : sampleRate_(sampleRate), channels_(channels), subBlockSize_(std::max(1, sampleRate / 10)),
+      subBlockFill_(0), totalFrames_(0) {
+    // K-weighting: high-shelf pre-filter then RLB high-pass, designed for
+    // this sample rate (BS.1770-4 gives coefficients for 48 kHz only)
+    const double pi = 3.14159265358979323846;
+    double K = std::tan(pi * 1681.974450955533 / sampleRate);
+    double Q = 0.7071752369554196;
+    double Vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    double Vb = std::pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    stage_[0] = { (Vh + Vb * K / Q + K * K) / a0, 2.0 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0,
+                  2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0 };
+
+    K = std::tan(pi * 38.13547087602444 / sampleRate);
+    Q = 0.5003270373238773;
+    a0 = 1.0 + K / Q + K * K;
+    stage_[1] = { 1.0, -2.0, 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0 };
+
+    // Channel weights: surrounds +1.5 dB, LFE excluded (default 5.1 order)
+    weights_.assign(channels, 1.0);
+    if (channels == 6) {
+        weights_[3] = 0.0;
+        weights_[4] = weights_[5] = 1.41;
+    }
+
+    // True-peak oversampler: windowed-sinc low-pass at the original Nyquist
+    factor_ = sampleRate < 96000 ? 4 : (sampleRate < 192000 ? 2 : 1);
+    taps_ = factor_ > 1 ? kTapsPerPhase : 1;
+    const int length = taps_ * factor_;
+    std::vector<double> prototype(length, 1.0);
+    if (factor_ > 1) {
+        const double center = (length - 1) / 2.0;
+        double sum = 0.0;
+        for (int n = 0; n < length; n++) {
+            double t = (n - center) / factor_;
+            double sinc = t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+            double window = 0.42 - 0.5 * std::cos(2.0 * pi * (n + 0.5) / length) +
+                            0.08 * std::cos(4.0 * pi * (n + 0.5) / length);
+            prototype[n] = sinc * window;
+            sum += prototype[n];
+        }
+        for (double& h : prototype) {
+            h *= factor_ / sum;
+        }
+    }
+    phases_.resize(length);
+    for (int p = 0; p < factor_; p++) {
+        for (int j = 0; j < taps_; j++) {
+            phases_[p * taps_ + j] = static_cast<float>(prototype[p + (taps_ - 1 - j) * factor_]);
+        }
+    }
+
+    state_.resize(channels);
+    Reset();
+}
+
+void LoudnessMeter::Reset() {
+    for (ChannelState& s : state_) {
+        std::memset(s.z, 0, sizeof(s.z));
+        s.history.assign(taps_ - 1, 0.0f);
+        s.energy = 0.0;
+    }
+    subBlockFill_ = 0;
+    totalFrames_ = 0;
+    truePeak_ = 0.0;
+    samplePeak_ = 0.0;
+    subBlocks_.clear();
+    binCount_.fill(0);
+    binEnergy_.fill(0.0);
+}
+
+void LoudnessMeter::Process(const float* samples, int frames) {
+    while (frames > 0) {
+        int chunk = std::min(frames, subBlockSize_ - subBlockFill_);
+        ProcessChunk(samples, chunk);
+        samples += static_cast<size_t>(chunk) * channels_;
+        frames -= chunk;
+        subBlockFill_ += chunk;
+        totalFrames_ += chunk;
+        if (subBlockFill_ == subBlockSize_) {
+            EndSubBlock();
+        }
+    }
+}
+
+void LoudnessMeter::ProcessChunk(const float* samples, int frames) {
+    const int lead = taps_ - 1;
+    scratch_.resize(static_cast<size_t>(lead) + frames);
+    upsampled_.resize(frames);
+
+    for (int c = 0; c < channels_; c++) {
+        ChannelState& s = state_[c];
+
+        // Previous samples first, so every output has its full FIR window
+        std::copy(s.history.begin(), s.history.end(), scratch_.begin());
+        float* x = scratch_.data() + lead;
+        float peak = 0.0f;
+        for (int i = 0; i < frames; i++) {
+            x[i] = samples[static_cast<size_t>(i) * channels_ + c];
+            peak = std::max(peak, std::fabs(x[i]));
+        }
+        samplePeak_ = std::max(samplePeak_, static_cast<double>(peak));
+
+        // K-weighting, two biquads in transposed direct form II
+        double energy = 0.0;
+        double z00 = s.z[0][0], z01 = s.z[0][1], z10 = s.z[1][0], z11 = s.z[1][1];
+        const Biquad& f = stage_[0];
+        const Biquad& g = stage_[1];
+        for (int i = 0; i < frames; i++) {
+            double in = x[i];
+            double y = f.b0 * in + z00;
+            z00 = f.b1 * in - f.a1 * y + z01;
+            z01 = f.b2 * in - f.a2 * y;
+            double w = g.b0 * y + z10;
+            z10 = g.b1 * y - g.a1 * w + z11;
+            z11 = g.b2 * y - g.a2 * w;
+            energy += w * w;
+        }
+        s.z[0][0] = z00; s.z[0][1] = z01; s.z[1][0] = z10; s.z[1][1] = z11;
+        s.energy += energy;
+
+        // True peak: each phase is a short FIR accumulated across the whole
+        // chunk, so the inner loops run over contiguous samples
+        if (factor_ > 1) {
+            const float* ext = scratch_.data();
+            float truePeak = peak;
+            for (int p = 0; p < factor_; p++) {
+                const float* h = phases_.data() + p * taps_;
+                std::fill(upsampled_.begin(), upsampled_.end(), 0.0f);
+                float* up = upsampled_.data();
+                for (int j = 0; j < taps_; j++) {
+                    const float coeff = h[j];
+                    const float* src = ext + j;
+                    for (int i = 0; i < frames; i++) {
+                        up[i] += coeff * src[i];
+                    }
+                }
+                for (int i = 0; i < frames; i++) {
+                    truePeak = std::max(truePeak, std::fabs(up[i]));
+                }
+            }
+            truePeak_ = std::max(truePeak_, static_cast<double>(truePeak));
+            std::copy(scratch_.end() - lead, scratch_.end(), s.history.begin());
+        } else {
+            truePeak_ = std::max(truePeak_, static_cast<double>(peak));
+        }
+    }
+}
+
+void LoudnessMeter::EndSubBlock() {
+    double energy = 0.0;
+    for (int c = 0; c < channels_; c++) {
+        ChannelState& s = state_[c];
+        energy += weights_[c] * s.energy / subBlockSize_;
+        s.energy = 0.0;
+
+        // Long silence would otherwise decay the filter state into denormals
+        for (auto& stage : s.z) {
+            for (double& z : stage) {
+                if (std::fabs(z) < 1e-20) z = 0.0;
+            }
+        }
+    }
+    subBlockFill_ = 0;
+
+    subBlocks_.push_back(energy);
+    if (subBlocks_.size() > kShortTermBlocks) {
+        subBlocks_.pop_front();
+    }
+    // Gating blocks are 400 ms with 75% overlap: one per sub-block
+    if (subBlocks_.size() >= kMomentaryBlocks) {
+        AddBlock(meanOfLast(subBlocks_, kMomentaryBlocks));
+    }
+}
+
+void LoudnessMeter::AddBlock(double energy) {
+    double loudness = energyToLufs(energy);
+    if (!(loudness > kAbsoluteGate)) {
+        return;
+    }
+    int bin = std::min(kBins - 1, static_cast<int>((loudness - kAbsoluteGate) / kBinWidth));
+    binCount_[bin]++;
+    binEnergy_[bin] += energy;
+}
+
+LoudnessMeter::Measurement LoudnessMeter::Measure() const {
+    const double minusInf = -std::numeric_limits<double>::infinity();
+    Measurement m;
+    m.momentary = subBlocks_.size() >= kMomentaryBlocks
+        ? energyToLufs(meanOfLast(subBlocks_, kMomentaryBlocks)) : minusInf;
+    m.shortTerm = subBlocks_.size() >= kShortTermBlocks
+        ? energyToLufs(meanOfLast(subBlocks_, kShortTermBlocks)) : minusInf;
+
+    // Integrated: mean of blocks above the absolute gate, then of blocks
+    // within 10 LU of that
+    uint64_t count = 0;
+    double energy = 0.0;
+    for (int b = 0; b < kBins; b++) {
+        count += binCount_[b];
+        energy += binEnergy_[b];
+    }
+    m.integrated = minusInf;
+    if (count > 0) {
+        double gate = energyToLufs(energy / count) + kRelativeGate;
+        count = 0;
+        energy = 0.0;
+        for (int b = 0; b < kBins; b++) {
+            // Bins straddling the gate count by their centre
+            if (kAbsoluteGate + (b + 0.5) * kBinWidth > gate) {
+                count += binCount_[b];
+                energy += binEnergy_[b];
+            }
+        }
+        if (count > 0) {
+            m.integrated = energyToLufs(energy / count);
+        }
+    }
+
+    m.truePeak = amplitudeToDb(truePeak_);
+    m.samplePeak = amplitudeToDb(samplePeak_);
+    m.duration = static_cast<double>(totalFrames_) / sampleRate_;
+    return m;
+}
+
+bool LoudnessMeter::ProcessFrame(const AVFrame* frame) {
+    if (!frame || frame->sample_rate != sampleRate_ || frame->ch_layout.nb_channels != channels_) {
+        return false;
+    }
+
+    AVSampleFormat format = static_cast<AVSampleFormat>(frame->format);
+    const bool planar = av_sample_fmt_is_planar(format);
+    const int bytes = av_get_bytes_per_sample(format);
+    const int frames = frame->nb_samples;
+    uint8_t* const* planes = frame->extended_data ? frame->extended_data : frame->data;
+    converted_.resize(static_cast<size_t>(frames) * channels_);
+
+    for (int c = 0; c < channels_; c++) {
+        const uint8_t* src = planar ? planes[c] : planes[0] + c * bytes;
+        const ptrdiff_t stride = planar ? bytes : static_cast<ptrdiff_t>(bytes) * channels_;
+        float* dst = converted_.data() + c;
+        switch (format) {
+            case AV_SAMPLE_FMT_U8: case AV_SAMPLE_FMT_U8P:
+                for (int i = 0; i < frames; i++) {
+                    dst[static_cast<size_t>(i) * channels_] = (src[i * stride] - 128) / 128.0f;
+                }
+                break;
+            case AV_SAMPLE_FMT_S16: case AV_SAMPLE_FMT_S16P:
+                for (int i = 0; i < frames; i++) {
+                    int16_t v;
+                    std::memcpy(&v, src + i * stride, sizeof(v));
+                    dst[static_cast<size_t>(i) * channels_] = v / 32768.0f;
+                }
+                break;
+            case AV_SAMPLE_FMT_S32: case AV_SAMPLE_FMT_S32P:
+                for (int i = 0; i < frames; i++) {
+                    int32_t v;
+                    std::memcpy(&v, src + i * stride, sizeof(v));
+                    dst[static_cast<size_t>(i) * channels_] = static_cast<float>(v / 2147483648.0);
+                }
+                break;
+            case AV_SAMPLE_FMT_FLT: case AV_SAMPLE_FMT_FLTP:
+                for (int i = 0; i < frames; i++) {
+                    std::memcpy(&dst[static_cast<size_t>(i) * channels_], src + i * stride, sizeof(float));
+                }
+                break;
+            case AV_SAMPLE_FMT_DBL: case AV_SAMPLE_FMT_DBLP:
+                for (int i = 0; i < frames; i++) {
+                    double v;
+                    std::memcpy(&v, src + i * stride, sizeof(v));
+                    dst[static_cast<size_t>(i) * channels_] = static_cast<float>(v);
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+
+    Process(converted_.data(), frames);
+    return true;
+}
+
+Napi::Object LoudnessMeter::ToJS(Napi::Env env, const Measurement& m) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("momentary", Napi::Number::New(env, m.momentary));
+    obj.Set("shortTerm", Napi::Number::New(env, m.shortTerm));
+    obj.Set("integrated", Napi::Number::New(env, m.integrated));
+    obj.Set("truePeak", Napi::Number::New(env, m.truePeak));
+    obj.Set("samplePeak", Napi::Number::New(env, m.samplePeak));
+    obj.Set("duration", Napi::Number::New(env, m.duration));
+    return obj;
+}
+
+// ==================== LoudnessMeterNative ====================
+
+Napi::FunctionReference LoudnessMeterNative::constructor;
+
+Napi::Object LoudnessMeterNative::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "LoudnessMeterNative", {
+        InstanceMethod("process", &LoudnessMeterNative::Process),
+        InstanceMethod("measure", &LoudnessMeterNative::Measure),
+        InstanceMethod("reset", &LoudnessMeterNative::Reset),
+    });
+
+    constructor = Napi::Persistent(func);
+    constructor.SuppressDestruct();
+
+    exports.Set("LoudnessMeterNative", func);
+    return exports;
+}
+
+LoudnessMeterNative::LoudnessMeterNative(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<LoudnessMeterNative>(info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "Expected sampleRate and channels").ThrowAsJavaScriptException();
+        return;
+    }
+    int sampleRate = info[0].As<Napi::Number>().Int32Value();
+    int channels = info[1].As<Napi::Number>().Int32Value();
+    if (sampleRate < 8000 || sampleRate > 768000 || channels < 1 || channels > 64) {
+        Napi::RangeError::New(env, "Unsupported sample rate or channel count").ThrowAsJavaScriptException();
+        return;
+    }
+
+    meter_.reset(new LoudnessMeter(sampleRate, channels));
+}
+
+void LoudnessMeterNative::Process(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject() ||
+        !info[0].As<Napi::Object>().InstanceOf(AudioDataNative::constructor.Value())) {
+        Napi::TypeError::New(env, "Expected an AudioDataNative").ThrowAsJavaScriptException();
+        return;
+    }
+    AVFrame* frame = Napi::ObjectWrap<AudioDataNative>::Unwrap(info[0].As<Napi::Object>())->GetFrame();
+    if (!frame) {
+        Napi::Error::New(env, "AudioData is closed").ThrowAsJavaScriptException();
+        return;
+    }
+    if (!meter_->ProcessFrame(frame)) {
+        Napi::Error::New(env, "AudioData does not match the meter's sample rate and channel count")
+            .ThrowAsJavaScriptException();
+        return;
+    }
+}
+
+Napi::Value LoudnessMeterNative::Measure(const Napi::CallbackInfo& info) {
+    return LoudnessMeter::ToJS(info.Env(), meter_->Measure());
+}
+
+void LoudnessMeterNative::Reset(const Napi::CallbackInfo& info) {
+    meter_->Reset();
+}
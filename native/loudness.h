@@ -0,0 +1,113 @@
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <napi.h>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+/**
+ * EBU R128 / ITU-R BS.1770-4 loudness and true-peak meter.
+ *
+ * Audio is K-weighted per channel and summed into 100 ms sub-blocks, from
+ * which momentary (400 ms), short-term (3 s) and gated integrated loudness
+ * are derived. True peak is measured on a 4x oversampled signal (2x at
+ * 96 kHz and above). Integrated loudness keeps a fixed-size histogram of
+ * block energies, so memory does not grow with programme length.
+ */
+class LoudnessMeter {
+public:
+    struct Measurement {
+        double momentary;   // LUFS, -Infinity until 400 ms are measured
+        double shortTerm;   // LUFS, -Infinity until 3 s are measured
+        double integrated;  // LUFS, -Infinity while every block is gated out
+        double truePeak;    // dBTP, max over all channels
+        double samplePeak;  // dBFS
+        double duration;    // Seconds of audio measured
+    };
+
+    LoudnessMeter(int sampleRate, int channels);
+
+    int sampleRate() const { return sampleRate_; }
+    int channels() const { return channels_; }
+
+    // Interleaved float samples
+    void Process(const float* samples, int frames);
+    // Any packed or planar PCM frame with this meter's rate and channel count
+    bool ProcessFrame(const AVFrame* frame);
+
+    Measurement Measure() const;
+    void Reset();
+
+    static Napi::Object ToJS(Napi::Env env, const Measurement& m);
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+    struct ChannelState {
+        double z[2][2];             // Direct form II transposed state per stage
+        std::vector<float> history; // Last taps-1 input samples for the oversampler
+        double energy;              // Sum of squares in the current sub-block
+    };
+
+    void ProcessChunk(const float* samples, int frames);
+    void EndSubBlock();
+    void AddBlock(double energy);
+
+    int sampleRate_;
+    int channels_;
+    int subBlockSize_;
+    int subBlockFill_;
+    int64_t totalFrames_;
+
+    Biquad stage_[2];
+    std::vector<double> weights_;
+    std::vector<ChannelState> state_;
+
+    // Oversampling FIR split into phases, each reversed for a forward dot product
+    int factor_;
+    int taps_;
+    std::vector<float> phases_;
+    std::vector<float> scratch_;
+    std::vector<float> upsampled_;
+    double truePeak_;
+    double samplePeak_;
+
+    // Weighted mean-square of recent sub-blocks, newest last (up to 3 s)
+    std::deque<double> subBlocks_;
+
+    // Gating histogram of 400 ms block energies: 0.1 LU bins from -70 LUFS
+    static constexpr int kBins = 1000;
+    std::array<uint64_t, kBins> binCount_;
+    std::array<double, kBins> binEnergy_;
+
+    std::vector<float> converted_;
+};
+
+/**
+ * JS handle for a standalone meter fed with AudioDataNative objects
+ */
+class LoudnessMeterNative : public Napi::ObjectWrap<LoudnessMeterNative> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    static Napi::FunctionReference constructor;
+
+    // new LoudnessMeterNative(sampleRate, channels)
+    LoudnessMeterNative(const Napi::CallbackInfo& info);
+
+private:
+    void Process(const Napi::CallbackInfo& info);
+    Napi::Value Measure(const Napi::CallbackInfo& info);
+    void Reset(const Napi::CallbackInfo& info);
+
+    std::unique_ptr<LoudnessMeter> meter_;
+};
+
+#endif
@@ -0,0 +1,464 @@
+#include "lut3d.h"
+#include "color.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUT3D_SSE2 1
+#endif
+
+namespace {
+
+// 8-bit RGB layout: component pointers' plane/offset and pixel step
+bool rgb8Layout(AVPixelFormat format, int plane[3], int offset[3], int& step) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!desc || !(desc->flags & AV_PIX_FMT_FLAG_RGB) || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) ||
+        (desc->flags & AV_PIX_FMT_FLAG_PAL) || desc->nb_components < 3) {
+        return false;
+    }
+    step = desc->comp[0].step;
+    for (int c = 0; c < 3; c++) {
+        const AVComponentDescriptor& comp = desc->comp[c];
+        if (comp.depth != 8 || comp.shift != 0 || comp.step != step) {
+            return false;
+        }
+        plane[c] = comp.plane;
+        offset[c] = comp.offset;
+    }
+    return true;
+}
+
+#ifdef LUT3D_SSE2
+// c000 + w0 (c1 - c000) + w1 (c2 - c1) + w2 (c111 - c2) for R, G and B at
+// once. Each load takes four floats; the fourth lane is the next entry (or
+// the table padding) and is ignored.
+__m128 blend(const float* const corner[4], const float weight[3]) {
+    __m128 p0 = _mm_loadu_ps(corner[0]);
+    __m128 p1 = _mm_loadu_ps(corner[1]);
+    __m128 p2 = _mm_loadu_ps(corner[2]);
+    __m128 p3 = _mm_loadu_ps(corner[3]);
+    __m128 v = _mm_add_ps(p0, _mm_mul_ps(_mm_set1_ps(weight[0]), _mm_sub_ps(p1, p0)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(weight[1]), _mm_sub_ps(p2, p1)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(weight[2]), _mm_sub_ps(p3, p2)));
+    return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+#endif
+
+std::mutex cacheMutex;
+std::map<std::string, std::weak_ptr<const Lut3D>> cache;
+
+}  // namespace
+
+std::shared_ptr<const Lut3D> Lut3D::Parse(const std::string& text, std::string& error) {
+    std::shared_ptr<Lut3D> lut(new Lut3D());
+    float domainMin[3] = {0.0f, 0.0f, 0.0f};
+    float domainMax[3] = {1.0f, 1.0f, 1.0f};
+
+    std::istringstream in(text);
+    std::string line;
+    size_t expected = 0;
+    while (std::getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line.substr(start));
+        std::string keyword;
+        fields >> keyword;
+
+        if (keyword == "TITLE") {
+            size_t open = line.find('"');
+            size_t close = line.rfind('"');
+            if (open != std::string::npos && close > open) {
+                lut->title_ = line.substr(open + 1, close - open - 1);
+            }
+        } else if (keyword == "LUT_3D_SIZE") {
+            fields >> lut->size_;
+            if (lut->size_ < 2 || lut->size_ > 256) {
+                error = "Invalid LUT_3D_SIZE";
+                return nullptr;
+            }
+            expected = static_cast<size_t>(lut->size_) * lut->size_ * lut->size_ * 3;
+            lut->table_.reserve(expected);
+        } else if (keyword == "LUT_1D_SIZE") {
+            error = "1D LUTs are not supported";
+            return nullptr;
+        } else if (keyword == "DOMAIN_MIN") {
+            fields >> domainMin[0] >> domainMin[1] >> domainMin[2];
+        } else if (keyword == "DOMAIN_MAX") {
+            fields >> domainMax[0] >> domainMax[1] >> domainMax[2];
+        } else if ((keyword[0] >= '0' && keyword[0] <= '9') || keyword[0] == '-' || keyword[0] == '.') {
+            std::istringstream values(line.substr(start));
+            float r, g, b;
+            if (!(values >> r >> g >> b) || expected == 0 || lut->table_.size() >= expected) {
+                error = "Unexpected LUT data line: " + line;
+                return nullptr;
+            }
+            lut->table_.push_back(r);
+            lut->table_.push_back(g);
+            lut->table_.push_back(b);
+        }
+        // Other keywords (e.g. LUT_IN_VIDEO_RANGE) are ignored
+    }
+
+    if (expected == 0 || lut->table_.size() != expected) {
+        error = "Incomplete 3D LUT";
+        return nullptr;
+    }
+    // Lets the last entry be read as four floats
+    lut->table_.push_back(0.0f);
+
+    // Where each 8-bit input code lands in the lattice
+    const int last = lut->size_ - 1;
+    for (int c = 0; c < 3; c++) {
+        float range = domainMax[c] - domainMin[c];
+        if (!(range > 0.0f)) {
+            error = "Invalid LUT domain";
+            return nullptr;
+        }
+        lut->domainMin_[c] = domainMin[c];
+        lut->latticeScale_[c] = last / range;
+        for (int v = 0; v < 256; v++) {
+            float x = (v / 255.0f - domainMin[c]) / range;
+            x = std::min(std::max(x, 0.0f), 1.0f) * last;
+            int cell = std::min(static_cast<int>(x), last - 1);
+            lut->cell_[c][v] = static_cast<uint16_t>(cell);
+            lut->frac_[c][v] = x - cell;
+        }
+    }
+
+    return lut;
+}
+
+std::shared_ptr<const Lut3D> Lut3D::Load(const std::string& path, std::string& error) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    auto it = cache.find(path);
+    if (it != cache.end()) {
+        if (auto lut = it->second.lock()) {
+            return lut;
+        }
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "Cannot open LUT file: " + path;
+        return nullptr;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+
+    std::shared_ptr<const Lut3D> lut = Parse(text.str(), error);
+    if (lut) {
+        cache[path] = lut;
+    }
+    return lut;
+}
+
+void Lut3D::Tetrahedron(int cr, int cg, int cb, float fr, float fg, float fb,
+                        const float* corner[4], float weight[3]) const {
+    const int n = size_;
+    // Lattice offsets (in floats) for one step along r, g and b
+    const int dr = 3;
+    const int dg = 3 * n;
+    const int db = 3 * n * n;
+
+    const float* c000 = table_.data() + cr * dr + cg * dg + cb * db;
+    const float* c111 = c000 + dr + dg + db;
+
+    // Pick the tetrahedron containing the point: order the fractions and
+    // walk from c000 to c111 along the matching edges
+    const float* c1;
+    const float* c2;
+    float w0, w1, w2;  // Weights of the three edge steps
+    if (fr > fg) {
+        if (fg > fb) {        // r > g > b
+            c1 = c000 + dr; c2 = c000 + dr + dg; w0 = fr; w1 = fg; w2 = fb;
+        } else if (fr > fb) { // r > b > g
+            c1 = c000 + dr; c2 = c000 + dr + db; w0 = fr; w1 = fb; w2 = fg;
+        } else {              // b > r > g
+            c1 = c000 + db; c2 = c000 + dr + db; w0 = fb; w1 = fr; w2 = fg;
+        }
+    } else {
+        if (fb > fg) {        // b > g > r
+            c1 = c000 + db; c2 = c000 + dg + db; w0 = fb; w1 = fg; w2 = fr;
+        } else if (fb > fr) { // g > b > r
+            c1 = c000 + dg; c2 = c000 + dg + db; w0 = fg; w1 = fb; w2 = fr;
+        } else {              // g > r > b
+            c1 = c000 + dg; c2 = c000 + dr + dg; w0 = fg; w1 = fr; w2 = fb;
+        }
+    }
+
+    corner[0] = c000;
+    corner[1] = c1;
+    corner[2] = c2;
+    corner[3] = c111;
+    weight[0] = w0;
+    weight[1] = w1;
+    weight[2] = w2;
+}
+
+void Lut3D::Interpolate(int cr, int cg, int cb, float fr, float fg, float fb, float out[3]) const {
+    const float* c[4];
+    float w[3];
+    Tetrahedron(cr, cg, cb, fr, fg, fb, c, w);
+    for (int i = 0; i < 3; i++) {
+        float v = c[0][i] + w[0] * (c[1][i] - c[0][i]) + w[1] * (c[2][i] - c[1][i]) + w[2] * (c[3][i] - c[2][i]);
+        out[i] = std::min(std::max(v, 0.0f), 1.0f);
+    }
+}
+
+void Lut3D::ApplyPixels(uint8_t* r, uint8_t* g, uint8_t* b, int step, int width) const {
+    int x = 0;
+#ifdef LUT3D_SSE2
+    {
+        // One pixel per register, R/G/B in the low three lanes
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        alignas(16) int32_t rgb[4];
+        for (; x < width; x++) {
+            const int off = x * step;
+            const uint8_t vr = r[off], vg = g[off], vb = b[off];
+            const float* c[4];
+            float w[3];
+            Tetrahedron(cell_[0][vr], cell_[1][vg], cell_[2][vb], frac_[0][vr], frac_[1][vg], frac_[2][vb], c, w);
+            _mm_store_si128(reinterpret_cast<__m128i*>(rgb),
+                            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(blend(c, w), scale), half)));
+            r[off] = static_cast<uint8_t>(rgb[0]);
+            g[off] = static_cast<uint8_t>(rgb[1]);
+            b[off] = static_cast<uint8_t>(rgb[2]);
+        }
+    }
+#endif
+    for (; x < width; x++) {
+        const int off = x * step;
+        const uint8_t vr = r[off], vg = g[off], vb = b[off];
+        float out[3];
+        Interpolate(cell_[0][vr], cell_[1][vg], cell_[2][vb], frac_[0][vr], frac_[1][vg], frac_[2][vb], out);
+        r[off] = static_cast<uint8_t>(out[0] * 255.0f + 0.5f);
+        g[off] = static_cast<uint8_t>(out[1] * 255.0f + 0.5f);
+        b[off] = static_cast<uint8_t>(out[2] * 255.0f + 0.5f);
+    }
+}
+
+void Lut3D::ApplyPixels16(uint16_t* r, uint16_t* g, uint16_t* b, int width) const {
+    const int last = size_ - 1;
+    uint16_t* planes[3] = {r, g, b};
+    auto locate = [&](int x, int cell[3], float frac[3]) {
+        for (int c = 0; c < 3; c++) {
+            float pos = (planes[c][x] * (1.0f / 65535.0f) - domainMin_[c]) * latticeScale_[c];
+            pos = std::min(std::max(pos, 0.0f), static_cast<float>(last));
+            cell[c] = std::min(static_cast<int>(pos), last - 1);
+            frac[c] = pos - cell[c];
+        }
+    };
+    int x = 0;
+#ifdef LUT3D_SSE2
+    {
+        const __m128 scale = _mm_set1_ps(65535.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        alignas(16) int32_t rgb[4];
+        for (; x < width; x++) {
+            int cell[3];
+            float frac[3];
+            locate(x, cell, frac);
+            const float* c[4];
+            float w[3];
+            Tetrahedron(cell[0], cell[1], cell[2], frac[0], frac[1], frac[2], c, w);
+            _mm_store_si128(reinterpret_cast<__m128i*>(rgb),
+                            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(blend(c, w), scale), half)));
+            r[x] = static_cast<uint16_t>(rgb[0]);
+            g[x] = static_cast<uint16_t>(rgb[1]);
+            b[x] = static_cast<uint16_t>(rgb[2]);
+        }
+    }
+#endif
+    for (; x < width; x++) {
+        int cell[3];
+        float frac[3];
+        locate(x, cell, frac);
+        float out[3];
+        Interpolate(cell[0], cell[1], cell[2], frac[0], frac[1], frac[2], out);
+        r[x] = static_cast<uint16_t>(out[0] * 65535.0f + 0.5f);
+        g[x] = static_cast<uint16_t>(out[1] * 65535.0f + 0.5f);
+        b[x] = static_cast<uint16_t>(out[2] * 65535.0f + 0.5f);
+    }
+}
+
+bool Lut3D::ApplyInPlace(AVFrame* frame) const {
+    if (frame->format == AV_PIX_FMT_GBRP16) {
+        // Planes are G, B, R
+        Parallel::forEachSlice(frame->height, [&](int first, int end) {
+            for (int y = first; y < end; y++) {
+                ApplyPixels16(
+                    reinterpret_cast<uint16_t*>(frame->data[2] + y * frame->linesize[2]),
+                    reinterpret_cast<uint16_t*>(frame->data[0] + y * frame->linesize[0]),
+                    reinterpret_cast<uint16_t*>(frame->data[1] + y * frame->linesize[1]),
+                    frame->width);
+            }
+        });
+        return true;
+    }
+
+    int plane[3], offset[3], step;
+    if (!rgb8Layout(static_cast<AVPixelFormat>(frame->format), plane, offset, step)) {
+        return false;
+    }
+
+    Parallel::forEachSlice(frame->height, [&](int first, int end) {
+        for (int y = first; y < end; y++) {
+            ApplyPixels(
+                frame->data[plane[0]] + y * frame->linesize[plane[0]] + offset[0],
+                frame->data[plane[1]] + y * frame->linesize[plane[1]] + offset[1],
+                frame->data[plane[2]] + y * frame->linesize[plane[2]] + offset[2],
+                step, frame->width);
+        }
+    });
+    return true;
+}
+
+AVFrame* Lut3D::Apply(const AVFrame* src, bool keepFormat) const {
+    if (!src || !src->data[0]) {
+        return nullptr;
+    }
+
+    AVPixelFormat srcFormat = static_cast<AVPixelFormat>(src->format);
+    int plane[3], offset[3], step;
+    bool direct = rgb8Layout(srcFormat, plane, offset, step);
+
+    // Working copy: same format for 8-bit RGB input, planar RGB otherwise.
+    // High bit depth input keeps its precision in 16-bit planes.
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(srcFormat);
+    AVPixelFormat working = desc && desc->comp[0].depth > 8 ? AV_PIX_FMT_GBRP16 : AV_PIX_FMT_GBRP;
+
+    AVFrame* rgb = av_frame_alloc();
+    if (!rgb) {
+        return nullptr;
+    }
+    rgb->format = direct ? srcFormat : working;
+    rgb->width = src->width;
+    rgb->height = src->height;
+    if (av_frame_get_buffer(rgb, 0) < 0) {
+        av_frame_free(&rgb);
+        return nullptr;
+    }
+    av_frame_copy_props(rgb, src);
+
+    if (direct) {
+        av_frame_copy(rgb, src);
+    } else {
+        // Bicubic, so subsampled chroma is interpolated rather than repeated
+        SwsContext* toRgb = sws_getContext(src->width, src->height, srcFormat,
+                                           src->width, src->height, working,
+                                           SWS_BICUBIC | SWS_ACCURATE_RND,
+                                           nullptr, nullptr, nullptr);
+        if (!toRgb) {
+            av_frame_free(&rgb);
+            return nullptr;
+        }
+        ColorSpace::configureSws(toRgb, srcFormat, src->colorspace, src->color_range,
+                                 working, AVCOL_SPC_RGB, AVCOL_RANGE_JPEG);
+        sws_scale(toRgb, src->data, src->linesize, 0, src->height, rgb->data, rgb->linesize);
+        sws_freeContext(toRgb);
+        rgb->colorspace = AVCOL_SPC_RGB;
+        rgb->color_range = AVCOL_RANGE_JPEG;
+    }
+
+    ApplyInPlace(rgb);
+
+    if (direct || !keepFormat) {
+        return rgb;
+    }
+
+    // Back to the source format and matrix
+    AVFrame* out = av_frame_alloc();
+    SwsContext* fromRgb = out ? sws_getContext(src->width, src->height, working,
+                                               src->width, src->height, srcFormat,
+                                               SWS_BICUBIC | SWS_ACCURATE_RND,
+                                               nullptr, nullptr, nullptr) : nullptr;
+    if (!fromRgb) {
+        av_frame_free(&out);
+        av_frame_free(&rgb);
+        return nullptr;
+    }
+    out->format = srcFormat;
+    out->width = src->width;
+    out->height = src->height;
+    if (av_frame_get_buffer(out, 0) < 0) {
+        sws_freeContext(fromRgb);
+        av_frame_free(&out);
+        av_frame_free(&rgb);
+        return nullptr;
+    }
+    av_frame_copy_props(out, src);
+    ColorSpace::configureSws(fromRgb, working, AVCOL_SPC_RGB, AVCOL_RANGE_JPEG,
+                             srcFormat, src->colorspace, src->color_range);
+    sws_scale(fromRgb, rgb->data, rgb->linesize, 0, src->height, out->data, out->linesize);
+    sws_freeContext(fromRgb);
+    av_frame_free(&rgb);
+    return out;
+}
+
+// ColorLutNative
+
+Napi::FunctionReference ColorLutNative::constructor;
+
+Napi::Object ColorLutNative::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "ColorLutNative", {
+        InstanceAccessor("size", &ColorLutNative::GetSize, nullptr),
+        InstanceAccessor("title", &ColorLutNative::GetTitle, nullptr),
+    });
+
+    constructor = Napi::Persistent(func);
+    constructor.SuppressDestruct();
+
+    exports.Set("ColorLutNative", func);
+    return exports;
+}
+
+ColorLutNative::ColorLutNative(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<ColorLutNative>(info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Expected .cube text or file path").ThrowAsJavaScriptException();
+        return;
+    }
+
+    std::string source = info[0].As<Napi::String>().Utf8Value();
+    bool isFile = info.Length() > 1 && info[1].IsBoolean() && info[1].As<Napi::Boolean>().Value();
+
+    std::string error;
+    lut_ = isFile ? Lut3D::Load(source, error) : Lut3D::Parse(source, error);
+    if (!lut_) {
+        Napi::Error::New(env, "Failed to load LUT: " + error).ThrowAsJavaScriptException();
+        return;
+    }
+}
+
+std::shared_ptr<const Lut3D> ColorLutNative::FromValue(Napi::Value value) {
+    if (!value.IsObject() || !value.As<Napi::Object>().InstanceOf(constructor.Value())) {
+        return nullptr;
+    }
+    return Napi::ObjectWrap<ColorLutNative>::Unwrap(value.As<Napi::Object>())->lut_;
+}
+
+Napi::Value ColorLutNative::GetSize(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), lut_ ? lut_->size() : 0);
+}
+
+Napi::Value ColorLutNative::GetTitle(const Napi::CallbackInfo& info) {
+    return Napi::String::New(info.Env(), lut_ ? lut_->title() : "");
+}
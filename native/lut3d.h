@@ -0,0 +1,95 @@
+#ifndef LUT3D_H
+#define LUT3D_H
+
+#include <napi.h>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+/**
+ * 3D color lookup table (.cube) with tetrahedral interpolation. The four
+ * corners of a tetrahedron are blended on R, G and B together with SSE2
+ * where available.
+ *
+ * Tables are immutable once parsed and shared through shared_ptr, so one
+ * parse serves every frame and every codec using it. Files loaded by path
+ * are cached while any user still holds them.
+ */
+class Lut3D {
+public:
+    // Parse .cube text. Returns nullptr and sets error on failure.
+    static std::shared_ptr<const Lut3D> Parse(const std::string& text, std::string& error);
+    // Load a .cube file, reusing the parsed table if the path is already loaded
+    static std::shared_ptr<const Lut3D> Load(const std::string& path, std::string& error);
+
+    int size() const { return size_; }
+    const std::string& title() const { return title_; }
+
+    /**
+     * Apply the table to a frame and return a new frame (nullptr on failure).
+     * 8-bit RGB formats are graded directly. Other formats go through planar
+     * RGB, 16-bit (GBRP16) when the source has more than 8 bits per component
+     * and GBRP otherwise: with keepFormat they are converted back, otherwise
+     * the planar frame is returned so a following conversion pass can pick it
+     * up.
+     */
+    AVFrame* Apply(const AVFrame* src, bool keepFormat) const;
+
+private:
+    Lut3D() : size_(0) {}
+
+    // Tetrahedron containing lattice cell (cr, cg, cb) + (fr, fg, fb): its
+    // corners from c000 to c111 and the weights of the three edges between them
+    void Tetrahedron(int cr, int cg, int cb, float fr, float fg, float fb,
+                     const float* corner[4], float weight[3]) const;
+    // Tetrahedral interpolation at lattice cell (cr, cg, cb) + (fr, fg, fb),
+    // clamped to [0, 1]
+    void Interpolate(int cr, int cg, int cb, float fr, float fg, float fb, float out[3]) const;
+    // Grade `width` pixels in place; step is the byte distance between pixels
+    void ApplyPixels(uint8_t* r, uint8_t* g, uint8_t* b, int step, int width) const;
+    // Grade `width` pixels of 16-bit planar rows in place
+    void ApplyPixels16(uint16_t* r, uint16_t* g, uint16_t* b, int width) const;
+    // Grade an 8-bit RGB or GBRP16 frame in place, rows split across threads
+    bool ApplyInPlace(AVFrame* frame) const;
+
+    int size_;
+    std::string title_;
+    std::vector<float> table_;  // size^3 RGB triplets, red fastest, plus one padding float
+
+    // Per-channel 8-bit code -> lattice cell and position inside it
+    std::array<uint16_t, 256> cell_[3];
+    std::array<float, 256> frac_[3];
+
+    // Per-channel normalized input -> lattice position, for 16-bit input
+    float domainMin_[3];
+    float latticeScale_[3];
+};
+
+/**
+ * JS handle for a shared Lut3D (ColorLUT on the TS side)
+ */
+class ColorLutNative : public Napi::ObjectWrap<ColorLutNative> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    static Napi::FunctionReference constructor;
+
+    // The table behind a ColorLutNative object, or nullptr if value is not one
+    static std::shared_ptr<const Lut3D> FromValue(Napi::Value value);
+
+    // new ColorLutNative(source, isFile)
+    ColorLutNative(const Napi::CallbackInfo& info);
+
+private:
+    Napi::Value GetSize(const Napi::CallbackInfo& info);
+    Napi::Value GetTitle(const Napi::CallbackInfo& info);
+
+    std::shared_ptr<const Lut3D> lut_;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <napi.h>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+#include <algorithm>
+
+/**
+ * Bounded buffer for pull-mode codec outputs.
+ *
+ * In pull mode the worker thread parks results here instead of calling into
+ * JS for each one; JS drains batches with takeOutputs(max). When the buffer
+ * is full the worker either blocks until JS takes something (natural
+ * backpressure on the codec) or drops an output, per the configured policy.
+ *
+ * JS is told that outputs are available through a single "readable"
+ * notification per drain cycle: the first push after a take() signals, the
+ * following pushes do not.
+ */
+template <typename T>
+class OutputBuffer {
+public:
+    enum class Policy { Block, DropOldest, DropNewest };
+    using Disposer = void (*)(T*);
+
+    explicit OutputBuffer(Disposer dispose)
+        : dispose_(dispose), capacity_(0), policy_(Policy::Block),
+          readableSignalled_(false), hasReadable_(false), dropped_(0) {}
+
+    ~OutputBuffer() {
+        Disable();
+    }
+
+    static bool ParsePolicy(const std::string& name, Policy& out) {
+        if (name == "block") { out = Policy::Block; return true; }
+        if (name == "drop-oldest") { out = Policy::DropOldest; return true; }
+        if (name == "drop-newest") { out = Policy::DropNewest; return true; }
+        return false;
+    }
+
+    // Switch the codec into pull mode (main thread)
+    void Enable(Napi::Env env, size_t capacity, Policy policy, Napi::Function onReadable) {
+        Disable();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity > 0 ? capacity : 1;
+        policy_ = policy;
+        readableSignalled_ = false;
+        dropped_ = 0;
+        tsfnReadable_ = Napi::ThreadSafeFunction::New(env, onReadable, "CodecOutputReadable", 0, 1);
+        tsfnReadable_.Unref(env);
+        hasReadable_ = true;
+        enabled_ = true;
+    }
+
+    // Leave pull mode: discard buffered outputs and wake a blocked worker
+    void Disable() {
+        std::deque<T*> discarded;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!enabled_ && !hasReadable_) {
+                return;
+            }
+            enabled_ = false;
+            discarded.swap(items_);
+            if (hasReadable_) {
+                tsfnReadable_.Release();
+                hasReadable_ = false;
+            }
+        }
+        spaceCV_.notify_all();
+        for (T* item : discarded) {
+            dispose_(item);
+        }
+    }
+
+    bool Enabled() const {
+        return enabled_;
+    }
+
+    // Discard buffered outputs but stay in pull mode (reset)
+    void Clear() {
+        std::deque<T*> discarded;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            discarded.swap(items_);
+            readableSignalled_ = false;
+        }
+        spaceCV_.notify_all();
+        for (T* item : discarded) {
+            dispose_(item);
+        }
+    }
+
+    // Hand an output to JS (worker thread). Takes ownership of item. With
+    // mayBlock false a full "block" buffer drops the item instead of waiting.
+    void Push(T* item, bool mayBlock = true) {
+        T* drop = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (enabled_ && items_.size() >= capacity_ && policy_ == Policy::Block && mayBlock) {
+                spaceCV_.wait(lock, [this] {
+                    return !enabled_ || items_.size() < capacity_;
+                });
+            }
+
+            if (!enabled_) {
+                drop = item;
+            } else if (items_.size() >= capacity_) {
+                dropped_++;
+                if (policy_ == Policy::DropOldest) {
+                    drop = items_.front();
+                    items_.pop_front();
+                    items_.push_back(item);
+                } else {
+                    drop = item;
+                }
+            } else {
+                items_.push_back(item);
+            }
+
+            if (enabled_ && !items_.empty() && !readableSignalled_ && hasReadable_) {
+                readableSignalled_ = true;
+                tsfnReadable_.NonBlockingCall();
+            }
+        }
+        if (drop) {
+            dispose_(drop);
+        }
+    }
+
+    // Take up to max outputs (main thread). Ownership passes to the caller.
+    std::vector<T*> Take(size_t max) {
+        std::vector<T*> out;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t count = std::min(max, items_.size());
+            out.reserve(count);
+            for (size_t i = 0; i < count; i++) {
+                out.push_back(items_.front());
+                items_.pop_front();
+            }
+            readableSignalled_ = false;
+        }
+        spaceCV_.notify_all();
+        return out;
+    }
+
+    size_t Size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+    uint64_t Dropped() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+private:
+    Disposer dispose_;
+    std::deque<T*> items_;
+    std::mutex mutex_;
+    std::condition_variable spaceCV_;
+    std::atomic<bool> enabled_{false};
+    size_t capacity_;
+    Policy policy_;
+    bool readableSignalled_;
+    bool hasReadable_;
+    uint64_t dropped_;
+    Napi::ThreadSafeFunction tsfnReadable_;
+};
+
+#endif // OUTPUT_BUFFER_H
@@ -0,0 +1,157 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel {
+
+// Rows per thread below which slicing is not worth handing work to the pool
+constexpr int kMinRowsPerSlice = 64;
+constexpr int kMaxSlices = 8;
+
+/**
+ * Process-wide pool of kMaxSlices - 1 worker threads, started on first use
+ * and kept for the life of the process, so per-frame kernels do not pay for
+ * thread creation.
+ *
+ * Run() queues a job and the calling thread works on it too, claiming
+ * indices from the same counter as the workers. The caller therefore never
+ * waits for a worker to become free: if all of them are busy (another
+ * codec's frame, or a nested Run() from inside a job) it simply runs every
+ * index itself. It only waits for indices a worker has already started.
+ */
+class Pool {
+public:
+    static Pool& Instance() {
+        // Never destroyed: workers may still be parked when the process exits
+        static Pool* pool = new Pool();
+        return *pool;
+    }
+
+    // Call task(i) for every i in [0, count) and return when all are done
+    void Run(int count, const std::function<void(int)>& task) {
+        if (threads_.empty() || count <= 1) {
+            for (int i = 0; i < count; i++) {
+                task(i);
+            }
+            return;
+        }
+
+        auto job = std::make_shared<Job>(task, count);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(job);
+        }
+        if (count - 1 >= static_cast<int>(threads_.size())) {
+            workCV_.notify_all();
+        } else {
+            for (int i = 1; i < count; i++) {
+                workCV_.notify_one();
+            }
+        }
+
+        Work(*job);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = std::find(jobs_.begin(), jobs_.end(), job);
+        if (it != jobs_.end()) {
+            jobs_.erase(it);
+        }
+        doneCV_.wait(lock, [&] { return job->done.load() == count; });
+    }
+
+private:
+    struct Job {
+        Job(const std::function<void(int)>& task, int count) : task(&task), count(count) {}
+        const std::function<void(int)>* task;  // Only called for indices < count
+        const int count;
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+    };
+
+    Pool() {
+        int threads = std::min<int>(std::max(1u, std::thread::hardware_concurrency()), kMaxSlices) - 1;
+        for (int i = 0; i < threads; i++) {
+            threads_.emplace_back(&Pool::WorkerLoop, this);
+            threads_.back().detach();
+        }
+    }
+
+    void Work(Job& job) {
+        for (int i = job.next++; i < job.count; i = job.next++) {
+            (*job.task)(i);
+            if (++job.done == job.count) {
+                // Taking the lock orders this with the caller's predicate check
+                std::lock_guard<std::mutex> lock(mutex_);
+                doneCV_.notify_all();
+            }
+        }
+    }
+
+    void WorkerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            workCV_.wait(lock, [this] { return !jobs_.empty(); });
+            std::shared_ptr<Job> job = jobs_.front();
+            lock.unlock();
+            Work(*job);
+            lock.lock();
+            // Every index is claimed; later workers move on to the next job
+            if (!jobs_.empty() && jobs_.front() == job) {
+                jobs_.pop_front();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable workCV_;
+    std::condition_variable doneCV_;
+    std::deque<std::shared_ptr<Job>> jobs_;
+};
+
+/**
+ * Run fn(firstRow, endRow) over [0, rows) in horizontal slices on the shared
+ * pool, with the calling thread taking part. Small jobs run inline. Slices
+ * are aligned to `align` rows (2 keeps 4:2:0 chroma rows whole).
+ */
+template <typename Fn>
+void forEachSlice(int rows, Fn fn, int align = 1) {
+    int slices = std::min<int>(std::max(1u, std::thread::hardware_concurrency()), kMaxSlices);
+    slices = std::min(slices, rows / kMinRowsPerSlice);
+    if (slices <= 1) {
+        fn(0, rows);
+        return;
+    }
+
+    int per = (rows + slices - 1) / slices;
+    per = (per + align - 1) / align * align;
+
+    Pool::Instance().Run(slices, [&](int slice) {
+        int first = slice * per;
+        if (first < rows) {
+            fn(first, std::min(rows, first + per));
+        }
+    });
+}
+
+/**
+ * Run fn(index) for every index in [0, count) on the shared pool, for jobs
+ * that are independent units (one layer, one tile) rather than rows.
+ */
+template <typename Fn>
+void forEachIndex(int count, Fn fn) {
+    Pool::Instance().Run(count, [&](int i) { fn(i); });
+}
+
+}  // namespace Parallel
+
+#endif
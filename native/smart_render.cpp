@@ -0,0 +1,385 @@
+#include "smart_render.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+struct Gop {
+    size_t first;
+    size_t count;
+    int64_t start;  // Earliest presentation time
+    int64_t end;    // Latest presentation end
+    bool open;      // Has frames presented before its keyframe (references the previous GOP)
+};
+
+struct Nal {
+    size_t begin;
+    size_t end;
+};
+
+int64_t readInt(Napi::Object obj, const char* key) {
+    Napi::Value v = obj.Get(key);
+    return v.IsNumber() ? v.As<Napi::Number>().Int64Value() : 0;
+}
+
+bool isHevc(const std::string& codec) {
+    return codec.rfind("hvc1", 0) == 0 || codec.rfind("hev1", 0) == 0;
+}
+
+// NAL unit payloads between Annex B start codes
+std::vector<Nal> splitAnnexB(const uint8_t* data, size_t size) {
+    // Start of the payload after each 00 00 01
+    std::vector<size_t> starts;
+    for (size_t i = 0; i + 3 <= size; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            starts.push_back(i + 3);
+            i += 2;
+        }
+    }
+
+    std::vector<Nal> nals;
+    for (size_t n = 0; n < starts.size(); n++) {
+        const size_t begin = starts[n];
+        size_t end = n + 1 < starts.size() ? starts[n + 1] - 3 : size;
+        // Drops the zero byte of a 4-byte start code and trailing_zero_8bits
+        while (end > begin && data[end - 1] == 0) {
+            end--;
+        }
+        if (end > begin) {
+            nals.push_back({begin, end});
+        }
+    }
+    return nals;
+}
+
+bool isParameterSet(uint8_t header, bool hevc) {
+    if (hevc) {
+        const int type = (header >> 1) & 0x3f;
+        return type >= 32 && type <= 34;  // VPS, SPS, PPS
+    }
+    const int type = header & 0x1f;
+    return type == 7 || type == 8;  // SPS, PPS
+}
+
+void appendLengthPrefixed(std::vector<uint8_t>& out, const uint8_t* nal, size_t length, int nalLengthSize) {
+    for (int b = nalLengthSize - 1; b >= 0; b--) {
+        out.push_back(static_cast<uint8_t>(length >> (8 * b)));
+    }
+    out.insert(out.end(), nal, nal + length);
+}
+
+// Parameter set NAL units listed in an avcC or hvcC record, length-prefixed;
+// false if the record is truncated
+bool recordParameterSets(const uint8_t* data, size_t size, bool hevc, int nalLengthSize,
+                         std::vector<uint8_t>& out) {
+    size_t pos;
+    auto readNals = [&](size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (pos + 2 > size) {
+                return false;
+            }
+            const size_t length = (static_cast<size_t>(data[pos]) << 8) | data[pos + 1];
+            pos += 2;
+            if (pos + length > size) {
+                return false;
+            }
+            appendLengthPrefixed(out, data + pos, length, nalLengthSize);
+            pos += length;
+        }
+        return true;
+    };
+
+    if (hevc) {
+        const size_t arrays = data[22];
+        pos = 23;
+        for (size_t a = 0; a < arrays; a++) {
+            if (pos + 3 > size) {
+                return false;
+            }
+            const size_t count = (static_cast<size_t>(data[pos + 1]) << 8) | data[pos + 2];
+            pos += 3;
+            if (!readNals(count)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    pos = 6;
+    if (!readNals(data[5] & 0x1f)) {
+        return false;
+    }
+    if (pos >= size) {
+        return false;
+    }
+    const size_t ppsCount = data[pos++];
+    return readNals(ppsCount);
+}
+
+}  // namespace
+
+Napi::Object SmartRender::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Object smartRender = Napi::Object::New(env);
+
+    smartRender.Set("plan", Napi::Function::New(env, PlanJS));
+    smartRender.Set("parseDecoderConfig", Napi::Function::New(env, ParseDecoderConfig));
+    smartRender.Set("toLengthPrefixed", Napi::Function::New(env, ToLengthPrefixedJS));
+    smartRender.Set("annexBParameterSets", Napi::Function::New(env, AnnexBParameterSetsJS));
+
+    exports.Set("SmartRender", smartRender);
+    return exports;
+}
+
+std::vector<SmartRender::Segment> SmartRender::Plan(const std::vector<Unit>& input,
+                                                    const std::vector<Range>& ranges,
+                                                    std::string& error) {
+    std::vector<Segment> segments;
+    if (input.empty()) {
+        return segments;
+    }
+    if (!input[0].key) {
+        error = "The first chunk must be a keyframe";
+        return segments;
+    }
+    for (const Range& range : ranges) {
+        if (range.start >= range.end) {
+            error = "Each range needs start < end";
+            return segments;
+        }
+    }
+
+    // Fill unknown durations from the gap to the next presentation time
+    std::vector<Unit> units(input);
+    std::vector<int64_t> times;
+    times.reserve(units.size());
+    for (const Unit& unit : units) {
+        times.push_back(unit.timestamp);
+    }
+    std::sort(times.begin(), times.end());
+    for (Unit& unit : units) {
+        if (unit.duration > 0) {
+            continue;
+        }
+        auto next = std::upper_bound(times.begin(), times.end(), unit.timestamp);
+        if (next != times.end()) {
+            unit.duration = *next - unit.timestamp;
+        } else if (times.size() > 1) {
+            unit.duration = times.back() - times[times.size() - 2];
+        }
+    }
+
+    std::vector<Gop> gops;
+    for (size_t i = 0; i < units.size(); i++) {
+        const Unit& unit = units[i];
+        if (unit.key) {
+            gops.push_back({i, 0, unit.timestamp, unit.timestamp + unit.duration, false});
+        }
+        Gop& gop = gops.back();
+        gop.count++;
+        gop.open = gop.open || unit.timestamp < units[gop.first].timestamp;
+        gop.start = std::min(gop.start, unit.timestamp);
+        gop.end = std::max(gop.end, unit.timestamp + unit.duration);
+    }
+
+    const int64_t streamStart = std::min_element(gops.begin(), gops.end(),
+        [](const Gop& a, const Gop& b) { return a.start < b.start; })->start;
+    const int64_t streamEnd = std::max_element(gops.begin(), gops.end(),
+        [](const Gop& a, const Gop& b) { return a.end < b.end; })->end;
+
+    // Ranges are concatenated in the order given
+    int64_t outputTime = 0;
+    for (const Range& range : ranges) {
+        const int64_t start = std::max(range.start, streamStart);
+        const int64_t end = std::min(range.end, streamEnd);
+        if (start >= end) {
+            continue;
+        }
+        const int64_t shift = outputTime - start;
+
+        bool previousCopied = false;
+        for (size_t g = 0; g < gops.size(); g++) {
+            const Gop& gop = gops[g];
+            if (gop.end <= start || gop.start >= end) {
+                previousCopied = false;
+                continue;
+            }
+
+            // An open GOP is only self-contained after the GOP it references
+            const bool inside = gop.start >= start && gop.end <= end && (!gop.open || previousCopied);
+            if (inside) {
+                Segment* last = segments.empty() ? nullptr : &segments.back();
+                if (last && last->copy && last->shift == shift && last->first + last->count == gop.first) {
+                    last->count += gop.count;
+                    last->gops++;
+                    last->end = gop.end;
+                } else {
+                    segments.push_back({true, gop.first, gop.count, 1, gop.start, gop.end, shift});
+                }
+            } else {
+                // Decode from the previous keyframe when this GOP's leading frames need it
+                const size_t first = gop.open && g > 0 ? gops[g - 1].first : gop.first;
+                segments.push_back({false, first, gop.first + gop.count - first, 1,
+                                    std::max(start, gop.start), std::min(end, gop.end), shift});
+            }
+            previousCopied = inside;
+        }
+        outputTime += end - start;
+    }
+    return segments;
+}
+
+std::vector<uint8_t> SmartRender::ToLengthPrefixed(const uint8_t* data, size_t size, int nalLengthSize) {
+    std::vector<Nal> nals = splitAnnexB(data, size);
+    std::vector<uint8_t> out;
+    out.reserve(size + nals.size() * nalLengthSize);
+    for (const Nal& nal : nals) {
+        appendLengthPrefixed(out, data + nal.begin, nal.end - nal.begin, nalLengthSize);
+    }
+    return out;
+}
+
+std::vector<uint8_t> SmartRender::AnnexBParameterSets(const uint8_t* data, size_t size, bool hevc) {
+    static const uint8_t kStartCode[4] = {0, 0, 0, 1};
+    std::vector<uint8_t> out;
+    for (const Nal& nal : splitAnnexB(data, size)) {
+        if (isParameterSet(data[nal.begin], hevc)) {
+            out.insert(out.end(), kStartCode, kStartCode + 4);
+            out.insert(out.end(), data + nal.begin, data + nal.end);
+        }
+    }
+    return out;
+}
+
+Napi::Value SmartRender::PlanJS(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsArray()) {
+        Napi::TypeError::New(env, "Expected (chunks, ranges)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Array chunkArray = info[0].As<Napi::Array>();
+    std::vector<Unit> units;
+    units.reserve(chunkArray.Length());
+    for (uint32_t i = 0; i < chunkArray.Length(); i++) {
+        Napi::Object chunk = chunkArray.Get(i).As<Napi::Object>();
+        Napi::Value key = chunk.Get("key");
+        units.push_back({readInt(chunk, "timestamp"), readInt(chunk, "duration"),
+                         key.IsBoolean() && key.As<Napi::Boolean>().Value()});
+    }
+
+    Napi::Array rangeArray = info[1].As<Napi::Array>();
+    std::vector<Range> ranges;
+    for (uint32_t i = 0; i < rangeArray.Length(); i++) {
+        Napi::Object range = rangeArray.Get(i).As<Napi::Object>();
+        ranges.push_back({readInt(range, "start"), readInt(range, "end")});
+    }
+
+    std::string error;
+    std::vector<Segment> segments = Plan(units, ranges, error);
+    if (!error.empty()) {
+        Napi::RangeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Array result = Napi::Array::New(env, segments.size());
+    for (size_t i = 0; i < segments.size(); i++) {
+        const Segment& seg = segments[i];
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("type", Napi::String::New(env, seg.copy ? "copy" : "reencode"));
+        obj.Set("first", Napi::Number::New(env, static_cast<double>(seg.first)));
+        obj.Set("count", Napi::Number::New(env, static_cast<double>(seg.count)));
+        obj.Set("gops", Napi::Number::New(env, static_cast<double>(seg.gops)));
+        obj.Set("start", Napi::Number::New(env, static_cast<double>(seg.start)));
+        obj.Set("end", Napi::Number::New(env, static_cast<double>(seg.end)));
+        obj.Set("shift", Napi::Number::New(env, static_cast<double>(seg.shift)));
+        result.Set(static_cast<uint32_t>(i), obj);
+    }
+    return result;
+}
+
+Napi::Value SmartRender::ParseDecoderConfig(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsTypedArray() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Expected (description, codec)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Uint8Array description = info[0].As<Napi::Uint8Array>();
+    const uint8_t* data = description.Data();
+    const size_t size = description.ElementLength();
+    const std::string codec = info[1].As<Napi::String>().Utf8Value();
+    const bool hevc = isHevc(codec);
+
+    Napi::Object result = Napi::Object::New(env);
+    std::vector<uint8_t> parameterSets;
+    if (hevc) {
+        // HEVCDecoderConfigurationRecord
+        if (size < 23 || data[0] != 1) {
+            return env.Null();
+        }
+        const int nalLengthSize = (data[21] & 3) + 1;
+        if (!recordParameterSets(data, size, true, nalLengthSize, parameterSets)) {
+            return env.Null();
+        }
+        result.Set("profile", Napi::Number::New(env, data[1] & 0x1f));
+        result.Set("level", Napi::Number::New(env, data[12]));
+        result.Set("nalLengthSize", Napi::Number::New(env, nalLengthSize));
+        result.Set("parameterSets", Napi::Buffer<uint8_t>::Copy(env, parameterSets.data(), parameterSets.size()));
+        return result;
+    }
+
+    // AVCDecoderConfigurationRecord
+    if (size < 7 || data[0] != 1) {
+        return env.Null();
+    }
+    const int nalLengthSize = (data[4] & 3) + 1;
+    if (!recordParameterSets(data, size, false, nalLengthSize, parameterSets)) {
+        return env.Null();
+    }
+    char codecString[16];
+    snprintf(codecString, sizeof(codecString), "avc1.%02x%02x%02x", data[1], data[2], data[3]);
+    result.Set("codec", Napi::String::New(env, codecString));
+    result.Set("profile", Napi::Number::New(env, data[1]));
+    result.Set("level", Napi::Number::New(env, data[3]));
+    result.Set("nalLengthSize", Napi::Number::New(env, nalLengthSize));
+    result.Set("parameterSets", Napi::Buffer<uint8_t>::Copy(env, parameterSets.data(), parameterSets.size()));
+    return result;
+}
+
+Napi::Value SmartRender::ToLengthPrefixedJS(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsTypedArray() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "Expected (data, nalLengthSize)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int nalLengthSize = info[1].As<Napi::Number>().Int32Value();
+    if (nalLengthSize != 1 && nalLengthSize != 2 && nalLengthSize != 4) {
+        Napi::RangeError::New(env, "nalLengthSize must be 1, 2 or 4").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Uint8Array data = info[0].As<Napi::Uint8Array>();
+    std::vector<uint8_t> out = ToLengthPrefixed(data.Data(), data.ElementLength(), nalLengthSize);
+    return Napi::Buffer<uint8_t>::Copy(env, out.data(), out.size());
+}
+
+Napi::Value SmartRender::AnnexBParameterSetsJS(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsTypedArray() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Expected (data, codec)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Uint8Array data = info[0].As<Napi::Uint8Array>();
+    std::vector<uint8_t> sets = AnnexBParameterSets(data.Data(), data.ElementLength(),
+                                                    isHevc(info[1].As<Napi::String>().Utf8Value()));
+    if (sets.empty()) {
+        return env.Null();
+    }
+    return Napi::Buffer<uint8_t>::Copy(env, sets.data(), sets.size());
+}
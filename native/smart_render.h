@@ -0,0 +1,65 @@
+#ifndef SMART_RENDER_H
+#define SMART_RENDER_H
+
+#include <napi.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * SmartRender - planning and bitstream helpers for trim/concat exports
+ *
+ * A plan splits the kept ranges of an encoded stream into GOPs that can be
+ * copied byte for byte and GOPs cut by an edit point, which have to be
+ * decoded and re-encoded. Decoding and encoding run through the regular
+ * VideoDecoder / worker-thread VideoEncoder; this module only decides
+ * what goes where and rewrites re-encoded packets to the source framing.
+ */
+class SmartRender {
+public:
+    struct Unit {
+        int64_t timestamp;
+        int64_t duration;
+        bool key;
+    };
+    struct Range {
+        int64_t start;  // Inclusive, microseconds
+        int64_t end;    // Exclusive
+    };
+    struct Segment {
+        bool copy;
+        size_t first;   // Index of the first chunk (a keyframe)
+        size_t count;   // Chunks to copy, or to decode for a re-encode
+        size_t gops;
+        int64_t start;  // Frames kept, in source time
+        int64_t end;
+        int64_t shift;  // Added to source timestamps for the output timeline
+    };
+
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+    // Empty with a message when the stream or ranges are unusable
+    static std::vector<Segment> Plan(const std::vector<Unit>& units, const std::vector<Range>& ranges,
+                                     std::string& error);
+
+    // Annex B start codes to big-endian NAL lengths of nalLengthSize bytes
+    static std::vector<uint8_t> ToLengthPrefixed(const uint8_t* data, size_t size, int nalLengthSize);
+
+    // H.264 SPS/PPS or HEVC VPS/SPS/PPS NAL units of an Annex B access unit,
+    // each behind a 4-byte start code; empty if there are none
+    static std::vector<uint8_t> AnnexBParameterSets(const uint8_t* data, size_t size, bool hevc);
+
+private:
+    // plan(chunks: {timestamp, duration, key}[], ranges: {start, end}[])
+    static Napi::Value PlanJS(const Napi::CallbackInfo& info);
+    // parseDecoderConfig(description, codec)
+    //   -> { codec?, profile, level, nalLengthSize, parameterSets } | null
+    // parameterSets: the record's parameter sets, length-prefixed for in-band use
+    static Napi::Value ParseDecoderConfig(const Napi::CallbackInfo& info);
+    // toLengthPrefixed(annexB, nalLengthSize) -> Buffer
+    static Napi::Value ToLengthPrefixedJS(const Napi::CallbackInfo& info);
+    // annexBParameterSets(annexB, codec) -> Buffer | null
+    static Napi::Value AnnexBParameterSetsJS(const Napi::CallbackInfo& info);
+};
+
+#endif // SMART_RENDER_H
@@ -0,0 +1,139 @@
+#ifndef TIMESTAMP_TABLE_H
+#define TIMESTAMP_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+/**
+ * Per-chunk metadata carried from decode() to the matching output frame.
+ */
+struct FrameMetadata {
+    int64_t timestamp;
+    int64_t duration;
+    double userData;
+    bool hasUserData;
+};
+
+/**
+ * Fixed-size ring mapping packet sequence numbers to chunk metadata.
+ *
+ * Decoders with B-frames (H.264, HEVC) emit frames in presentation order,
+ * so the frame returned by avcodec_receive_frame() usually does not belong
+ * to the packet that was just sent. Each packet is tagged with a monotonically
+ * increasing sequence number (as its pts, and as its opaque pointer when the
+ * decoder supports AV_CODEC_FLAG_COPY_OPAQUE). The decoder reorders that tag
+ * along with the picture, and we look the original chunk metadata back up here.
+ *
+ * Slots are indexed by seq % kCapacity and validated against the stored seq,
+ * so lookups are O(1), nothing is allocated per frame, and stale entries left
+ * behind by reset() can never match a newer packet.
+ */
+class TimestampTable {
+public:
+    static constexpr size_t kCapacity = 256;
+
+    TimestampTable() : nextSeq_(0) {
+        last_ = {0, 0, 0, false};
+        for (size_t i = 0; i < kCapacity; i++) {
+            slots_[i].seq = -1;
+        }
+    }
+
+    // Store metadata for a new packet and return the sequence number to tag it with
+    int64_t Insert(int64_t timestamp, int64_t duration, double userData, bool hasUserData) {
+        int64_t seq = nextSeq_++;
+        Slot& slot = slots_[static_cast<size_t>(seq) % kCapacity];
+        slot.seq = seq;
+        slot.meta.timestamp = timestamp;
+        slot.meta.duration = duration;
+        slot.meta.userData = userData;
+        slot.meta.hasUserData = hasUserData;
+        return seq;
+    }
+
+    // Look up (and release) the metadata for a sequence number
+    bool Take(int64_t seq, FrameMetadata& out) {
+        if (seq < 0) {
+            return false;
+        }
+        Slot& slot = slots_[static_cast<size_t>(seq) % kCapacity];
+        if (slot.seq != seq) {
+            return false;
+        }
+        out = slot.meta;
+        slot.seq = -1;
+        return true;
+    }
+
+    // Tag a packet so its sequence number survives decoder reordering
+    static void TagPacket(AVPacket* packet, int64_t seq) {
+        packet->pts = seq;
+        packet->dts = seq;
+#ifdef AV_CODEC_FLAG_COPY_OPAQUE
+        packet->opaque = reinterpret_cast<void*>(static_cast<intptr_t>(seq + 1));
+#endif
+    }
+
+    // Recover the sequence number a decoded frame was produced from
+    static int64_t FrameSeq(const AVFrame* frame) {
+#ifdef AV_CODEC_FLAG_COPY_OPAQUE
+        if (frame->opaque) {
+            return static_cast<int64_t>(reinterpret_cast<intptr_t>(frame->opaque)) - 1;
+        }
+#endif
+        if (frame->pts != AV_NOPTS_VALUE) {
+            return frame->pts;
+        }
+        return frame->best_effort_timestamp;
+    }
+
+    // Enable opaque pass-through on the codec context (before avcodec_open2)
+    static void ConfigureContext(AVCodecContext* ctx) {
+#ifdef AV_CODEC_FLAG_COPY_OPAQUE
+        ctx->flags |= AV_CODEC_FLAG_COPY_OPAQUE;
+#endif
+    }
+
+    // Packets sent after the one a decoded frame came from, i.e. how far the
+    // decoder runs behind its input. Counting on both sides by sequence number
+    // stays right when a packet yields no frame or several. -1 if the frame
+    // lost its tag.
+    int64_t Backlog(const AVFrame* frame) const {
+        const int64_t seq = FrameSeq(frame);
+        if (seq < 0 || seq >= nextSeq_) {
+            return -1;
+        }
+        return nextSeq_ - 1 - seq;
+    }
+
+    // Metadata for a decoded frame. If the decoder dropped the tag, extrapolate
+    // from the previous output so timestamps stay monotonic.
+    FrameMetadata Resolve(const AVFrame* frame) {
+        FrameMetadata meta;
+        if (!Take(FrameSeq(frame), meta)) {
+            meta.timestamp = last_.timestamp + last_.duration;
+            meta.duration = last_.duration;
+            meta.userData = 0;
+            meta.hasUserData = false;
+        }
+        last_ = meta;
+        return meta;
+    }
+
+private:
+    struct Slot {
+        int64_t seq;
+        FrameMetadata meta;
+    };
+
+    Slot slots_[kCapacity];
+    int64_t nextSeq_;
+    FrameMetadata last_;
+};
+
+#endif // TIMESTAMP_TABLE_H
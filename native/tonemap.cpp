@@ -0,0 +1,394 @@
+#include "tonemap.h"
+#include "color.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TONEMAP_SSE2 1
+#endif
+
+namespace ToneMap {
+
+namespace {
+
+// BT.2408 HDR reference white; linear light is expressed in multiples of it,
+// so 1.0 lands on SDR 100%
+constexpr double kReferenceWhite = 203.0;
+constexpr double kDefaultPeak = 1000.0;
+
+// SMPTE ST 2084 (PQ)
+constexpr double kPqM1 = 2610.0 / 16384.0;
+constexpr double kPqM2 = 2523.0 / 4096.0 * 128.0;
+constexpr double kPqC1 = 3424.0 / 4096.0;
+constexpr double kPqC2 = 2413.0 / 4096.0 * 32.0;
+constexpr double kPqC3 = 2392.0 / 4096.0 * 32.0;
+
+// ARIB STD-B67 (HLG)
+constexpr double kHlgA = 0.17883277;
+constexpr double kHlgB = 0.28466892;
+constexpr double kHlgC = 0.55991073;
+constexpr double kHlgPeak = 1000.0;
+constexpr double kHlgGamma = 1.2;
+
+// Gain / encode tables are indexed by sqrt(x) to keep precision in the shadows
+constexpr int kGainSize = 1024;
+constexpr int kEncodeSize = 4096;
+
+double pqToNits(double e) {
+    double p = std::pow(std::max(e, 0.0), 1.0 / kPqM2);
+    return 10000.0 * std::pow(std::max(p - kPqC1, 0.0) / (kPqC2 - kPqC3 * p), 1.0 / kPqM1);
+}
+
+double nitsToPq(double nits) {
+    double y = std::pow(std::max(nits, 0.0) / 10000.0, kPqM1);
+    return std::pow((kPqC1 + kPqC2 * y) / (1.0 + kPqC3 * y), kPqM2);
+}
+
+double hlgToScene(double e) {
+    return e <= 0.5 ? e * e / 3.0 : (std::exp((e - kHlgC) / kHlgA) + kHlgB) / 12.0;
+}
+
+// 16-bit PQ code -> display light relative to reference white
+const std::vector<float>& pqTable() {
+    static const std::vector<float> table = [] {
+        std::vector<float> t(65536);
+        for (int i = 0; i < 65536; i++) {
+            t[i] = static_cast<float>(pqToNits(i / 65535.0) / kReferenceWhite);
+        }
+        return t;
+    }();
+    return table;
+}
+
+// 16-bit HLG code -> scene light [0, 1]
+const std::vector<float>& hlgTable() {
+    static const std::vector<float> table = [] {
+        std::vector<float> t(65536);
+        for (int i = 0; i < 65536; i++) {
+            t[i] = static_cast<float>(hlgToScene(i / 65535.0));
+        }
+        return t;
+    }();
+    return table;
+}
+
+// HLG OOTF gain by sqrt(scene luminance): Lw * Ys^(gamma - 1), relative to reference white
+const std::vector<float>& hlgOotfTable() {
+    static const std::vector<float> table = [] {
+        std::vector<float> t(kEncodeSize + 1);
+        for (int i = 0; i <= kEncodeSize; i++) {
+            double s = static_cast<double>(i) / kEncodeSize;
+            t[i] = static_cast<float>(kHlgPeak / kReferenceWhite * std::pow(s * s, kHlgGamma - 1.0));
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Linear [0, 1] by sqrt -> 8-bit BT.709 (BT.1886 display inverse)
+const std::vector<uint8_t>& encodeTable() {
+    static const std::vector<uint8_t> table = [] {
+        std::vector<uint8_t> t(kEncodeSize + 1);
+        for (int i = 0; i <= kEncodeSize; i++) {
+            double s = static_cast<double>(i) / kEncodeSize;
+            t[i] = static_cast<uint8_t>(std::lround(255.0 * std::pow(s * s, 1.0 / 2.4)));
+        }
+        return t;
+    }();
+    return table;
+}
+
+double hable(double x) {
+    const double A = 0.15, B = 0.50, C = 0.10, D = 0.20, E = 0.02, F = 0.30;
+    return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
+}
+
+// BT.2390 EETF: hermite knee in the PQ domain, source peak onto target peak (nits)
+double bt2390(double nits, double srcPeak, double dstPeak) {
+    double srcPq = nitsToPq(srcPeak);
+    double e1 = nitsToPq(nits) / srcPq;
+    double maxLum = nitsToPq(dstPeak) / srcPq;
+    double ks = 1.5 * maxLum - 0.5;
+
+    double e2 = e1;
+    if (e1 > ks) {
+        double t = (e1 - ks) / (1.0 - ks);
+        double t2 = t * t;
+        double t3 = t2 * t;
+        e2 = (2.0 * t3 - 3.0 * t2 + 1.0) * ks +
+             (t3 - 2.0 * t2 + t) * (1.0 - ks) +
+             (-2.0 * t3 + 3.0 * t2) * maxLum;
+    }
+    return pqToNits(std::min(e2, 1.0) * srcPq);
+}
+
+// BT.2020 -> BT.709 primaries (linear light)
+constexpr float kM[3][3] = {
+    { 1.6605f, -0.5876f, -0.0728f},
+    {-0.1246f,  1.1329f, -0.0083f},
+    {-0.0182f, -0.1006f,  1.1187f},
+};
+
+}  // namespace
+
+Curve parseCurve(const std::string& name) {
+    if (name == "hable") return Curve::Hable;
+    if (name == "bt2390") return Curve::BT2390;
+    return Curve::None;
+}
+
+bool isHdr(const AVFrame* frame) {
+    return frame && ColorSpace::isHdrTransfer(frame->color_trc);
+}
+
+ToneMapper::ToneMapper(Curve curve, double peakLuminance)
+    : curve_(curve)
+    , peak_(static_cast<float>((peakLuminance > 0 ? peakLuminance : kDefaultPeak) / kReferenceWhite))
+    , toRgb_(nullptr)
+    , rgb16_(nullptr)
+    , decode_(nullptr)
+    , hlg_(false)
+    , convertPrimaries_(true) {
+    BuildGainTable(peak_);
+}
+
+ToneMapper::~ToneMapper() {
+    if (toRgb_) {
+        sws_freeContext(toRgb_);
+    }
+    if (rgb16_) {
+        av_frame_free(&rgb16_);
+    }
+}
+
+void ToneMapper::BuildGainTable(float peak) {
+    // gain(m) = curve(m) / m for max(R,G,B) = m, sampled at m = peak * s^2
+    gain_.resize(kGainSize + 1);
+    const double bias = 2.0;  // Hable exposure bias
+    double hableWhite = hable(bias * peak);
+
+    for (int i = 0; i <= kGainSize; i++) {
+        double s = static_cast<double>(i) / kGainSize;
+        double m = std::max(peak * s * s, 1e-6);
+        double out;
+        if (curve_ == Curve::BT2390) {
+            out = bt2390(m * kReferenceWhite, peak * kReferenceWhite, kReferenceWhite) / kReferenceWhite;
+        } else {
+            out = hable(bias * m) / hableWhite;
+        }
+        gain_[i] = static_cast<float>(out / m);
+    }
+}
+
+bool ToneMapper::PrepareInput(const AVFrame* src) {
+    hlg_ = src->color_trc == AVCOL_TRC_ARIB_STD_B67;
+    decode_ = hlg_ ? &hlgTable() : &pqTable();
+    // Untagged HDR is BT.2020 in practice
+    convertPrimaries_ = src->color_primaries != AVCOL_PRI_BT709;
+
+    if (!rgb16_ || rgb16_->width != src->width || rgb16_->height != src->height) {
+        if (rgb16_) {
+            av_frame_free(&rgb16_);
+        }
+        rgb16_ = av_frame_alloc();
+        if (!rgb16_) {
+            return false;
+        }
+        rgb16_->format = AV_PIX_FMT_GBRP16;
+        rgb16_->width = src->width;
+        rgb16_->height = src->height;
+        if (av_frame_get_buffer(rgb16_, 0) < 0) {
+            av_frame_free(&rgb16_);
+            return false;
+        }
+        rowR_.resize(src->width);
+        rowG_.resize(src->width);
+        rowB_.resize(src->width);
+    }
+
+    toRgb_ = sws_getCachedContext(toRgb_,
+        src->width, src->height, static_cast<AVPixelFormat>(src->format),
+        src->width, src->height, AV_PIX_FMT_GBRP16,
+        SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!toRgb_) {
+        return false;
+    }
+
+    AVColorSpace matrix = src->colorspace == AVCOL_SPC_UNSPECIFIED
+        ? AVCOL_SPC_BT2020_NCL : src->colorspace;
+    ColorSpace::configureSws(toRgb_,
+        static_cast<AVPixelFormat>(src->format), matrix, src->color_range,
+        AV_PIX_FMT_GBRP16, AVCOL_SPC_RGB, AVCOL_RANGE_JPEG);
+    return true;
+}
+
+void ToneMapper::ProcessRow(const uint16_t* g, const uint16_t* b, const uint16_t* r,
+                            uint8_t* outG, uint8_t* outB, uint8_t* outR, int width) {
+    float* __restrict rr = rowR_.data();
+    float* __restrict gg = rowG_.data();
+    float* __restrict bb = rowB_.data();
+    const float* lut = decode_->data();
+
+    // Transfer decode
+    for (int x = 0; x < width; x++) {
+        rr[x] = lut[r[x]];
+        gg[x] = lut[g[x]];
+        bb[x] = lut[b[x]];
+    }
+
+    // HLG OOTF: scene light -> display light, using BT.2020 luminance
+    if (hlg_) {
+        const float* ootf = hlgOotfTable().data();
+        for (int x = 0; x < width; x++) {
+            float ys = 0.2627f * rr[x] + 0.6780f * gg[x] + 0.0593f * bb[x];
+            float k = ootf[static_cast<int>(std::sqrt(std::min(ys, 1.0f)) * kEncodeSize + 0.5f)];
+            rr[x] *= k;
+            gg[x] *= k;
+            bb[x] *= k;
+        }
+    }
+
+    // Primaries
+    if (convertPrimaries_) {
+        int x = 0;
+#ifdef TONEMAP_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        for (; x + 4 <= width; x += 4) {
+            __m128 r0 = _mm_loadu_ps(rr + x);
+            __m128 g0 = _mm_loadu_ps(gg + x);
+            __m128 b0 = _mm_loadu_ps(bb + x);
+            _mm_storeu_ps(rr + x, _mm_max_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(kM[0][0]), r0), _mm_mul_ps(_mm_set1_ps(kM[0][1]), g0)),
+                _mm_mul_ps(_mm_set1_ps(kM[0][2]), b0)), zero));
+            _mm_storeu_ps(gg + x, _mm_max_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(kM[1][0]), r0), _mm_mul_ps(_mm_set1_ps(kM[1][1]), g0)),
+                _mm_mul_ps(_mm_set1_ps(kM[1][2]), b0)), zero));
+            _mm_storeu_ps(bb + x, _mm_max_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(kM[2][0]), r0), _mm_mul_ps(_mm_set1_ps(kM[2][1]), g0)),
+                _mm_mul_ps(_mm_set1_ps(kM[2][2]), b0)), zero));
+        }
+#endif
+        for (; x < width; x++) {
+            float r0 = rr[x], g0 = gg[x], b0 = bb[x];
+            rr[x] = std::max(kM[0][0] * r0 + kM[0][1] * g0 + kM[0][2] * b0, 0.0f);
+            gg[x] = std::max(kM[1][0] * r0 + kM[1][1] * g0 + kM[1][2] * b0, 0.0f);
+            bb[x] = std::max(kM[2][0] * r0 + kM[2][1] * g0 + kM[2][2] * b0, 0.0f);
+        }
+    }
+
+    // Tone curve on max(R,G,B), applied as a gain so hues are kept
+    const float* gain = gain_.data();
+    const float invPeak = 1.0f / peak_;
+    int x = 0;
+#ifdef TONEMAP_SSE2
+    {
+        // The gain lookup is a gather, so only the index and the
+        // interpolation weight are computed four at a time
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(static_cast<float>(kGainSize));
+        const __m128 vInvPeak = _mm_set1_ps(invPeak);
+        const __m128i lastIndex = _mm_set1_epi32(kGainSize - 1);
+        alignas(16) int32_t idx[4];
+        for (; x + 4 <= width; x += 4) {
+            __m128 r0 = _mm_loadu_ps(rr + x);
+            __m128 g0 = _mm_loadu_ps(gg + x);
+            __m128 b0 = _mm_loadu_ps(bb + x);
+            __m128 m = _mm_max_ps(_mm_max_ps(r0, g0), b0);
+            __m128 t = _mm_mul_ps(_mm_sqrt_ps(_mm_min_ps(_mm_mul_ps(m, vInvPeak), one)), scale);
+            __m128i i = _mm_cvttps_epi32(t);
+            // t <= kGainSize, so at most one step over the last index
+            i = _mm_add_epi32(i, _mm_cmpgt_epi32(i, lastIndex));
+            __m128 f = _mm_sub_ps(t, _mm_cvtepi32_ps(i));
+            _mm_store_si128(reinterpret_cast<__m128i*>(idx), i);
+            __m128 lo = _mm_setr_ps(gain[idx[0]], gain[idx[1]], gain[idx[2]], gain[idx[3]]);
+            __m128 hi = _mm_setr_ps(gain[idx[0] + 1], gain[idx[1] + 1], gain[idx[2] + 1], gain[idx[3] + 1]);
+            __m128 k = _mm_add_ps(lo, _mm_mul_ps(_mm_sub_ps(hi, lo), f));
+            _mm_storeu_ps(rr + x, _mm_min_ps(_mm_mul_ps(r0, k), one));
+            _mm_storeu_ps(gg + x, _mm_min_ps(_mm_mul_ps(g0, k), one));
+            _mm_storeu_ps(bb + x, _mm_min_ps(_mm_mul_ps(b0, k), one));
+        }
+    }
+#endif
+    for (; x < width; x++) {
+        float m = std::max(std::max(rr[x], gg[x]), bb[x]);
+        float t = std::sqrt(std::min(m * invPeak, 1.0f)) * kGainSize;
+        int i = std::min(static_cast<int>(t), kGainSize - 1);
+        float f = t - static_cast<float>(i);
+        float k = gain[i] + (gain[i + 1] - gain[i]) * f;
+        rr[x] = std::min(rr[x] * k, 1.0f);
+        gg[x] = std::min(gg[x] * k, 1.0f);
+        bb[x] = std::min(bb[x] * k, 1.0f);
+    }
+
+    // BT.709 encode
+    const uint8_t* enc = encodeTable().data();
+    x = 0;
+#ifdef TONEMAP_SSE2
+    {
+        const __m128 scale = _mm_set1_ps(static_cast<float>(kEncodeSize));
+        const __m128 half = _mm_set1_ps(0.5f);
+        alignas(16) int32_t ir[4], ig[4], ib[4];
+        for (; x + 4 <= width; x += 4) {
+            _mm_store_si128(reinterpret_cast<__m128i*>(ir), _mm_cvttps_epi32(
+                _mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(_mm_loadu_ps(rr + x)), scale), half)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(ig), _mm_cvttps_epi32(
+                _mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(_mm_loadu_ps(gg + x)), scale), half)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(ib), _mm_cvttps_epi32(
+                _mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(_mm_loadu_ps(bb + x)), scale), half)));
+            for (int j = 0; j < 4; j++) {
+                outR[x + j] = enc[ir[j]];
+                outG[x + j] = enc[ig[j]];
+                outB[x + j] = enc[ib[j]];
+            }
+        }
+    }
+#endif
+    for (; x < width; x++) {
+        outR[x] = enc[static_cast<int>(std::sqrt(rr[x]) * kEncodeSize + 0.5f)];
+        outG[x] = enc[static_cast<int>(std::sqrt(gg[x]) * kEncodeSize + 0.5f)];
+        outB[x] = enc[static_cast<int>(std::sqrt(bb[x]) * kEncodeSize + 0.5f)];
+    }
+}
+
+AVFrame* ToneMapper::Process(const AVFrame* src) {
+    if (!src || curve_ == Curve::None || !PrepareInput(src)) {
+        return nullptr;
+    }
+
+    sws_scale(toRgb_, src->data, src->linesize, 0, src->height,
+              rgb16_->data, rgb16_->linesize);
+
+    AVFrame* out = av_frame_alloc();
+    if (!out) {
+        return nullptr;
+    }
+    out->format = AV_PIX_FMT_GBRP;
+    out->width = src->width;
+    out->height = src->height;
+    if (av_frame_get_buffer(out, 0) < 0) {
+        av_frame_free(&out);
+        return nullptr;
+    }
+    av_frame_copy_props(out, src);
+    out->color_primaries = AVCOL_PRI_BT709;
+    out->color_trc = AVCOL_TRC_BT709;
+    out->colorspace = AVCOL_SPC_RGB;
+    out->color_range = AVCOL_RANGE_JPEG;
+
+    // GBRP plane order: G, B, R
+    for (int y = 0; y < src->height; y++) {
+        ProcessRow(
+            reinterpret_cast<const uint16_t*>(rgb16_->data[0] + y * rgb16_->linesize[0]),
+            reinterpret_cast<const uint16_t*>(rgb16_->data[1] + y * rgb16_->linesize[1]),
+            reinterpret_cast<const uint16_t*>(rgb16_->data[2] + y * rgb16_->linesize[2]),
+            out->data[0] + y * out->linesize[0],
+            out->data[1] + y * out->linesize[1],
+            out->data[2] + y * out->linesize[2],
+            src->width);
+    }
+
+    return out;
+}
+
+}  // namespace ToneMap
@@ -0,0 +1,74 @@
+#ifndef TONEMAP_H
+#define TONEMAP_H
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace ToneMap {
+
+enum class Curve { None, Hable, BT2390 };
+
+// Map a WebCodecs-style option string ("hable", "bt2390") to a curve
+Curve parseCurve(const std::string& name);
+
+// Whether the frame carries PQ or HLG content
+bool isHdr(const AVFrame* frame);
+
+/**
+ * HDR (PQ/HLG, BT.2020) to SDR (BT.709) converter.
+ *
+ * Frames are brought to 16-bit planar RGB by swscale, then every row goes
+ * through the same float kernel: transfer decode (LUT), BT.2020 -> BT.709
+ * primaries, a ratio-preserving tone curve on max(R,G,B), and BT.709 encode
+ * (LUT) to 8 bits. The kernel works on separate R/G/B row buffers. The
+ * primaries, tone curve and encode passes have SSE2 paths; the table lookups
+ * stay scalar, and other targets use the plain loops.
+ *
+ * Keeps its scaler and scratch buffers between frames; not thread-safe.
+ */
+class ToneMapper {
+public:
+    // peakLuminance in cd/m2; 0 uses 1000 (the usual mastering peak)
+    ToneMapper(Curve curve, double peakLuminance);
+    ~ToneMapper();
+
+    ToneMapper(const ToneMapper&) = delete;
+    ToneMapper& operator=(const ToneMapper&) = delete;
+
+    // Returns a new AV_PIX_FMT_GBRP frame tagged BT.709, or nullptr on failure.
+    // The caller owns the result. Timestamps and other props are copied.
+    AVFrame* Process(const AVFrame* src);
+
+private:
+    bool PrepareInput(const AVFrame* src);
+    void BuildGainTable(float peak);
+    void ProcessRow(const uint16_t* g, const uint16_t* b, const uint16_t* r,
+                    uint8_t* outG, uint8_t* outB, uint8_t* outR, int width);
+
+    Curve curve_;
+    float peak_;
+
+    SwsContext* toRgb_;
+    AVFrame* rgb16_;
+
+    // Transfer decode for the current input, 16-bit code -> linear light
+    const std::vector<float>* decode_;
+    bool hlg_;
+    bool convertPrimaries_;
+
+    // Tone curve as a gain on max(R,G,B), sampled on sqrt(x / peak)
+    std::vector<float> gain_;
+
+    // Row scratch
+    std::vector<float> rowR_, rowG_, rowB_;
+};
+
+}  // namespace ToneMap
+
+#endif
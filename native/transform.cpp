@@ -0,0 +1,262 @@
+#include "transform.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SSE2 1
+#endif
+
+namespace FrameTransform {
+
+namespace {
+
+// Tile edge for the 90/270 paths: the source rows touched by one tile stay
+// in L1 while its columns are written out as destination rows
+constexpr int kTile = 32;
+
+struct PlaneLayout {
+    int count;
+    int elementSize[4];  // Bytes per pixel within the plane
+    int shiftW[4];
+    int shiftH[4];
+};
+
+int ceilShift(int value, int shift) {
+    return (value + (1 << shift) - 1) >> shift;
+}
+
+bool describe(AVPixelFormat format, PlaneLayout& layout) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+        return false;
+    }
+    // Packed 4:2:2 (YUYV) has no per-pixel element to move
+    if (!(desc->flags & AV_PIX_FMT_FLAG_PLANAR) && (desc->log2_chroma_w || desc->log2_chroma_h)) {
+        return false;
+    }
+
+    layout.count = 0;
+    for (int p = 0; p < 4; p++) {
+        layout.elementSize[p] = 0;
+    }
+    for (int c = 0; c < desc->nb_components; c++) {
+        const AVComponentDescriptor& comp = desc->comp[c];
+        layout.elementSize[comp.plane] = std::max(layout.elementSize[comp.plane], comp.step);
+        layout.count = std::max(layout.count, comp.plane + 1);
+    }
+    for (int p = 0; p < layout.count; p++) {
+        int size = layout.elementSize[p];
+        if (size != 1 && size != 2 && size != 4 && size != 8) {
+            return false;  // e.g. RGB24
+        }
+        bool chroma = (p == 1 || p == 2);
+        layout.shiftW[p] = chroma ? desc->log2_chroma_w : 0;
+        layout.shiftH[p] = chroma ? desc->log2_chroma_h : 0;
+    }
+    return layout.count > 0;
+}
+
+#ifdef TRANSFORM_SSE2
+// 8x8 block of a byte plane for the 90/270 paths. s is the source pixel of
+// destination (0,0); source rows (colStep apart) become destination rows.
+// rowStep is +1 or -1: for -1 the eight bytes are loaded from s - 7 and the
+// transposed rows are written bottom-up.
+void transpose8x8(const uint8_t* s, ptrdiff_t colStep, ptrdiff_t rowStep,
+                  uint8_t* d, ptrdiff_t dstStride) {
+    const uint8_t* base = rowStep < 0 ? s - 7 : s;
+    __m128i r[8];
+    for (int k = 0; k < 8; k++) {
+        r[k] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(base + k * colStep));
+    }
+    __m128i a0 = _mm_unpacklo_epi8(r[0], r[1]);
+    __m128i a1 = _mm_unpacklo_epi8(r[2], r[3]);
+    __m128i a2 = _mm_unpacklo_epi8(r[4], r[5]);
+    __m128i a3 = _mm_unpacklo_epi8(r[6], r[7]);
+    __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+    __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+    __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+    __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+    // Each register holds two output rows, one per 64-bit half
+    __m128i c[4] = {
+        _mm_unpacklo_epi32(b0, b2), _mm_unpackhi_epi32(b0, b2),
+        _mm_unpacklo_epi32(b1, b3), _mm_unpackhi_epi32(b1, b3),
+    };
+    for (int j = 0; j < 8; j++) {
+        __m128i row = (j & 1) ? _mm_srli_si128(c[j >> 1], 8) : c[j >> 1];
+        const int y = rowStep < 0 ? 7 - j : j;
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(d + y * dstStride), row);
+    }
+}
+#endif
+
+template <typename T>
+void transformPlane(const uint8_t* src, int srcStride, int srcW, int srcH,
+                    uint8_t* dst, int dstStride, int rotation, bool flip) {
+    const bool swap = rotation == 90 || rotation == 270;
+    const int dstW = swap ? srcH : srcW;
+    const int dstH = swap ? srcW : srcH;
+
+    // Source pixel of destination (0,0), and the source step for one
+    // destination column (ax, ay) and one destination row (bx, by)
+    int x0 = 0, y0 = 0, ax = 1, ay = 0, bx = 0, by = 1;
+    switch (rotation) {
+        case 90:  y0 = srcH - 1; ax = 0; ay = -1; bx = 1; by = 0; break;
+        case 180: x0 = srcW - 1; y0 = srcH - 1; ax = -1; by = -1; break;
+        case 270: x0 = srcW - 1; ax = 0; ay = 1; bx = -1; by = 0; break;
+        default: break;
+    }
+    if (flip) {
+        x0 += ax * (dstW - 1);
+        y0 += ay * (dstW - 1);
+        ax = -ax;
+        ay = -ay;
+    }
+
+    const ptrdiff_t elem = sizeof(T);
+    const ptrdiff_t colStep = ax * elem + ay * static_cast<ptrdiff_t>(srcStride);
+    const ptrdiff_t rowStep = bx * elem + by * static_cast<ptrdiff_t>(srcStride);
+    const uint8_t* origin = src + x0 * elem + y0 * static_cast<ptrdiff_t>(srcStride);
+
+    if (colStep == elem) {
+        // Rows stay rows, same direction
+        for (int y = 0; y < dstH; y++) {
+            memcpy(dst + y * static_cast<ptrdiff_t>(dstStride), origin + y * rowStep, dstW * elem);
+        }
+    } else if (colStep == -elem) {
+        // Rows stay rows, reversed: contiguous, so the loop vectorizes
+        for (int y = 0; y < dstH; y++) {
+            const T* s = reinterpret_cast<const T*>(origin + y * rowStep);
+            T* d = reinterpret_cast<T*>(dst + y * static_cast<ptrdiff_t>(dstStride));
+            for (int x = 0; x < dstW; x++) {
+                d[x] = s[-x];
+            }
+        }
+    } else {
+        // Columns become rows: walk the plane in tiles
+        auto copyRow = [&](int y, int xStart, int xEnd) {
+            const uint8_t* s = origin + y * rowStep + xStart * colStep;
+            T* d = reinterpret_cast<T*>(dst + y * static_cast<ptrdiff_t>(dstStride));
+            for (int x = xStart; x < xEnd; x++, s += colStep) {
+                memcpy(&d[x], s, sizeof(T));
+            }
+        };
+        for (int ty = 0; ty < dstH; ty += kTile) {
+            const int yEnd = std::min(ty + kTile, dstH);
+            for (int tx = 0; tx < dstW; tx += kTile) {
+                const int xEnd = std::min(tx + kTile, dstW);
+                int y = ty;
+#ifdef TRANSFORM_SSE2
+                // Byte planes (luma, 8-bit chroma) go through in 8x8 blocks
+                if (sizeof(T) == 1) {
+                    for (; y + 8 <= yEnd; y += 8) {
+                        int x = tx;
+                        for (; x + 8 <= xEnd; x += 8) {
+                            transpose8x8(origin + y * rowStep + x * colStep, colStep, rowStep,
+                                         dst + y * static_cast<ptrdiff_t>(dstStride) + x, dstStride);
+                        }
+                        for (int row = y; row < y + 8 && x < xEnd; row++) {
+                            copyRow(row, x, xEnd);
+                        }
+                    }
+                }
+#endif
+                for (; y < yEnd; y++) {
+                    copyRow(y, tx, xEnd);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace
+
+bool isValidRotation(int rotation) {
+    return rotation == 0 || rotation == 90 || rotation == 180 || rotation == 270;
+}
+
+bool isSupported(const AVFrame* frame, int rotation) {
+    if (!frame || !frame->data[0] || !isValidRotation(rotation)) {
+        return false;
+    }
+    PlaneLayout layout;
+    if (!describe(static_cast<AVPixelFormat>(frame->format), layout)) {
+        return false;
+    }
+    if (rotation == 90 || rotation == 270) {
+        const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+        return desc->log2_chroma_w == desc->log2_chroma_h;
+    }
+    return true;
+}
+
+AVFrame* apply(const AVFrame* src, int rotation, bool flip) {
+    if (!isSupported(src, rotation)) {
+        return nullptr;
+    }
+
+    PlaneLayout layout;
+    describe(static_cast<AVPixelFormat>(src->format), layout);
+
+    // Vertical flip: same pixels read bottom-up
+    if (rotation == 180 && flip) {
+        AVFrame* view = av_frame_alloc();
+        if (!view || av_frame_ref(view, src) < 0) {
+            av_frame_free(&view);
+            return nullptr;
+        }
+        for (int p = 0; p < layout.count; p++) {
+            int rows = ceilShift(src->height, layout.shiftH[p]);
+            view->data[p] += static_cast<ptrdiff_t>(rows - 1) * view->linesize[p];
+            view->linesize[p] = -view->linesize[p];
+        }
+        return view;
+    }
+
+    const bool swap = rotation == 90 || rotation == 270;
+    AVFrame* out = av_frame_alloc();
+    if (!out) {
+        return nullptr;
+    }
+    out->format = src->format;
+    out->width = swap ? src->height : src->width;
+    out->height = swap ? src->width : src->height;
+    if (av_frame_get_buffer(out, 0) < 0) {
+        av_frame_free(&out);
+        return nullptr;
+    }
+    av_frame_copy_props(out, src);
+
+    for (int p = 0; p < layout.count; p++) {
+        int w = ceilShift(src->width, layout.shiftW[p]);
+        int h = ceilShift(src->height, layout.shiftH[p]);
+        switch (layout.elementSize[p]) {
+            case 1:
+                transformPlane<uint8_t>(src->data[p], src->linesize[p], w, h,
+                                        out->data[p], out->linesize[p], rotation, flip);
+                break;
+            case 2:
+                transformPlane<uint16_t>(src->data[p], src->linesize[p], w, h,
+                                         out->data[p], out->linesize[p], rotation, flip);
+                break;
+            case 4:
+                transformPlane<uint32_t>(src->data[p], src->linesize[p], w, h,
+                                         out->data[p], out->linesize[p], rotation, flip);
+                break;
+            case 8:
+                transformPlane<uint64_t>(src->data[p], src->linesize[p], w, h,
+                                         out->data[p], out->linesize[p], rotation, flip);
+                break;
+        }
+    }
+
+    return out;
+}
+
+}  // namespace FrameTransform
@@ -0,0 +1,36 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+/**
+ * Lossless orientation changes for software frames: clockwise rotation by
+ * 0/90/180/270 degrees followed by an optional horizontal flip (the order
+ * used by the WebCodecs VideoFrame rotation/flip fields).
+ *
+ * Supports planar YUV/RGB, NV12/P010 and packed RGB with 1, 2, 4 or 8 byte
+ * elements. 90/270 degree turns need square chroma subsampling (4:2:0,
+ * 4:4:4), since 4:2:2 would turn into 4:4:0.
+ */
+namespace FrameTransform {
+
+// 0, 90, 180 or 270
+bool isValidRotation(int rotation);
+
+// Whether apply() can handle this frame and orientation
+bool isSupported(const AVFrame* frame, int rotation);
+
+/**
+ * Returns a new frame with the orientation applied, or nullptr if the
+ * format is not supported. A pure vertical flip (180 + flip) is returned as
+ * a zero-copy view with negative line sizes, so a following swscale pass
+ * does the flip for free. Props (pts, color) are copied from src.
+ */
+AVFrame* apply(const AVFrame* src, int rotation, bool flip);
+
+}  // namespace FrameTransform
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * AudioBatchScheduler - encodes many audio sessions on one worker thread
+ * (Non-standard extension)
+ *
+ * Built for servers that run hundreds of small encoders, typically Opus
+ * with 20 ms frames. Encoders configured with a scheduler only queue their
+ * input. Once per tick the worker encodes every queued frame of every
+ * session in one pass and delivers all resulting chunks in a single
+ * callback, instead of one wakeup and one callback per frame per session.
+ *
+ * ```ts
+ * const scheduler = new AudioBatchScheduler({ tickMs: 10 });
+ * encoder.configure({ codec: 'opus', sampleRate: 48000, numberOfChannels: 1, scheduler });
+ * // ... more encoders sharing the scheduler
+ * scheduler.close();
+ * ```
+ */
+
+import { native } from './native';
+import { DOMException } from './types';
+
+export interface AudioBatchSchedulerInit {
+  /**
+   * Interval between worker sweeps in milliseconds (1-1000). Output is
+   * delayed by up to one tick.
+   * @default 10
+   */
+  tickMs?: number;
+}
+
+export interface AudioBatchSchedulerStats {
+  /** Sessions currently open */
+  sessions: number;
+  /** Ticks that had work to do */
+  sweeps: number;
+  /** Chunks encoded so far */
+  chunks: number;
+  /** Time the most recent sweep took, in microseconds */
+  lastSweepUs: number;
+}
+
+/** @internal Receiver of one session's output */
+export interface AudioBatchSession {
+  _onChunk(data: Uint8Array, timestamp: number, duration: number, extradata?: Uint8Array): void;
+  _onError(message: string): void;
+  _onFlushed(): void;
+  /** The worker took `count` queued inputs of the session */
+  _onDequeued(count: number): void;
+  /** The scheduler was closed; the session is gone */
+  _onSchedulerClosed(): void;
+}
+
+interface BatchEntry {
+  session: number;
+  offset?: number;
+  size?: number;
+  timestamp?: number;
+  duration?: number;
+  extradata?: Uint8Array;
+  flushed?: boolean;
+  dequeued?: number;
+  error?: string;
+}
+
+export class AudioBatchScheduler {
+  /** @internal */
+  readonly _native: any;
+  private _sessions: Map<number, AudioBatchSession> = new Map();
+  private _closed: boolean = false;
+
+  constructor(init: AudioBatchSchedulerInit = {}) {
+    if (!native?.AudioBatchSchedulerNative) {
+      throw new DOMException('AudioBatchScheduler requires the native addon', 'NotSupportedError');
+    }
+    try {
+      this._native = new native.AudioBatchSchedulerNative(init, this._onBatch.bind(this));
+    } catch (e) {
+      throw new DOMException((e as Error).message, e instanceof TypeError ? 'TypeError' : 'OperationError');
+    }
+  }
+
+  get stats(): AudioBatchSchedulerStats {
+    return this._native.stats;
+  }
+
+  /**
+   * Stop the worker. Encoders still using the scheduler are closed with an
+   * EncodingError, and their pending flushes are rejected.
+   */
+  close(): void {
+    if (this._closed) return;
+    this._closed = true;
+    this._native.close();
+    const sessions = Array.from(this._sessions.values());
+    this._sessions.clear();
+    for (const session of sessions) {
+      session._onSchedulerClosed();
+    }
+  }
+
+  /** @internal Open an encoder session; throws on an invalid config */
+  _open(params: { codec: string; sampleRate: number; channels: number; bitrate?: number },
+        session: AudioBatchSession): number {
+    if (this._closed) {
+      throw new DOMException('Scheduler is closed', 'InvalidStateError');
+    }
+    const id: number = this._native.open(params);
+    this._sessions.set(id, session);
+    return id;
+  }
+
+  /** @internal Queued output of the session is dropped */
+  _close(id: number): void {
+    if (this._closed || !this._sessions.delete(id)) return;
+    this._native.closeSession(id);
+  }
+
+  private _onBatch(data: Uint8Array, entries: BatchEntry[]): void {
+    for (const entry of entries) {
+      // Sessions closed since the tick are skipped
+      const session = this._sessions.get(entry.session);
+      if (!session) continue;
+
+      if (entry.error !== undefined) {
+        session._onError(entry.error);
+      } else if (entry.flushed) {
+        session._onFlushed();
+      } else if (entry.dequeued !== undefined) {
+        session._onDequeued(entry.dequeued);
+      } else {
+        const offset = entry.offset!;
+        session._onChunk(data.subarray(offset, offset + entry.size!), entry.timestamp!, entry.duration!,
+                         entry.extradata);
+      }
+    }
+  }
+}
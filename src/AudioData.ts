@@ -237,6 +237,15 @@ export class AudioData {
     });
   }
 
+  /**
+   * Get the native audio handle (internal use only)
+   * @internal
+   */
+  _getNative(): any {
+    this._assertNotClosed();
+    return this._native;
+  }
+
   /**
    * Close the audio data and release resources
    */
@@ -6,13 +6,24 @@
 import { AudioData, AudioDataInit, AudioSampleFormat } from './AudioData';
 import { EncodedAudioChunk } from './EncodedAudioChunk';
 import { isAudioCodecSupported, getFFmpegAudioDecoder, parseAacCodecString } from './codec-registry';
-import { CodecState, DOMException, BufferSource } from './types';
+import { CodecState, DOMException, BufferSource, DecoderLimits } from './types';
+import type { LoudnessMeasurement } from './LoudnessMeter';
 
 export interface AudioDecoderConfig {
   codec: string;
   sampleRate: number;
   numberOfChannels: number;
   description?: BufferSource;
+  /**
+   * Meter EBU R128 loudness and true peak of the decoded audio natively
+   * (non-standard). Read the running values from `decoder.loudness`.
+   */
+  loudness?: boolean;
+  /**
+   * maxSamples and maxChunkBytes limits for untrusted input (non-standard).
+   * Violations are reported as QuotaExceededError without closing the decoder.
+   */
+  limits?: DecoderLimits;
 }
 
 export interface AudioDecoderInit {
@@ -36,6 +47,7 @@ export class AudioDecoder {
   private _decodeQueueSize: number = 0;
   private _config: AudioDecoderConfig | null = null;
   private _ondequeue: ((event: Event) => void) | null = null;
+  private _loudness: LoudnessMeasurement | null = null;
 
   static async isConfigSupported(config: AudioDecoderConfig): Promise<AudioDecoderSupport> {
     const supported = isAudioCodecSupported(config.codec);
@@ -61,6 +73,14 @@ export class AudioDecoder {
     }
   }
 
+  /**
+   * Loudness of everything decoded since configure() when configured with
+   * `loudness: true` (non-standard). Final once flush() resolves.
+   */
+  get loudness(): LoudnessMeasurement | null {
+    return this._loudness;
+  }
+
   get state(): CodecState {
     return this._state;
   }
@@ -99,6 +119,8 @@ export class AudioDecoder {
       sampleRate: config.sampleRate,
       channels: config.numberOfChannels,
     };
+    if (config.loudness) codecParams.loudness = true;
+    if (config.limits) codecParams.limits = config.limits;
 
     if (config.description) {
       let desc: Uint8Array;
@@ -116,6 +138,7 @@ export class AudioDecoder {
 
     this._native.configure(codecParams);
     this._config = config;
+    this._loudness = null;
     this._state = 'configured';
   }
 
@@ -182,9 +205,11 @@ export class AudioDecoder {
     sampleRate: number,
     numberOfFrames: number,
     numberOfChannels: number,
-    timestamp: number
+    timestamp: number,
+    loudness?: LoudnessMeasurement
   ): void {
     this._decodeQueueSize = Math.max(0, this._decodeQueueSize - 1);
+    if (loudness) this._loudness = loudness;
     
     // Dispatch dequeue event
     if (this._ondequeue) {
@@ -211,9 +236,9 @@ export class AudioDecoder {
     }
   }
 
-  private _onError(message: string): void {
+  private _onError(message: string, name: string = 'EncodingError'): void {
     try {
-      this._errorCallback(new DOMException(message, 'EncodingError') as any);
+      this._errorCallback(new DOMException(message, name) as any);
     } catch (e) {
       // Don't propagate callback errors
     }
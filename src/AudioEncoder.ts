@@ -7,6 +7,7 @@ import { AudioData } from './AudioData';
 import { EncodedAudioChunk } from './EncodedAudioChunk';
 import { isAudioCodecSupported, getFFmpegAudioCodec } from './codec-registry';
 import { CodecState, DOMException } from './types';
+import { AudioBatchScheduler } from './AudioBatchScheduler';
 
 export type AudioBitrateMode = 'constant' | 'variable';
 
@@ -16,6 +17,11 @@ export interface AudioEncoderConfig {
   numberOfChannels: number;
   bitrate?: number;
   bitrateMode?: AudioBitrateMode;
+  /**
+   * Encode on a shared AudioBatchScheduler worker instead of the JS thread.
+   * Output arrives once per scheduler tick. (Non-standard extension)
+   */
+  scheduler?: AudioBatchScheduler;
 }
 
 export interface AudioEncoderInit {
@@ -50,6 +56,9 @@ export class AudioEncoder {
   private _sentDecoderConfig: boolean = false;
   private _listeners: Map<string, Set<() => void>> = new Map();
   private _ondequeue: ((event: Event) => void) | null = null;
+  private _scheduler: AudioBatchScheduler | null = null;
+  private _sessionId: number = -1;
+  private _pendingFlushes: Array<{ resolve: () => void; reject: (e: DOMException) => void }> = [];
 
   static async isConfigSupported(config: AudioEncoderConfig): Promise<AudioEncoderSupport> {
     const supported = isAudioCodecSupported(config.codec) &&
@@ -179,7 +188,19 @@ export class AudioEncoder {
 
     if (config.bitrate) codecParams.bitrate = config.bitrate;
 
-    this._native.configure(codecParams);
+    this._releaseSession();
+    if (config.scheduler) {
+      this._sessionId = config.scheduler._open(codecParams, {
+        _onChunk: this._onChunk.bind(this),
+        _onError: this._onError.bind(this),
+        _onFlushed: this._onFlushed.bind(this),
+        _onDequeued: this._onDequeued.bind(this),
+        _onSchedulerClosed: this._onSchedulerClosed.bind(this),
+      });
+      this._scheduler = config.scheduler;
+    } else {
+      this._native.configure(codecParams);
+    }
     this._config = config;
     this._state = 'configured';
     this._sentDecoderConfig = false;
@@ -196,6 +217,18 @@ export class AudioEncoder {
     data.copyTo(buffer, { planeIndex: 0 });
 
     this._encodeQueueSize++;
+    if (this._scheduler) {
+      this._scheduler._native.encode(
+        this._sessionId,
+        new Float32Array(buffer),
+        data.format,
+        data.sampleRate,
+        data.numberOfFrames,
+        data.numberOfChannels,
+        data.timestamp
+      );
+      return;
+    }
     this._native.encode(
       new Float32Array(buffer),
       data.format,
@@ -204,6 +237,8 @@ export class AudioEncoder {
       data.numberOfChannels,
       data.timestamp
     );
+    // Encoded synchronously: the input has left the queue, whether or not a chunk came out
+    this._onDequeued(1);
   }
 
   async flush(): Promise<void> {
@@ -211,6 +246,14 @@ export class AudioEncoder {
       throw new DOMException('Encoder is not configured', 'InvalidStateError');
     }
 
+    if (this._scheduler) {
+      const scheduler = this._scheduler;
+      return new Promise((resolve, reject) => {
+        this._pendingFlushes.push({ resolve, reject });
+        scheduler._native.flush(this._sessionId);
+      });
+    }
+
     return new Promise((resolve, reject) => {
       this._native.flush((err: Error | null) => {
         if (err) {
@@ -227,6 +270,7 @@ export class AudioEncoder {
       throw new DOMException('Encoder is closed', 'InvalidStateError');
     }
 
+    this._releaseSession();
     if (this._native) {
       this._native.reset();
     }
@@ -239,6 +283,7 @@ export class AudioEncoder {
   close(): void {
     if (this._state === 'closed') return;
 
+    this._releaseSession();
     if (this._native) {
       this._native.close();
     }
@@ -247,10 +292,45 @@ export class AudioEncoder {
     this._config = null;
   }
 
-  private _onChunk(data: Uint8Array, timestamp: number, duration: number, extradata?: Uint8Array): void {
-    this._encodeQueueSize = Math.max(0, this._encodeQueueSize - 1);
+  private _releaseSession(error: DOMException = new DOMException('Encoder was reset', 'AbortError')): void {
+    if (!this._scheduler) return;
+    this._scheduler._close(this._sessionId);
+    this._scheduler = null;
+    this._sessionId = -1;
+
+    const flushes = this._pendingFlushes;
+    this._pendingFlushes = [];
+    for (const flush of flushes) {
+      flush.reject(error);
+    }
+  }
+
+  /**
+   * The scheduler closed under a configured encoder: the session cannot
+   * encode anymore, so the encoder is closed as on any fatal encoding error
+   */
+  private _onSchedulerClosed(): void {
+    if (this._state === 'closed') return;
+    const error = new DOMException('Scheduler closed', 'EncodingError');
+    this._releaseSession(error);
+    this.close();
+    try {
+      this._errorCallback(error as any);
+    } catch (e) {
+      // Don't propagate callback errors
+    }
+  }
+
+  private _onFlushed(): void {
+    this._pendingFlushes.shift()?.resolve();
+  }
+
+  private _onDequeued(count: number): void {
+    this._encodeQueueSize = Math.max(0, this._encodeQueueSize - count);
     this._dispatchEvent('dequeue');
+  }
 
+  private _onChunk(data: Uint8Array, timestamp: number, duration: number, extradata?: Uint8Array): void {
     const chunk = new EncodedAudioChunk({
       type: 'key',  // Audio frames are typically all keyframes
       timestamp,
@@ -0,0 +1,60 @@
+/**
+ * ColorLUT - 3D color lookup table (.cube) applied natively
+ * (Non-standard extension)
+ *
+ * The table is parsed once and shared by every frame and codec it is
+ * handed to. Loading the same file path twice reuses the parsed table.
+ *
+ * ```ts
+ * const lut = ColorLUT.fromFile('grade.cube');
+ * const graded = frame.applyLUT(lut);
+ * encoder.configure({ ...config, colorLut: lut });
+ * ```
+ */
+
+import { native } from './native';
+import { DOMException } from './types';
+
+export class ColorLUT {
+  /** @internal */
+  readonly _native: any;
+
+  private constructor(nativeLut: any) {
+    this._native = nativeLut;
+  }
+
+  /**
+   * Load a .cube file
+   */
+  static fromFile(path: string): ColorLUT {
+    return ColorLUT._create(path, true);
+  }
+
+  /**
+   * Parse .cube text
+   */
+  static fromCube(text: string): ColorLUT {
+    return ColorLUT._create(text, false);
+  }
+
+  /** Lattice points per axis (LUT_3D_SIZE) */
+  get size(): number {
+    return this._native.size;
+  }
+
+  /** TITLE from the .cube file, or '' */
+  get title(): string {
+    return this._native.title;
+  }
+
+  private static _create(source: string, isFile: boolean): ColorLUT {
+    if (!native?.ColorLutNative) {
+      throw new DOMException('ColorLUT requires the native addon', 'NotSupportedError');
+    }
+    try {
+      return new ColorLUT(new native.ColorLutNative(source, isFile));
+    } catch (e) {
+      throw new DOMException((e as Error).message, 'DataError');
+    }
+  }
+}
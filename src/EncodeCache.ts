@@ -0,0 +1,85 @@
+/**
+ * EncodeCache - content-addressed cache of encoded GOPs
+ * (Non-standard extension)
+ *
+ * An encoder configured with a cache hashes each GOP of input pixels
+ * together with its normalized settings. GOPs seen before are replayed
+ * from the cache instead of being encoded, so re-exporting a mostly
+ * unchanged timeline costs little more than reading the packets. Frames
+ * stream to the encoder unless the GOP starts like a stored one.
+ *
+ * ```ts
+ * const cache = new EncodeCache({ directory: '/var/cache/exports' });
+ * encoder.configure({ ...config, encodeCache: cache });
+ * // ... encode and flush
+ * console.log(cache.stats.hitRate);
+ * ```
+ */
+
+import { native } from './native';
+import { DOMException } from './types';
+
+export interface EncodeCacheInit {
+  /**
+   * In-memory budget for stored packets
+   * @default 268435456 (256 MiB)
+   */
+  maxMemoryBytes?: number;
+  /**
+   * Directory for a persistent store, shared across processes and runs.
+   * Entries stay in memory only when omitted.
+   */
+  directory?: string;
+  /**
+   * On-disk budget; least recently used GOPs are removed beyond it
+   * @default 4294967296 (4 GiB)
+   */
+  maxDiskBytes?: number;
+  /**
+   * Raw frames one encoder may hold back while a GOP could still be a hit;
+   * a larger GOP is encoded instead
+   * @default 134217728 (128 MiB)
+   */
+  maxPendingBytes?: number;
+}
+
+export interface EncodeCacheStats {
+  /** GOPs replayed from the cache */
+  hits: number;
+  /** GOPs that had to be encoded */
+  misses: number;
+  /** hits / (hits + misses), or 0 before the first GOP */
+  hitRate: number;
+  /** Encoded bytes replayed instead of encoded */
+  replayedBytes: number;
+  memoryEntries: number;
+  memoryBytes: number;
+  diskEntries: number;
+  diskBytes: number;
+}
+
+export class EncodeCache {
+  /** @internal */
+  readonly _native: any;
+
+  constructor(init: EncodeCacheInit = {}) {
+    if (!native?.EncodeCacheNative) {
+      throw new DOMException('EncodeCache requires the native addon', 'NotSupportedError');
+    }
+    try {
+      this._native = new native.EncodeCacheNative(init);
+    } catch (e) {
+      throw new DOMException((e as Error).message, e instanceof TypeError ? 'TypeError' : 'OperationError');
+    }
+  }
+
+  /** Hit/miss counters and current store sizes */
+  get stats(): EncodeCacheStats {
+    return this._native.stats;
+  }
+
+  /** Remove every entry, including files in the directory, and reset counters */
+  clear(): void {
+    this._native.clear();
+  }
+}
@@ -194,9 +194,9 @@ export class ImageDecoder {
     try {
       const result = this._native.decode(options?.frameIndex ?? 0);
 
-      // The native decode returns an object with image (native VideoFrameNative) and complete
-      // We need to wrap the native frame in a VideoFrame
-      const videoFrame = new VideoFrame(result.image);
+      // The native decode returns an object with image (native VideoFrameNative) and complete.
+      // The handle is wrapped as is; the VideoFrame constructor only takes pixels or a VideoFrame
+      const videoFrame = VideoFrame._fromNative(result.image, 0);
 
       return {
         image: videoFrame,
@@ -0,0 +1,70 @@
+/**
+ * LoudnessMeter - EBU R128 loudness and true-peak metering in native code
+ * (Non-standard extension)
+ *
+ * Feed AudioData in order and read the running measurement at any time.
+ * AudioDecoder can run the same meter on its output; see the `loudness`
+ * config option.
+ *
+ * ```ts
+ * const meter = new LoudnessMeter({ sampleRate: 48000, numberOfChannels: 2 });
+ * for (const data of audio) meter.push(data);
+ * const { integrated, truePeak } = meter.measure();
+ * ```
+ */
+
+import { native } from './native';
+import { AudioData } from './AudioData';
+import { DOMException } from './types';
+
+export interface LoudnessMeasurement {
+  /** LUFS over the last 400 ms; -Infinity before 400 ms of audio */
+  momentary: number;
+  /** LUFS over the last 3 s; -Infinity before 3 s of audio */
+  shortTerm: number;
+  /** Gated programme loudness in LUFS; -Infinity while everything is gated out */
+  integrated: number;
+  /** Maximum true peak across channels, dBTP */
+  truePeak: number;
+  /** Maximum sample peak across channels, dBFS */
+  samplePeak: number;
+  /** Seconds of audio measured */
+  duration: number;
+}
+
+export interface LoudnessMeterInit {
+  sampleRate: number;
+  numberOfChannels: number;
+}
+
+export class LoudnessMeter {
+  private _native: any;
+
+  constructor(init: LoudnessMeterInit) {
+    if (!native?.LoudnessMeterNative) {
+      throw new DOMException('LoudnessMeter requires the native addon', 'NotSupportedError');
+    }
+    this._native = new native.LoudnessMeterNative(init.sampleRate, init.numberOfChannels);
+  }
+
+  /**
+   * Add audio to the measurement. Sample rate and channel count must match
+   * the meter.
+   */
+  push(data: AudioData): void {
+    const nativeData = data._getNative();
+    if (!nativeData) {
+      throw new DOMException('AudioData is not backed by the native addon', 'NotSupportedError');
+    }
+    this._native.process(nativeData);
+  }
+
+  measure(): LoudnessMeasurement {
+    return this._native.measure();
+  }
+
+  /** Start a new measurement */
+  reset(): void {
+    this._native.reset();
+  }
+}
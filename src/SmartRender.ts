@@ -0,0 +1,283 @@
+/**
+ * smartRender - trim and concatenate encoded video, re-encoding only the
+ * GOPs cut by an edit point (Non-standard extension)
+ *
+ * GOPs that lie entirely inside a kept range are copied byte for byte and
+ * only retimed. A GOP cut by a range boundary is decoded, and its kept
+ * frames are re-encoded on the worker-thread encoder with the source's
+ * codec, profile and level, starting on a keyframe.
+ *
+ * For H.264 and HEVC the re-encoded GOPs carry the encoder's own parameter
+ * sets in band. Copied GOPs that follow one get the source's parameter sets
+ * put back in front of their keyframe. When the source config has a
+ * description, the result's codec string moves to the in-band variant
+ * (avc3 / hev1).
+ *
+ * ```ts
+ * const { chunks, decoderConfig } = await smartRender({
+ *   chunks: sourceChunks,
+ *   decoderConfig: sourceConfig,
+ *   ranges: [{ start: 2_000_000, end: 9_500_000 }, { start: 20_000_000, end: 31_000_000 }],
+ * });
+ * ```
+ */
+
+import { native } from './native';
+import { DOMException } from './types';
+import { EncodedVideoChunk } from './EncodedVideoChunk';
+import { VideoDecoder, VideoDecoderConfig } from './VideoDecoder';
+import { VideoEncoder, VideoEncoderConfig } from './VideoEncoder';
+import { VideoFrame } from './VideoFrame';
+
+export interface SmartRenderRange {
+  /** First kept presentation time, microseconds (inclusive) */
+  start: number;
+  /** End of the kept range, microseconds (exclusive) */
+  end: number;
+}
+
+export interface SmartRenderOptions {
+  /** Source chunks in decode order, starting with a keyframe */
+  chunks: EncodedVideoChunk[];
+  /** Configuration the source chunks decode with */
+  decoderConfig: VideoDecoderConfig;
+  /** Kept ranges, concatenated in this order */
+  ranges: SmartRenderRange[];
+  /**
+   * Overrides for the encoder used on boundary GOPs. By default it matches
+   * the source codec, profile, level and size, at the bitrate of the GOP it
+   * replaces.
+   */
+  encoderConfig?: Partial<VideoEncoderConfig>;
+}
+
+export interface SmartRenderResult {
+  /** Output chunks, retimed to start at 0 */
+  chunks: EncodedVideoChunk[];
+  /**
+   * Decoder configuration for the output: the source's, with an avc3 / hev1
+   * codec string when re-encoded GOPs carry parameter sets in band
+   */
+  decoderConfig: VideoDecoderConfig;
+  copiedGops: number;
+  reencodedGops: number;
+  copiedFrames: number;
+  reencodedFrames: number;
+}
+
+interface PlanSegment {
+  type: 'copy' | 'reencode';
+  first: number;
+  count: number;
+  gops: number;
+  start: number;
+  end: number;
+  shift: number;
+}
+
+interface SourceFormat {
+  /** For H.264, rebuilt from avcC so profile and level match the stream */
+  codec: string;
+  /** Set for length-prefixed (avcC / hvcC) sources */
+  nalLengthSize?: number;
+  /** Source parameter sets in the source framing, to restore after a re-encoded GOP */
+  parameterSets?: Uint8Array;
+}
+
+export async function smartRender(options: SmartRenderOptions): Promise<SmartRenderResult> {
+  if (!native?.SmartRender) {
+    throw new DOMException('smartRender requires the native addon', 'NotSupportedError');
+  }
+
+  const { chunks, decoderConfig, ranges } = options;
+  let plan: PlanSegment[];
+  try {
+    plan = native.SmartRender.plan(
+      chunks.map(c => ({ timestamp: c.timestamp, duration: c.duration ?? 0, key: c.type === 'key' })),
+      ranges
+    );
+  } catch (e) {
+    throw new DOMException((e as Error).message, 'DataError');
+  }
+
+  const format = describeSource(decoderConfig, chunks);
+  const result: SmartRenderResult = {
+    chunks: [],
+    decoderConfig,
+    copiedGops: 0,
+    reencodedGops: 0,
+    copiedFrames: 0,
+    reencodedFrames: 0,
+  };
+
+  let afterReencode = false;
+  for (const segment of plan) {
+    if (segment.type === 'copy') {
+      for (let i = segment.first; i < segment.first + segment.count; i++) {
+        // The decoder still holds the re-encoded GOP's parameter sets
+        const data = i === segment.first && afterReencode && format.parameterSets
+          ? concat(format.parameterSets, chunkBytes(chunks[i]))
+          : undefined;
+        result.chunks.push(retime(chunks[i], chunks[i].timestamp + segment.shift, data));
+      }
+      result.copiedGops += segment.gops;
+      result.copiedFrames += segment.count;
+      afterReencode = false;
+    } else {
+      const encoded = await reencodeSegment(options, format, segment);
+      result.chunks.push(...encoded);
+      result.reencodedGops += segment.gops;
+      result.reencodedFrames += encoded.length;
+      afterReencode = afterReencode || encoded.length > 0;
+    }
+  }
+
+  if (result.reencodedFrames > 0 && format.nalLengthSize) {
+    result.decoderConfig = { ...decoderConfig, codec: inBandCodec(decoderConfig.codec) };
+  }
+  return result;
+}
+
+function inBandCodec(codec: string): string {
+  if (codec.startsWith('avc1')) return 'avc3' + codec.slice(4);
+  if (codec.startsWith('hvc1')) return 'hev1' + codec.slice(4);
+  return codec;
+}
+
+function concat(a: Uint8Array, b: Uint8Array): Uint8Array {
+  const out = new Uint8Array(a.byteLength + b.byteLength);
+  out.set(a, 0);
+  out.set(b, a.byteLength);
+  return out;
+}
+
+function describeSource(config: VideoDecoderConfig, chunks: EncodedVideoChunk[]): SourceFormat {
+  const codec = config.codec;
+  // Only H.264 and HEVC parameter sets can change between GOPs
+  const h26x = /^(avc1|avc3|hvc1|hev1)\./.test(codec);
+  if (!config.description) {
+    // Annex B: the first keyframe carries the parameter sets
+    const parameterSets = h26x && chunks.length > 0
+      ? native.SmartRender.annexBParameterSets(chunkBytes(chunks[0]), codec) ?? undefined
+      : undefined;
+    return { codec, parameterSets };
+  }
+  const description = config.description instanceof ArrayBuffer
+    ? new Uint8Array(config.description)
+    : new Uint8Array(
+        (config.description as ArrayBufferView).buffer,
+        (config.description as ArrayBufferView).byteOffset,
+        (config.description as ArrayBufferView).byteLength
+      );
+  if (!h26x) {
+    return { codec };
+  }
+  const parsed = native.SmartRender.parseDecoderConfig(description, codec);
+  if (!parsed) {
+    return { codec };
+  }
+  return {
+    codec: parsed.codec ?? codec,
+    nalLengthSize: parsed.nalLengthSize,
+    parameterSets: parsed.parameterSets.byteLength > 0 ? new Uint8Array(parsed.parameterSets) : undefined,
+  };
+}
+
+function chunkBytes(chunk: EncodedVideoChunk): Uint8Array {
+  const data = new Uint8Array(chunk.byteLength);
+  chunk.copyTo(data);
+  return data;
+}
+
+function retime(chunk: EncodedVideoChunk, timestamp: number, data?: Uint8Array): EncodedVideoChunk {
+  return new EncodedVideoChunk({
+    type: chunk.type,
+    timestamp,
+    duration: chunk.duration ?? undefined,
+    data: data ?? chunkBytes(chunk),
+  });
+}
+
+async function reencodeSegment(
+  options: SmartRenderOptions,
+  format: SourceFormat,
+  segment: PlanSegment
+): Promise<EncodedVideoChunk[]> {
+  const source = options.chunks.slice(segment.first, segment.first + segment.count);
+
+  // Decode the whole GOP, keep the frames inside the range
+  const frames: VideoFrame[] = [];
+  let failure: DOMException | null = null;
+  const decoder = new VideoDecoder({
+    output: frame => {
+      if (frame.timestamp >= segment.start && frame.timestamp < segment.end) {
+        frames.push(frame);
+      } else {
+        frame.close();
+      }
+    },
+    error: e => { failure = e; },
+  });
+  decoder.configure(options.decoderConfig);
+  for (const chunk of source) {
+    decoder.decode(chunk);
+  }
+  await decoder.flush();
+  decoder.close();
+  if (failure) {
+    frames.forEach(f => f.close());
+    throw failure;
+  }
+  if (frames.length === 0) {
+    return [];
+  }
+  frames.sort((a, b) => a.timestamp - b.timestamp);
+
+  // Match the GOP being replaced: same size, frame rate and bitrate
+  const spanSeconds = Math.max(
+    source.reduce((end, c) => Math.max(end, c.timestamp + (c.duration ?? 0)), 0) -
+      Math.min(...source.map(c => c.timestamp)),
+    1
+  ) / 1e6;
+  const sourceBytes = source.reduce((sum, c) => sum + c.byteLength, 0);
+  const frameDuration = frames.length > 1
+    ? (frames[frames.length - 1].timestamp - frames[0].timestamp) / (frames.length - 1)
+    : (frames[0].duration ?? 33333);
+
+  const encoded: EncodedVideoChunk[] = [];
+  const encoder = new VideoEncoder({
+    output: chunk => { encoded.push(chunk); },
+    error: e => { failure = e; },
+  });
+  encoder.configure({
+    codec: format.codec,
+    width: frames[0].displayWidth,
+    height: frames[0].displayHeight,
+    framerate: Math.max(1, Math.round(1e6 / Math.max(frameDuration, 1))),
+    bitrate: Math.max(100_000, Math.round((sourceBytes * 8) / spanSeconds)),
+    latencyMode: 'quality',
+    ...options.encoderConfig,
+    // Annex B, so the framing of the encoder output is known below
+    ...(format.codec.startsWith('avc') ? { avc: { ...options.encoderConfig?.avc, format: 'annexb' as const } } : {}),
+    useWorkerThread: true,
+  });
+
+  frames.forEach((frame, i) => {
+    encoder.encode(frame, { keyFrame: i === 0 });
+    frame.close();
+  });
+  await encoder.flush();
+  encoder.close();
+  if (failure) {
+    throw failure;
+  }
+
+  // Length-prefixed sources get length-prefixed NAL units; parameter sets stay in band.
+  // The encoder always writes Annex B (see configure above).
+  return encoded.map(chunk => {
+    const data = format.nalLengthSize
+      ? new Uint8Array(native.SmartRender.toLengthPrefixed(chunkBytes(chunk), format.nalLengthSize))
+      : undefined;
+    return retime(chunk, chunk.timestamp + segment.shift, data);
+  });
+}
@@ -3,10 +3,17 @@
  * Implements the W3C WebCodecs VideoDecoder interface
  */
 
-import { VideoFrame, VideoFrameBufferInit } from './VideoFrame';
+import {
+  VideoFrame,
+  VideoPixelFormat,
+  VideoFrameAnalysis,
+  VideoFrameAnalysisOptions,
+  VideoFrameMetadata,
+} from './VideoFrame';
+import { ColorLUT } from './ColorLUT';
 import { EncodedVideoChunk } from './EncodedVideoChunk';
 import { isVideoCodecSupported, getFFmpegVideoDecoder, parseAvcCodecString } from './codec-registry';
-import { CodecState, DOMException, BufferSource } from './types';
+import { CodecState, DOMException, BufferSource, PullModeOptions, DecoderLimits } from './types';
 
 export interface VideoDecoderConfig {
   codec: string;
@@ -28,11 +35,67 @@ export interface VideoDecoderConfig {
    * Set to false to use synchronous decoder (blocks event loop during decoding).
    */
   useWorkerThread?: boolean;
+  /**
+   * Extra outputs produced on the worker thread from each decoded frame
+   * (non-standard, requires the worker-thread decoder). Delivered to the
+   * `rendition` callback together with the index of the spec.
+   */
+  renditions?: VideoDecoderRendition[];
+  /**
+   * Buffer decoded frames natively and drain them with `takeOutputs()` or
+   * `for await (const frame of decoder)` instead of the output callback
+   * (non-standard, requires the worker-thread decoder).
+   */
+  pullMode?: PullModeOptions;
+  /**
+   * 3D LUT applied natively to every decoded frame, before renditions
+   * (non-standard). Frames keep their decoded pixel format.
+   */
+  colorLut?: ColorLUT;
+  /**
+   * Compute luma statistics for every decoded frame natively (non-standard).
+   * Results are in `frame.metadata().analysis`, with `diff` measured
+   * against the previous output frame.
+   */
+  analysis?: boolean | VideoFrameAnalysisOptions;
+  /**
+   * The stream is intra-only (every chunk a keyframe), as produced by an
+   * encoder configured with `intraOnly` (non-standard). Frames are decoded
+   * on parallel frame threads; with optimizeForLatency, slice threads keep
+   * single-frame seeks immediate instead. Delta chunks are rejected.
+   */
+  intraOnly?: boolean;
+  /**
+   * Size and time limits for untrusted input (non-standard). Violations are
+   * reported as QuotaExceededError without closing the decoder.
+   */
+  limits?: DecoderLimits;
+}
+
+export interface VideoDecoderRendition {
+  /** Pixel format of the rendition. Defaults to the decoded format. */
+  format?: VideoPixelFormat;
+  /** Output size. Defaults to the decoded size. */
+  width?: number;
+  height?: number;
+  /** Produce on every Nth decoded frame. Defaults to 1. */
+  every?: number;
+}
+
+export interface VideoDecoderDecodeOptions {
+  /**
+   * Caller tag carried natively through decoder reordering and returned as
+   * `frame.metadata().userData` on the frame this chunk produces
+   * (non-standard). Use it to index per-chunk metadata kept by the caller.
+   */
+  userData?: number;
 }
 
 export interface VideoDecoderInit {
   output: (frame: VideoFrame) => void;
   error: (error: DOMException) => void;
+  /** Receives the frames requested via `config.renditions` */
+  rendition?: (frame: VideoFrame, index: number) => void;
 }
 
 export interface VideoDecoderSupport {
@@ -48,12 +111,18 @@ export class VideoDecoder {
   private _state: CodecState = 'unconfigured';
   private _outputCallback: (frame: VideoFrame) => void;
   private _errorCallback: (error: DOMException) => void;
+  private _renditionCallback: ((frame: VideoFrame, index: number) => void) | null;
   private _decodeQueueSize: number = 0;
   private _config: VideoDecoderConfig | null = null;
   private _listeners: Map<string, Set<() => void>> = new Map();
   private _useAsync: boolean = true;
   private _nativeCreated: boolean = false;
   private _ondequeue: ((event: Event) => void) | null = null;
+  private _belowHighWater: boolean = true;
+  private _pullMode: boolean = false;
+  private _pullDrained: boolean = false;  // flush() finished and nothing was submitted since
+  private _submitted: number = 0;
+  private _readableWaiters: Array<() => void> = [];
 
   static async isConfigSupported(config: VideoDecoderConfig): Promise<VideoDecoderSupport> {
     // Basic validation first
@@ -100,6 +169,7 @@ export class VideoDecoder {
 
     this._outputCallback = init.output;
     this._errorCallback = init.error;
+    this._renditionCallback = init.rendition ?? null;
 
     // Defer native creation to configure() so we know whether to use async or sync
   }
@@ -112,6 +182,15 @@ export class VideoDecoder {
     return this._decodeQueueSize;
   }
 
+  /**
+   * Number of chunks the decoder held back before emitting the most recent
+   * frame (non-standard). With optimizeForLatency this is normally 0 for
+   * streams without B-frames.
+   */
+  get decoderDelay(): number {
+    return this._native?.decoderDelay ?? 0;
+  }
+
   /**
    * Event handler for dequeue events
    */
@@ -198,6 +277,10 @@ export class VideoDecoder {
     // Default to async unless explicitly disabled
     this._useAsync = config.useWorkerThread !== false && !!native.VideoDecoderAsync;
 
+    if (config.renditions?.length && !this._useAsync) {
+      throw new DOMException('renditions require the worker-thread decoder', 'NotSupportedError');
+    }
+
     // Create native decoder if not already created
     if (!this._nativeCreated) {
       if (this._useAsync) {
@@ -228,6 +311,13 @@ export class VideoDecoder {
 
     if (config.codedWidth) codecParams.width = config.codedWidth;
     if (config.codedHeight) codecParams.height = config.codedHeight;
+    if (config.optimizeForLatency) codecParams.optimizeForLatency = true;
+    if (config.intraOnly) codecParams.intraOnly = true;
+    if (config.limits) codecParams.limits = config.limits;
+    // Renditions nobody receives would cost a scaling pass per frame
+    if (config.renditions?.length && this._renditionCallback) codecParams.renditions = config.renditions;
+    if (config.colorLut) codecParams.colorLut = config.colorLut._native;
+    if (config.analysis) codecParams.analysis = config.analysis;
 
     if (config.description) {
       // Convert BufferSource to Buffer
@@ -244,26 +334,142 @@ export class VideoDecoder {
       codecParams.extradata = Buffer.from(desc);
     }
 
+    // Leaving pull mode must reach the native buffer too, or outputs keep being parked there
+    const wasPullMode = this._pullMode;
+    this._pullMode = false;
+    this._pullDrained = false;
+    if (!config.pullMode && wasPullMode) {
+      this._native.setPullMode(false);
+      this._wakeReaders();
+    }
+    if (config.pullMode) {
+      if (!this._native.setPullMode) {
+        throw new DOMException('pullMode requires the worker-thread decoder', 'NotSupportedError');
+      }
+      this._native.setPullMode(
+        config.pullMode.capacity ?? 16,
+        config.pullMode.policy ?? 'block',
+        () => this._wakeReaders()
+      );
+      this._pullMode = true;
+    }
+
     this._native.configure(codecParams);
+    // Chunks queued before a reconfigure are dropped without output
+    this._decodeQueueSize = 0;
     this._config = config;
     this._state = 'configured';
   }
 
-  decode(chunk: EncodedVideoChunk): void {
+  decode(chunk: EncodedVideoChunk, options?: VideoDecoderDecodeOptions): void {
     if (this._state !== 'configured') {
       throw new DOMException('Decoder is not configured', 'InvalidStateError');
     }
 
+    if (this._config?.intraOnly && chunk.type !== 'key') {
+      throw new DOMException('intraOnly decoder received a delta chunk', 'DataError');
+    }
+    const userData = options?.userData;
+    if (userData !== undefined && !Number.isFinite(userData)) {
+      throw new TypeError('userData must be a finite number');
+    }
+
     const data = new Uint8Array(chunk.byteLength);
     chunk.copyTo(data);
 
     this._decodeQueueSize++;
-    this._native.decode(
+    this._submitted++;
+    this._pullDrained = false;
+    // The worker-thread decoder reports false once its queue hits the high-water mark
+    this._belowHighWater = this._native.decode(
       Buffer.from(data),
       chunk.type === 'key',
       chunk.timestamp,
-      chunk.duration ?? 0
-    );
+      chunk.duration ?? 0,
+      userData
+    ) !== false;
+  }
+
+  /**
+   * Signal native job-queue pressure to a producer (non-standard, used by the
+   * stream wrappers). `onResume` is called from the worker once the queue has
+   * drained to `lowWaterMark` after a decode() reached `highWaterMark`.
+   *
+   * @returns false if the synchronous decoder is in use
+   * @internal
+   */
+  _setBackpressure(highWaterMark: number, lowWaterMark: number, onResume: () => void): boolean {
+    if (!this._native?.setBackpressure) return false;
+    this._native.setBackpressure(highWaterMark, lowWaterMark, onResume);
+    return true;
+  }
+
+  /**
+   * Whether the last decode() left the native queue below its high-water mark
+   * @internal
+   */
+  _isBelowHighWater(): boolean {
+    return this._belowHighWater;
+  }
+
+  /**
+   * Drain buffered frames in pull mode (non-standard). Returns up to `max`
+   * frames in output order; renditions are passed to the rendition callback.
+   * With the 'block' policy the worker waits while the native buffer is full.
+   */
+  takeOutputs(max?: number): VideoFrame[] {
+    if (!this._pullMode) {
+      throw new DOMException('Decoder is not in pull mode', 'InvalidStateError');
+    }
+
+    const batch: any[] = this._native.takeOutputs(max);
+    if (batch.length > 0) {
+      this._decodeQueueSize = Math.max(0, this._decodeQueueSize - batch.length);
+      this._dispatchEvent('dequeue');
+    }
+
+    const frames: VideoFrame[] = [];
+    for (const out of batch) {
+      frames.push(this._wrapFrame(out.frame, out.timestamp, out.duration, out.analysis, out.userData));
+      this._emitRenditions(out.renditions, out.timestamp, out.duration);
+    }
+    return frames;
+  }
+
+  /**
+   * Number of frames discarded by a drop policy since pull mode was enabled
+   */
+  get droppedOutputs(): number {
+    return this._pullMode ? this._native.droppedOutputs : 0;
+  }
+
+  /**
+   * Iterate over decoded frames in pull mode. Ends once everything
+   * submitted before flush() has been read, or on reset() or close().
+   */
+  async *[Symbol.asyncIterator](): AsyncIterableIterator<VideoFrame> {
+    while (true) {
+      if (this._state === 'closed' || !this._pullMode) return;
+
+      const batch = this.takeOutputs(16);
+      for (const frame of batch) {
+        yield frame;
+      }
+
+      if (batch.length === 0) {
+        // Everything up to the last flush() has been read, or reset() dropped it
+        if (this._pullDrained || this._state !== 'configured') return;
+        await new Promise<void>((resolve) => this._readableWaiters.push(resolve));
+      }
+    }
+  }
+
+  private _wakeReaders(): void {
+    const waiters = this._readableWaiters;
+    this._readableWaiters = [];
+    for (const resolve of waiters) {
+      resolve();
+    }
   }
 
   async flush(): Promise<void> {
@@ -271,11 +477,16 @@ export class VideoDecoder {
       throw new DOMException('Decoder is not configured', 'InvalidStateError');
     }
 
+    const submitted = this._submitted;
     return new Promise((resolve, reject) => {
       this._native.flush((err: Error | null) => {
         if (err) {
-          reject(new DOMException(err.message, 'EncodingError'));
+          reject(new DOMException(err.message, err.name === 'AbortError' ? 'AbortError' : 'EncodingError'));
         } else {
+          if (this._pullMode && this._submitted === submitted) {
+            this._pullDrained = true;
+            this._wakeReaders();
+          }
           resolve();
         }
       });
@@ -292,6 +503,7 @@ export class VideoDecoder {
     }
     this._decodeQueueSize = 0;
     this._state = 'unconfigured';
+    this._wakeReaders();
     this._config = null;
   }
 
@@ -304,42 +516,69 @@ export class VideoDecoder {
     this._state = 'closed';
     this._decodeQueueSize = 0;
     this._config = null;
+    this._wakeReaders();
   }
 
-  private _onFrame(nativeFrame: any, timestamp: number, duration: number): void {
+  private _onFrame(
+    nativeFrame: any,
+    timestamp: number,
+    duration: number,
+    userData?: number,
+    renditions?: Array<{ index: number; frame: any }>,
+    analysis?: VideoFrameAnalysis
+  ): void {
     this._decodeQueueSize = Math.max(0, this._decodeQueueSize - 1);
     this._dispatchEvent('dequeue');
 
     try {
-      // Get frame info from native
-      const width = nativeFrame.width;
-      const height = nativeFrame.height;
-      const format = nativeFrame.format || 'I420';
-
-      // Get the data from the native frame
-      const size = nativeFrame.allocationSize();
-      const buffer = Buffer.alloc(size);
-      nativeFrame.copyTo(buffer);
-
-      // Create VideoFrame
-      const frame = new VideoFrame(buffer, {
-        format: format,
-        codedWidth: width,
-        codedHeight: height,
-        timestamp: timestamp,
-        duration: duration > 0 ? duration : undefined,
-      } as VideoFrameBufferInit);
-
-      this._outputCallback(frame);
+      this._outputCallback(this._wrapFrame(nativeFrame, timestamp, duration, analysis, userData));
     } catch (e) {
       // Don't propagate callback errors, but report as error
       console.error('VideoDecoder output callback error:', e);
     }
+
+    this._emitRenditions(renditions, timestamp, duration);
+  }
+
+  private _emitRenditions(
+    renditions: Array<{ index: number; frame: any }> | undefined,
+    timestamp: number,
+    duration: number
+  ): void {
+    if (!renditions || !this._renditionCallback) return;
+
+    for (const rendition of renditions) {
+      try {
+        this._renditionCallback(this._wrapFrame(rendition.frame, timestamp, duration), rendition.index);
+      } catch (e) {
+        console.error('VideoDecoder rendition callback error:', e);
+      }
+    }
+  }
+
+  private _wrapFrame(
+    nativeFrame: any,
+    timestamp: number,
+    duration: number,
+    analysis?: VideoFrameAnalysis,
+    userData?: number
+  ): VideoFrame {
+    const metadata: VideoFrameMetadata = {};
+    if (analysis) metadata.analysis = analysis;
+    if (userData !== undefined) metadata.userData = userData;
+
+    // Adopt the decoder's frame instead of copying it out and back in
+    return VideoFrame._fromNative(
+      nativeFrame,
+      timestamp,
+      duration > 0 ? duration : undefined,
+      metadata
+    );
   }
 
-  private _onError(message: string): void {
+  private _onError(message: string, name: string = 'EncodingError'): void {
     try {
-      this._errorCallback(new DOMException(message, 'EncodingError') as any);
+      this._errorCallback(new DOMException(message, name) as any);
     } catch (e) {
       // Don't propagate callback errors
     }
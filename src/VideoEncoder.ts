@@ -3,11 +3,13 @@
  * Implements the W3C WebCodecs VideoEncoder interface
  */
 
-import { VideoFrame } from './VideoFrame';
+import { VideoFrame, parseRotation, combineOrientation } from './VideoFrame';
 import { EncodedVideoChunk, EncodedVideoChunkType } from './EncodedVideoChunk';
 import { isVideoCodecSupported, getFFmpegVideoCodec, parseAvcCodecString } from './codec-registry';
-import { CodecState, DOMException } from './types';
+import { CodecState, DOMException, PullModeOptions, ToneMappingCurve } from './types';
 import { VideoColorSpaceInit } from './VideoColorSpace';
+import { ColorLUT } from './ColorLUT';
+import { EncodeCache } from './EncodeCache';
 
 /**
  * Encoder latency mode
@@ -15,6 +17,7 @@ import { VideoColorSpaceInit } from './VideoColorSpace';
  * - `realtime`: Optimize for encoding speed (lower latency)
  */
 export type LatencyMode = 'quality' | 'realtime';
+export type VideoEncoderContentHint = '' | 'motion' | 'detail' | 'text';
 
 /**
  * Bitrate control mode
@@ -117,11 +120,77 @@ export interface VideoEncoderConfig {
    */
   latencyMode?: LatencyMode;
 
+  /**
+   * Kind of content being encoded. 'text' (screen share, slides) turns on
+   * screen-content tools: x264 stillimage tune, x265 animation tune, VP8
+   * screen content mode, VP9/libaom screen content tune with palette and
+   * intra block copy, SVT-AV1 scm. 'detail' uses slower presets to keep
+   * sharpness. 'motion' or '' keeps the camera-oriented defaults.
+   * @see https://w3c.github.io/webcodecs/#dom-videoencoderconfig-contenthint
+   */
+  contentHint?: VideoEncoderContentHint;
+
   /**
    * Color space metadata (primaries, transfer, matrix)
    */
   colorSpace?: VideoColorSpaceInit;
 
+  /**
+   * Tone map PQ/HLG input frames to SDR BT.709 before encoding.
+   * Output is tagged BT.709 unless colorSpace is given. (Non-standard extension)
+   */
+  toneMapping?: ToneMappingCurve;
+
+  /**
+   * Mastering peak luminance in cd/m2 used by toneMapping
+   * @default 1000
+   */
+  hdrPeakLuminance?: number;
+
+  /**
+   * Clockwise rotation (multiple of 90) applied natively to every input
+   * frame, on top of the frame's own rotation/flip. Set width/height to the
+   * rotated size. (Non-standard extension)
+   */
+  rotation?: number;
+
+  /**
+   * Horizontal flip applied after rotation. (Non-standard extension)
+   */
+  flip?: boolean;
+
+  /**
+   * Intra-only (mezzanine) encoding for editing proxies: every frame is a
+   * keyframe, with slice-threaded encoding and no lookahead, so any frame
+   * decodes on its own. The decoderConfig in the output metadata carries
+   * `intraOnly: true` for the decoder fast path. (Non-standard extension)
+   */
+  intraOnly?: boolean;
+
+  /**
+   * Convert the input to `framerate` natively: frames are mapped onto the
+   * output grid by timestamp and get grid timestamps. `'drop'` keeps the
+   * first frame of each output interval and `'blend'` averages them (one
+   * frame of delay). Intervals with no input repeat the previous frame.
+   * Dropped frames are discarded before they are copied or converted.
+   * Requires the worker-thread encoder. (Non-standard extension)
+   */
+  frameRateConversion?: 'drop' | 'blend';
+
+  /**
+   * 3D LUT applied natively to every input frame before it is converted
+   * for the encoder. (Non-standard extension)
+   */
+  colorLut?: ColorLUT;
+
+  /**
+   * Replay previously encoded GOPs whose input pixels and settings match,
+   * instead of encoding them again. GOPs end at forced keyframes and every
+   * `framerate` frames. Requires the worker-thread encoder and
+   * `latencyMode: 'quality'`. (Non-standard extension)
+   */
+  encodeCache?: EncodeCache;
+
   /**
    * H.264/AVC specific options
    */
@@ -141,6 +210,67 @@ export interface VideoEncoderConfig {
    * @default true
    */
   useWorkerThread?: boolean;
+
+  /**
+   * Buffer encoded chunks natively and drain them with `takeOutputs()` or
+   * `for await (const { chunk } of encoder)` instead of the output callback.
+   * Requires the worker-thread encoder.
+   */
+  pullMode?: PullModeOptions;
+
+  /**
+   * Keep the encoded chunks since the last keyframe natively, bounded in
+   * bytes, so a viewer joining a live stream mid-GOP can fetch them with
+   * `getLiveGop()` instead of waiting for, or forcing, a keyframe.
+   * Turns off libx264's realtime intra refresh, which would leave the stream
+   * without keyframes after the first. Requires the worker-thread encoder.
+   * (Non-standard extension)
+   */
+  liveGopCache?: {
+    /** @default 8 MiB */
+    maxBytes?: number;
+  };
+
+  /**
+   * Report where each chunk's latency went in `metadata.stageTimings`.
+   * In pull mode, delivery lasts until `takeOutputs()` returns the chunk.
+   * Requires the worker-thread encoder. (Non-standard extension)
+   */
+  stageTimings?: boolean;
+}
+
+/**
+ * Per-chunk latency breakdown, in microseconds (Non-standard extension)
+ */
+export interface VideoEncoderStageTimings {
+  /** encode() until the worker picked the frame up */
+  queueUs: number;
+  /** Orientation, tone mapping, LUT and pixel format conversion */
+  convertUs: number;
+  /** Frame sent to the codec until its packet came out */
+  encodeUs: number;
+  /** Packet out until the output callback ran, or takeOutputs() in pull mode */
+  deliveryUs: number;
+}
+
+/**
+ * An encoded chunk drained in pull mode
+ */
+export interface VideoEncoderPulledOutput {
+  chunk: EncodedVideoChunk;
+  metadata?: VideoEncoderOutputMetadata;
+}
+
+/**
+ * The GOP in progress, for a viewer joining a live stream (Non-standard extension)
+ */
+export interface VideoEncoderLiveGop {
+  /** Configuration for the new viewer's decoder, with the current description */
+  decoderConfig: NonNullable<VideoEncoderOutputMetadata['decoderConfig']>;
+  /** The keyframe, then every chunk encoded after it */
+  chunks: EncodedVideoChunk[];
+  /** Total payload bytes of `chunks` */
+  byteLength: number;
 }
 
 /**
@@ -180,6 +310,8 @@ export interface VideoEncoderOutputMetadata {
     codedHeight: number;
     /** Codec-specific extradata (e.g., H.264 SPS/PPS, VP9 CodecPrivate) */
     description?: ArrayBuffer;
+    /** Set for intra-only streams (Non-standard extension) */
+    intraOnly?: boolean;
   };
 
   /**
@@ -189,6 +321,16 @@ export interface VideoEncoderOutputMetadata {
     /** Temporal layer ID (0 = base layer) */
     temporalLayerId: number;
   };
+
+  /**
+   * Quantizer the encoder reports for this chunk, on the codec's own scale
+   * (0-51 for H.264/HEVC). Present when the encoder exports quality stats.
+   * (Non-standard extension)
+   */
+  qp?: number;
+
+  /** Set when the encoder was configured with `stageTimings` (Non-standard extension) */
+  stageTimings?: VideoEncoderStageTimings;
 }
 
 /**
@@ -207,6 +349,67 @@ export interface VideoEncoderEncodeOptions {
    * ```
    */
   keyFrame?: boolean;
+
+  /**
+   * Regions that get more or fewer bits in this frame, in encoded picture
+   * coordinates. Where regions overlap, the first listed wins. Applied by
+   * libx264, libx265 and libvpx on the worker-thread encoder and ignored
+   * by other encoders. x264 and x265 apply them through adaptive
+   * quantization, so they are also ignored with bitrateMode 'quantizer'.
+   * (Non-standard extension)
+   * @example
+   * ```ts
+   * encoder.encode(frame, {
+   *   roi: [
+   *     { x: 800, y: 200, width: 320, height: 400, qualityOffset: 0.3 },  // face
+   *     { x: 0, y: 0, width: 1920, height: 1080, qualityOffset: -0.3 },   // background
+   *   ],
+   * });
+   * ```
+   */
+  roi?: VideoEncoderRegionOfInterest[];
+
+  /**
+   * Per-frame quantizer for the codec being encoded, used when the encoder
+   * is configured with bitrateMode 'quantizer'. Options for other codecs
+   * are ignored. libvpx and libaom do not take a per-frame quantizer, so
+   * a vp9 or av1 quantizer throws NotSupportedError.
+   * @see https://w3c.github.io/webcodecs/avc_codec_registration.html#avc-encode-options
+   */
+  avc?: VideoEncoderEncodeOptionsForQuantizer;
+  hevc?: VideoEncoderEncodeOptionsForQuantizer;
+  vp9?: VideoEncoderEncodeOptionsForQuantizer;
+  av1?: VideoEncoderEncodeOptionsForQuantizer;
+}
+
+/**
+ * Codec-specific per-frame options (VideoEncoderEncodeOptionsForAvc and friends)
+ */
+export interface VideoEncoderEncodeOptionsForQuantizer {
+  /**
+   * 0-51 for AVC and HEVC; not supported for VP9 and AV1. With libx264 the
+   * value is exact per frame in realtime mode; with lookahead it applies
+   * from the frame that leaves the lookahead. Frames without one use QP 23.
+   * Read the value actually used from metadata.qp.
+   */
+  quantizer?: number;
+}
+
+/**
+ * A rectangle with a quality offset for region-of-interest encoding
+ * (Non-standard extension)
+ */
+export interface VideoEncoderRegionOfInterest {
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+  /**
+   * -1 to 1: positive spends more bits on the region, negative fewer.
+   * Scaled by each encoder onto its quantizer range.
+   * @default 0
+   */
+  qualityOffset?: number;
 }
 
 /**
@@ -287,11 +490,17 @@ export class VideoEncoder {
   private _errorCallback: (error: DOMException) => void;
   private _encodeQueueSize: number = 0;
   private _config: VideoEncoderConfig | null = null;
+  private _rotation: number = 0;
   private _sentDecoderConfig: boolean = false;
   private _listeners: Map<string, Set<() => void>> = new Map();
   private _useAsync: boolean = true;
   private _nativeCreated: boolean = false;
   private _ondequeue: ((event: Event) => void) | null = null;
+  private _belowHighWater: boolean = true;
+  private _pullMode: boolean = false;
+  private _pullDrained: boolean = false;  // flush() finished and nothing was submitted since
+  private _submitted: number = 0;
+  private _readableWaiters: Array<() => void> = [];
 
   /**
    * Check if a VideoEncoder configuration is supported
@@ -534,7 +743,9 @@ export class VideoEncoder {
    * Configure the encoder with codec parameters
    *
    * Must be called before encoding frames. Can be called multiple times to
-   * reconfigure (e.g., to change bitrate or resolution).
+   * reconfigure (e.g., to change bitrate or resolution). Frames still queued
+   * are dropped and a pending flush() rejects with AbortError, so flush()
+   * first to keep them.
    *
    * @param config - Encoder configuration
    * @throws DOMException if encoder is closed
@@ -598,6 +809,14 @@ export class VideoEncoder {
       );
     }
 
+    // Validate contentHint
+    if (config.contentHint && !['motion', 'detail', 'text'].includes(config.contentHint)) {
+      throw new DOMException(
+        `Invalid contentHint: ${config.contentHint}. Must be 'motion', 'detail', or 'text'.`,
+        'TypeError'
+      );
+    }
+
     // Validate bitrateMode
     if (config.bitrateMode && !['constant', 'variable', 'quantizer'].includes(config.bitrateMode)) {
       throw new DOMException(
@@ -606,6 +825,9 @@ export class VideoEncoder {
       );
     }
 
+    // Orientation pre-stage (throws TypeError for non-numeric rotation)
+    this._rotation = parseRotation(config.rotation);
+
     if (!native) {
       throw new DOMException('Native addon not available', 'NotSupportedError');
     }
@@ -651,12 +873,80 @@ export class VideoEncoder {
     if (config.framerate) codecParams.framerate = config.framerate;
     if (config.bitrateMode) codecParams.bitrateMode = config.bitrateMode;
     if (config.latencyMode) codecParams.latencyMode = config.latencyMode;
+    if (config.contentHint) codecParams.contentHint = config.contentHint;
+    if (config.intraOnly) codecParams.intraOnly = true;
     if (config.colorSpace) codecParams.colorSpace = config.colorSpace;
     if (config.hardwareAcceleration) codecParams.hardwareAcceleration = config.hardwareAcceleration;
     if (config.alpha) codecParams.alpha = config.alpha;
     if (config.scalabilityMode) codecParams.scalabilityMode = config.scalabilityMode;
+    if (config.toneMapping) codecParams.toneMapping = config.toneMapping;
+    if (config.hdrPeakLuminance) codecParams.hdrPeakLuminance = config.hdrPeakLuminance;
+    if (config.colorLut) codecParams.colorLut = config.colorLut._native;
+
+    if (config.encodeCache) {
+      if (!this._useAsync) {
+        throw new DOMException('encodeCache requires the worker-thread encoder', 'NotSupportedError');
+      }
+      if (config.latencyMode === 'realtime') {
+        throw new DOMException("encodeCache requires latencyMode 'quality'", 'NotSupportedError');
+      }
+      codecParams.encodeCache = config.encodeCache._native;
+    }
+
+    if (config.frameRateConversion) {
+      if (!this._useAsync) {
+        throw new DOMException('frameRateConversion requires the worker-thread encoder', 'NotSupportedError');
+      }
+      if (config.frameRateConversion !== 'drop' && config.frameRateConversion !== 'blend') {
+        throw new DOMException(`Unknown frameRateConversion: ${config.frameRateConversion}`, 'TypeError');
+      }
+      if (!config.framerate) {
+        throw new DOMException('frameRateConversion requires framerate', 'TypeError');
+      }
+      codecParams.frameRateConversion = config.frameRateConversion;
+    }
+
+    if (config.liveGopCache) {
+      if (!this._useAsync) {
+        throw new DOMException('liveGopCache requires the worker-thread encoder', 'NotSupportedError');
+      }
+      const maxBytes = config.liveGopCache.maxBytes ?? 8 * 1024 * 1024;
+      if (!(maxBytes > 0)) {
+        throw new DOMException('liveGopCache.maxBytes must be positive', 'TypeError');
+      }
+      codecParams.liveGopCacheBytes = maxBytes;
+    }
+
+    if (config.stageTimings) {
+      if (!this._useAsync) {
+        throw new DOMException('stageTimings requires the worker-thread encoder', 'NotSupportedError');
+      }
+      codecParams.stageTimings = true;
+    }
+
+    // Leaving pull mode must reach the native buffer too, or outputs keep being parked there
+    const wasPullMode = this._pullMode;
+    this._pullMode = false;
+    this._pullDrained = false;
+    if (!config.pullMode && wasPullMode) {
+      this._native.setPullMode(false);
+      this._wakeReaders();
+    }
+    if (config.pullMode) {
+      if (!this._native.setPullMode) {
+        throw new DOMException('pullMode requires the worker-thread encoder', 'NotSupportedError');
+      }
+      this._native.setPullMode(
+        config.pullMode.capacity ?? 16,
+        config.pullMode.policy ?? 'block',
+        () => this._wakeReaders()
+      );
+      this._pullMode = true;
+    }
 
     this._native.configure(codecParams);
+    // Frames queued before a reconfigure are dropped without output
+    this._encodeQueueSize = 0;
     this._config = config;
     this._state = 'configured';
     this._sentDecoderConfig = false;
@@ -713,8 +1003,179 @@ export class VideoEncoder {
 
     const keyFrame = options?.keyFrame ?? false;
 
-    this._encodeQueueSize++;
-    this._native.encode(nativeFrame, frame.timestamp, keyFrame);
+    // Frame orientation plus the configured pre-stage, applied on the native side
+    const orientation = combineOrientation(
+      frame.rotation,
+      frame.flip,
+      this._rotation,
+      this._config?.flip ?? false
+    );
+
+    const quantizer = this._frameQuantizer(options);
+
+    // The worker-thread encoder reports false once its queue hits the high-water mark
+    this._belowHighWater = this._native.encode(
+      nativeFrame,
+      frame.timestamp,
+      keyFrame,
+      orientation.rotation,
+      orientation.flip,
+      options?.roi,
+      quantizer
+    ) !== false;
+    // Frame-rate conversion may drop the frame, hold it, or add repeats
+    this._encodeQueueSize += this._config?.frameRateConversion ? this._native.lastEncodeQueued : 1;
+    this._submitted++;
+    this._pullDrained = false;
+  }
+
+  /**
+   * Per-frame quantizer for the configured codec, or undefined
+   */
+  private _frameQuantizer(options?: VideoEncoderEncodeOptions): number | undefined {
+    if (!options || this._config?.bitrateMode !== 'quantizer') return undefined;
+
+    const codec = this._config.codec;
+    let quantizer: number | undefined;
+    if (codec.startsWith('avc1') || codec.startsWith('avc3')) {
+      quantizer = options.avc?.quantizer;
+    } else if (codec.startsWith('hvc1') || codec.startsWith('hev1')) {
+      quantizer = options.hevc?.quantizer;
+    } else if ((codec.startsWith('vp09') && options.vp9?.quantizer !== undefined) ||
+               (codec.startsWith('av01') && options.av1?.quantizer !== undefined)) {
+      // libvpx and libaom ignore frame->quality
+      throw new DOMException('Per-frame quantizer is not supported for VP9 and AV1', 'NotSupportedError');
+    }
+
+    if (quantizer === undefined) return undefined;
+    if (!Number.isInteger(quantizer) || quantizer < 0 || quantizer > 51) {
+      throw new DOMException('quantizer must be an integer between 0 and 51', 'TypeError');
+    }
+    return quantizer;
+  }
+
+  /**
+   * Signal native job-queue pressure to a producer (non-standard, used by the
+   * stream wrappers). `onResume` is called from the worker once the queue has
+   * drained to `lowWaterMark` after an encode() reached `highWaterMark`.
+   *
+   * @returns false if the synchronous encoder is in use
+   * @internal
+   */
+  _setBackpressure(highWaterMark: number, lowWaterMark: number, onResume: () => void): boolean {
+    if (!this._native?.setBackpressure) return false;
+    this._native.setBackpressure(highWaterMark, lowWaterMark, onResume);
+    return true;
+  }
+
+  /**
+   * Whether the last encode() left the native queue below its high-water mark
+   * @internal
+   */
+  _isBelowHighWater(): boolean {
+    return this._belowHighWater;
+  }
+
+  /**
+   * Drain buffered chunks in pull mode (non-standard)
+   *
+   * Returns up to `max` chunks in output order. With the 'block' policy the
+   * worker thread waits while the native buffer is full, so pulling at your
+   * own pace throttles the encoder.
+   *
+   * @param max - Maximum number of chunks to return (default: all buffered)
+   * @throws DOMException if pull mode is not enabled
+   *
+   * @example
+   * ```ts
+   * encoder.configure({ ...config, pullMode: { capacity: 32 } });
+   * for await (const { chunk, metadata } of encoder) {
+   *   socket.write(chunk);
+   * }
+   * ```
+   */
+  takeOutputs(max?: number): VideoEncoderPulledOutput[] {
+    if (!this._pullMode) {
+      throw new DOMException('Encoder is not in pull mode', 'InvalidStateError');
+    }
+
+    const batch: any[] = this._native.takeOutputs(max);
+    if (batch.length > 0) {
+      this._encodeQueueSize = Math.max(0, this._encodeQueueSize - batch.length);
+      this._dispatchEvent('dequeue');
+    }
+    return batch.map((out) =>
+      this._makeChunk(out.data, out.isKeyframe, out.timestamp, out.duration, out.extradata, out.qp,
+                      out.stageTimings)
+    );
+  }
+
+  /**
+   * Number of chunks discarded by a drop policy since pull mode was enabled
+   */
+  get droppedOutputs(): number {
+    return this._pullMode ? this._native.droppedOutputs : 0;
+  }
+
+  /**
+   * The chunks since the most recent keyframe, ready for a viewer that
+   * joins mid-GOP, or null when none are held: no keyframe yet, the GOP
+   * outgrew `liveGopCache.maxBytes`, or the cache is not configured.
+   *
+   * ```ts
+   * const gop = encoder.getLiveGop();
+   * if (gop) viewer.send(gop.decoderConfig, gop.chunks);
+   * else encoder.encode(frame, { keyFrame: true });
+   * ```
+   */
+  getLiveGop(): VideoEncoderLiveGop | null {
+    if (this._state !== 'configured' || !this._config?.liveGopCache) {
+      return null;
+    }
+
+    const gop = this._native.getLiveGop();
+    if (!gop) {
+      return null;
+    }
+    return {
+      decoderConfig: this._decoderConfig(gop.extradata),
+      chunks: gop.packets.map((p: any) => new EncodedVideoChunk({
+        type: p.isKeyframe ? 'key' : 'delta',
+        timestamp: p.timestamp,
+        duration: p.duration > 0 ? p.duration : undefined,
+        data: p.data,
+      })),
+      byteLength: gop.bytes,
+    };
+  }
+
+  /**
+   * Iterate over encoded chunks in pull mode. Ends once everything
+   * submitted before flush() has been read, or on reset() or close().
+   */
+  async *[Symbol.asyncIterator](): AsyncIterableIterator<VideoEncoderPulledOutput> {
+    while (true) {
+      if (this._state === 'closed' || !this._pullMode) return;
+
+      const batch = this.takeOutputs(16);
+      for (const output of batch) {
+        yield output;
+      }
+
+      if (batch.length === 0) {
+        // Everything up to the last flush() has been read, or reset() dropped it
+        if (this._pullDrained || this._state !== 'configured') return;
+        await new Promise<void>((resolve) => this._readableWaiters.push(resolve));
+      }
+    }
+  }
+
+  private _wakeReaders(): void {
+    const waiters = this._readableWaiters;
+    this._readableWaiters = [];
+    for (const resolve of waiters) {
+      resolve();
+    }
   }
 
   /**
@@ -748,11 +1209,16 @@ export class VideoEncoder {
       throw new DOMException('Encoder is not configured', 'InvalidStateError');
     }
 
+    const submitted = this._submitted;
     return new Promise((resolve, reject) => {
       this._native.flush((err: Error | null) => {
         if (err) {
-          reject(new DOMException(err.message, 'EncodingError'));
+          reject(new DOMException(err.message, err.name === 'AbortError' ? 'AbortError' : 'EncodingError'));
         } else {
+          if (this._pullMode && this._submitted === submitted) {
+            this._pullDrained = true;
+            this._wakeReaders();
+          }
           resolve();
         }
       });
@@ -788,6 +1254,7 @@ export class VideoEncoder {
     }
     this._encodeQueueSize = 0;
     this._state = 'unconfigured';
+    this._wakeReaders();
     this._sentDecoderConfig = false;
     this._config = null;
   }
@@ -821,12 +1288,41 @@ export class VideoEncoder {
     this._state = 'closed';
     this._encodeQueueSize = 0;
     this._config = null;
+    this._wakeReaders();
   }
 
-  private _onChunk(data: Uint8Array, isKeyframe: boolean, timestamp: number, duration: number, extradata?: Uint8Array): void {
+  private _onChunk(
+    data: Uint8Array,
+    isKeyframe: boolean,
+    timestamp: number,
+    duration: number,
+    extradata?: Uint8Array,
+    _alphaSideData?: Uint8Array,
+    qp?: number,
+    stageTimings?: VideoEncoderStageTimings
+  ): void {
     this._encodeQueueSize = Math.max(0, this._encodeQueueSize - 1);
     this._dispatchEvent('dequeue');
 
+    const { chunk, metadata } = this._makeChunk(data, isKeyframe, timestamp, duration, extradata, qp,
+                                                stageTimings);
+
+    try {
+      this._outputCallback(chunk, metadata);
+    } catch (e) {
+      // Don't propagate callback errors
+    }
+  }
+
+  private _makeChunk(
+    data: Uint8Array,
+    isKeyframe: boolean,
+    timestamp: number,
+    duration: number,
+    extradata?: Uint8Array,
+    qp?: number,
+    stageTimings?: VideoEncoderStageTimings
+  ): VideoEncoderPulledOutput {
     const chunk = new EncodedVideoChunk({
       type: isKeyframe ? 'key' : 'delta',
       timestamp,
@@ -838,22 +1334,30 @@ export class VideoEncoder {
 
     // Send decoder config with first keyframe
     if (isKeyframe && !this._sentDecoderConfig && this._config) {
-      metadata = {
-        decoderConfig: {
-          codec: this._config.codec,
-          codedWidth: this._config.width,
-          codedHeight: this._config.height,
-          description: extradata ? new Uint8Array(extradata).buffer as ArrayBuffer : undefined,
-        },
-      };
+      metadata = { decoderConfig: this._decoderConfig(extradata) };
       this._sentDecoderConfig = true;
     }
 
-    try {
-      this._outputCallback(chunk, metadata);
-    } catch (e) {
-      // Don't propagate callback errors
+    if (qp !== undefined && qp >= 0) {
+      metadata = { ...metadata, qp };
     }
+
+    if (stageTimings) {
+      metadata = { ...metadata, stageTimings };
+    }
+
+    return { chunk, metadata };
+  }
+
+  private _decoderConfig(extradata?: Uint8Array): NonNullable<VideoEncoderOutputMetadata['decoderConfig']> {
+    const config = this._config!;
+    return {
+      codec: config.codec,
+      codedWidth: config.width,
+      codedHeight: config.height,
+      description: extradata ? new Uint8Array(extradata).buffer as ArrayBuffer : undefined,
+      ...(config.intraOnly ? { intraOnly: true } : {}),
+    };
   }
 
   private _onError(message: string): void {
@@ -4,7 +4,8 @@
  */
 
 import { VideoColorSpace, VideoColorSpaceInit } from './VideoColorSpace';
-import { BufferSource, DOMRectReadOnly, DOMException } from './types';
+import { BufferSource, DOMRectReadOnly, DOMException, ToneMappingCurve } from './types';
+import type { ColorLUT } from './ColorLUT';
 
 export type VideoPixelFormat =
   | 'I420'
@@ -37,6 +38,10 @@ export interface VideoFrameInit {
     height: number;
   };
   colorSpace?: VideoColorSpaceInit;
+  /** Clockwise rotation in degrees, rounded to a multiple of 90 */
+  rotation?: number;
+  /** Horizontal flip, applied after rotation */
+  flip?: boolean;
 }
 
 export interface VideoFrameBufferInit extends VideoFrameInit {
@@ -54,15 +59,85 @@ export interface VideoFrameCopyToOptions {
   };
   layout?: PlaneLayout[];
   format?: VideoPixelFormat;
+  /**
+   * Tone map PQ/HLG frames to SDR BT.709 before conversion.
+   * SDR frames are copied unchanged. (Non-standard extension)
+   */
+  toneMapping?: ToneMappingCurve;
+  /** Mastering peak luminance in cd/m2 used by toneMapping. Defaults to 1000. */
+  hdrPeakLuminance?: number;
+}
+
+/**
+ * Luma statistics of a frame (Non-standard extension). Values are 8-bit
+ * luma codes: limited-range frames span 16-235, full-range and RGB 0-255.
+ */
+export interface VideoFrameAnalysis {
+  /** Sampled pixels per luma code */
+  histogram: Uint32Array;
+  /** Number of sampled pixels */
+  samples: number;
+  mean: number;
+  variance: number;
+  /** Fraction of samples at or below the black threshold */
+  blackRatio: number;
+  /** Mean absolute luma difference from the previous frame, or null without one */
+  diff: number | null;
+  fullRange: boolean;
+}
+
+export interface VideoFrameAnalysisOptions {
+  /** Fraction of nominal white at or below which a pixel is black. Defaults to 0.1. */
+  blackThreshold?: number;
+  /** Sample every Nth row and column, 1-8. Defaults to 2. */
+  subsample?: number;
+}
+
+export interface VideoFrameMetadata {
+  /** Set by decoders configured with `analysis` (non-standard) */
+  analysis?: VideoFrameAnalysis;
+  /** The `userData` passed to VideoDecoder.decode() with this frame's chunk (non-standard) */
+  userData?: number;
 }
 
 // Load native addon
 import { native } from './native';
 
+/**
+ * Normalize a rotation to 0, 90, 180 or 270 (nearest multiple of 90)
+ * @internal
+ */
+export function parseRotation(rotation: number | undefined): number {
+  if (rotation === undefined) return 0;
+  if (!Number.isFinite(rotation)) {
+    throw new TypeError('rotation must be a finite number');
+  }
+  const aligned = Math.floor(rotation / 90 + 0.5) * 90;
+  return ((aligned % 360) + 360) % 360;
+}
+
+/**
+ * Orientation of applying (rotation, flip) on top of (baseRotation, baseFlip)
+ * @internal
+ */
+export function combineOrientation(
+  baseRotation: number,
+  baseFlip: boolean,
+  rotation: number,
+  flip: boolean
+): { rotation: number; flip: boolean } {
+  // A flip reverses the direction of any rotation that follows it
+  return {
+    rotation: parseRotation(baseRotation + (baseFlip ? -rotation : rotation)),
+    flip: baseFlip !== flip,
+  };
+}
+
 export class VideoFrame {
   private _native: any;
   private _closed: boolean = false;
   private _buffer: Uint8Array | null = null;
+  private _metadata: VideoFrameMetadata = {};
 
   readonly format: VideoPixelFormat | null;
   readonly codedWidth: number;
@@ -73,6 +148,8 @@ export class VideoFrame {
   readonly duration: number | null;
   readonly colorSpace: VideoColorSpace;
   readonly visibleRect: DOMRectReadOnly | null;
+  readonly rotation: number;
+  readonly flip: boolean;
 
   constructor(data: BufferSource, init: VideoFrameBufferInit);
   constructor(image: VideoFrame, init?: VideoFrameInit);
@@ -85,6 +162,7 @@ export class VideoFrame {
 
       this._native = dataOrImage._native ? dataOrImage._native.clone() : null;
       this._buffer = dataOrImage._buffer ? new Uint8Array(dataOrImage._buffer) : null;
+      this._metadata = { ...dataOrImage._metadata };
       this.format = dataOrImage.format;
       this.codedWidth = dataOrImage.codedWidth;
       this.codedHeight = dataOrImage.codedHeight;
@@ -94,6 +172,15 @@ export class VideoFrame {
       this.duration = init?.duration ?? dataOrImage.duration;
       this.colorSpace = dataOrImage.colorSpace;
       this.visibleRect = dataOrImage.visibleRect;
+
+      const orientation = combineOrientation(
+        dataOrImage.rotation,
+        dataOrImage.flip,
+        parseRotation(init?.rotation),
+        init?.flip ?? false
+      );
+      this.rotation = orientation.rotation;
+      this.flip = orientation.flip;
     } else {
       // Create from buffer
       const bufferInit = init as VideoFrameBufferInit;
@@ -127,7 +214,8 @@ export class VideoFrame {
             Buffer.from(buffer),
             bufferInit.format,
             bufferInit.codedWidth,
-            bufferInit.codedHeight
+            bufferInit.codedHeight,
+            bufferInit.colorSpace
           );
         } catch (e) {
           // Fall back to JS-only mode
@@ -143,6 +231,8 @@ export class VideoFrame {
       this.timestamp = bufferInit.timestamp;
       this.duration = bufferInit.duration ?? null;
       this.colorSpace = new VideoColorSpace(bufferInit.colorSpace);
+      this.rotation = parseRotation(bufferInit.rotation);
+      this.flip = bufferInit.flip ?? false;
       this.visibleRect = bufferInit.visibleRect
         ? new DOMRectReadOnly(
             bufferInit.visibleRect.x,
@@ -154,6 +244,40 @@ export class VideoFrame {
     }
   }
 
+  /**
+   * Wrap a native frame produced by a decoder without copying its pixels
+   * (internal use only). The VideoFrame takes ownership of the handle.
+   */
+  static _fromNative(
+    nativeFrame: any,
+    timestamp: number,
+    duration?: number,
+    metadata?: VideoFrameMetadata
+  ): VideoFrame {
+    const frame = Object.create(VideoFrame.prototype) as VideoFrame;
+    const codedWidth: number = nativeFrame.width;
+    const codedHeight: number = nativeFrame.height;
+
+    // Bypasses the constructor, so every field is assigned here
+    return Object.assign(frame, {
+      _native: nativeFrame,
+      _closed: false,
+      _buffer: null,
+      _metadata: metadata ?? {},
+      format: (nativeFrame.format || 'I420') as VideoPixelFormat,
+      codedWidth,
+      codedHeight,
+      displayWidth: codedWidth,
+      displayHeight: codedHeight,
+      timestamp,
+      duration: duration ?? null,
+      colorSpace: new VideoColorSpace(nativeFrame.colorSpace ?? undefined),
+      visibleRect: new DOMRectReadOnly(0, 0, codedWidth, codedHeight),
+      rotation: 0,
+      flip: false,
+    });
+  }
+
   /**
    * Get the native frame handle (internal use only)
    */
@@ -186,7 +310,7 @@ export class VideoFrame {
       case 'I420':
         return Math.floor(width * height * 1.5);
       case 'I420A':
-        return width * height * 2;
+        return Math.floor(width * height * 2.5);
       case 'I422':
         return width * height * 2;
       case 'I444':
@@ -235,6 +359,71 @@ export class VideoFrame {
     return new VideoFrame(this);
   }
 
+  /**
+   * Rotate/flip the pixels natively and return them as a new frame
+   * (non-standard extension). Without options this frame's own rotation and
+   * flip are applied, giving an upright frame. The result always has
+   * rotation 0 and flip false.
+   */
+  transform(options?: { rotation?: number; flip?: boolean }): VideoFrame {
+    this._assertNotClosed();
+    if (!this._native) {
+      throw new DOMException('transform() requires the native addon', 'NotSupportedError');
+    }
+
+    const rotation = options ? parseRotation(options.rotation) : this.rotation;
+    const flip = options ? options.flip ?? false : this.flip;
+    return VideoFrame._fromNative(
+      this._native.transform(rotation, flip),
+      this.timestamp,
+      this.duration ?? undefined
+    );
+  }
+
+  /**
+   * Apply a 3D LUT natively and return the graded pixels as a new frame in
+   * the same format (non-standard extension)
+   */
+  applyLUT(lut: ColorLUT): VideoFrame {
+    this._assertNotClosed();
+    if (!this._native) {
+      throw new DOMException('applyLUT() requires the native addon', 'NotSupportedError');
+    }
+
+    const graded = VideoFrame._fromNative(
+      this._native.applyLut(lut._native),
+      this.timestamp,
+      this.duration ?? undefined
+    );
+    return Object.assign(graded, { rotation: this.rotation, flip: this.flip });
+  }
+
+  /**
+   * Metadata attached to the frame, such as decoder analysis results
+   */
+  metadata(): VideoFrameMetadata {
+    this._assertNotClosed();
+    return { ...this._metadata };
+  }
+
+  /**
+   * Compute luma statistics natively (non-standard extension). With
+   * `previous`, `diff` scores the change from that frame, e.g. to detect
+   * frozen video.
+   */
+  analyze(options?: VideoFrameAnalysisOptions & { previous?: VideoFrame }): VideoFrameAnalysis {
+    this._assertNotClosed();
+    if (!this._native) {
+      throw new DOMException('analyze() requires the native addon', 'NotSupportedError');
+    }
+
+    const previous = options?.previous ? options.previous._getNative() : undefined;
+    return this._native.analyze(
+      { blackThreshold: options?.blackThreshold, subsample: options?.subsample },
+      previous
+    );
+  }
+
   /**
    * Close the frame and release resources
    */
@@ -6,7 +6,17 @@
  */
 
 // Core frame types
-export { VideoFrame, VideoFrameInit, VideoFrameBufferInit, VideoPixelFormat, PlaneLayout, VideoFrameCopyToOptions } from './VideoFrame';
+export {
+  VideoFrame,
+  VideoFrameInit,
+  VideoFrameBufferInit,
+  VideoPixelFormat,
+  PlaneLayout,
+  VideoFrameCopyToOptions,
+  VideoFrameMetadata,
+  VideoFrameAnalysis,
+  VideoFrameAnalysisOptions,
+} from './VideoFrame';
 export { AudioData, AudioDataInit, AudioDataCopyToOptions, AudioSampleFormat } from './AudioData';
 
 // Encoded chunk types
@@ -14,8 +24,18 @@ export { EncodedVideoChunk, EncodedVideoChunkInit, EncodedVideoChunkType } from
 export { EncodedAudioChunk, EncodedAudioChunkInit, EncodedAudioChunkType } from './EncodedAudioChunk';
 
 // Color space
+export { ColorLUT } from './ColorLUT';
 export { VideoColorSpace, VideoColorSpaceInit, VideoColorPrimaries, VideoTransferCharacteristics, VideoMatrixCoefficients } from './VideoColorSpace';
 
+// Compositing
+export { VideoCompositor, VideoCompositorInit, CompositorLayer } from './VideoCompositor';
+
+// Encode result cache
+export { EncodeCache, EncodeCacheInit, EncodeCacheStats } from './EncodeCache';
+
+// Smart-render trimming
+export { smartRender, SmartRenderOptions, SmartRenderRange, SmartRenderResult } from './SmartRender';
+
 // Image decoder
 export { ImageDecoder, ImageDecoderInit, ImageDecodeResult, ImageDecodeOptions } from './ImageDecoder';
 
@@ -27,7 +47,12 @@ export {
   VideoEncoderSupport,
   VideoEncoderOutputMetadata,
   VideoEncoderEncodeOptions,
+  VideoEncoderRegionOfInterest,
+  VideoEncoderPulledOutput,
+  VideoEncoderLiveGop,
+  VideoEncoderStageTimings,
   LatencyMode,
+  VideoEncoderContentHint,
   BitrateMode,
   AlphaOption,
 } from './VideoEncoder';
@@ -35,8 +60,10 @@ export {
 export {
   VideoDecoder,
   VideoDecoderConfig,
+  VideoDecoderDecodeOptions,
   VideoDecoderInit,
   VideoDecoderSupport,
+  VideoDecoderRendition,
 } from './VideoDecoder';
 
 // Audio encoder/decoder
@@ -56,6 +83,23 @@ export {
   AudioDecoderSupport,
 } from './AudioDecoder';
 
+export {
+  AudioBatchScheduler,
+  AudioBatchSchedulerInit,
+  AudioBatchSchedulerStats,
+} from './AudioBatchScheduler';
+export { LoudnessMeter, LoudnessMeterInit, LoudnessMeasurement } from './LoudnessMeter';
+
+// Stream pipeline wrappers
+export {
+  CodecStream,
+  CodecStreamOptions,
+  createVideoDecoderStream,
+  createVideoEncoderStream,
+  createAudioDecoderStream,
+  createAudioEncoderStream,
+} from './streams';
+
 // Codec registry utilities
 export {
   isVideoCodecSupported,
@@ -68,7 +112,7 @@ export {
 } from './codec-registry';
 
 // Type exports
-export { CodecState, BufferSource, DOMRectReadOnly } from './types';
+export { CodecState, BufferSource, DOMRectReadOnly, PullModeOptions, ToneMappingCurve, DecoderLimits } from './types';
 
 // Native utilities (if available)
 import { native as _native } from './native';
@@ -0,0 +1,276 @@
+/**
+ * Stream wrappers - Node.js Duplex and WHATWG TransformStream adapters
+ *
+ * Lets the codecs sit directly in stream pipelines:
+ *
+ * ```ts
+ * await pipeline(chunkSource, createVideoDecoderStream(decConfig),
+ *                createVideoEncoderStream(encConfig), sink);
+ * ```
+ *
+ * Writes are acknowledged only while the codec's job queue is below its
+ * high-water mark and the readable side has room. With the worker-thread
+ * video codecs the queue depth comes from the native job queue, and the
+ * resume signal is sent by the worker thread. An audio encoder on an
+ * AudioBatchScheduler is paced by its encodeQueueSize, which the
+ * scheduler's worker lowers as it takes input. The other audio codecs work
+ * synchronously inside write(), so only the readable side can hold writes
+ * back.
+ */
+
+import { Duplex } from 'stream';
+import type { ReadableStream, WritableStream } from 'stream/web';
+import { VideoDecoder, VideoDecoderConfig } from './VideoDecoder';
+import { VideoEncoder, VideoEncoderConfig, VideoEncoderOutputMetadata } from './VideoEncoder';
+import { AudioDecoder, AudioDecoderConfig } from './AudioDecoder';
+import { AudioEncoder, AudioEncoderConfig, AudioEncoderOutputMetadata } from './AudioEncoder';
+import { VideoFrame } from './VideoFrame';
+import { AudioData } from './AudioData';
+import { EncodedVideoChunk } from './EncodedVideoChunk';
+import { EncodedAudioChunk } from './EncodedAudioChunk';
+
+export interface CodecStreamOptions {
+  /** Queued jobs at which writes are held back. Defaults to 8. */
+  highWaterMark?: number;
+  /** Queue depth at which held-back writes resume. Defaults to highWaterMark / 2. */
+  lowWaterMark?: number;
+  /**
+   * Close VideoFrame/AudioData inputs once they have been submitted.
+   * Defaults to true, so decoder -> encoder pipelines do not leak frames.
+   */
+  closeInputs?: boolean;
+}
+
+/** The parts of a WebCodecs codec the stream wrapper drives */
+interface StreamCodec<I> {
+  submit(input: I): void;
+  queueSize(): number;
+  flush(): Promise<void>;
+  close(): void;
+  onDequeue?(listener: () => void): void;
+  setBackpressure?(highWaterMark: number, lowWaterMark: number, onResume: () => void): boolean;
+  isBelowHighWater?(): boolean;
+}
+
+/**
+ * Object-mode Duplex around a codec. Inputs written to it are submitted to
+ * the codec, and codec outputs are pushed to the readable side.
+ */
+export class CodecStream<I, O> extends Duplex {
+  private _codec: StreamCodec<I>;
+  private _highWaterMark: number;
+  private _lowWaterMark: number;
+  private _closeInputs: boolean;
+  private _nativeBackpressure: boolean;
+  private _codecFull: boolean = false;
+  private _readerFull: boolean = false;
+  private _pendingWrite: ((error?: Error | null) => void) | null = null;
+
+  /** @internal */
+  constructor(
+    create: (output: (output: O) => void, error: (error: Error) => void) => StreamCodec<I>,
+    options: CodecStreamOptions = {}
+  ) {
+    const highWaterMark = Math.max(1, options.highWaterMark ?? 8);
+    super({ objectMode: true, highWaterMark });
+
+    this._highWaterMark = highWaterMark;
+    this._lowWaterMark = Math.min(
+      highWaterMark - 1,
+      Math.max(0, options.lowWaterMark ?? Math.floor(highWaterMark / 2))
+    );
+    this._closeInputs = options.closeInputs !== false;
+
+    this._codec = create(
+      (output) => this._onOutput(output),
+      (error) => this.destroy(error)
+    );
+
+    // Prefer the native queue signal; otherwise watch the JS-side queue size
+    this._nativeBackpressure = this._codec.setBackpressure?.(
+      this._highWaterMark,
+      this._lowWaterMark,
+      () => this._onCodecResume()
+    ) ?? false;
+
+    if (!this._nativeBackpressure) {
+      this._codec.onDequeue?.(() => {
+        if (this._codecFull && this._codec.queueSize() <= this._lowWaterMark) {
+          this._onCodecResume();
+        }
+      });
+    }
+  }
+
+  /**
+   * Expose this stream as a WHATWG TransformStream-style pair
+   */
+  toWeb(): { readable: ReadableStream<O>; writable: WritableStream<I> } {
+    return Duplex.toWeb(this) as { readable: ReadableStream<O>; writable: WritableStream<I> };
+  }
+
+  _write(input: I, _encoding: BufferEncoding, callback: (error?: Error | null) => void): void {
+    try {
+      this._codec.submit(input);
+    } catch (e) {
+      callback(e as Error);
+      return;
+    }
+
+    if (this._closeInputs && typeof (input as any)?.close === 'function') {
+      (input as any).close();
+    }
+
+    if (this._nativeBackpressure) {
+      this._codecFull = !this._codec.isBelowHighWater!();
+    } else {
+      // Without a dequeue signal there is nothing to wait on (synchronous codecs)
+      this._codecFull = !!this._codec.onDequeue && this._codec.queueSize() >= this._highWaterMark;
+    }
+
+    this._pendingWrite = callback;
+    this._releaseWrite();
+  }
+
+  _final(callback: (error?: Error | null) => void): void {
+    this._codec.flush().then(
+      () => {
+        this.push(null);
+        callback();
+      },
+      (error) => callback(error)
+    );
+  }
+
+  _read(): void {
+    this._readerFull = false;
+    this._releaseWrite();
+  }
+
+  _destroy(error: Error | null, callback: (error?: Error | null) => void): void {
+    try {
+      this._codec.close();
+    } catch {
+      // Already closed
+    }
+    callback(error);
+  }
+
+  private _onOutput(output: O): void {
+    if (!this.push(output)) {
+      this._readerFull = true;
+    }
+  }
+
+  private _onCodecResume(): void {
+    this._codecFull = false;
+    this._releaseWrite();
+  }
+
+  private _releaseWrite(): void {
+    if (this._pendingWrite && !this._codecFull && !this._readerFull) {
+      const callback = this._pendingWrite;
+      this._pendingWrite = null;
+      callback();
+    }
+  }
+}
+
+/**
+ * Duplex that decodes EncodedVideoChunk inputs into VideoFrame outputs
+ */
+export function createVideoDecoderStream(
+  config: VideoDecoderConfig,
+  options?: CodecStreamOptions
+): CodecStream<EncodedVideoChunk, VideoFrame> {
+  return new CodecStream<EncodedVideoChunk, VideoFrame>((output, error) => {
+    const decoder = new VideoDecoder({ output, error });
+    decoder.configure(config);
+    return {
+      submit: (chunk) => decoder.decode(chunk),
+      queueSize: () => decoder.decodeQueueSize,
+      flush: () => decoder.flush(),
+      close: () => decoder.close(),
+      onDequeue: (listener) => decoder.addEventListener('dequeue', listener),
+      setBackpressure: (high, low, onResume) => decoder._setBackpressure(high, low, onResume),
+      isBelowHighWater: () => decoder._isBelowHighWater(),
+    };
+  }, options);
+}
+
+/**
+ * Duplex that encodes VideoFrame inputs into EncodedVideoChunk outputs.
+ * Output metadata (decoder config, SVC info) is emitted as a 'metadata' event.
+ */
+export function createVideoEncoderStream(
+  config: VideoEncoderConfig,
+  options?: CodecStreamOptions
+): CodecStream<VideoFrame, EncodedVideoChunk> {
+  const stream: CodecStream<VideoFrame, EncodedVideoChunk> = new CodecStream<VideoFrame, EncodedVideoChunk>((output, error) => {
+    const encoder = new VideoEncoder({
+      output: (chunk: EncodedVideoChunk, metadata?: VideoEncoderOutputMetadata) => {
+        if (metadata) stream.emit('metadata', metadata, chunk);
+        output(chunk);
+      },
+      error,
+    });
+    encoder.configure(config);
+    return {
+      submit: (frame) => encoder.encode(frame),
+      queueSize: () => encoder.encodeQueueSize,
+      flush: () => encoder.flush(),
+      close: () => encoder.close(),
+      onDequeue: (listener) => encoder.addEventListener('dequeue', listener),
+      setBackpressure: (high, low, onResume) => encoder._setBackpressure(high, low, onResume),
+      isBelowHighWater: () => encoder._isBelowHighWater(),
+    };
+  }, options);
+  return stream;
+}
+
+/**
+ * Duplex that decodes EncodedAudioChunk inputs into AudioData outputs
+ */
+export function createAudioDecoderStream(
+  config: AudioDecoderConfig,
+  options?: CodecStreamOptions
+): CodecStream<EncodedAudioChunk, AudioData> {
+  return new CodecStream<EncodedAudioChunk, AudioData>((output, error) => {
+    const decoder = new AudioDecoder({ output, error });
+    decoder.configure(config);
+    return {
+      submit: (chunk) => decoder.decode(chunk),
+      queueSize: () => decoder.decodeQueueSize,
+      flush: () => decoder.flush(),
+      close: () => decoder.close(),
+    };
+  }, options);
+}
+
+/**
+ * Duplex that encodes AudioData inputs into EncodedAudioChunk outputs.
+ * Output metadata is emitted as a 'metadata' event.
+ */
+export function createAudioEncoderStream(
+  config: AudioEncoderConfig,
+  options?: CodecStreamOptions
+): CodecStream<AudioData, EncodedAudioChunk> {
+  const stream: CodecStream<AudioData, EncodedAudioChunk> = new CodecStream<AudioData, EncodedAudioChunk>((output, error) => {
+    const encoder = new AudioEncoder({
+      output: (chunk: EncodedAudioChunk, metadata?: AudioEncoderOutputMetadata) => {
+        if (metadata) stream.emit('metadata', metadata, chunk);
+        output(chunk);
+      },
+      error,
+    });
+    encoder.configure(config);
+    return {
+      submit: (data) => encoder.encode(data),
+      queueSize: () => encoder.encodeQueueSize,
+      flush: () => encoder.flush(),
+      close: () => encoder.close(),
+      onDequeue: (listener) => encoder.addEventListener('dequeue', listener),
+    };
+  }, options);
+  return stream;
+}
@@ -118,3 +118,50 @@ export { WebCodecsDOMException as DOMException };
 
 // Codec state type
 export type CodecState = 'unconfigured' | 'configured' | 'closed';
+
+/**
+ * Pull-mode output draining (non-standard, worker-thread codecs only).
+ * Outputs are held in a bounded native buffer and drained with
+ * takeOutputs() or `for await` instead of being pushed to the output callback.
+ */
+export interface PullModeOptions {
+  /** Maximum number of buffered outputs. Defaults to 16. */
+  capacity?: number;
+  /**
+   * What the worker does when the buffer is full: wait for the consumer
+   * ('block', the default) or discard an output.
+   */
+  policy?: 'block' | 'drop-oldest' | 'drop-newest';
+}
+
+/**
+ * HDR (PQ/HLG) to SDR tone curve
+ * - `hable`: filmic curve, soft shoulder
+ * - `bt2390`: ITU-R BT.2390 EETF, keeps midtones unchanged
+ */
+export type ToneMappingCurve = 'hable' | 'bt2390';
+
+/**
+ * Per-instance resource limits for decoding untrusted streams (non-standard).
+ * A violation is reported to the error callback as a QuotaExceededError.
+ * The decoder stays configured and resumes at the next keyframe.
+ * Omitted or 0 means unlimited.
+ */
+export interface DecoderLimits {
+  /** Largest decoded picture width (video) */
+  maxWidth?: number;
+  /** Largest decoded picture height (video) */
+  maxHeight?: number;
+  /** Largest width * height, checked by FFmpeg before allocation (video) */
+  maxPixels?: number;
+  /** Largest chunk accepted by decode(); bigger chunks are not copied */
+  maxChunkBytes?: number;
+  /**
+   * Wall-time budget per chunk in milliseconds (video). Checked at every
+   * frame allocation and after each decode call; FFmpeg cannot interrupt
+   * a call that is already running.
+   */
+  maxDecodeTimeMs?: number;
+  /** Largest decoded audio frame, samples times channels (audio) */
+  maxSamples?: number;
+}
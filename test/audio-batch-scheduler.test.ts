@@ -0,0 +1,152 @@
+/**
+ * Tests for AudioBatchScheduler (non-standard extension)
+ */
+
+import { AudioBatchScheduler } from '../src/AudioBatchScheduler';
+import { AudioEncoder, AudioEncoderConfig } from '../src/AudioEncoder';
+import { AudioData } from '../src/AudioData';
+import { EncodedAudioChunk } from '../src/EncodedAudioChunk';
+import { isCI, thrownName } from './helpers';
+
+const CONFIG: AudioEncoderConfig = {
+  codec: 'opus',
+  sampleRate: 48000,
+  numberOfChannels: 1,
+  bitrate: 32000,
+};
+
+// 20 ms at 48 kHz, the usual Opus frame
+const FRAME_SIZE = 960;
+const FRAME_DURATION = 20000;
+
+function createAudioData(index: number): AudioData {
+  const samples = new Float32Array(FRAME_SIZE);
+  for (let i = 0; i < FRAME_SIZE; i++) {
+    samples[i] = 0.5 * Math.sin((2 * Math.PI * 440 * (index * FRAME_SIZE + i)) / CONFIG.sampleRate);
+  }
+  return new AudioData({
+    format: 'f32',
+    sampleRate: CONFIG.sampleRate,
+    numberOfFrames: FRAME_SIZE,
+    numberOfChannels: 1,
+    timestamp: index * FRAME_DURATION,
+    data: samples,
+  });
+}
+
+interface Session {
+  encoder: AudioEncoder;
+  chunks: EncodedAudioChunk[];
+  errors: Error[];
+}
+
+function openSession(scheduler: AudioBatchScheduler): Session {
+  const session: Session = { encoder: null as unknown as AudioEncoder, chunks: [], errors: [] };
+  session.encoder = new AudioEncoder({
+    output: (chunk) => { session.chunks.push(chunk); },
+    error: (e) => { session.errors.push(e); },
+  });
+  session.encoder.configure({ ...CONFIG, scheduler });
+  return session;
+}
+
+function encodeSome(session: Session, count: number): void {
+  for (let i = 0; i < count; i++) {
+    const data = createAudioData(i);
+    session.encoder.encode(data);
+    data.close();
+  }
+}
+
+describe('AudioBatchScheduler', () => {
+  let available = false;
+  let scheduler: AudioBatchScheduler;
+
+  beforeAll(async () => {
+    const { supported } = await AudioEncoder.isConfigSupported(CONFIG);
+    if (!supported && !isCI) {
+      throw new Error(`Encoder not available: ${CONFIG.codec}`);
+    }
+    available = !!supported;
+  });
+
+  beforeEach(() => {
+    scheduler = new AudioBatchScheduler({ tickMs: 5 });
+  });
+
+  afterEach(() => {
+    scheduler.close();
+  });
+
+  it('should start with no sessions', () => {
+    const stats = scheduler.stats;
+    expect(stats.sessions).toBe(0);
+    expect(stats.sweeps).toBe(0);
+    expect(stats.chunks).toBe(0);
+  });
+
+  it('should encode every session in the same sweeps', async () => {
+    if (!available) return;
+    const sessions = [0, 1, 2, 3].map(() => openSession(scheduler));
+    expect(scheduler.stats.sessions).toBe(4);
+
+    sessions.forEach((s) => encodeSome(s, 10));
+    await Promise.all(sessions.map((s) => s.encoder.flush()));
+
+    let total = 0;
+    for (const session of sessions) {
+      expect(session.errors).toHaveLength(0);
+      expect(session.chunks.length).toBeGreaterThan(0);
+      const timestamps = session.chunks.map((c) => c.timestamp);
+      expect(timestamps).toEqual([...timestamps].sort((a, b) => a - b));
+      total += session.chunks.length;
+    }
+
+    const stats = scheduler.stats;
+    expect(stats.chunks).toBe(total);
+    expect(stats.sweeps).toBeGreaterThan(0);
+    // Sweeps carry several sessions' frames, not one frame each
+    expect(stats.sweeps).toBeLessThan(total);
+    sessions.forEach((s) => s.encoder.close());
+  }, 30000);
+
+  it('should keep sessions isolated when one is reset', async () => {
+    if (!available) return;
+    const kept = openSession(scheduler);
+    const dropped = openSession(scheduler);
+    encodeSome(kept, 5);
+    encodeSome(dropped, 5);
+
+    const flushing = dropped.encoder.flush();
+    dropped.encoder.reset();
+    await expect(flushing).rejects.toMatchObject({ name: 'AbortError' });
+    expect(scheduler.stats.sessions).toBe(1);
+
+    await kept.encoder.flush();
+    expect(kept.chunks.length).toBeGreaterThan(0);
+    expect(dropped.chunks).toHaveLength(0);
+    kept.encoder.close();
+  }, 30000);
+
+  it('should close encoders still using it on close()', async () => {
+    if (!available) return;
+    const sessions = [openSession(scheduler), openSession(scheduler)];
+    sessions.forEach((s) => encodeSome(s, 3));
+    const flushes = sessions.map((s) => s.encoder.flush());
+
+    scheduler.close();
+
+    for (let i = 0; i < sessions.length; i++) {
+      await expect(flushes[i]).rejects.toMatchObject({ name: 'EncodingError' });
+      expect(sessions[i].encoder.state).toBe('closed');
+      expect(sessions[i].errors.map((e) => e.message)).toEqual(['Scheduler closed']);
+    }
+  });
+
+  it('should reject new sessions after close()', () => {
+    scheduler.close();
+    const encoder = new AudioEncoder({ output: () => {}, error: () => {} });
+    expect(thrownName(() => encoder.configure({ ...CONFIG, scheduler }))).toBe('InvalidStateError');
+    encoder.close();
+  });
+});
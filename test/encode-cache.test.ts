@@ -0,0 +1,120 @@
+/**
+ * Tests for EncodeCache (non-standard extension)
+ */
+
+import { VideoEncoder, VideoEncoderConfig } from '../src/VideoEncoder';
+import { EncodeCache } from '../src/EncodeCache';
+import { EncodedVideoChunk } from '../src/EncodedVideoChunk';
+import { encodeFrames, encoderAvailable, thrownName } from './helpers';
+
+const CONFIG: VideoEncoderConfig = {
+  codec: 'avc1.42001f',
+  width: 64,
+  height: 64,
+  bitrate: 500_000,
+  framerate: 30,
+  latencyMode: 'quality',
+};
+
+function bytesOf(chunk: EncodedVideoChunk): number[] {
+  const data = new Uint8Array(chunk.byteLength);
+  chunk.copyTo(data);
+  return Array.from(data);
+}
+
+describe('EncodeCache', () => {
+  let available = false;
+
+  beforeAll(async () => {
+    available = await encoderAvailable(CONFIG);
+  });
+
+  it('should start with empty stats', () => {
+    const cache = new EncodeCache();
+    const stats = cache.stats;
+    expect(stats.hits).toBe(0);
+    expect(stats.misses).toBe(0);
+    expect(stats.hitRate).toBe(0);
+    expect(stats.memoryEntries).toBe(0);
+  });
+
+  it('should replay identical GOPs from the cache', async () => {
+    if (!available) return;
+    const cache = new EncodeCache();
+    const config = { ...CONFIG, encodeCache: cache };
+
+    // 60 frames at a GOP length of 30 (the framerate) close two GOPs
+    const first = await encodeFrames(config, 60);
+    const afterFirst = cache.stats;
+    expect(afterFirst.hits).toBe(0);
+    expect(afterFirst.misses).toBe(2);
+    expect(afterFirst.memoryEntries).toBe(2);
+
+    const second = await encodeFrames(config, 60);
+    const afterSecond = cache.stats;
+    expect(afterSecond.hits).toBe(2);
+    expect(afterSecond.misses).toBe(2);
+    expect(afterSecond.hitRate).toBeCloseTo(0.5, 5);
+    expect(afterSecond.replayedBytes).toBeGreaterThan(0);
+
+    expect(second.chunks.map((c) => c.timestamp)).toEqual(first.chunks.map((c) => c.timestamp));
+    expect(second.chunks.map((c) => c.type)).toEqual(first.chunks.map((c) => c.type));
+    for (let i = 0; i < first.chunks.length; i++) {
+      expect(bytesOf(second.chunks[i])).toEqual(bytesOf(first.chunks[i]));
+    }
+    // A replayed keyframe still carries the decoder config
+    expect(second.metadata[0]?.decoderConfig).toBeDefined();
+  }, 60000);
+
+  it('should miss when the settings change', async () => {
+    if (!available) return;
+    const cache = new EncodeCache();
+    await encodeFrames({ ...CONFIG, encodeCache: cache }, 30);
+    await encodeFrames({ ...CONFIG, bitrate: 250_000, encodeCache: cache }, 30);
+    expect(cache.stats.hits).toBe(0);
+    expect(cache.stats.misses).toBe(2);
+  }, 60000);
+
+  it('should encode GOPs larger than maxPendingBytes', async () => {
+    if (!available) return;
+    // Nothing may be held back, so a known GOP is encoded instead of replayed
+    const cache = new EncodeCache({ maxPendingBytes: 0 });
+    const config = { ...CONFIG, encodeCache: cache };
+
+    const first = await encodeFrames(config, 60);
+    const second = await encodeFrames(config, 60);
+    expect(cache.stats.hits).toBe(0);
+    expect(cache.stats.misses).toBe(4);
+    expect(cache.stats.memoryEntries).toBe(2);
+    expect(second.chunks.map((c) => c.timestamp)).toEqual(first.chunks.map((c) => c.timestamp));
+    expect(second.chunks[0].type).toBe('key');
+    expect(second.chunks[30].type).toBe('key');
+  }, 60000);
+
+  it('should reject a negative maxPendingBytes', () => {
+    expect(() => new EncodeCache({ maxPendingBytes: -1 })).toThrow(/non-negative/);
+  });
+
+  it('should reset entries and counters on clear()', async () => {
+    if (!available) return;
+    const cache = new EncodeCache();
+    await encodeFrames({ ...CONFIG, encodeCache: cache }, 30);
+    expect(cache.stats.memoryEntries).toBe(1);
+
+    cache.clear();
+    const stats = cache.stats;
+    expect(stats.misses).toBe(0);
+    expect(stats.memoryEntries).toBe(0);
+    expect(stats.memoryBytes).toBe(0);
+  }, 30000);
+
+  it('should require latencyMode quality', () => {
+    const encoder = new VideoEncoder({ output: () => {}, error: () => {} });
+    expect(thrownName(() => encoder.configure({
+      ...CONFIG,
+      latencyMode: 'realtime',
+      encodeCache: new EncodeCache(),
+    }))).toBe('NotSupportedError');
+    encoder.close();
+  });
+});
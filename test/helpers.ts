@@ -0,0 +1,128 @@
+/**
+ * Shared helpers for the native feature tests
+ */
+
+import { VideoEncoder, VideoEncoderConfig, VideoEncoderOutputMetadata } from '../src/VideoEncoder';
+import { VideoFrame } from '../src/VideoFrame';
+import { EncodedVideoChunk } from '../src/EncodedVideoChunk';
+import { AudioData } from '../src/AudioData';
+
+// CI environments may not have every encoder available
+export const isCI = process.env.CI === 'true';
+
+/**
+ * Flat I420 frame with the given plane values
+ */
+export function createI420Frame(
+  width: number,
+  height: number,
+  timestamp: number,
+  y: number = 128,
+  u: number = 128,
+  v: number = 128
+): VideoFrame {
+  const ySize = width * height;
+  const uvSize = (width / 2) * (height / 2);
+  const data = new Uint8Array(ySize + uvSize * 2);
+  data.fill(y, 0, ySize);
+  data.fill(u, ySize, ySize + uvSize);
+  data.fill(v, ySize + uvSize);
+  return new VideoFrame(data, { format: 'I420', codedWidth: width, codedHeight: height, timestamp });
+}
+
+/**
+ * Mono f32 AudioData holding block `index` of a continuous 440 Hz tone.
+ * The default 960 frames are one 20 ms Opus frame at 48 kHz.
+ */
+export function createToneAudioData(
+  index: number,
+  sampleRate: number = 48000,
+  numberOfFrames: number = 960
+): AudioData {
+  const samples = new Float32Array(numberOfFrames);
+  for (let i = 0; i < numberOfFrames; i++) {
+    samples[i] = 0.5 * Math.sin((2 * Math.PI * 440 * (index * numberOfFrames + i)) / sampleRate);
+  }
+  return new AudioData({
+    format: 'f32',
+    sampleRate,
+    numberOfFrames,
+    numberOfChannels: 1,
+    timestamp: Math.round((index * numberOfFrames * 1e6) / sampleRate),
+    data: samples,
+  });
+}
+
+/**
+ * Luma value of frame `index`; varies so every frame has something to encode
+ */
+export function lumaFor(index: number): number {
+  return 16 + ((index * 7) % 200);
+}
+
+/**
+ * Whether the encoder config can run here. Outside CI a missing encoder
+ * is a failure rather than a skip.
+ */
+export async function encoderAvailable(config: VideoEncoderConfig): Promise<boolean> {
+  const { supported } = await VideoEncoder.isConfigSupported(config);
+  if (!supported && !isCI) {
+    throw new Error(`Encoder not available: ${config.codec}`);
+  }
+  return supported;
+}
+
+export interface EncodedStream {
+  chunks: EncodedVideoChunk[];
+  metadata: Array<VideoEncoderOutputMetadata | undefined>;
+}
+
+/**
+ * Encode `count` frames at `frameDuration` microseconds apart, keyframe first
+ */
+export async function encodeFrames(
+  config: VideoEncoderConfig,
+  count: number,
+  frameDuration: number = 33333
+): Promise<EncodedStream> {
+  const stream: EncodedStream = { chunks: [], metadata: [] };
+  let failure: Error | null = null;
+  const encoder = new VideoEncoder({
+    output: (chunk, metadata) => {
+      stream.chunks.push(chunk);
+      stream.metadata.push(metadata);
+    },
+    error: (e) => { failure = e; },
+  });
+  encoder.configure(config);
+  for (let i = 0; i < count; i++) {
+    const frame = createI420Frame(config.width, config.height, i * frameDuration, lumaFor(i));
+    encoder.encode(frame, { keyFrame: i === 0 });
+    frame.close();
+  }
+  await encoder.flush();
+  encoder.close();
+  if (failure) throw failure;
+  return stream;
+}
+
+/**
+ * Luma of the top-left pixel
+ */
+export async function topLeftLuma(frame: VideoFrame): Promise<number> {
+  const data = new Uint8Array(frame.allocationSize({ format: 'I420' }));
+  await frame.copyTo(data, { format: 'I420' });
+  return data[0];
+}
+
+/**
+ * Name of the error fn throws, or undefined if it returns
+ */
+export function thrownName(fn: () => unknown): string | undefined {
+  try {
+    fn();
+  } catch (e) {
+    return (e as Error).name;
+  }
+  return undefined;
+}
@@ -0,0 +1,248 @@
+/**
+ * Tests for AVIF decoding through the HEIF item parser, including alpha
+ * auxiliary images and grids
+ */
+
+import { ImageDecoder } from '../src/ImageDecoder';
+import { VideoEncoder, VideoEncoderConfig } from '../src/VideoEncoder';
+import { VideoFrame } from '../src/VideoFrame';
+import { createI420Frame, isCI } from './helpers';
+
+const WIDTH = 64;
+const HEIGHT = 64;
+
+const AV1_CONFIG: VideoEncoderConfig = {
+  codec: 'av01.0.04M.08',
+  width: WIDTH,
+  height: HEIGHT,
+  bitrate: 1_000_000,
+  framerate: 30,
+};
+
+const ALPHA_URN = 'urn:mpeg:mpegB:cicp:systems:auxiliary:alpha';
+
+// A single flat keyframe, as the OBUs of one temporal unit
+async function encodeStill(luma: number): Promise<Uint8Array> {
+  const chunks: Uint8Array[] = [];
+  const encoder = new VideoEncoder({
+    output: (chunk) => {
+      const data = new Uint8Array(chunk.byteLength);
+      chunk.copyTo(data);
+      chunks.push(data);
+    },
+    error: () => {},
+  });
+  encoder.configure(AV1_CONFIG);
+  const frame = createI420Frame(WIDTH, HEIGHT, 0, luma);
+  encoder.encode(frame, { keyFrame: true });
+  frame.close();
+  await encoder.flush();
+  encoder.close();
+  return chunks[0];
+}
+
+function concat(...parts: Uint8Array[]): Uint8Array {
+  const out = new Uint8Array(parts.reduce((sum, p) => sum + p.byteLength, 0));
+  let offset = 0;
+  for (const part of parts) {
+    out.set(part, offset);
+    offset += part.byteLength;
+  }
+  return out;
+}
+
+function u16(v: number): Uint8Array {
+  return new Uint8Array([(v >> 8) & 0xff, v & 0xff]);
+}
+
+function u32(v: number): Uint8Array {
+  return new Uint8Array([(v >>> 24) & 0xff, (v >> 16) & 0xff, (v >> 8) & 0xff, v & 0xff]);
+}
+
+function ascii(s: string): Uint8Array {
+  return new Uint8Array(Array.from(s, (c) => c.charCodeAt(0)));
+}
+
+function box(type: string, ...payload: Uint8Array[]): Uint8Array {
+  const body = concat(...payload);
+  return concat(u32(body.byteLength + 8), ascii(type), body);
+}
+
+function fullBox(type: string, version: number, flags: number, ...payload: Uint8Array[]): Uint8Array {
+  return box(type, new Uint8Array([version, (flags >> 16) & 0xff, (flags >> 8) & 0xff, flags & 0xff]), ...payload);
+}
+
+interface HeifItem {
+  type: string;
+  data: Uint8Array;
+  // 1-based ipco indices, all marked essential
+  properties: number[];
+}
+
+/**
+ * Minimal HEIF with item 1 as the primary item. Item payloads are stored
+ * in one mdat; properties are 1 ispe (WIDTH x HEIGHT) and 2 auxC (alpha).
+ */
+function buildHeif(items: HeifItem[], refs: Uint8Array[]): Uint8Array {
+  const ftyp = box('ftyp', ascii('avif'), u32(0), ascii('avif'), ascii('mif1'), ascii('miaf'));
+
+  const meta = (offsets: number[]) => {
+    const infe = items.map((item, i) => fullBox('infe', 2, 0, u16(i + 1), u16(0), ascii(item.type), new Uint8Array([0])));
+    const iloc = fullBox('iloc', 0, 0,
+      new Uint8Array([0x44, 0x00]),  // offset_size 4, length_size 4, base_offset_size 0
+      u16(items.length),
+      ...items.map((item, i) => concat(u16(i + 1), u16(0), u16(1), u32(offsets[i]), u32(item.data.byteLength))));
+
+    const ipco = box('ipco',
+      fullBox('ispe', 0, 0, u32(WIDTH), u32(HEIGHT)),
+      fullBox('auxC', 0, 0, ascii(ALPHA_URN), new Uint8Array([0])));
+    const ipma = fullBox('ipma', 0, 0,
+      u32(items.length),
+      ...items.map((item, i) => concat(u16(i + 1), new Uint8Array([item.properties.length, ...item.properties.map((p) => 0x80 | p)]))));
+
+    return fullBox('meta', 0, 0,
+      fullBox('hdlr', 0, 0, u32(0), ascii('pict'), u32(0), u32(0), u32(0), new Uint8Array([0])),
+      fullBox('pitm', 0, 0, u16(1)),
+      fullBox('iinf', 0, 0, u16(items.length), ...infe),
+      iloc,
+      box('iprp', ipco, ipma),
+      ...(refs.length ? [fullBox('iref', 0, 0, ...refs)] : []));
+  };
+
+  // The meta box size does not depend on the offsets
+  const mdatStart = ftyp.byteLength + meta(items.map(() => 0)).byteLength + 8;
+  const offsets: number[] = [];
+  let offset = mdatStart;
+  for (const item of items) {
+    offsets.push(offset);
+    offset += item.data.byteLength;
+  }
+  return concat(ftyp, meta(offsets), box('mdat', ...items.map((item) => item.data)));
+}
+
+/**
+ * Minimal AVIF: item 1 is the primary color image, item 2 (if given) its
+ * alpha auxiliary image
+ */
+function buildAvif(color: Uint8Array, alpha?: Uint8Array): Uint8Array {
+  const items: HeifItem[] = [{ type: 'av01', data: color, properties: [1] }];
+  if (!alpha) return buildHeif(items, []);
+  items.push({ type: 'av01', data: alpha, properties: [1, 2] });
+  return buildHeif(items, [box('auxl', u16(2), u16(1), u16(1))]);
+}
+
+/**
+ * AVIF whose primary item is a rows x columns grid of `tile`, declared as
+ * width x height
+ */
+function buildGridAvif(tile: Uint8Array, rows: number, columns: number, width: number, height: number): Uint8Array {
+  const count = rows * columns;
+  const grid = concat(new Uint8Array([0, 0, rows - 1, columns - 1]), u16(width), u16(height));
+  const items: HeifItem[] = [{ type: 'grid', data: grid, properties: [1] }];
+  for (let i = 0; i < count; i++) {
+    items.push({ type: 'av01', data: tile, properties: [1] });
+  }
+  const tileIds = Array.from({ length: count }, (_, i) => u16(i + 2));
+  return buildHeif(items, [box('dimg', u16(1), u16(count), ...tileIds)]);
+}
+
+async function decodeAvif(data: Uint8Array): Promise<VideoFrame> {
+  const decoder = new ImageDecoder({ data, type: 'image/avif' });
+  const { image, complete } = await decoder.decode();
+  expect(complete).toBe(true);
+  decoder.close();
+  return image;
+}
+
+describe('ImageDecoder AVIF', () => {
+  let canDecode = false;
+  let available = false;
+  let color: Uint8Array;
+  let alpha: Uint8Array;
+
+  beforeAll(async () => {
+    // AV1 encoders are optional and slow; skip rather than fail without one
+    const canEncode = (await VideoEncoder.isConfigSupported(AV1_CONFIG)).supported;
+    canDecode = await ImageDecoder.isTypeSupported('image/avif');
+    available = !isCI && !!canEncode && canDecode;
+    if (!available) return;
+    color = await encodeStill(100);
+    alpha = await encodeStill(200);
+  }, 60000);
+
+  it('should decode the primary item', async () => {
+    if (!available) return;
+    const image = await decodeAvif(buildAvif(color));
+    expect(image.format).toBe('I420');
+    expect(image.codedWidth).toBe(WIDTH);
+    expect(image.codedHeight).toBe(HEIGHT);
+
+    const data = new Uint8Array(image.allocationSize());
+    await image.copyTo(data);
+    expect(Math.abs(data[0] - 100)).toBeLessThanOrEqual(4);
+    image.close();
+  }, 30000);
+
+  it('should attach the alpha auxiliary image', async () => {
+    if (!available) return;
+    const image = await decodeAvif(buildAvif(color, alpha));
+    expect(image.format).toBe('I420A');
+
+    // Y, U, V, then the alpha plane; alpha keeps its coded values
+    const data = new Uint8Array(image.allocationSize());
+    await image.copyTo(data);
+    const alphaOffset = WIDTH * HEIGHT + 2 * (WIDTH / 2) * (HEIGHT / 2);
+    expect(Math.abs(data[0] - 100)).toBeLessThanOrEqual(4);
+    expect(Math.abs(data[alphaOffset] - 200)).toBeLessThanOrEqual(4);
+    expect(Math.abs(data[data.length - 1] - 200)).toBeLessThanOrEqual(4);
+
+    // Converting to RGBA keeps it
+    const rgba = new Uint8Array(WIDTH * HEIGHT * 4);
+    await image.copyTo(rgba, { format: 'RGBA' });
+    expect(Math.abs(rgba[3] - 200)).toBeLessThanOrEqual(4);
+    image.close();
+  }, 30000);
+
+  it('should ignore an auxiliary image that does not reference the primary item', async () => {
+    if (!available) return;
+    const data = buildAvif(color, alpha);
+    // Point the auxl reference at item 3, which does not exist
+    const auxl = data.findIndex((_, i) =>
+      data[i] === 0x61 && data[i + 1] === 0x75 && data[i + 2] === 0x78 && data[i + 3] === 0x6c);
+    data[auxl + 9] = 3;
+
+    const image = await decodeAvif(data);
+    expect(image.format).toBe('I420');
+    image.close();
+  }, 30000);
+
+  it('should decode a grid of tiles', async () => {
+    if (!available) return;
+    const image = await decodeAvif(buildGridAvif(color, 2, 2, WIDTH * 2 - 8, HEIGHT * 2 - 8));
+    expect(image.codedWidth).toBe(WIDTH * 2 - 8);
+    expect(image.codedHeight).toBe(HEIGHT * 2 - 8);
+    image.close();
+  }, 30000);
+
+  it('should reject a grid whose last row starts outside the image', async () => {
+    if (!available) return;
+    // Two rows of 64-pixel tiles for a 64-pixel-high image
+    const decoder = new ImageDecoder({ data: buildGridAvif(color, 2, 1, WIDTH, HEIGHT), type: 'image/avif' });
+    await expect(decoder.decode()).rejects.toMatchObject({
+      name: 'EncodingError',
+      message: expect.stringContaining('Grid tiles extend past the image'),
+    });
+    decoder.close();
+  }, 30000);
+
+  it('should reject a file without a meta box', async () => {
+    if (!canDecode) return;
+    const data = concat(box('ftyp', ascii('avif'), u32(0), ascii('avif')), box('mdat', new Uint8Array(16)));
+    const decoder = new ImageDecoder({ data, type: 'image/avif' });
+    await expect(decoder.decode()).rejects.toMatchObject({
+      name: 'EncodingError',
+      message: expect.stringContaining('No meta box'),
+    });
+    decoder.close();
+  });
+});
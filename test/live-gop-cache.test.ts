@@ -0,0 +1,139 @@
+/**
+ * Tests for the live GOP cache (non-standard extension)
+ */
+
+import { VideoEncoder, VideoEncoderConfig } from '../src/VideoEncoder';
+import { EncodedVideoChunk } from '../src/EncodedVideoChunk';
+import { VideoDecoder } from '../src/VideoDecoder';
+import { createI420Frame, encoderAvailable, lumaFor, thrownName } from './helpers';
+
+const CONFIG: VideoEncoderConfig = {
+  codec: 'avc1.42001f',
+  width: 64,
+  height: 64,
+  bitrate: 500_000,
+  framerate: 30,
+  latencyMode: 'realtime',
+};
+
+const FRAME_DURATION = 33333;
+
+function bytesOf(chunk: EncodedVideoChunk): number[] {
+  const data = new Uint8Array(chunk.byteLength);
+  chunk.copyTo(data);
+  return Array.from(data);
+}
+
+describe('VideoEncoder live GOP cache', () => {
+  let available = false;
+  let outputs: EncodedVideoChunk[];
+  let encoder: VideoEncoder;
+
+  beforeAll(async () => {
+    available = await encoderAvailable(CONFIG);
+  });
+
+  beforeEach(() => {
+    outputs = [];
+    encoder = new VideoEncoder({
+      output: (chunk) => { outputs.push(chunk); },
+      error: () => {},
+    });
+  });
+
+  afterEach(() => {
+    if (encoder.state !== 'closed') {
+      encoder.close();
+    }
+  });
+
+  async function encode(count: number): Promise<void> {
+    for (let i = 0; i < count; i++) {
+      const frame = createI420Frame(CONFIG.width, CONFIG.height, i * FRAME_DURATION, lumaFor(i));
+      encoder.encode(frame, { keyFrame: i === 0 });
+      frame.close();
+    }
+    await encoder.flush();
+  }
+
+  it('should return null when not configured', () => {
+    expect(encoder.getLiveGop()).toBeNull();
+  });
+
+  it('should return null when the cache is not enabled', async () => {
+    if (!available) return;
+    encoder.configure(CONFIG);
+    await encode(5);
+    expect(encoder.getLiveGop()).toBeNull();
+  }, 30000);
+
+  it('should hold the chunks since the most recent keyframe', async () => {
+    if (!available) return;
+    encoder.configure({ ...CONFIG, liveGopCache: { maxBytes: 1024 * 1024 } });
+    await encode(45);
+
+    // Intra refresh is off with the cache, so keyframes keep coming
+    const keyIndexes = outputs.map((c, i) => (c.type === 'key' ? i : -1)).filter((i) => i >= 0);
+    expect(keyIndexes.length).toBeGreaterThan(1);
+
+    const gop = encoder.getLiveGop();
+    expect(gop).not.toBeNull();
+    const tail = outputs.slice(keyIndexes[keyIndexes.length - 1]);
+    expect(gop!.chunks.map((c) => c.timestamp)).toEqual(tail.map((c) => c.timestamp));
+    expect(gop!.chunks[0].type).toBe('key');
+    expect(gop!.chunks.slice(1).every((c) => c.type === 'delta')).toBe(true);
+    expect(gop!.byteLength).toBe(tail.reduce((sum, c) => sum + c.byteLength, 0));
+    for (let i = 0; i < tail.length; i++) {
+      expect(bytesOf(gop!.chunks[i])).toEqual(bytesOf(tail[i]));
+    }
+  }, 30000);
+
+  it('should give a late joiner a GOP that decodes on its own', async () => {
+    if (!available) return;
+    encoder.configure({ ...CONFIG, liveGopCache: { maxBytes: 1024 * 1024 } });
+    await encode(40);
+    const gop = encoder.getLiveGop()!;
+
+    const timestamps: number[] = [];
+    let failure: Error | null = null;
+    const decoder = new VideoDecoder({
+      output: (frame) => {
+        timestamps.push(frame.timestamp);
+        frame.close();
+      },
+      error: (e) => { failure = e; },
+    });
+    decoder.configure(gop.decoderConfig);
+    for (const chunk of gop.chunks) {
+      decoder.decode(chunk);
+    }
+    await decoder.flush();
+    decoder.close();
+
+    expect(failure).toBeNull();
+    expect(timestamps).toEqual(gop.chunks.map((c) => c.timestamp));
+  }, 30000);
+
+  it('should return null once the GOP outgrows maxBytes', async () => {
+    if (!available) return;
+    encoder.configure({ ...CONFIG, liveGopCache: { maxBytes: 1 } });
+    await encode(5);
+    expect(encoder.getLiveGop()).toBeNull();
+  }, 30000);
+
+  it('should drop the cached GOP on reset()', async () => {
+    if (!available) return;
+    const config = { ...CONFIG, liveGopCache: { maxBytes: 1024 * 1024 } };
+    encoder.configure(config);
+    await encode(5);
+    expect(encoder.getLiveGop()).not.toBeNull();
+
+    encoder.reset();
+    encoder.configure(config);
+    expect(encoder.getLiveGop()).toBeNull();
+  }, 30000);
+
+  it('should reject a non-positive maxBytes', () => {
+    expect(thrownName(() => encoder.configure({ ...CONFIG, liveGopCache: { maxBytes: 0 } }))).toBe('TypeError');
+  });
+});
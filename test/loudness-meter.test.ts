@@ -0,0 +1,176 @@
+/**
+ * Tests for LoudnessMeter and AudioDecoder loudness metering (non-standard
+ * extensions)
+ */
+
+import { LoudnessMeter } from '../src/LoudnessMeter';
+import { AudioData } from '../src/AudioData';
+import { AudioDecoder } from '../src/AudioDecoder';
+import { AudioEncoder, AudioEncoderConfig } from '../src/AudioEncoder';
+import { EncodedAudioChunk } from '../src/EncodedAudioChunk';
+import { createToneAudioData, isCI } from './helpers';
+
+const SAMPLE_RATE = 48000;
+
+/**
+ * Interleaved stereo f32 AudioData holding `seconds` of a sine starting at
+ * sample `offset`, the same signal on both channels
+ */
+function stereoSine(
+  offset: number,
+  seconds: number,
+  frequency: number,
+  amplitude: number,
+  phase: number = 0
+): AudioData {
+  const frames = Math.round(seconds * SAMPLE_RATE);
+  const samples = new Float32Array(frames * 2);
+  for (let i = 0; i < frames; i++) {
+    const v = amplitude * Math.sin((2 * Math.PI * frequency * (offset + i)) / SAMPLE_RATE + phase);
+    samples[i * 2] = v;
+    samples[i * 2 + 1] = v;
+  }
+  return new AudioData({
+    format: 'f32',
+    sampleRate: SAMPLE_RATE,
+    numberOfFrames: frames,
+    numberOfChannels: 2,
+    timestamp: Math.round((offset * 1e6) / SAMPLE_RATE),
+    data: samples,
+  });
+}
+
+function push(meter: LoudnessMeter, data: AudioData): void {
+  meter.push(data);
+  data.close();
+}
+
+describe('LoudnessMeter', () => {
+  it('should read -23 LUFS for a -23 dBFS 1 kHz stereo sine (EBU Tech 3341 case 1)', () => {
+    const meter = new LoudnessMeter({ sampleRate: SAMPLE_RATE, numberOfChannels: 2 });
+    const amplitude = Math.pow(10, -23 / 20);
+    for (let s = 0; s < 20; s++) {
+      push(meter, stereoSine(s * SAMPLE_RATE, 1, 1000, amplitude));
+    }
+
+    const m = meter.measure();
+    expect(m.duration).toBeCloseTo(20, 3);
+    expect(Math.abs(m.integrated + 23)).toBeLessThanOrEqual(0.1);
+    expect(Math.abs(m.momentary + 23)).toBeLessThanOrEqual(0.1);
+    expect(Math.abs(m.shortTerm + 23)).toBeLessThanOrEqual(0.1);
+  });
+
+  it('should report -Infinity until a full window has been measured', () => {
+    const meter = new LoudnessMeter({ sampleRate: SAMPLE_RATE, numberOfChannels: 2 });
+    push(meter, stereoSine(0, 0.3, 1000, 0.5));
+
+    const m = meter.measure();
+    expect(m.momentary).toBe(-Infinity);
+    expect(m.shortTerm).toBe(-Infinity);
+    expect(m.integrated).toBe(-Infinity);
+    expect(Number.isFinite(m.samplePeak)).toBe(true);
+  });
+
+  it('should gate out silence from the integrated loudness', () => {
+    const meter = new LoudnessMeter({ sampleRate: SAMPLE_RATE, numberOfChannels: 2 });
+    const amplitude = Math.pow(10, -23 / 20);
+    for (let s = 0; s < 10; s++) {
+      push(meter, stereoSine(s * SAMPLE_RATE, 1, 1000, amplitude));
+    }
+    // Ten more seconds far below the -70 LUFS absolute gate
+    for (let s = 10; s < 20; s++) {
+      push(meter, stereoSine(s * SAMPLE_RATE, 1, 1000, 1e-6));
+    }
+
+    expect(Math.abs(meter.measure().integrated + 23)).toBeLessThanOrEqual(0.1);
+  });
+
+  it('should find the true peak between samples', () => {
+    // fs/4 at 45 degrees: every sample sits at 0.707 of the waveform peak
+    const meter = new LoudnessMeter({ sampleRate: SAMPLE_RATE, numberOfChannels: 2 });
+    push(meter, stereoSine(0, 1, SAMPLE_RATE / 4, 0.5, Math.PI / 4));
+
+    const m = meter.measure();
+    expect(m.samplePeak).toBeCloseTo(20 * Math.log10(0.5 * Math.SQRT1_2), 1);
+    expect(m.truePeak).toBeGreaterThan(m.samplePeak + 2.5);
+    expect(m.truePeak).toBeLessThan(20 * Math.log10(0.5) + 0.5);
+  });
+
+  it('should start over after reset()', () => {
+    const meter = new LoudnessMeter({ sampleRate: SAMPLE_RATE, numberOfChannels: 2 });
+    push(meter, stereoSine(0, 1, 1000, 0.5));
+    meter.reset();
+
+    const m = meter.measure();
+    expect(m.duration).toBe(0);
+    expect(m.integrated).toBe(-Infinity);
+  });
+
+  it('should reject audio with a different layout', () => {
+    const meter = new LoudnessMeter({ sampleRate: SAMPLE_RATE, numberOfChannels: 2 });
+    const mono = createToneAudioData(0);
+    expect(() => meter.push(mono)).toThrow(/sample rate and channel count/);
+    mono.close();
+  });
+
+  it('should reject an unsupported sample rate', () => {
+    expect(() => new LoudnessMeter({ sampleRate: 1000, numberOfChannels: 2 })).toThrow(/Unsupported sample rate/);
+  });
+});
+
+describe('AudioDecoder loudness', () => {
+  const OPUS: AudioEncoderConfig = {
+    codec: 'opus',
+    sampleRate: SAMPLE_RATE,
+    numberOfChannels: 1,
+    bitrate: 64000,
+  };
+  let available = false;
+
+  beforeAll(async () => {
+    const { supported } = await AudioEncoder.isConfigSupported(OPUS);
+    if (!supported && !isCI) {
+      throw new Error(`Encoder not available: ${OPUS.codec}`);
+    }
+    available = !!supported;
+  });
+
+  it('should meter the decoded output when enabled', async () => {
+    if (!available) return;
+
+    const chunks: EncodedAudioChunk[] = [];
+    const encoder = new AudioEncoder({
+      output: (chunk) => chunks.push(chunk),
+      error: () => {},
+    });
+    encoder.configure(OPUS);
+    // Two seconds of the -6 dBFS 440 Hz tone
+    for (let i = 0; i < 100; i++) {
+      const data = createToneAudioData(i);
+      encoder.encode(data);
+      data.close();
+    }
+    await encoder.flush();
+    encoder.close();
+
+    const decoder = new AudioDecoder({
+      output: (data) => data.close(),
+      error: () => {},
+    });
+    decoder.configure({ codec: 'opus', sampleRate: SAMPLE_RATE, numberOfChannels: 1, loudness: true });
+    expect(decoder.loudness).toBeNull();
+    for (const chunk of chunks) {
+      decoder.decode(chunk);
+    }
+    await decoder.flush();
+    decoder.close();
+
+    const m = decoder.loudness;
+    expect(m).not.toBeNull();
+    expect(m!.duration).toBeGreaterThan(1.5);
+    // A mono -6 dBFS sine is about -9 LUFS; Opus keeps it within a dB or so
+    expect(m!.integrated).toBeGreaterThan(-12);
+    expect(m!.integrated).toBeLessThan(-6);
+    expect(m!.samplePeak).toBeLessThan(0);
+  }, 30000);
+});
@@ -0,0 +1,254 @@
+/**
+ * Tests for pull-mode output draining (non-standard extension)
+ */
+
+import { VideoEncoder, VideoEncoderConfig } from '../src/VideoEncoder';
+import { VideoDecoder } from '../src/VideoDecoder';
+import { EncodedVideoChunk } from '../src/EncodedVideoChunk';
+import { VideoFrame } from '../src/VideoFrame';
+import { createI420Frame, encodeFrames, encoderAvailable, lumaFor, thrownName } from './helpers';
+
+const CONFIG: VideoEncoderConfig = {
+  codec: 'avc1.42001f',
+  width: 64,
+  height: 64,
+  bitrate: 500_000,
+  framerate: 30,
+  latencyMode: 'realtime',
+};
+
+const FRAME_DURATION = 33333;
+
+function encodeSome(encoder: VideoEncoder, count: number, first: number = 0): number[] {
+  const timestamps: number[] = [];
+  for (let i = first; i < first + count; i++) {
+    const frame = createI420Frame(CONFIG.width, CONFIG.height, i * FRAME_DURATION, lumaFor(i));
+    encoder.encode(frame, { keyFrame: i === first });
+    frame.close();
+    timestamps.push(i * FRAME_DURATION);
+  }
+  return timestamps;
+}
+
+describe('pull mode', () => {
+  let available = false;
+
+  beforeAll(async () => {
+    available = await encoderAvailable(CONFIG);
+  });
+
+  describe('VideoEncoder', () => {
+    let outputs: EncodedVideoChunk[];
+    let encoder: VideoEncoder;
+
+    beforeEach(() => {
+      outputs = [];
+      encoder = new VideoEncoder({
+        output: (chunk) => { outputs.push(chunk); },
+        error: () => {},
+      });
+    });
+
+    afterEach(() => {
+      if (encoder.state !== 'closed') {
+        encoder.close();
+      }
+    });
+
+    it('should buffer chunks natively until they are taken', async () => {
+      if (!available) return;
+      encoder.configure({ ...CONFIG, pullMode: { capacity: 32 } });
+      const timestamps = encodeSome(encoder, 10);
+      await encoder.flush();
+
+      expect(outputs).toHaveLength(0);
+      const pulled = encoder.takeOutputs();
+      expect(pulled.map((p) => p.chunk.timestamp)).toEqual(timestamps);
+      expect(pulled[0].chunk.type).toBe('key');
+      expect(pulled[0].metadata?.decoderConfig).toBeDefined();
+      expect(encoder.encodeQueueSize).toBe(0);
+      expect(encoder.takeOutputs()).toHaveLength(0);
+    }, 30000);
+
+    it('should return at most max chunks', async () => {
+      if (!available) return;
+      encoder.configure({ ...CONFIG, pullMode: { capacity: 32 } });
+      encodeSome(encoder, 6);
+      await encoder.flush();
+
+      expect(encoder.takeOutputs(4)).toHaveLength(4);
+      expect(encoder.takeOutputs(4)).toHaveLength(2);
+    }, 30000);
+
+    it('should end the iterator once everything before flush() was read', async () => {
+      if (!available) return;
+      encoder.configure({ ...CONFIG, pullMode: { capacity: 32 } });
+
+      const received: number[] = [];
+      const reading = (async () => {
+        for await (const { chunk } of encoder) {
+          received.push(chunk.timestamp);
+        }
+      })();
+
+      const timestamps = encodeSome(encoder, 10);
+      await encoder.flush();
+      await reading;
+      expect(received).toEqual(timestamps);
+    }, 30000);
+
+    it('should end the iterator on close()', async () => {
+      if (!available) return;
+      encoder.configure({ ...CONFIG, pullMode: { capacity: 32 } });
+
+      const reading = (async () => {
+        let count = 0;
+        for await (const _ of encoder) {
+          count++;
+        }
+        return count;
+      })();
+
+      encoder.close();
+      await expect(reading).resolves.toBe(0);
+    });
+
+    it('should end the iterator on reset()', async () => {
+      if (!available) return;
+      encoder.configure({ ...CONFIG, pullMode: { capacity: 32 } });
+
+      const reading = (async () => {
+        for await (const _ of encoder) {
+          // Nothing was encoded
+        }
+      })();
+
+      encoder.reset();
+      await expect(reading).resolves.toBeUndefined();
+    });
+
+    it('should deliver through the output callback after reconfiguring without pullMode', async () => {
+      if (!available) return;
+      encoder.configure({ ...CONFIG, pullMode: { capacity: 32 } });
+      encodeSome(encoder, 3);
+      await encoder.flush();
+      expect(encoder.takeOutputs()).toHaveLength(3);
+
+      encoder.configure(CONFIG);
+      const timestamps = encodeSome(encoder, 5, 3);
+      await encoder.flush();
+
+      expect(outputs.map((c) => c.timestamp)).toEqual(timestamps);
+      expect(thrownName(() => encoder.takeOutputs())).toBe('InvalidStateError');
+    }, 30000);
+
+    it('should count chunks discarded by a drop policy', async () => {
+      if (!available) return;
+      encoder.configure({ ...CONFIG, pullMode: { capacity: 2, policy: 'drop-newest' } });
+      const timestamps = encodeSome(encoder, 10);
+      await encoder.flush();
+
+      const pulled = encoder.takeOutputs();
+      expect(pulled.map((p) => p.chunk.timestamp)).toEqual(timestamps.slice(0, 2));
+      expect(encoder.droppedOutputs).toBe(8);
+    }, 30000);
+
+    it('should carry stage timings on pulled chunks', async () => {
+      if (!available) return;
+      encoder.configure({ ...CONFIG, pullMode: { capacity: 32 }, stageTimings: true });
+      encodeSome(encoder, 5);
+      await encoder.flush();
+
+      const pulled = encoder.takeOutputs();
+      expect(pulled).toHaveLength(5);
+      for (const { metadata } of pulled) {
+        const timings = metadata?.stageTimings;
+        expect(timings).toBeDefined();
+        expect(timings!.queueUs).toBeGreaterThanOrEqual(0);
+        expect(timings!.convertUs).toBeGreaterThanOrEqual(0);
+        expect(timings!.encodeUs).toBeGreaterThanOrEqual(0);
+        expect(timings!.deliveryUs).toBeGreaterThanOrEqual(0);
+      }
+    }, 30000);
+
+    it('should require the worker-thread encoder', () => {
+      expect(thrownName(() => encoder.configure({
+        ...CONFIG,
+        useWorkerThread: false,
+        pullMode: { capacity: 4 },
+      }))).toBe('NotSupportedError');
+    });
+  });
+
+  describe('VideoDecoder', () => {
+    let chunks: EncodedVideoChunk[];
+
+    beforeAll(async () => {
+      if (!available) return;
+      chunks = (await encodeFrames(CONFIG, 10, FRAME_DURATION)).chunks;
+    }, 30000);
+
+    it('should buffer frames natively until they are taken', async () => {
+      if (!available) return;
+      const outputs: VideoFrame[] = [];
+      const decoder = new VideoDecoder({
+        output: (frame) => { outputs.push(frame); },
+        error: () => {},
+      });
+      decoder.configure({ codec: CONFIG.codec, pullMode: { capacity: 32 } });
+      for (const chunk of chunks) {
+        decoder.decode(chunk);
+      }
+      await decoder.flush();
+
+      expect(outputs).toHaveLength(0);
+      const frames = decoder.takeOutputs();
+      expect(frames.map((f) => f.timestamp)).toEqual(chunks.map((c) => c.timestamp));
+      frames.forEach((f) => f.close());
+      decoder.close();
+    }, 30000);
+
+    it('should end the iterator once everything before flush() was read', async () => {
+      if (!available) return;
+      const decoder = new VideoDecoder({ output: () => {}, error: () => {} });
+      decoder.configure({ codec: CONFIG.codec, pullMode: { capacity: 32 } });
+
+      const received: number[] = [];
+      const reading = (async () => {
+        for await (const frame of decoder) {
+          received.push(frame.timestamp);
+          frame.close();
+        }
+      })();
+
+      for (const chunk of chunks) {
+        decoder.decode(chunk);
+      }
+      await decoder.flush();
+      await reading;
+      expect(received).toEqual(chunks.map((c) => c.timestamp));
+      decoder.close();
+    }, 30000);
+
+    it('should deliver through the output callback after reconfiguring without pullMode', async () => {
+      if (!available) return;
+      const outputs: number[] = [];
+      const decoder = new VideoDecoder({
+        output: (frame) => {
+          outputs.push(frame.timestamp);
+          frame.close();
+        },
+        error: () => {},
+      });
+      decoder.configure({ codec: CONFIG.codec, pullMode: { capacity: 32 } });
+      decoder.configure({ codec: CONFIG.codec });
+      for (const chunk of chunks) {
+        decoder.decode(chunk);
+      }
+      await decoder.flush();
+
+      expect(outputs).toEqual(chunks.map((c) => c.timestamp));
+      decoder.close();
+    }, 30000);
+  });
+});
@@ -0,0 +1,267 @@
+/**
+ * Tests for smartRender (non-standard extension)
+ */
+
+import { native } from '../src/native';
+import { smartRender } from '../src/SmartRender';
+import { VideoEncoderConfig } from '../src/VideoEncoder';
+import { VideoDecoder, VideoDecoderConfig } from '../src/VideoDecoder';
+import { EncodedVideoChunk } from '../src/EncodedVideoChunk';
+import { EncodedStream, encodeFrames, encoderAvailable } from './helpers';
+
+const FRAME_DURATION = 33333;
+
+const CONFIG: VideoEncoderConfig = {
+  codec: 'avc1.42001f',
+  width: 64,
+  height: 64,
+  bitrate: 500_000,
+  framerate: 30,
+  latencyMode: 'quality',
+};
+
+function units(keys: number[], count: number) {
+  return Array.from({ length: count }, (_, i) => ({ timestamp: i * 100, duration: 100, key: keys.includes(i) }));
+}
+
+function bytesOf(chunk: EncodedVideoChunk): number[] {
+  const data = new Uint8Array(chunk.byteLength);
+  chunk.copyTo(data);
+  return Array.from(data);
+}
+
+async function decodeAll(config: VideoDecoderConfig, chunks: EncodedVideoChunk[]): Promise<number[]> {
+  const timestamps: number[] = [];
+  let failure: Error | null = null;
+  const decoder = new VideoDecoder({
+    output: (frame) => {
+      timestamps.push(frame.timestamp);
+      frame.close();
+    },
+    error: (e) => { failure = e; },
+  });
+  decoder.configure(config);
+  for (const chunk of chunks) {
+    decoder.decode(chunk);
+  }
+  await decoder.flush();
+  decoder.close();
+  if (failure) throw failure;
+  return timestamps.sort((a, b) => a - b);
+}
+
+describe('smartRender', () => {
+  describe('plan', () => {
+    it('should copy whole GOPs and re-encode cut ones', () => {
+      const plan = native.SmartRender.plan(units([0, 3, 6], 9), [{ start: 150, end: 750 }]);
+      expect(plan).toEqual([
+        { type: 'reencode', first: 0, count: 3, gops: 1, start: 150, end: 300, shift: -150 },
+        { type: 'copy', first: 3, count: 3, gops: 1, start: 300, end: 600, shift: -150 },
+        { type: 'reencode', first: 6, count: 3, gops: 1, start: 600, end: 750, shift: -150 },
+      ]);
+    });
+
+    it('should merge adjacent copied GOPs of one range', () => {
+      const plan = native.SmartRender.plan(units([0, 3, 6], 9), [{ start: 0, end: 900 }]);
+      expect(plan).toEqual([
+        { type: 'copy', first: 0, count: 9, gops: 3, start: 0, end: 900, shift: 0 },
+      ]);
+    });
+
+    it('should concatenate ranges in the given order', () => {
+      const plan = native.SmartRender.plan(units([0, 3, 6], 9), [
+        { start: 600, end: 900 },
+        { start: 0, end: 300 },
+      ]);
+      expect(plan).toEqual([
+        { type: 'copy', first: 6, count: 3, gops: 1, start: 600, end: 900, shift: -600 },
+        { type: 'copy', first: 0, count: 3, gops: 1, start: 0, end: 300, shift: 300 },
+      ]);
+    });
+
+    it('should fill missing durations from the next presentation time', () => {
+      const input = units([0, 3], 6).map((u) => ({ ...u, duration: 0 }));
+      const plan = native.SmartRender.plan(input, [{ start: 300, end: 600 }]);
+      expect(plan).toEqual([
+        { type: 'copy', first: 3, count: 3, gops: 1, start: 300, end: 600, shift: -300 },
+      ]);
+    });
+
+    it('should decode an open GOP from the previous keyframe', () => {
+      // The second GOP presents frame 4 (t=300) before its keyframe (t=400)
+      const input = [
+        { timestamp: 0, duration: 100, key: true },
+        { timestamp: 200, duration: 100, key: false },
+        { timestamp: 100, duration: 100, key: false },
+        { timestamp: 400, duration: 100, key: true },
+        { timestamp: 300, duration: 100, key: false },
+        { timestamp: 500, duration: 100, key: false },
+      ];
+
+      // Copied after the GOP it references
+      expect(native.SmartRender.plan(input, [{ start: 0, end: 600 }])).toEqual([
+        { type: 'copy', first: 0, count: 6, gops: 2, start: 0, end: 600, shift: 0 },
+      ]);
+      // Alone it needs the previous GOP to decode
+      expect(native.SmartRender.plan(input, [{ start: 300, end: 600 }])).toEqual([
+        { type: 'reencode', first: 0, count: 6, gops: 1, start: 300, end: 600, shift: -300 },
+      ]);
+    });
+
+    it('should skip ranges outside the stream', () => {
+      expect(native.SmartRender.plan(units([0], 3), [{ start: 1000, end: 2000 }])).toEqual([]);
+    });
+
+    it('should reject a stream that does not start with a keyframe', () => {
+      expect(() => native.SmartRender.plan(units([1], 3), [{ start: 0, end: 300 }]))
+        .toThrow('The first chunk must be a keyframe');
+    });
+
+    it('should reject empty ranges', () => {
+      expect(() => native.SmartRender.plan(units([0], 3), [{ start: 200, end: 200 }]))
+        .toThrow('Each range needs start < end');
+    });
+  });
+
+  describe('bitstream helpers', () => {
+    const annexB = new Uint8Array([0, 0, 0, 1, 0x67, 1, 2, 0, 0, 1, 0x68, 3, 0, 0, 1, 0x65, 9, 9]);
+
+    it('should convert Annex B to length-prefixed NAL units', () => {
+      expect(Array.from(native.SmartRender.toLengthPrefixed(annexB, 4))).toEqual([
+        0, 0, 0, 3, 0x67, 1, 2,
+        0, 0, 0, 2, 0x68, 3,
+        0, 0, 0, 3, 0x65, 9, 9,
+      ]);
+      expect(Array.from(native.SmartRender.toLengthPrefixed(annexB, 2))).toEqual([
+        0, 3, 0x67, 1, 2,
+        0, 2, 0x68, 3,
+        0, 3, 0x65, 9, 9,
+      ]);
+    });
+
+    it('should reject unsupported NAL length sizes', () => {
+      expect(() => native.SmartRender.toLengthPrefixed(annexB, 3)).toThrow('nalLengthSize must be 1, 2 or 4');
+    });
+
+    it('should extract the parameter sets of a keyframe', () => {
+      expect(Array.from(native.SmartRender.annexBParameterSets(annexB, 'avc1.42001f'))).toEqual([
+        0, 0, 0, 1, 0x67, 1, 2,
+        0, 0, 0, 1, 0x68, 3,
+      ]);
+      expect(native.SmartRender.annexBParameterSets(new Uint8Array([0, 0, 1, 0x41, 7]), 'avc1.42001f')).toBeNull();
+    });
+
+    it('should parse an avcC record', () => {
+      const avcC = new Uint8Array([
+        1, 0x42, 0xc0, 0x1f, 0xff,
+        0xe1, 0, 3, 0x67, 0x42, 0x1f,
+        1, 0, 2, 0x68, 0xce,
+      ]);
+      const parsed = native.SmartRender.parseDecoderConfig(avcC, 'avc1.42c01f');
+      expect(parsed.codec).toBe('avc1.42c01f');
+      expect(parsed.profile).toBe(0x42);
+      expect(parsed.level).toBe(0x1f);
+      expect(parsed.nalLengthSize).toBe(4);
+      expect(Array.from(parsed.parameterSets)).toEqual([
+        0, 0, 0, 3, 0x67, 0x42, 0x1f,
+        0, 0, 0, 2, 0x68, 0xce,
+      ]);
+
+      expect(native.SmartRender.parseDecoderConfig(avcC.subarray(0, 9), 'avc1.42c01f')).toBeNull();
+      const badVersion = avcC.slice();
+      badVersion[0] = 0;
+      expect(native.SmartRender.parseDecoderConfig(badVersion, 'avc1.42c01f')).toBeNull();
+    });
+  });
+
+  describe('end to end', () => {
+    let available = false;
+    let source: EncodedStream;
+    let sourceConfig: VideoDecoderConfig;
+    let keys: number[];
+
+    beforeAll(async () => {
+      available = await encoderAvailable(CONFIG);
+      if (!available) return;
+      // Keyframes every 30 frames (the GOP length follows the framerate)
+      source = await encodeFrames(CONFIG, 90, FRAME_DURATION);
+      sourceConfig = source.metadata[0]!.decoderConfig!;
+      keys = source.chunks.map((c, i) => (c.type === 'key' ? i : -1)).filter((i) => i >= 0);
+    }, 60000);
+
+    it('should copy GOPs that lie inside the range byte for byte', async () => {
+      if (!available) return;
+      expect(keys.length).toBeGreaterThanOrEqual(3);
+      const start = source.chunks[keys[1]].timestamp;
+      const end = source.chunks[keys[2]].timestamp;
+
+      const result = await smartRender({
+        chunks: source.chunks,
+        decoderConfig: sourceConfig,
+        ranges: [{ start, end }],
+      });
+
+      const gop = source.chunks.slice(keys[1], keys[2]);
+      expect(result.copiedGops).toBe(1);
+      expect(result.reencodedGops).toBe(0);
+      expect(result.copiedFrames).toBe(gop.length);
+      expect(result.decoderConfig).toBe(sourceConfig);
+      expect(result.chunks.map((c) => c.timestamp)).toEqual(gop.map((c) => c.timestamp - start));
+      for (let i = 0; i < gop.length; i++) {
+        expect(bytesOf(result.chunks[i])).toEqual(bytesOf(gop[i]));
+      }
+    }, 60000);
+
+    it('should re-encode the GOPs cut by the range edges', async () => {
+      if (!available) return;
+      const start = source.chunks[keys[1]].timestamp - 5 * FRAME_DURATION;
+      const end = source.chunks[keys[2]].timestamp + 5 * FRAME_DURATION;
+
+      const result = await smartRender({
+        chunks: source.chunks,
+        decoderConfig: sourceConfig,
+        ranges: [{ start, end }],
+      });
+
+      expect(result.copiedGops).toBe(1);
+      expect(result.reencodedGops).toBe(2);
+      expect(result.copiedFrames).toBe(keys[2] - keys[1]);
+      expect(result.reencodedFrames).toBe(10);
+      expect(result.chunks[0].type).toBe('key');
+
+      // Every kept frame decodes, retimed to start at 0
+      const frames = (end - start) / FRAME_DURATION;
+      const timestamps = await decodeAll(result.decoderConfig, result.chunks);
+      expect(timestamps).toEqual(Array.from({ length: frames }, (_, i) => i * FRAME_DURATION));
+    }, 60000);
+
+    it('should move a length-prefixed source to in-band parameter sets', async () => {
+      if (!available) return;
+      const avc = await encodeFrames({ ...CONFIG, avc: { format: 'avc' } }, 60, FRAME_DURATION);
+      const config = avc.metadata[0]!.decoderConfig!;
+      expect(config.description).toBeDefined();
+
+      // Inside the first GOP, so every output chunk comes from the encoder
+      const result = await smartRender({
+        chunks: avc.chunks,
+        decoderConfig: config,
+        ranges: [{ start: 10 * FRAME_DURATION, end: 20 * FRAME_DURATION }],
+      });
+
+      expect(result.reencodedGops).toBe(1);
+      expect(result.reencodedFrames).toBe(10);
+      expect(result.decoderConfig.codec.startsWith('avc3.')).toBe(true);
+      const timestamps = await decodeAll(result.decoderConfig, result.chunks);
+      expect(timestamps).toHaveLength(10);
+    }, 60000);
+
+    it('should report a malformed plan as a DataError', async () => {
+      const chunk = new EncodedVideoChunk({ type: 'delta', timestamp: 0, data: new Uint8Array(4) });
+      await expect(smartRender({
+        chunks: [chunk],
+        decoderConfig: { codec: CONFIG.codec },
+        ranges: [{ start: 0, end: 100 }],
+      })).rejects.toMatchObject({ name: 'DataError' });
+    });
+  });
+});
@@ -0,0 +1,174 @@
+/**
+ * Tests for the codec stream wrappers
+ */
+
+import { Readable, Writable } from 'stream';
+import { finished, pipeline } from 'stream/promises';
+import {
+  createAudioDecoderStream,
+  createAudioEncoderStream,
+  createVideoDecoderStream,
+  createVideoEncoderStream,
+} from '../src/streams';
+import { AudioBatchScheduler } from '../src/AudioBatchScheduler';
+import { AudioEncoder, AudioEncoderConfig } from '../src/AudioEncoder';
+import { AudioData } from '../src/AudioData';
+import { EncodedAudioChunk } from '../src/EncodedAudioChunk';
+import { EncodedVideoChunk } from '../src/EncodedVideoChunk';
+import { VideoEncoderConfig } from '../src/VideoEncoder';
+import { VideoFrame } from '../src/VideoFrame';
+import { createI420Frame, createToneAudioData, encodeFrames, encoderAvailable, isCI, lumaFor } from './helpers';
+
+const VIDEO: VideoEncoderConfig = {
+  codec: 'avc1.42001f',
+  width: 640,
+  height: 360,
+  bitrate: 1_000_000,
+  framerate: 30,
+  latencyMode: 'realtime',
+};
+
+const OPUS: AudioEncoderConfig = {
+  codec: 'opus',
+  sampleRate: 48000,
+  numberOfChannels: 1,
+  bitrate: 32000,
+};
+
+// Collects outputs, closing frames and audio data as they arrive
+function collector<T>(outputs: T[]): Writable {
+  return new Writable({
+    objectMode: true,
+    write(output: T, _encoding, callback) {
+      outputs.push(output);
+      (output as any).close?.();
+      callback();
+    },
+  });
+}
+
+describe('codec streams', () => {
+  describe('video', () => {
+    let available = false;
+    let chunks: EncodedVideoChunk[];
+
+    beforeAll(async () => {
+      available = await encoderAvailable(VIDEO);
+      if (!available) return;
+      // Big enough frames that the decoder cannot keep up with synchronous writes
+      chunks = (await encodeFrames(VIDEO, 30)).chunks;
+    }, 30000);
+
+    it('should hold writes back while the native queue is at highWaterMark', async () => {
+      if (!available) return;
+      const stream = createVideoDecoderStream({ codec: VIDEO.codec }, { highWaterMark: 2 });
+      const timestamps: number[] = [];
+      stream.on('data', (frame: VideoFrame) => {
+        timestamps.push(frame.timestamp);
+        frame.close();
+      });
+
+      for (const chunk of chunks) {
+        stream.write(chunk);
+      }
+      // The reader keeps up, so what is still buffered waits on the decoder
+      expect(stream.writableLength).toBeGreaterThan(0);
+
+      stream.end();
+      await finished(stream);
+      expect(timestamps).toEqual(chunks.map((c) => c.timestamp));
+    }, 30000);
+
+    it('should hold writes back while the readable side is full', async () => {
+      if (!available) return;
+      const stream = createVideoDecoderStream({ codec: VIDEO.codec }, { highWaterMark: 2 });
+      for (const chunk of chunks) {
+        stream.write(chunk);
+      }
+      await new Promise((resolve) => setTimeout(resolve, 200));
+
+      // Nobody reads: decoding stops once the readable side is full
+      expect(stream.readableLength).toBeGreaterThanOrEqual(2);
+      expect(stream.readableLength).toBeLessThan(chunks.length);
+      expect(stream.writableLength).toBeGreaterThan(0);
+
+      const frames: VideoFrame[] = [];
+      stream.end();
+      await pipeline(stream, collector(frames));
+      expect(frames.map((f) => f.timestamp)).toEqual(chunks.map((c) => c.timestamp));
+    }, 30000);
+
+    it('should flush the codec at the end of the stream', async () => {
+      if (!available) return;
+      const frames = Array.from({ length: 10 }, (_, i) =>
+        createI420Frame(VIDEO.width, VIDEO.height, i * 33333, lumaFor(i)));
+      const encoded: EncodedVideoChunk[] = [];
+      const encoder = createVideoEncoderStream(VIDEO);
+      let metadataEvents = 0;
+      encoder.on('metadata', () => { metadataEvents++; });
+
+      // Inputs are closed by the stream once submitted
+      await pipeline(Readable.from(frames), encoder, collector(encoded));
+      expect(encoded.map((c) => c.timestamp)).toEqual(frames.map((f) => f.timestamp));
+      expect(encoded[0].type).toBe('key');
+      expect(metadataEvents).toBeGreaterThan(0);
+
+      const decoded: VideoFrame[] = [];
+      await pipeline(Readable.from(encoded), createVideoDecoderStream({ codec: VIDEO.codec }), collector(decoded));
+      expect(decoded).toHaveLength(encoded.length);
+    }, 30000);
+  });
+
+  describe('audio', () => {
+    let available = false;
+
+    beforeAll(async () => {
+      const { supported } = await AudioEncoder.isConfigSupported(OPUS);
+      if (!supported && !isCI) {
+        throw new Error(`Encoder not available: ${OPUS.codec}`);
+      }
+      available = !!supported;
+    });
+
+    it('should flush encoder and decoder at the end of the stream', async () => {
+      if (!available) return;
+      const encoded: EncodedAudioChunk[] = [];
+      const encoder = createAudioEncoderStream(OPUS);
+      let description: unknown;
+      encoder.on('metadata', (metadata) => { description = metadata.decoderConfig; });
+
+      const inputs = Array.from({ length: 25 }, (_, i) => createToneAudioData(i));
+      await pipeline(Readable.from(inputs), encoder, collector(encoded));
+
+      // The encoder's delay comes out with the flush at the end
+      expect(encoded.length).toBeGreaterThanOrEqual(inputs.length);
+      expect(description).toBeDefined();
+      const timestamps = encoded.map((c) => c.timestamp);
+      expect(timestamps).toEqual([...timestamps].sort((a, b) => a - b));
+
+      const decoded: AudioData[] = [];
+      await pipeline(Readable.from(encoded), createAudioDecoderStream(OPUS), collector(decoded));
+      expect(decoded.length).toBeGreaterThan(0);
+      expect(decoded.every((d) => d.sampleRate === OPUS.sampleRate)).toBe(true);
+    }, 30000);
+
+    it('should pace a scheduler-backed encoder by its queue', async () => {
+      if (!available) return;
+      // Nothing leaves the queue before the first tick
+      const scheduler = new AudioBatchScheduler({ tickMs: 50 });
+      const stream = createAudioEncoderStream({ ...OPUS, scheduler }, { highWaterMark: 2 });
+      const encoded: EncodedAudioChunk[] = [];
+      stream.on('data', (chunk: EncodedAudioChunk) => { encoded.push(chunk); });
+
+      for (let i = 0; i < 10; i++) {
+        stream.write(createToneAudioData(i));
+      }
+      expect(stream.writableLength).toBeGreaterThan(0);
+
+      stream.end();
+      await finished(stream);
+      expect(encoded.length).toBeGreaterThanOrEqual(10);
+      scheduler.close();
+    }, 30000);
+  });
+});
@@ -0,0 +1,124 @@
+/**
+ * Tests for VideoCompositor (non-standard extension)
+ */
+
+import { VideoCompositor } from '../src/VideoCompositor';
+import { VideoFrame } from '../src/VideoFrame';
+import { createI420Frame } from './helpers';
+
+const WIDTH = 64;
+const HEIGHT = 64;
+
+async function lumaPlane(frame: VideoFrame): Promise<Uint8Array> {
+  const data = new Uint8Array(frame.allocationSize({ format: 'I420' }));
+  await frame.copyTo(data, { format: 'I420' });
+  return data.subarray(0, frame.codedWidth * frame.codedHeight);
+}
+
+describe('VideoCompositor', () => {
+  let compositor: VideoCompositor;
+
+  beforeEach(() => {
+    compositor = new VideoCompositor({ width: WIDTH, height: HEIGHT });
+  });
+
+  afterEach(() => {
+    compositor.close();
+  });
+
+  it('should reject a non-positive size', () => {
+    expect(() => new VideoCompositor({ width: 0, height: 64 })).toThrow();
+  });
+
+  it('should fill the canvas with the background color', async () => {
+    const white = new VideoCompositor({ width: WIDTH, height: HEIGHT, background: { r: 255, g: 255, b: 255 } });
+    const out = await white.compose([], 1000, 500);
+    expect(out.format).toBe('I420');
+    expect(out.codedWidth).toBe(WIDTH);
+    expect(out.codedHeight).toBe(HEIGHT);
+    expect(out.timestamp).toBe(1000);
+    expect(out.duration).toBe(500);
+    expect(out.colorSpace.matrix).toBe('bt709');
+
+    const luma = await lumaPlane(out);
+    expect(luma.every((v) => v === 235)).toBe(true);
+    out.close();
+    white.close();
+  });
+
+  it('should scale layers into their rects and stack them by zIndex', async () => {
+    const base = createI420Frame(32, 32, 0, 100);
+    const inset = createI420Frame(16, 16, 0, 200);
+
+    // The inset comes first in the array but is drawn on top
+    const out = await compositor.compose([
+      { frame: inset, x: 32, y: 32, width: 32, height: 32, zIndex: 1 },
+      { frame: base, x: 0, y: 0, width: WIDTH, height: HEIGHT },
+    ], 0);
+    base.close();
+    inset.close();
+
+    const luma = await lumaPlane(out);
+    expect(Math.abs(luma[0] - 100)).toBeLessThanOrEqual(3);
+    expect(Math.abs(luma[31 * WIDTH + 31] - 100)).toBeLessThanOrEqual(3);
+    expect(Math.abs(luma[40 * WIDTH + 40] - 200)).toBeLessThanOrEqual(3);
+    expect(Math.abs(luma[63 * WIDTH + 63] - 200)).toBeLessThanOrEqual(3);
+    out.close();
+  });
+
+  it('should blend a layer with its alpha', async () => {
+    const base = createI420Frame(WIDTH, HEIGHT, 0, 100);
+    const overlay = createI420Frame(WIDTH, HEIGHT, 0, 200);
+
+    const out = await compositor.compose([
+      { frame: base, x: 0, y: 0, width: WIDTH, height: HEIGHT },
+      { frame: overlay, x: 0, y: 0, width: WIDTH, height: HEIGHT, zIndex: 1, alpha: 0.5 },
+    ], 0);
+    base.close();
+    overlay.close();
+
+    const luma = await lumaPlane(out);
+    expect(Math.abs(luma[0] - 150)).toBeLessThanOrEqual(3);
+    out.close();
+  });
+
+  it('should clip layers that extend past the canvas', async () => {
+    const layer = createI420Frame(32, 32, 0, 200);
+    const out = await compositor.compose([
+      { frame: layer, x: -16, y: -16, width: 32, height: 32 },
+    ], 0);
+    layer.close();
+
+    const luma = await lumaPlane(out);
+    expect(Math.abs(luma[0] - 200)).toBeLessThanOrEqual(3);
+    expect(luma[32 * WIDTH + 32]).toBe(16);
+    out.close();
+  });
+
+  it('should resolve composes in call order', async () => {
+    const layer = createI420Frame(32, 32, 0, 120);
+    const pending = [0, 1, 2, 3].map((i) =>
+      compositor.compose([{ frame: layer, x: 0, y: 0, width: WIDTH, height: HEIGHT }], i * 1000)
+    );
+    layer.close();
+
+    const frames = await Promise.all(pending);
+    expect(frames.map((f) => f.timestamp)).toEqual([0, 1000, 2000, 3000]);
+    frames.forEach((f) => f.close());
+  });
+
+  it('should reject a closed layer frame', async () => {
+    const layer = createI420Frame(32, 32, 0);
+    layer.close();
+    await expect(compositor.compose([{ frame: layer, x: 0, y: 0, width: 32, height: 32 }], 0))
+      .rejects.toMatchObject({ name: 'InvalidStateError' });
+  });
+
+  it('should reject compose() after close()', async () => {
+    const layer = createI420Frame(32, 32, 0);
+    compositor.close();
+    await expect(compositor.compose([{ frame: layer, x: 0, y: 0, width: 32, height: 32 }], 0))
+      .rejects.toMatchObject({ name: 'InvalidStateError' });
+    layer.close();
+  });
+});
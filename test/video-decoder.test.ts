@@ -3,8 +3,10 @@
  */
 
 import { VideoDecoder, VideoDecoderConfig } from '../src/VideoDecoder';
-import { VideoFrame } from '../src/VideoFrame';
+import { VideoFrame, VideoFrameAnalysis } from '../src/VideoFrame';
 import { EncodedVideoChunk } from '../src/EncodedVideoChunk';
+import { VideoEncoderConfig } from '../src/VideoEncoder';
+import { EncodedStream, encodeFrames, encoderAvailable, lumaFor, thrownName } from './helpers';
 
 describe('VideoDecoder', () => {
   describe('isConfigSupported', () => {
@@ -120,4 +122,240 @@ describe('VideoDecoder', () => {
       }).toThrow();
     });
   });
+
+  describe('worker-thread decoding', () => {
+    const baseline: VideoEncoderConfig = {
+      codec: 'avc1.42001f',
+      width: 64,
+      height: 64,
+      bitrate: 500_000,
+      framerate: 30,
+      latencyMode: 'realtime',
+    };
+
+    let available = false;
+    let stream: EncodedStream;
+
+    beforeAll(async () => {
+      available = await encoderAvailable(baseline);
+      if (!available) return;
+      stream = await encodeFrames(baseline, 10);
+    }, 30000);
+
+    // Decode every chunk; frames are closed after their timestamps are read
+    async function decodeAll(
+      config: VideoDecoderConfig,
+      chunks: EncodedVideoChunk[],
+      onFrame: (frame: VideoFrame) => void = () => {}
+    ): Promise<{ timestamps: number[]; errors: Error[]; decoder: VideoDecoder }> {
+      const result = { timestamps: [] as number[], errors: [] as Error[], decoder: null as unknown as VideoDecoder };
+      result.decoder = new VideoDecoder({
+        output: (frame) => {
+          result.timestamps.push(frame.timestamp);
+          onFrame(frame);
+          frame.close();
+        },
+        error: (e) => { result.errors.push(e); },
+      });
+      result.decoder.configure(config);
+      for (const chunk of chunks) {
+        result.decoder.decode(chunk);
+      }
+      await result.decoder.flush();
+      return result;
+    }
+
+    it('should output frames in presentation order through B-frame reordering', async () => {
+      if (!available) return;
+      const main: VideoEncoderConfig = { ...baseline, codec: 'avc1.4d001f', latencyMode: 'quality' };
+      const { chunks } = await encodeFrames(main, 20);
+
+      const { timestamps, errors, decoder } = await decodeAll({ codec: main.codec }, chunks);
+      expect(errors).toHaveLength(0);
+      expect(timestamps).toEqual(Array.from({ length: 20 }, (_, i) => i * 33333));
+      decoder.close();
+    }, 30000);
+
+    it('should return the userData of each chunk on the frame it produced', async () => {
+      if (!available) return;
+      const main: VideoEncoderConfig = { ...baseline, codec: 'avc1.4d001f', latencyMode: 'quality' };
+      const { chunks } = await encodeFrames(main, 20);
+
+      for (const useWorkerThread of [true, false]) {
+        const tagged: Array<{ timestamp: number; userData?: number }> = [];
+        const decoder = new VideoDecoder({
+          output: (frame) => {
+            tagged.push({ timestamp: frame.timestamp, userData: frame.metadata().userData });
+            frame.close();
+          },
+          error: () => {},
+        });
+        decoder.configure({ codec: main.codec, useWorkerThread });
+        chunks.forEach((chunk, i) => decoder.decode(chunk, { userData: i }));
+        await decoder.flush();
+        decoder.close();
+
+        // Tags follow the frames through reordering, not the submission order
+        expect(tagged).toHaveLength(chunks.length);
+        for (const { timestamp, userData } of tagged) {
+          expect(chunks[userData!].timestamp).toBe(timestamp);
+        }
+      }
+    }, 30000);
+
+    it('should reject a non-numeric userData', () => {
+      if (!available) return;
+      const decoder = new VideoDecoder({ output: () => {}, error: () => {} });
+      decoder.configure({ codec: baseline.codec });
+      expect(() => decoder.decode(stream.chunks[0], { userData: NaN })).toThrow('userData must be a finite number');
+      decoder.close();
+    });
+
+    it('should hold no chunks back with optimizeForLatency', async () => {
+      if (!available) return;
+      const { timestamps, decoder } = await decodeAll(
+        { codec: baseline.codec, optimizeForLatency: true }, stream.chunks);
+      expect(timestamps).toHaveLength(stream.chunks.length);
+      expect(decoder.decoderDelay).toBe(0);
+      decoder.close();
+    }, 30000);
+
+    it('should deliver renditions next to each frame', async () => {
+      if (!available) return;
+      const renditions: Array<{ index: number; format: string | null; width: number }> = [];
+      const decoder = new VideoDecoder({
+        output: (frame) => frame.close(),
+        error: () => {},
+        rendition: (frame, index) => {
+          renditions.push({ index, format: frame.format, width: frame.codedWidth });
+          frame.close();
+        },
+      });
+      decoder.configure({
+        codec: baseline.codec,
+        renditions: [
+          { format: 'RGBA', width: 32, height: 32 },
+          { every: 2 },
+        ],
+      });
+      for (const chunk of stream.chunks) {
+        decoder.decode(chunk);
+      }
+      await decoder.flush();
+      decoder.close();
+
+      const thumbnails = renditions.filter((r) => r.index === 0);
+      const sampled = renditions.filter((r) => r.index === 1);
+      expect(thumbnails).toHaveLength(10);
+      expect(thumbnails.every((r) => r.format === 'RGBA' && r.width === 32)).toBe(true);
+      expect(sampled).toHaveLength(5);
+      expect(sampled.every((r) => r.format === 'I420' && r.width === 64)).toBe(true);
+    }, 30000);
+
+    it('should drop queued chunks and abort a pending flush on reconfigure', async () => {
+      if (!available) return;
+      // Large enough that the worker cannot have drained the queue by the time configure() runs
+      const { chunks } = await encodeFrames({ ...baseline, width: 640, height: 360 }, 30);
+
+      let decoded = 0;
+      const decoder = new VideoDecoder({
+        output: (frame) => {
+          decoded++;
+          frame.close();
+        },
+        error: () => {},
+      });
+      decoder.configure({ codec: baseline.codec });
+      for (const chunk of chunks) {
+        decoder.decode(chunk);
+      }
+      const flushing = decoder.flush();
+
+      decoder.configure({ codec: baseline.codec });
+      expect(decoder.decodeQueueSize).toBe(0);
+      await expect(flushing).rejects.toMatchObject({ name: 'AbortError' });
+      expect(decoded).toBeLessThan(chunks.length);
+
+      // The new configuration starts from an empty queue
+      decoded = 0;
+      for (const chunk of stream.chunks) {
+        decoder.decode(chunk);
+      }
+      await decoder.flush();
+      // Outputs from before the reconfigure may still be in flight, so only a lower bound holds
+      expect(decoded).toBeGreaterThanOrEqual(stream.chunks.length);
+      decoder.close();
+    }, 30000);
+
+    it('should attach luma statistics with analysis', async () => {
+      if (!available) return;
+      const stats: Array<VideoFrameAnalysis | undefined> = [];
+      const { decoder } = await decodeAll({ codec: baseline.codec, analysis: true }, stream.chunks,
+                                          (frame) => { stats.push(frame.metadata().analysis); });
+      decoder.close();
+
+      expect(stats).toHaveLength(10);
+      expect(stats[0]!.diff).toBeNull();
+      stats.forEach((s, i) => {
+        expect(Math.abs(s!.mean - lumaFor(i))).toBeLessThanOrEqual(4);
+      });
+      expect(stats[1]!.diff).toBeGreaterThan(0);
+    }, 30000);
+
+    describe('limits', () => {
+      it('should reject pictures larger than maxWidth without closing', async () => {
+        if (!available) return;
+        const { timestamps, errors, decoder } = await decodeAll(
+          { codec: baseline.codec, limits: { maxWidth: 32 } }, stream.chunks);
+
+        expect(timestamps).toHaveLength(0);
+        expect(errors.length).toBeGreaterThan(0);
+        expect(errors[0].name).toBe('QuotaExceededError');
+        expect(decoder.state).toBe('configured');
+
+        // Still usable once the limit is lifted
+        decoder.configure({ codec: baseline.codec });
+        for (const chunk of stream.chunks) {
+          decoder.decode(chunk);
+        }
+        await decoder.flush();
+        decoder.close();
+      }, 30000);
+
+      it('should reject chunks over maxChunkBytes', async () => {
+        if (!available) return;
+        const { timestamps, errors, decoder } = await decodeAll(
+          { codec: baseline.codec, limits: { maxChunkBytes: 1 } }, stream.chunks);
+
+        expect(timestamps).toHaveLength(0);
+        expect(errors.length).toBeGreaterThan(0);
+        expect(errors.every((e) => e.name === 'QuotaExceededError')).toBe(true);
+        expect(decoder.state).toBe('configured');
+        decoder.close();
+      }, 30000);
+    });
+
+    describe('intraOnly', () => {
+      it('should decode an intra-only stream', async () => {
+        if (!available) return;
+        const { chunks, metadata } = await encodeFrames({ ...baseline, intraOnly: true }, 6);
+        const config = metadata[0]!.decoderConfig!;
+        expect(config.intraOnly).toBe(true);
+
+        const { timestamps, decoder } = await decodeAll(config, chunks);
+        expect(timestamps).toEqual(chunks.map((c) => c.timestamp));
+        decoder.close();
+      }, 30000);
+
+      it('should reject delta chunks', () => {
+        if (!available) return;
+        const decoder = new VideoDecoder({ output: () => {}, error: () => {} });
+        decoder.configure({ codec: baseline.codec, intraOnly: true });
+        const delta = stream.chunks.find((c) => c.type === 'delta')!;
+        expect(thrownName(() => decoder.decode(delta))).toBe('DataError');
+        expect(decoder.state).toBe('configured');
+        decoder.close();
+      });
+    });
+  });
 });
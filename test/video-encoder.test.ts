@@ -2,13 +2,21 @@
  * Tests for VideoEncoder
  */
 
-import { VideoEncoder, VideoEncoderConfig } from '../src/VideoEncoder';
+import {
+  VideoEncoder,
+  VideoEncoderConfig,
+  VideoEncoderEncodeOptions,
+  VideoEncoderOutputMetadata,
+} from '../src/VideoEncoder';
 import { VideoFrame } from '../src/VideoFrame';
 import { EncodedVideoChunk } from '../src/EncodedVideoChunk';
+import { createI420Frame, encoderAvailable, lumaFor, thrownName } from './helpers';
 
 // CI environments may not have hardware encoders available
 const isCI = process.env.CI === 'true';
 
+const FRAME_DURATION = 33333;
+
 describe('VideoEncoder', () => {
   describe('isConfigSupported', () => {
     it('should support H.264 baseline profile', async () => {
@@ -137,4 +145,299 @@ describe('VideoEncoder', () => {
       }).toThrow();
     });
   });
+
+  describe('worker-thread encoding', () => {
+    const config: VideoEncoderConfig = {
+      codec: 'avc1.42001f',
+      width: 64,
+      height: 64,
+      bitrate: 500_000,
+      framerate: 30,
+      latencyMode: 'realtime',
+    };
+
+    let available = false;
+    let outputs: Array<{ chunk: EncodedVideoChunk; metadata?: VideoEncoderOutputMetadata }>;
+    let encoder: VideoEncoder;
+
+    beforeAll(async () => {
+      available = await encoderAvailable(config);
+    });
+
+    beforeEach(() => {
+      outputs = [];
+      encoder = new VideoEncoder({
+        output: (chunk, metadata) => { outputs.push({ chunk, metadata }); },
+        error: () => {},
+      });
+    });
+
+    afterEach(() => {
+      if (encoder.state !== 'closed') {
+        encoder.close();
+      }
+    });
+
+    let configured: VideoEncoderConfig = config;
+    function configure(c: VideoEncoderConfig): void {
+      encoder.configure(c);
+      configured = c;
+    }
+
+    // Frames of the configured size from timestamp `start`, keyframe first
+    function encodeSome(
+      count: number,
+      frameDuration: number = FRAME_DURATION,
+      options: (i: number) => VideoEncoderEncodeOptions = () => ({}),
+      start: number = 0
+    ): number[] {
+      const timestamps: number[] = [];
+      for (let i = 0; i < count; i++) {
+        const timestamp = start + i * frameDuration;
+        const frame = createI420Frame(configured.width, configured.height, timestamp, lumaFor(i));
+        encoder.encode(frame, { keyFrame: i === 0, ...options(i) });
+        frame.close();
+        timestamps.push(timestamp);
+      }
+      return timestamps;
+    }
+
+    it('should deliver every chunk in order through the job ring', async () => {
+      if (!available) return;
+      configure(config);
+      let dequeues = 0;
+      encoder.addEventListener('dequeue', () => { dequeues++; });
+
+      const timestamps = encodeSome(300);
+      await encoder.flush();
+
+      expect(outputs.map((o) => o.chunk.timestamp)).toEqual(timestamps);
+      expect(encoder.encodeQueueSize).toBe(0);
+      expect(dequeues).toBeGreaterThan(0);
+    }, 60000);
+
+    it('should encode at the new size after reconfiguring', async () => {
+      if (!available) return;
+      configure(config);
+      encodeSome(5);
+      await encoder.flush();
+
+      configure({ ...config, width: 128, height: 96 });
+      const timestamps = encodeSome(5);
+      await encoder.flush();
+
+      const after = outputs.slice(5);
+      expect(after.map((o) => o.chunk.timestamp)).toEqual(timestamps);
+      expect(after[0].chunk.type).toBe('key');
+      expect(after[0].metadata?.decoderConfig?.codedWidth).toBe(128);
+      expect(after[0].metadata?.decoderConfig?.codedHeight).toBe(96);
+    }, 30000);
+
+    it('should drop queued frames and abort a pending flush on reconfigure', async () => {
+      if (!available) return;
+      const large = { ...config, width: 640, height: 360 };
+      configure(large);
+      // Created up front so the encode() calls run back to back, faster than the worker
+      const frames = Array.from({ length: 30 }, (_, i) =>
+        createI420Frame(large.width, large.height, i * FRAME_DURATION, lumaFor(i)));
+      frames.forEach((frame, i) => {
+        encoder.encode(frame, { keyFrame: i === 0 });
+        frame.close();
+      });
+      const flushing = encoder.flush();
+
+      configure(config);
+      expect(encoder.encodeQueueSize).toBe(0);
+      await expect(flushing).rejects.toMatchObject({ name: 'AbortError' });
+      expect(outputs.length).toBeLessThan(frames.length);
+    }, 30000);
+
+    for (const latencyMode of ['realtime', 'quality'] as const) {
+      it(`should apply ROI quality offsets with latencyMode ${latencyMode}`, async () => {
+        if (!available) return;
+        // Textured frames, so the quantizer decides the size
+        function encodeTextured(start: number, options: VideoEncoderEncodeOptions): void {
+          for (let i = 0; i < 10; i++) {
+            const data = new Uint8Array(config.width * config.height * 3 / 2).fill(128);
+            for (let p = 0; p < config.width * config.height; p++) {
+              data[p] = (p * 37 + i * 11 + ((p * p) >> 5)) & 0xff;
+            }
+            const frame = new VideoFrame(data, {
+              format: 'I420',
+              codedWidth: config.width,
+              codedHeight: config.height,
+              timestamp: start + i * FRAME_DURATION,
+            });
+            encoder.encode(frame, { keyFrame: i === 0, ...options });
+            frame.close();
+          }
+        }
+        const bytes = (from: number) => outputs
+          .filter((o) => o.chunk.timestamp >= from && o.chunk.timestamp < from + 1_000_000)
+          .reduce((sum, o) => sum + o.chunk.byteLength, 0);
+
+        configure({ ...config, latencyMode });
+        encodeTextured(0, {});
+        await encoder.flush();
+        configure({ ...config, latencyMode });
+        encodeTextured(1_000_000, {
+          roi: [{ x: 0, y: 0, width: config.width, height: config.height, qualityOffset: -1 }],
+        });
+        await encoder.flush();
+
+        expect(bytes(1_000_000)).toBeLessThan(bytes(0));
+      }, 30000);
+    }
+
+    it('should report stage timings, also after reset and reconfigure', async () => {
+      if (!available) return;
+      configure({ ...config, stageTimings: true });
+      encodeSome(5);
+      encoder.reset();
+
+      // Chunks encoded before the reset may still arrive; count the later ones
+      configure({ ...config, stageTimings: true });
+      const timestamps = encodeSome(5, FRAME_DURATION, () => ({}), 1_000_000);
+      await encoder.flush();
+
+      const after = outputs.filter((o) => o.chunk.timestamp >= 1_000_000);
+      expect(after.map((o) => o.chunk.timestamp)).toEqual(timestamps);
+      for (const { metadata } of after) {
+        const timings = metadata?.stageTimings;
+        expect(timings).toBeDefined();
+        expect(timings!.queueUs).toBeGreaterThanOrEqual(0);
+        expect(timings!.convertUs).toBeGreaterThanOrEqual(0);
+        expect(timings!.encodeUs).toBeGreaterThanOrEqual(0);
+        expect(timings!.deliveryUs).toBeGreaterThanOrEqual(0);
+      }
+    }, 30000);
+
+    it('should encode with every contentHint', async () => {
+      if (!available) return;
+      let start = 0;
+      for (const contentHint of ['motion', 'detail', 'text'] as const) {
+        for (const latencyMode of ['realtime', 'quality'] as const) {
+          configure({ ...config, contentHint, latencyMode });
+          const timestamps = encodeSome(5, FRAME_DURATION, () => ({}), start);
+          await encoder.flush();
+          const produced = outputs.filter((o) => o.chunk.timestamp >= start);
+          expect(produced.map((o) => o.chunk.timestamp)).toEqual(timestamps);
+          start += 1_000_000;
+        }
+      }
+    }, 60000);
+
+    it('should reject an unknown contentHint', () => {
+      expect(thrownName(() => encoder.configure({ ...config, contentHint: 'slides' as any }))).toBe('TypeError');
+    });
+
+    it('should make every chunk a keyframe when intraOnly', async () => {
+      if (!available) return;
+      configure({ ...config, intraOnly: true });
+      encodeSome(8);
+      await encoder.flush();
+
+      expect(outputs).toHaveLength(8);
+      expect(outputs.every((o) => o.chunk.type === 'key')).toBe(true);
+      expect(outputs[0].metadata?.decoderConfig?.intraOnly).toBe(true);
+    }, 30000);
+
+    it('should encode with the per-frame quantizer', async () => {
+      if (!available) return;
+      configure({ ...config, bitrateMode: 'quantizer' });
+      encodeSome(6, FRAME_DURATION, (i) => ({ avc: { quantizer: i < 3 ? 20 : 40 } }));
+      await encoder.flush();
+
+      expect(outputs).toHaveLength(6);
+      // Keyframes get the I-frame offset; delta frames use the quantizer as given
+      outputs.forEach(({ chunk, metadata }, i) => {
+        expect(metadata?.qp).toBeDefined();
+        if (chunk.type === 'delta') {
+          expect(Math.abs(metadata!.qp! - (i < 3 ? 20 : 40))).toBeLessThanOrEqual(1);
+        }
+      });
+    }, 30000);
+
+    it('should reject an out-of-range quantizer', () => {
+      if (!available) return;
+      configure({ ...config, bitrateMode: 'quantizer' });
+      const frame = createI420Frame(config.width, config.height, 0);
+      expect(thrownName(() => encoder.encode(frame, { avc: { quantizer: 52 } }))).toBe('TypeError');
+      frame.close();
+    });
+
+    it('should go back to the default QP for frames without a quantizer', async () => {
+      if (!available) return;
+      configure({ ...config, bitrateMode: 'quantizer' });
+      encodeSome(6, FRAME_DURATION, (i) => (i < 3 ? { avc: { quantizer: 40 } } : {}));
+      await encoder.flush();
+
+      expect(outputs).toHaveLength(6);
+      outputs.slice(3).forEach(({ chunk, metadata }) => {
+        if (chunk.type === 'delta') {
+          expect(Math.abs(metadata!.qp! - 23)).toBeLessThanOrEqual(1);
+        }
+      });
+    }, 30000);
+
+    it('should reject a VP9 quantizer as not supported', async () => {
+      const vp9: VideoEncoderConfig = { ...config, codec: 'vp09.00.10.08', bitrateMode: 'quantizer' };
+      if (!(await encoderAvailable(vp9))) return;
+      configure(vp9);
+      const frame = createI420Frame(config.width, config.height, 0);
+      expect(thrownName(() => encoder.encode(frame, { vp9: { quantizer: 30 } }))).toBe('NotSupportedError');
+      frame.close();
+    });
+
+    describe('frameRateConversion', () => {
+      it('should keep one frame per output interval with drop', async () => {
+        if (!available) return;
+        // 30 fps in, 10 fps out
+        configure({ ...config, framerate: 10, frameRateConversion: 'drop' });
+        encodeSome(30);
+        await encoder.flush();
+
+        expect(outputs.map((o) => o.chunk.timestamp)).toEqual(
+          Array.from({ length: 10 }, (_, k) => k * 100000));
+        expect(encoder.encodeQueueSize).toBe(0);
+      }, 30000);
+
+      it('should emit the last blended group on flush', async () => {
+        if (!available) return;
+        configure({ ...config, framerate: 10, frameRateConversion: 'blend' });
+        encodeSome(30);
+        await encoder.flush();
+
+        expect(outputs.map((o) => o.chunk.timestamp)).toEqual(
+          Array.from({ length: 10 }, (_, k) => k * 100000));
+      }, 30000);
+
+      it('should repeat frames to fill a higher output rate', async () => {
+        if (!available) return;
+        // 15 fps in, 30 fps out: every input frame is followed by a repeat except the last
+        configure({ ...config, framerate: 30, frameRateConversion: 'drop' });
+        encodeSome(10, 66667);
+        await encoder.flush();
+
+        expect(outputs.map((o) => o.chunk.timestamp)).toEqual(
+          Array.from({ length: 19 }, (_, k) => Math.round((k * 1e6) / 30)));
+      }, 30000);
+
+      it('should require a framerate', () => {
+        expect(thrownName(() => encoder.configure({
+          ...config,
+          framerate: undefined,
+          frameRateConversion: 'drop',
+        }))).toBe('TypeError');
+      });
+
+      it('should require the worker-thread encoder', () => {
+        expect(thrownName(() => encoder.configure({
+          ...config,
+          useWorkerThread: false,
+          frameRateConversion: 'drop',
+        }))).toBe('NotSupportedError');
+      });
+    });
+  });
 });
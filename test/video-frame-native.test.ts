@@ -0,0 +1,398 @@
+/**
+ * Tests for native VideoFrame processing (non-standard extensions) and the
+ * lifetime of frames produced by decoders
+ */
+
+import { VideoFrame } from '../src/VideoFrame';
+import { VideoDecoder } from '../src/VideoDecoder';
+import { VideoEncoderConfig } from '../src/VideoEncoder';
+import { ColorLUT } from '../src/ColorLUT';
+import { createI420Frame, encodeFrames, encoderAvailable, lumaFor, thrownName, topLeftLuma } from './helpers';
+
+const CONFIG: VideoEncoderConfig = {
+  codec: 'avc1.42001f',
+  width: 64,
+  height: 64,
+  bitrate: 1_000_000,
+  framerate: 30,
+  latencyMode: 'realtime',
+};
+
+// .cube lattice with R varying fastest
+function cube(map: (r: number, g: number, b: number) => [number, number, number]): string {
+  const lines = ['TITLE "test"', 'LUT_3D_SIZE 2'];
+  for (let b = 0; b < 2; b++) {
+    for (let g = 0; g < 2; g++) {
+      for (let r = 0; r < 2; r++) {
+        lines.push(map(r, g, b).join(' '));
+      }
+    }
+  }
+  return lines.join('\n');
+}
+
+function rgbaFrame(width: number, height: number, r: number, g: number, b: number): VideoFrame {
+  const data = new Uint8Array(width * height * 4);
+  for (let i = 0; i < data.length; i += 4) {
+    data[i] = r;
+    data[i + 1] = g;
+    data[i + 2] = b;
+    data[i + 3] = 255;
+  }
+  return new VideoFrame(data, { format: 'RGBA', codedWidth: width, codedHeight: height, timestamp: 0 });
+}
+
+async function firstPixel(frame: VideoFrame, format: 'RGBA' | 'BGRA'): Promise<number[]> {
+  const data = new Uint8Array(frame.codedWidth * frame.codedHeight * 4);
+  await frame.copyTo(data, { format });
+  return Array.from(data.subarray(0, 4));
+}
+
+describe('VideoFrame native processing', () => {
+  describe('decoded frames', () => {
+    let available = false;
+
+    beforeAll(async () => {
+      available = await encoderAvailable(CONFIG);
+    });
+
+    it('should keep every open frame intact while others are closed', async () => {
+      if (!available) return;
+      const { chunks } = await encodeFrames(CONFIG, 12);
+
+      // Closing every other frame as it arrives frees native wrappers while
+      // later frames are created; the kept frames must keep their own pixels
+      const kept: VideoFrame[] = [];
+      const decoder = new VideoDecoder({
+        output: (frame) => {
+          if (Math.round(frame.timestamp / 33333) % 2 === 0) {
+            kept.push(frame);
+          } else {
+            frame.close();
+            frame.close();  // A second close is a no-op
+          }
+        },
+        error: () => {},
+      });
+      decoder.configure({ codec: CONFIG.codec });
+      for (const chunk of chunks) {
+        decoder.decode(chunk);
+      }
+      await decoder.flush();
+      decoder.close();
+
+      expect(kept).toHaveLength(6);
+      for (const frame of kept) {
+        const index = Math.round(frame.timestamp / 33333);
+        expect(frame.format).toBe('I420');
+        expect(Math.abs((await topLeftLuma(frame)) - lumaFor(index))).toBeLessThanOrEqual(4);
+        frame.close();
+      }
+    }, 30000);
+
+    it('should keep a clone usable after the decoded frame is closed', async () => {
+      if (!available) return;
+      const { chunks } = await encodeFrames(CONFIG, 1);
+
+      let clone: VideoFrame | null = null;
+      const decoder = new VideoDecoder({
+        output: (frame) => {
+          clone = frame.clone();
+          frame.close();
+          expect(thrownName(() => frame.metadata())).toBe('InvalidStateError');
+        },
+        error: () => {},
+      });
+      decoder.configure({ codec: CONFIG.codec });
+      decoder.decode(chunks[0]);
+      await decoder.flush();
+      decoder.close();
+
+      expect(clone).not.toBeNull();
+      const frame = clone! as VideoFrame;
+      expect(Math.abs((await topLeftLuma(frame)) - lumaFor(0))).toBeLessThanOrEqual(4);
+      frame.close();
+    }, 30000);
+
+    it('should report the same format and color space for every decoded frame', async () => {
+      if (!available) return;
+      const { chunks } = await encodeFrames(CONFIG, 4);
+
+      const frames: VideoFrame[] = [];
+      const decoder = new VideoDecoder({
+        output: (frame) => frames.push(frame),
+        error: () => {},
+      });
+      decoder.configure({ codec: CONFIG.codec });
+      for (const chunk of chunks) {
+        decoder.decode(chunk);
+      }
+      await decoder.flush();
+      decoder.close();
+
+      expect(frames).toHaveLength(4);
+      for (const frame of frames) {
+        expect(frame.format).toBe(frames[0].format);
+        expect(frame.colorSpace.toJSON()).toEqual(frames[0].colorSpace.toJSON());
+        frame.close();
+      }
+    }, 30000);
+  });
+
+  describe('transform', () => {
+    it('should rotate the pixels clockwise', async () => {
+      // 64x32, left half dark and right half bright
+      const width = 64;
+      const height = 32;
+      const data = new Uint8Array(width * height * 1.5).fill(128);
+      for (let y = 0; y < height; y++) {
+        data.fill(50, y * width, y * width + width / 2);
+        data.fill(200, y * width + width / 2, (y + 1) * width);
+      }
+      const frame = new VideoFrame(data, { format: 'I420', codedWidth: width, codedHeight: height, timestamp: 0 });
+
+      const rotated = frame.transform({ rotation: 90 });
+      expect(rotated.codedWidth).toBe(height);
+      expect(rotated.codedHeight).toBe(width);
+      expect(rotated.rotation).toBe(0);
+
+      // The left half is now the top half
+      const out = new Uint8Array(rotated.allocationSize());
+      await rotated.copyTo(out);
+      expect(out[0]).toBe(50);
+      expect(out[(width - 1) * height]).toBe(200);
+
+      rotated.close();
+      frame.close();
+    });
+
+    it('should apply the frame orientation without options', () => {
+      const frame = new VideoFrame(new Uint8Array(64 * 32 * 1.5), {
+        format: 'I420',
+        codedWidth: 64,
+        codedHeight: 32,
+        timestamp: 0,
+        rotation: 270,
+      });
+      const upright = frame.transform();
+      expect(upright.codedWidth).toBe(32);
+      expect(upright.codedHeight).toBe(64);
+      upright.close();
+      frame.close();
+    });
+
+    it('should move every luma pixel for each orientation', async () => {
+      // Not a multiple of the 8x8 blocks or 32x32 tiles, so edges are covered
+      const width = 42;
+      const height = 26;
+      const data = new Uint8Array(width * height * 1.5).fill(128);
+      for (let i = 0; i < width * height; i++) {
+        data[i] = (i * 7) & 0xff;
+      }
+      const frame = new VideoFrame(data, { format: 'I420', codedWidth: width, codedHeight: height, timestamp: 0 });
+
+      for (const rotation of [90, 270] as const) {
+        for (const flip of [false, true]) {
+          const turned = frame.transform({ rotation, flip });
+          const out = new Uint8Array(turned.allocationSize());
+          await turned.copyTo(out);
+          // Destination is height x width; undo the flip, then the rotation
+          for (let y = 0; y < width; y++) {
+            for (let x = 0; x < height; x++) {
+              const col = flip ? height - 1 - x : x;
+              const sx = rotation === 90 ? y : width - 1 - y;
+              const sy = rotation === 90 ? height - 1 - col : col;
+              expect(out[y * height + x]).toBe(data[sy * width + sx]);
+            }
+          }
+          turned.close();
+        }
+      }
+      frame.close();
+    });
+  });
+
+  describe('applyLUT', () => {
+    it('should leave pixels unchanged with an identity LUT', async () => {
+      const lut = ColorLUT.fromCube(cube((r, g, b) => [r, g, b]));
+      expect(lut.size).toBe(2);
+      expect(lut.title).toBe('test');
+
+      const frame = rgbaFrame(32, 32, 100, 150, 200);
+      const graded = frame.applyLUT(lut);
+      const [r, g, b] = await firstPixel(graded, 'RGBA');
+      expect(Math.abs(r - 100)).toBeLessThanOrEqual(1);
+      expect(Math.abs(g - 150)).toBeLessThanOrEqual(1);
+      expect(Math.abs(b - 200)).toBeLessThanOrEqual(1);
+      graded.close();
+      frame.close();
+    });
+
+    it('should interpolate between lattice points', async () => {
+      const lut = ColorLUT.fromCube(cube((r, g, b) => [1 - r, 1 - g, 1 - b]));
+      const frame = rgbaFrame(32, 32, 100, 150, 200);
+      const graded = frame.applyLUT(lut);
+      expect(graded.format).toBe('RGBA');
+      const [r, g, b] = await firstPixel(graded, 'RGBA');
+      expect(Math.abs(r - 155)).toBeLessThanOrEqual(2);
+      expect(Math.abs(g - 105)).toBeLessThanOrEqual(2);
+      expect(Math.abs(b - 55)).toBeLessThanOrEqual(2);
+      graded.close();
+      frame.close();
+    });
+
+    it('should reject malformed .cube text', () => {
+      expect(thrownName(() => ColorLUT.fromCube('LUT_3D_SIZE 2\n0 0 0\n'))).toBe('DataError');
+    });
+
+    it('should clamp LUT outputs outside the unit range', async () => {
+      const lut = ColorLUT.fromCube(cube(() => [2, -1, 0.5]));
+      const frame = rgbaFrame(32, 32, 10, 120, 240);
+      const graded = frame.applyLUT(lut);
+      const [r, g, b] = await firstPixel(graded, 'RGBA');
+      expect(r).toBe(255);
+      expect(g).toBe(0);
+      expect(Math.abs(b - 128)).toBeLessThanOrEqual(1);
+      graded.close();
+      frame.close();
+    });
+  });
+
+  describe('analyze', () => {
+    it('should report black frames and zero difference for a repeat', () => {
+      const frame = createI420Frame(64, 64, 0, 16);
+      const repeat = createI420Frame(64, 64, 33333, 16);
+
+      const stats = frame.analyze();
+      expect(stats.samples).toBeGreaterThan(0);
+      expect(stats.histogram[16]).toBe(stats.samples);
+      expect(stats.mean).toBeCloseTo(16, 5);
+      expect(stats.blackRatio).toBe(1);
+      expect(stats.diff).toBeNull();
+
+      expect(repeat.analyze({ previous: frame }).diff).toBe(0);
+      frame.close();
+      repeat.close();
+    });
+
+    it('should score the change from the previous frame', () => {
+      const dark = createI420Frame(64, 64, 0, 40);
+      const bright = createI420Frame(64, 64, 33333, 140);
+      const stats = bright.analyze({ previous: dark, subsample: 1 });
+      expect(stats.diff).toBeCloseTo(100, 0);
+      expect(stats.blackRatio).toBe(0);
+      dark.close();
+      bright.close();
+    });
+
+    it('should match a direct computation on a row that is not a multiple of 16', () => {
+      // 40 samples per row: two 16-sample blocks and an 8-sample tail
+      const width = 40;
+      const height = 8;
+      const luma = (i: number, shift: number) => (i * 37 + shift) & 0xff;
+      const make = (shift: number, timestamp: number) => {
+        const data = new Uint8Array(width * height * 1.5).fill(128);
+        for (let i = 0; i < width * height; i++) {
+          data[i] = luma(i, shift);
+        }
+        return new VideoFrame(data, { format: 'I420', codedWidth: width, codedHeight: height, timestamp });
+      };
+      const previous = make(0, 0);
+      const frame = make(90, 33333);
+
+      let sum = 0;
+      let squares = 0;
+      let black = 0;
+      let diff = 0;
+      for (let i = 0; i < width * height; i++) {
+        const v = luma(i, 90);
+        sum += v;
+        squares += v * v;
+        black += v <= 16 ? 1 : 0;
+        diff += Math.abs(v - luma(i, 0));
+      }
+      const n = width * height;
+
+      const stats = frame.analyze({ previous, subsample: 1, blackThreshold: 0 });
+      expect(stats.samples).toBe(n);
+      expect(stats.mean).toBeCloseTo(sum / n, 6);
+      expect(stats.variance).toBeCloseTo(squares / n - (sum / n) ** 2, 4);
+      expect(stats.blackRatio).toBeCloseTo(black / n, 6);
+      expect(stats.diff).toBeCloseTo(diff / n, 6);
+      previous.close();
+      frame.close();
+    });
+  });
+
+  describe('copyTo', () => {
+    it('should convert with the frame matrix instead of BT.601', async () => {
+      // Y=126 V=168 is a reddish gray whose green differs by ~11 between matrices
+      const data = new Uint8Array(32 * 32 * 1.5);
+      data.fill(126, 0, 32 * 32);
+      data.fill(128, 32 * 32, 32 * 32 * 1.25);
+      data.fill(168, 32 * 32 * 1.25);
+      const tagged = new VideoFrame(data, {
+        format: 'I420',
+        codedWidth: 32,
+        codedHeight: 32,
+        timestamp: 0,
+        colorSpace: { primaries: 'bt709', transfer: 'bt709', matrix: 'bt709', fullRange: false },
+      });
+
+      const [r, g, b] = await firstPixel(tagged, 'RGBA');
+      expect(Math.abs(r - 200)).toBeLessThanOrEqual(3);
+      expect(Math.abs(g - 107)).toBeLessThanOrEqual(3);
+      expect(Math.abs(b - 128)).toBeLessThanOrEqual(3);
+      tagged.close();
+    });
+
+    it('should give the same pixels when the target format alternates', async () => {
+      const frame = rgbaFrame(32, 32, 10, 120, 240);
+      const rgba = await firstPixel(frame, 'RGBA');
+      const bgra = await firstPixel(frame, 'BGRA');
+      const again = await firstPixel(frame, 'RGBA');
+
+      expect(rgba.slice(0, 3)).toEqual([10, 120, 240]);
+      expect(bgra.slice(0, 3)).toEqual([240, 120, 10]);
+      expect(again).toEqual(rgba);
+      frame.close();
+    });
+
+    it('should leave SDR frames unchanged when tone mapping', async () => {
+      const frame = createI420Frame(32, 32, 0, 180, 100, 150);
+      const plain = new Uint8Array(32 * 32 * 4);
+      const mapped = new Uint8Array(32 * 32 * 4);
+      await frame.copyTo(plain, { format: 'RGBA' });
+      await frame.copyTo(mapped, { format: 'RGBA', toneMapping: 'hable' });
+      expect(mapped).toEqual(plain);
+      frame.close();
+    });
+
+    it('should tone map PQ frames into SDR range and keep grays neutral', async () => {
+      // Y=180 limited range is ~1000 cd/m2 in PQ, around the default peak
+      const data = new Uint8Array(32 * 32 * 1.5);
+      data.fill(180, 0, 32 * 32);
+      data.fill(128, 32 * 32);
+      const pq = new VideoFrame(data, {
+        format: 'I420',
+        codedWidth: 32,
+        codedHeight: 32,
+        timestamp: 0,
+        colorSpace: { primaries: 'bt2020', transfer: 'pq', matrix: 'bt2020-ncl', fullRange: false },
+      });
+
+      const plain = await firstPixel(pq, 'RGBA');
+      for (const curve of ['hable', 'bt2390'] as const) {
+        const mapped = new Uint8Array(32 * 32 * 4);
+        await pq.copyTo(mapped, { format: 'RGBA', toneMapping: curve });
+        const [r, g, b] = Array.from(mapped.subarray(0, 3));
+        expect(Math.abs(r - g)).toBeLessThanOrEqual(2);
+        expect(Math.abs(g - b)).toBeLessThanOrEqual(2);
+        expect(r).toBeGreaterThan(plain[0]);
+        // Every pixel of a flat frame maps the same way
+        expect(mapped.subarray(mapped.length - 4, mapped.length - 1)).toEqual(mapped.subarray(0, 3));
+      }
+      pq.close();
+    });
+  });
+});